@@ -5,6 +5,7 @@
 #include "calibrator.h"
 #include "cuda_utils.h"
 #include "utils.h"
+#include "image_decode.h"
 
 Int8EntropyCalibrator2::Int8EntropyCalibrator2(int batchsize, int input_w, int input_h, const char* img_dir, const char* calib_table_name, const char* input_blob_name, bool read_cache)
     : batchsize_(batchsize)
@@ -40,7 +41,8 @@ bool Int8EntropyCalibrator2::getBatch(void* bindings[], const char* names[], int
     std::vector<cv::Mat> input_imgs_;
     for (int i = img_idx_; i < img_idx_ + batchsize_; i++) {
         std::cout << img_files_[i] << "  " << i << std::endl;
-        cv::Mat temp = cv::imread(img_dir_ + img_files_[i]);
+        // 大JPEG按DCT缩放解码到刚好覆盖input_w x input_h的尺寸, 之后的letterbox与原来相同
+        cv::Mat temp = imread_for_input(img_dir_ + img_files_[i], input_w_, input_h_);
         if (temp.empty()){
             std::cerr << "Fatal error: image cannot open!" << std::endl;
             return false;
@@ -0,0 +1,188 @@
+// 离线精度/速度评估, 只用CPU: COCO标注 + ./yolov5 -e记录的检测文件(每个engine/精度/模型一个)
+// 对每个文件按CONF_THRESH x NMS_THRESH的组合重新做NMS(与yolov5-p6.cpp相同的nms/xywh2xyxy/scale_coords), 计算COCO mAP(coco_eval.h),
+// 并给出记录的推理耗时和本机的NMS耗时; -b给定精度要求(mAP@.5:.95)时选出满足要求且最快的组合, 否则选mAP最高的, 打印其逐类AP
+// ./coco_eval instances_val2017.json fp16.dets int8.dets [-c 0.45,0.5,0.6] [-n 0.45,0.5,0.6] [-b 0.35]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "postprocess.h"
+#include "letterbox.h"
+#include "detection_file.h"
+#include "coco_eval.h"
+
+struct SweepRow {
+    std::string file;
+    float conf, nms;
+    EvalSummary eval;
+    double infer_ms, infer_p99_ms, nms_ms;
+    double cost_ms() const { return infer_ms + nms_ms; }
+};
+
+static std::vector<float> parse_list(const char* arg) {
+    std::vector<float> values;
+    std::stringstream ss(arg);
+    std::string item;
+    while (std::getline(ss, item, ',')) values.push_back((float)atof(item.c_str()));
+    return values;
+}
+
+static std::string base_name(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+static double percentile(std::vector<float> values, double q) {
+    if (values.empty()) return 0;
+    size_t k = std::min(values.size() - 1, (size_t)(q * values.size()));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+// 一个检测文件在所有阈值组合下的评估结果追加到rows
+static bool sweep_file(const std::string& path, const CocoGroundTruth& gt, const std::vector<float>& confs, const std::vector<float>& nmses, ThreadPool& pool, std::vector<SweepRow>& rows) {
+    std::vector<DetectionRecord> records;
+    bool gpu_nms = false;
+    std::string engine;
+    if (!read_detection_file(path, records, gpu_nms, engine)) return false;
+
+    // 只评估检测文件中出现的图片
+    std::vector<int> images;
+    std::vector<DetectionRecord*> matched;
+    std::vector<float> infer_ms;
+    int overflow = 0;
+    for (DetectionRecord& r : records) {
+        auto it = gt.image_index.find(base_name(r.name));
+        if (it == gt.image_index.end()) continue;
+        images.push_back(it->second);
+        matched.push_back(&r);
+        infer_ms.push_back(r.infer_ms);
+        if (r.candidates > (int)r.output[0]) overflow++;
+    }
+    std::cout << path << " (" << engine << ", " << (gpu_nms ? "NMS in engine" : "host NMS") << "): " << matched.size() << " of " << records.size()
+              << " images annotated";
+    if (overflow) std::cout << ", " << overflow << " images exceeded MAX_OUTPUT_BBOX_COUNT";
+    std::cout << std::endl;
+    if (matched.empty()) return false;
+    // 网络类别序号k对应第k个category, engine的类别数必须与标注一致: 多出的类别无法评估, nms也要按同样的类别数分派
+    const int num_classes = (int)gt.category_ids.size();
+    const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+    for (const DetectionRecord* r : matched) {
+        for (int i = 0; i < (int)r->output[0]; i++) {
+            int cls = (int)r->output[1 + i * det_size + 5];
+            if (cls < 0 || cls >= num_classes) {
+                std::cerr << path << ": class " << cls << " in " << r->name << ", but the annotations have " << num_classes << " categories" << std::endl;
+                return false;
+            }
+        }
+    }
+    double mean_ms = 0;
+    for (float ms : infer_ms) mean_ms += ms;
+    mean_ms /= infer_ms.size();
+    const double p99_ms = percentile(infer_ms, 0.99);
+
+    std::vector<std::vector<EvalDetection>> dets(matched.size());
+    char line[512];
+    snprintf(line, sizeof(line), "%-24s %5s %5s %7s %7s %7s %6s %6s %9s %9s %8s\n", "file", "conf", "nms", "mAP", "AP50", "AP75", "P50", "R50", "infer ms", "p99 ms", "nms ms");
+    std::cout << line;
+    for (float conf : confs) {
+        for (float nms_thresh : nmses) {
+            std::atomic<long long> nms_ns(0);
+            pool.parallel_for((int)matched.size(), [&](int i) {
+                DetectionRecord& r = *matched[i];
+                std::vector<Yolo::Detection> res;
+                auto start = std::chrono::high_resolution_clock::now();
+                nms(res, r.output.data(), conf, nms_thresh, num_classes);
+                nms_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count();
+                xywh2xyxy(res);
+                scale_coords(res, r.img_w, r.img_h, r.lb);
+                dets[i].clear();
+                for (const auto& det : res) {
+                    dets[i].push_back(EvalDetection{ { det.bbox[0], det.bbox[1], det.bbox[2], det.bbox[3] }, det.conf, (int)det.class_id });
+                }
+            });
+            SweepRow row;
+            row.file = path;
+            row.conf = conf;
+            row.nms = nms_thresh;
+            row.eval = evaluate_coco(gt, images, dets, pool);
+            row.infer_ms = mean_ms;
+            row.infer_p99_ms = p99_ms;
+            row.nms_ms = nms_ns.load() / 1e6 / matched.size();
+            rows.push_back(row);
+
+            snprintf(line, sizeof(line), "%-24s %5.2f %5.2f %7.4f %7.4f %7.4f %6.3f %6.3f %9.3f %9.3f %8.4f\n", base_name(path).c_str(), conf, nms_thresh,
+                     row.eval.map, row.eval.map50, row.eval.map75, row.eval.precision50, row.eval.recall50, row.infer_ms, row.infer_p99_ms, row.nms_ms);
+            std::cout << line;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::string ann_path;
+    std::vector<std::string> files;
+    std::vector<float> confs = { Yolo::IGNORE_THRESH, 0.5f, 0.6f };
+    std::vector<float> nmses = { 0.45f, 0.5f, 0.6f };
+    float bar = -1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if ((arg == "-c" || arg == "-n" || arg == "-b") && i + 1 < argc) {
+            if (arg == "-c") confs = parse_list(argv[++i]);
+            else if (arg == "-n") nmses = parse_list(argv[++i]);
+            else bar = (float)atof(argv[++i]);
+        } else if (ann_path.empty()) {
+            ann_path = arg;
+        } else {
+            files.push_back(arg);
+        }
+    }
+    if (ann_path.empty() || files.empty() || confs.empty() || nmses.empty()) {
+        std::cerr << "arguments not right!" << std::endl;
+        std::cerr << "./coco_eval [instances.json] [.dets ...] [-c conf,...] [-n nms,...] [-b min mAP]  // files recorded by ./yolov5 -e" << std::endl;
+        return -1;
+    }
+    for (float conf : confs) {
+        if (conf < Yolo::IGNORE_THRESH) {
+            std::cout << "note: boxes below IGNORE_THRESH(" << Yolo::IGNORE_THRESH << ") are not in the engine output, conf " << conf << " acts as " << Yolo::IGNORE_THRESH << std::endl;
+        }
+    }
+
+    CocoGroundTruth gt;
+    if (!load_coco_annotations(ann_path, gt)) return -1;
+    ThreadPool pool;
+    std::vector<SweepRow> rows;
+    for (const std::string& f : files) sweep_file(f, gt, confs, nmses, pool, rows);
+    if (rows.empty()) return -1;
+
+    // 满足精度要求的最快组合(推理 + NMS的平均耗时), 没有要求时取mAP最高的
+    const SweepRow* pick = nullptr;
+    for (const SweepRow& row : rows) {
+        if (bar >= 0) {
+            if (row.eval.map >= bar && (!pick || row.cost_ms() < pick->cost_ms())) pick = &row;
+        } else if (!pick || row.eval.map > pick->eval.map) {
+            pick = &row;
+        }
+    }
+    if (!pick) {
+        std::cout << "no configuration reaches mAP " << bar << std::endl;
+        return 1;
+    }
+    std::cout << (bar >= 0 ? "cheapest with mAP >= " + std::to_string(bar) : std::string("best mAP")) << ": " << pick->file << " conf " << pick->conf
+              << " nms " << pick->nms << ", mAP " << pick->eval.map << ", " << pick->cost_ms() << " ms/image" << std::endl;
+    char line[512];
+    snprintf(line, sizeof(line), "%4s %-20s %7s %7s %7s %7s %7s\n", "id", "class", "gt", "dets", "AP", "AP50", "AP75");
+    std::cout << line;
+    for (size_t c = 0; c < pick->eval.classes.size(); c++) {
+        const ClassAP& r = pick->eval.classes[c];
+        if (r.gt == 0) continue;
+        snprintf(line, sizeof(line), "%4d %-20s %7d %7d %7.4f %7.4f %7.4f\n", (int)c, gt.category_names[c].c_str(), r.gt, r.dets, r.ap, r.ap50, r.ap75);
+        std::cout << line;
+    }
+    return 0;
+}
@@ -0,0 +1,289 @@
+#ifndef TRTX_YOLOV5_COCO_EVAL_H_
+#define TRTX_YOLOV5_COCO_EVAL_H_
+
+// COCO风格的bbox精度评估, 与pycocotools的COCOeval(iouType="bbox")一致:
+//   IoU阈值0.50:0.05:0.95, 每张图每类按分数取前100个检测, 101点插值的AP, 面积范围只算all
+//   iscrowd的标注不计漏检, 匹配到它的检测(IoU = 交集 / 检测框面积)既不算TP也不算FP
+// 网络的类别序号k对应标注文件中第k小的category id(COCO 80类即yolov5的coco80_to_91)
+// 各类别相互独立, 在ThreadPool上按类别并行
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "json_reader.h"
+#include "thread_pool.h"
+
+struct CocoBox {
+    float x1, y1, x2, y2;
+};
+
+struct CocoGtBox {
+    CocoBox box;
+    int cls;    // 网络类别序号
+    bool crowd;
+};
+
+struct CocoGroundTruth {
+    std::vector<int> image_ids;
+    std::vector<std::string> file_names;
+    std::vector<std::vector<CocoGtBox>> boxes;   // 与image_ids对应
+    std::vector<int> category_ids;               // 升序, 下标即网络类别序号
+    std::vector<std::string> category_names;
+    std::map<std::string, int> image_index;      // 文件名 -> 下标
+};
+
+// 读取instances_*.json中的images/annotations/categories, 其余字段跳过
+static inline bool load_coco_annotations(const std::string& path, CocoGroundTruth& gt) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "can not open " << path << std::endl;
+        return false;
+    }
+    std::stringstream buf;
+    buf << file.rdbuf();
+    const std::string text = buf.str();
+    JsonReader json(text);
+
+    struct RawAnnotation {
+        int image_id, category_id;
+        float x, y, w, h;
+        bool crowd;
+    };
+    std::vector<RawAnnotation> anns;
+    std::map<int, std::string> categories;
+    std::string key, field, s;
+    double v;
+    json.begin_object();
+    while (json.next_key(key)) {
+        if (key == "images" && json.begin_array()) {
+            while (json.next_element() && json.begin_object()) {
+                int id = -1;
+                std::string name;
+                while (json.next_key(field)) {
+                    if (field == "id" && json.read_number(v)) id = (int)v;
+                    else if (field == "file_name") json.read_string(name);
+                    else json.skip();
+                }
+                gt.image_ids.push_back(id);
+                gt.file_names.push_back(name);
+            }
+        } else if (key == "annotations" && json.begin_array()) {
+            while (json.next_element() && json.begin_object()) {
+                RawAnnotation a = { -1, -1, 0, 0, 0, 0, false };
+                while (json.next_key(field)) {
+                    if (field == "image_id" && json.read_number(v)) a.image_id = (int)v;
+                    else if (field == "category_id" && json.read_number(v)) a.category_id = (int)v;
+                    else if (field == "iscrowd" && json.read_number(v)) a.crowd = v != 0;
+                    else if (field == "bbox" && json.begin_array()) {
+                        float* xywh[4] = { &a.x, &a.y, &a.w, &a.h };
+                        for (int i = 0; json.next_element(); i++) {
+                            if (json.read_number(v) && i < 4) *xywh[i] = (float)v;
+                        }
+                    } else json.skip();
+                }
+                anns.push_back(a);
+            }
+        } else if (key == "categories" && json.begin_array()) {
+            while (json.next_element() && json.begin_object()) {
+                int id = -1;
+                std::string name;
+                while (json.next_key(field)) {
+                    if (field == "id" && json.read_number(v)) id = (int)v;
+                    else if (field == "name") json.read_string(name);
+                    else json.skip();
+                }
+                categories[id] = name;
+            }
+        } else {
+            json.skip();
+        }
+    }
+    if (!json.ok()) {
+        std::cerr << path << ": invalid JSON" << std::endl;
+        return false;
+    }
+
+    std::map<int, int> image_slot, category_slot;
+    for (size_t i = 0; i < gt.image_ids.size(); i++) {
+        image_slot[gt.image_ids[i]] = (int)i;
+        gt.image_index[gt.file_names[i]] = (int)i;
+    }
+    for (const auto& c : categories) {
+        category_slot[c.first] = (int)gt.category_ids.size();
+        gt.category_ids.push_back(c.first);
+        gt.category_names.push_back(c.second);
+    }
+    gt.boxes.assign(gt.image_ids.size(), std::vector<CocoGtBox>());
+    for (const RawAnnotation& a : anns) {
+        auto img = image_slot.find(a.image_id);
+        auto cat = category_slot.find(a.category_id);
+        if (img == image_slot.end() || cat == category_slot.end()) continue;
+        CocoGtBox g = { { a.x, a.y, a.x + a.w, a.y + a.h }, cat->second, a.crowd };
+        gt.boxes[img->second].push_back(g);
+    }
+    std::cout << path << ": " << gt.image_ids.size() << " images, " << anns.size() << " annotations, " << gt.category_ids.size() << " categories" << std::endl;
+    return true;
+}
+
+struct EvalDetection {
+    CocoBox box;  // 原图坐标
+    float score;
+    int cls;
+};
+
+struct ClassAP {
+    double ap = -1, ap50 = -1, ap75 = -1; // 没有标注的类别为-1, 不参与平均
+    int gt = 0;
+    int dets = 0;
+};
+
+struct EvalSummary {
+    double map = 0, map50 = 0, map75 = 0;
+    double precision50 = 0, recall50 = 0; // IoU 0.5下全部检测的精确率/召回率(工作点的指标)
+    std::vector<ClassAP> classes;
+};
+
+static inline float coco_iou(const CocoBox& d, const CocoBox& g, bool crowd) {
+    float iw = std::min(d.x2, g.x2) - std::max(d.x1, g.x1);
+    float ih = std::min(d.y2, g.y2) - std::max(d.y1, g.y1);
+    if (iw <= 0 || ih <= 0) return 0;
+    float inter = iw * ih;
+    float area_d = (d.x2 - d.x1) * (d.y2 - d.y1);
+    float uni = crowd ? area_d : area_d + (g.x2 - g.x1) * (g.y2 - g.y1) - inter;
+    return uni > 0 ? inter / uni : 0;
+}
+
+// images为参与评估的gt图片下标, dets[i]为images[i]上的检测
+static inline EvalSummary evaluate_coco(const CocoGroundTruth& gt, const std::vector<int>& images, const std::vector<std::vector<EvalDetection>>& dets, ThreadPool& pool) {
+    static const int NUM_IOU = 10;
+    static const int MAX_DETS = 100;
+    const int num_classes = (int)gt.category_ids.size();
+    // 与pycocotools一样按image id顺序拼接各图的检测, 分数相同时的先后与之一致
+    std::vector<int> order(images.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return gt.image_ids[images[a]] < gt.image_ids[images[b]]; });
+
+    EvalSummary summary;
+    summary.classes.resize(num_classes);
+    std::vector<int> tp50(num_classes, 0), counted(num_classes, 0);
+
+    pool.parallel_for(num_classes, [&](int c) {
+        struct Entry {
+            float score;
+            int tp, ignore; // 按IoU阈值的位掩码
+        };
+        std::vector<Entry> entries;
+        std::vector<const CocoGtBox*> g;
+        std::vector<const EvalDetection*> d;
+        std::vector<char> matched;
+        int npig = 0;
+        for (int slot : order) {
+            g.clear();
+            d.clear();
+            for (const CocoGtBox& box : gt.boxes[images[slot]]) {
+                if (box.cls == c && !box.crowd) g.push_back(&box);
+            }
+            npig += (int)g.size();
+            for (const CocoGtBox& box : gt.boxes[images[slot]]) { // crowd排在后面
+                if (box.cls == c && box.crowd) g.push_back(&box);
+            }
+            for (const EvalDetection& det : dets[slot]) {
+                if (det.cls == c) d.push_back(&det);
+            }
+            if (d.empty()) continue;
+            std::stable_sort(d.begin(), d.end(), [](const EvalDetection* a, const EvalDetection* b) { return a->score > b->score; });
+            if ((int)d.size() > MAX_DETS) d.resize(MAX_DETS);
+
+            std::vector<Entry> img_entries(d.size(), Entry{ 0, 0, 0 });
+            for (int t = 0; t < NUM_IOU; t++) {
+                const float thresh = 0.5f + 0.05f * t;
+                matched.assign(g.size(), 0);
+                for (size_t k = 0; k < d.size(); k++) {
+                    float best_iou = std::min(thresh, 1 - 1e-10f);
+                    int best = -1;
+                    for (size_t j = 0; j < g.size(); j++) {
+                        if (matched[j] && !g[j]->crowd) continue;
+                        // 已匹配到普通标注时不再考虑crowd
+                        if (best > -1 && !g[best]->crowd && g[j]->crowd) break;
+                        float iou = coco_iou(d[k]->box, g[j]->box, g[j]->crowd);
+                        if (iou < best_iou) continue;
+                        best_iou = iou;
+                        best = (int)j;
+                    }
+                    if (best < 0) continue;
+                    matched[best] = 1;
+                    if (g[best]->crowd) img_entries[k].ignore |= 1 << t;
+                    else img_entries[k].tp |= 1 << t;
+                }
+            }
+            for (size_t k = 0; k < d.size(); k++) img_entries[k].score = d[k]->score;
+            entries.insert(entries.end(), img_entries.begin(), img_entries.end());
+        }
+
+        ClassAP& result = summary.classes[c];
+        result.gt = npig;
+        result.dets = (int)entries.size();
+        if (npig == 0) return;
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.score > b.score; });
+        const size_t nd = entries.size();
+        std::vector<double> recall(nd), precision(nd);
+        double ap_sum = 0;
+        for (int t = 0; t < NUM_IOU; t++) {
+            double tp = 0, fp = 0;
+            for (size_t k = 0; k < nd; k++) {
+                if (!(entries[k].ignore >> t & 1)) {
+                    if (entries[k].tp >> t & 1) tp++;
+                    else fp++;
+                }
+                recall[k] = tp / npig;
+                precision[k] = tp / (tp + fp + 2.2204e-16);
+            }
+            if (t == 0) {
+                tp50[c] = (int)tp;
+                counted[c] = (int)(tp + fp);
+            }
+            // precision从后往前取最大值(包络), 再在101个召回率点上取值
+            for (size_t k = nd; k-- > 1;) precision[k - 1] = std::max(precision[k - 1], precision[k]);
+            double q_sum = 0;
+            size_t k = 0;
+            for (int r = 0; r <= 100; r++) {
+                const double rc = r / 100.0;
+                while (k < nd && recall[k] < rc) k++;
+                if (k < nd) q_sum += precision[k];
+            }
+            const double ap = q_sum / 101;
+            ap_sum += ap;
+            if (t == 0) result.ap50 = ap;
+            if (t == 5) result.ap75 = ap;
+        }
+        result.ap = ap_sum / NUM_IOU;
+    });
+
+    int valid = 0;
+    long long total_tp = 0, total_dets = 0, total_gt = 0;
+    for (int c = 0; c < num_classes; c++) {
+        const ClassAP& r = summary.classes[c];
+        if (r.gt == 0) continue;
+        valid++;
+        summary.map += r.ap;
+        summary.map50 += r.ap50;
+        summary.map75 += r.ap75;
+        total_tp += tp50[c];
+        total_dets += counted[c];
+        total_gt += r.gt;
+    }
+    if (valid > 0) {
+        summary.map /= valid;
+        summary.map50 /= valid;
+        summary.map75 /= valid;
+    }
+    summary.precision50 = total_dets ? (double)total_tp / total_dets : 0;
+    summary.recall50 = total_gt ? (double)total_tp / total_gt : 0;
+    return summary;
+}
+
+#endif  // TRTX_YOLOV5_COCO_EVAL_H_
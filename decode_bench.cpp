@@ -0,0 +1,145 @@
+// host端decode和nms的耗时(只用CPU, 不需要GPU/TensorRT)
+//   decode: decode_host<float>(与YoloLayer kernel相同的代码)
+//   nms:    nms(按类别分桶, 连续数组上算IoU) vs nms_generic(std::map + erase)
+// 类别数为CLASS_NUM(6)和COCO的80
+// decode的输入为P6四个head(stride 8/16/32/64)的随机logit, 约cands个anchor超过IGNORE_THRESH
+// nms的输入为cands个候选框, 每个目标周围抖动出若干个重叠的框
+// nms先校验两者的结果相同, 再报告每次调用的微秒数
+// ./decode_bench [候选框数, 默认50,300,1000] [重复次数]
+
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "yolo_decode.h"
+#include "postprocess.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct DecodeInput {
+    std::vector<std::vector<float>> heads;
+    Yolo::DecodeParams p;
+};
+
+// 所有logit为-8(sigmoid后远低于IGNORE_THRESH), 随机选cands个anchor把objectness设为+4并给一个随机类别
+static DecodeInput make_decode_input(int classes, int cands, std::mt19937& rng) {
+    static const int strides[] = { 8, 16, 32, 64 };
+    DecodeInput in;
+    memset(&in.p, 0, sizeof(in.p));
+    in.p.num_heads = 4;
+    in.p.batch = 1;
+    in.p.classes = classes;
+    in.p.net_width = Yolo::INPUT_W;
+    in.p.net_height = Yolo::INPUT_H;
+    in.p.max_out = Yolo::MAX_OUTPUT_BBOX_COUNT;
+    in.p.output_elem = 1 + Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) / sizeof(float);
+    in.p.layout = Yolo::kLayoutLinear;
+    const int info_len = 5 + classes;
+    int offset = 0;
+    for (int h = 0; h < 4; h++) {
+        Yolo::DecodeHead& head = in.p.heads[h];
+        head.width = Yolo::INPUT_W / strides[h];
+        head.height = Yolo::INPUT_H / strides[h];
+        head.cell_offset = offset;
+        for (int a = 0; a < Yolo::CHECK_COUNT * 2; a++) head.anchors[a] = (float)strides[h] * (1 + a % 3);
+        offset += head.width * head.height;
+        in.heads.emplace_back((size_t)info_len * Yolo::CHECK_COUNT * head.width * head.height, -8.f);
+    }
+    in.p.cells_per_image = offset;
+    std::uniform_int_distribution<int> pick_cell(0, offset - 1), pick_anchor(0, Yolo::CHECK_COUNT - 1), pick_class(0, classes - 1);
+    std::uniform_real_distribution<float> logit(-2.f, 2.f);
+    for (int i = 0; i < cands; i++) {
+        int local = pick_cell(rng), h = 0;
+        while (h + 1 < 4 && local >= in.p.heads[h + 1].cell_offset) h++;
+        int cell = local - in.p.heads[h].cell_offset, grid = in.p.heads[h].width * in.p.heads[h].height;
+        int c0 = pick_anchor(rng) * info_len;
+        std::vector<float>& data = in.heads[h];
+        for (int c = 0; c < 4; c++) data[(size_t)(c0 + c) * grid + cell] = logit(rng);
+        data[(size_t)(c0 + 4) * grid + cell] = 4.f;
+        data[(size_t)(c0 + 5 + pick_class(rng)) * grid + cell] = 4.f;
+    }
+    for (int h = 0; h < 4; h++) in.p.inputs[h] = in.heads[h].data();
+    return in;
+}
+
+// cands个候选框: 每个目标(cands / 8个)周围8个抖动的框, conf和类别随机
+static std::vector<float> make_nms_input(int classes, int cands, std::mt19937& rng) {
+    const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+    std::vector<float> out(1 + Yolo::MAX_OUTPUT_BBOX_COUNT * det_size, 0.f);
+    std::uniform_real_distribution<float> x(32.f, Yolo::INPUT_W - 32.f), y(32.f, Yolo::INPUT_H - 32.f), size(16.f, 96.f), jitter(-4.f, 4.f), conf(0.3f, 1.f);
+    std::uniform_int_distribution<int> pick_class(0, classes - 1);
+    int n = std::min(cands, Yolo::MAX_OUTPUT_BBOX_COUNT);
+    Yolo::Detection* dets = reinterpret_cast<Yolo::Detection*>(&out[1]);
+    Yolo::Detection object;
+    for (int i = 0; i < n; i++) {
+        if (i % 8 == 0) {
+            object.bbox[0] = x(rng);
+            object.bbox[1] = y(rng);
+            object.bbox[2] = size(rng);
+            object.bbox[3] = size(rng);
+            object.class_id = (float)pick_class(rng);
+        }
+        dets[i] = object;
+        for (int k = 0; k < 4; k++) dets[i].bbox[k] += jitter(rng);
+        dets[i].conf = conf(rng);
+    }
+    out[0] = (float)n;
+    return out;
+}
+
+template <class F>
+static double time_us(int reps, F f) {
+    auto start = Clock::now();
+    for (int r = 0; r < reps; r++) f();
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / reps;
+}
+
+static bool same_detections(const std::vector<Yolo::Detection>& a, const std::vector<Yolo::Detection>& b) {
+    return a.size() == b.size() && (a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(Yolo::Detection)) == 0);
+}
+
+static const int COCO_CLASSES = 80;
+
+static bool bench_classes(int classes, int cands, int reps, std::mt19937& rng) {
+    DecodeInput in = make_decode_input(classes, cands, rng);
+    std::vector<float> decoded(in.p.output_elem);
+    double decode_us = time_us(reps, [&] { Yolo::decode_host<float>(in.p, decoded.data()); });
+
+    std::vector<float> output = make_nms_input(classes, cands, rng);
+    std::vector<Yolo::Detection> a, b;
+    nms(a, output.data(), 0.4f, 0.5f, classes);
+    nms_generic(b, output.data(), 0.4f, 0.5f);
+    if (!same_detections(a, b)) {
+        std::cerr << "nms differs from nms_generic (" << classes << " classes)" << std::endl;
+        return false;
+    }
+    double nms_us = time_us(reps, [&] { a.clear(); nms(a, output.data(), 0.4f, 0.5f, classes); });
+    double generic_us = time_us(reps, [&] { b.clear(); nms_generic(b, output.data(), 0.4f, 0.5f); });
+
+    std::cout << classes << " classes, " << cands << " candidates (" << (int)decoded[0] << " decoded, " << a.size() << " kept)" << std::endl;
+    std::cout << "  decode_host: " << decode_us << " us" << std::endl;
+    std::cout << "  nms: " << nms_us << " us, nms_generic: " << generic_us << " us, x" << generic_us / nms_us << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> cands;
+    std::stringstream ss(argc > 1 ? argv[1] : "50,300,1000");
+    std::string item;
+    while (std::getline(ss, item, ',')) cands.push_back(atoi(item.c_str()));
+    int reps = argc > 2 ? atoi(argv[2]) : 200;
+    if (cands.empty() || reps <= 0) {
+        std::cerr << "./decode_bench [candidates, e.g. 50,300,1000] [repetitions]" << std::endl;
+        return -1;
+    }
+    std::mt19937 rng(0);
+    for (int n : cands) {
+        if (!bench_classes(Yolo::CLASS_NUM, n, reps, rng)) return 1;
+        if (!bench_classes(COCO_CLASSES, n, reps, rng)) return 1;
+    }
+    return 0;
+}
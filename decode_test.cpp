@@ -0,0 +1,349 @@
+// YoloLayer解码的启动配置和下标映射(yolo_decode.h)的测试, 只用CPU
+//   - decode_geometry: 线程数不超过上限, blocks x threads覆盖batch中所有cell, 最后一个block之外没有整块空闲的block
+//   - locate_cell: 每个线程下标对应唯一的(batch, head, cell), 反过来每个(batch, head, cell)只对应一个线程下标, 超出范围的下标返回false
+//   - decode_host: 与按head逐个格子、逐个anchor的直接实现(逐类sigmoid后取最大)比较, 输出的框和顺序相同; 输出溢出时只写前max_out个
+// 覆盖奇数尺寸的grid、3个和4个head、batch 1/3/16、类别数6/80/3
+//   - FP16输入: 同一组head按kLINEAR float、kLINEAR half、kCHW2 half、kHWC8 half打包后decode_host<half_bits>,
+//     打包按TensorRT的格式定义独立实现(不用channel_offset); 通道数33/255/27(5 + 类别数6/80/4, 再乘3)不是2或8的倍数,
+//     补齐的通道填入会改变结果的值. 数据先按half取整时各布局与float完全相同; 不取整时与float的差在half精度内
+// ./decode_test, 失败时返回非0
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "yolo_decode.h"
+#include "test_check.h"
+
+static const int DET_SIZE = sizeof(Yolo::Detection) / sizeof(float);
+static const int COCO_CLASSES = 80;
+
+struct HeadSize {
+    int width, height;
+};
+
+struct DecodeInput {
+    std::vector<std::vector<float>> heads;  // kLINEAR, batch x channels x height x width
+    Yolo::DecodeParams p;
+};
+
+static DecodeInput make_input(const std::vector<HeadSize>& sizes, int batch, int classes, int max_out, std::mt19937& rng) {
+    DecodeInput in;
+    memset(&in.p, 0, sizeof(in.p));
+    in.p.num_heads = (int)sizes.size();
+    in.p.batch = batch;
+    in.p.classes = classes;
+    in.p.net_width = 608;
+    in.p.net_height = 352;
+    in.p.max_out = max_out;
+    in.p.output_elem = 1 + max_out * DET_SIZE;
+    in.p.layout = Yolo::kLayoutLinear;
+    const int channels = (5 + classes) * Yolo::CHECK_COUNT;
+    std::uniform_real_distribution<float> logit(-3.f, 3.f);
+    int offset = 0;
+    for (size_t h = 0; h < sizes.size(); h++) {
+        Yolo::DecodeHead& head = in.p.heads[h];
+        head.width = sizes[h].width;
+        head.height = sizes[h].height;
+        head.cell_offset = offset;
+        for (int a = 0; a < Yolo::CHECK_COUNT * 2; a++) head.anchors[a] = 4.f * (h + 1) + a;
+        offset += head.width * head.height;
+        std::vector<float> data((size_t)batch * channels * head.width * head.height);
+        for (float& v : data) v = logit(rng);
+        in.heads.push_back(data);
+    }
+    in.p.cells_per_image = offset;
+    for (size_t h = 0; h < sizes.size(); h++) in.p.inputs[h] = in.heads[h].data();
+    return in;
+}
+
+static float sigmoid(float x) {
+    return 1.f / (1.f + expf(-x));
+}
+
+// 直接实现: 按batch、head、行、列、anchor的顺序, 与decode_host按线程下标的顺序相同
+static std::vector<Yolo::Detection> reference_decode(const DecodeInput& in, int b) {
+    std::vector<Yolo::Detection> out;
+    const Yolo::DecodeParams& p = in.p;
+    const int info_len = 5 + p.classes;
+    const int channels = info_len * Yolo::CHECK_COUNT;
+    for (int h = 0; h < p.num_heads; h++) {
+        const Yolo::DecodeHead& head = p.heads[h];
+        const int grid = head.width * head.height;
+        const float* img = in.heads[h].data() + (size_t)b * channels * grid;
+        for (int row = 0; row < head.height; row++) {
+            for (int col = 0; col < head.width; col++) {
+                for (int k = 0; k < Yolo::CHECK_COUNT; k++) {
+                    auto at = [&](int c) { return img[(size_t)(k * info_len + c) * grid + row * head.width + col]; };
+                    float box_prob = sigmoid(at(4));
+                    if (box_prob < Yolo::IGNORE_THRESH) continue;
+                    // 逐类sigmoid取最大; 不同的logit在float的sigmoid后可能相等, 此时取logit大的(与decode_anchor一致)
+                    int class_id = 0;
+                    float best = sigmoid(at(5));
+                    for (int c = 1; c < p.classes; c++) {
+                        float prob = sigmoid(at(5 + c));
+                        if (prob > best || (prob == best && at(5 + c) > at(5 + class_id))) {
+                            best = prob;
+                            class_id = c;
+                        }
+                    }
+                    Yolo::Detection det;
+                    float stride_x = (float)p.net_width / head.width, stride_y = (float)p.net_height / head.height;
+                    det.bbox[0] = (col - 0.5f + 2.f * sigmoid(at(0))) * stride_x;
+                    det.bbox[1] = (row - 0.5f + 2.f * sigmoid(at(1))) * stride_y;
+                    float w = 2.f * sigmoid(at(2)), hh = 2.f * sigmoid(at(3));
+                    det.bbox[2] = w * w * head.anchors[2 * k];
+                    det.bbox[3] = hh * hh * head.anchors[2 * k + 1];
+                    det.conf = best * box_prob;
+                    det.class_id = (float)class_id;
+                    out.push_back(det);
+                }
+            }
+        }
+    }
+    return out;
+}
+
+static void check_mapping(const Yolo::DecodeParams& p) {
+    const int total = p.cells_per_image * p.batch;
+    for (int max_threads : { 1, 7, 64, 256, 512 }) {
+        Yolo::LaunchGeometry g = Yolo::decode_geometry(p, max_threads);
+        CHECK(g.threads >= 1 && g.threads <= max_threads);
+        CHECK(g.blocks * g.threads >= total);
+        CHECK((g.blocks - 1) * g.threads < total);
+        if (total < max_threads) CHECK(g.blocks == 1 && g.threads == total);
+    }
+
+    // 每个线程下标 -> (batch, head, cell) -> 线程下标
+    Yolo::LaunchGeometry g = Yolo::decode_geometry(p, 256);
+    std::vector<int> hits(total, 0);
+    int bad = 0;
+    for (int idx = 0; idx < g.blocks * g.threads; idx++) {
+        int b = -1, head = -1, cell = -1;
+        bool inside = Yolo::locate_cell(p, idx, b, head, cell);
+        if (idx >= total) {
+            bad += inside;
+            continue;
+        }
+        if (!inside || b < 0 || b >= p.batch || head < 0 || head >= p.num_heads || cell < 0 || cell >= p.heads[head].width * p.heads[head].height) {
+            bad++;
+            continue;
+        }
+        int back = b * p.cells_per_image + p.heads[head].cell_offset + cell;
+        if (back != idx) bad++;
+        hits[back]++;
+    }
+    CHECK(bad == 0);
+    int b, head, cell;
+    CHECK(!Yolo::locate_cell(p, -1, b, head, cell));
+    // 每个(batch, head, cell)恰好一个线程, 每个线程解码该cell的CHECK_COUNT个anchor
+    int missing = 0;
+    for (int h : hits) missing += h != 1;
+    CHECK(missing == 0);
+}
+
+static bool same_det(const Yolo::Detection& a, const Yolo::Detection& b) {
+    for (int k = 0; k < 4; k++) {
+        if (fabsf(a.bbox[k] - b.bbox[k]) > 1e-3f * (1.f + fabsf(b.bbox[k]))) return false;
+    }
+    return fabsf(a.conf - b.conf) <= 1e-5f && a.class_id == b.class_id;
+}
+
+static void check_decode(const DecodeInput& in) {
+    const Yolo::DecodeParams& p = in.p;
+    std::vector<float> output((size_t)p.batch * p.output_elem, -1.f);
+    Yolo::decode_host<float>(p, output.data());
+    for (int b = 0; b < p.batch; b++) {
+        std::vector<Yolo::Detection> ref = reference_decode(in, b);
+        const float* out = &output[(size_t)b * p.output_elem];
+        int claimed = (int)out[0];
+        int written = std::min(claimed, p.max_out);
+        const Yolo::Detection* dets = reinterpret_cast<const Yolo::Detection*>(out + 1);
+        if ((int)ref.size() <= p.max_out) {
+            CHECK(claimed == (int)ref.size());
+        } else {
+            // 溢出后计数仍在增加, 但只写出前max_out个
+            CHECK(claimed >= p.max_out);
+        }
+        int mismatched = 0;
+        for (int i = 0; i < written && i < (int)ref.size(); i++) mismatched += !same_det(dets[i], ref[i]);
+        CHECK(mismatched == 0);
+        if (mismatched) std::cerr << "  batch " << b << "/" << p.batch << ", " << p.num_heads << " heads, " << p.classes << " classes: " << mismatched << " boxes differ" << std::endl;
+    }
+}
+
+static void test_half_conversion() {
+    CHECK(Yolo::float_to_half(1.f) == 0x3c00);
+    CHECK(Yolo::float_to_half(-2.f) == 0xc000);
+    CHECK(Yolo::float_to_half(65504.f) == 0x7bff);
+    CHECK(Yolo::float_to_half(1e6f) == 0x7c00);
+    CHECK(Yolo::float_to_half(1.f + 1.f / 4096) == 0x3c00);
+    CHECK(Yolo::float_to_half(1.f + 1.f / 2048) == 0x3c00);  // 正好在中间, 舍入到偶数
+    CHECK(Yolo::float_to_half(1.f + 3.f / 2048) == 0x3c02);
+    CHECK(Yolo::half_to_float(0x0001) == ldexpf(1.f, -24)); // 最小的subnormal
+    CHECK(Yolo::half_to_float(0x7c00) == INFINITY);
+    // 所有有限的half往返不变
+    int bad = 0;
+    for (uint32_t h = 0; h < 0x10000; h++) {
+        if ((h & 0x7c00) == 0x7c00) continue;
+        bad += Yolo::float_to_half(Yolo::half_to_float((uint16_t)h)) != h;
+    }
+    CHECK(bad == 0);
+}
+
+// 把objectness移出IGNORE_THRESH附近, 并让最大的类别logit领先0.5, half取整不会改变是否保留和类别
+static void separate_logits(DecodeInput& in) {
+    const float thresh_logit = logf(Yolo::IGNORE_THRESH / (1.f - Yolo::IGNORE_THRESH));
+    const int info_len = 5 + in.p.classes;
+    for (int h = 0; h < in.p.num_heads; h++) {
+        const int grid = in.p.heads[h].width * in.p.heads[h].height;
+        float* data = in.heads[h].data();
+        for (int b = 0; b < in.p.batch; b++) {
+            for (int k = 0; k < Yolo::CHECK_COUNT; k++) {
+                float* anchor = data + ((size_t)b * Yolo::CHECK_COUNT + k) * info_len * grid;
+                for (int cell = 0; cell < grid; cell++) {
+                    float& obj = anchor[4 * grid + cell];
+                    if (fabsf(obj - thresh_logit) < 0.05f) obj = thresh_logit + (obj < thresh_logit ? -0.1f : 0.1f);
+                    int best = 0;
+                    for (int c = 1; c < in.p.classes; c++) {
+                        if (anchor[(5 + c) * grid + cell] > anchor[(5 + best) * grid + cell]) best = c;
+                    }
+                    anchor[(5 + best) * grid + cell] += 0.5f;
+                }
+            }
+        }
+    }
+}
+
+// TensorRT的格式定义, 不用yolo_decode.h中的channel_offset/image_elements, 两边的错误不会互相抵消
+//   kCHW2: 通道补齐到2的倍数, 每2个通道一组, 组内按像素交错: [C/2][H][W][2]
+//   kHWC8: 通道补齐到8的倍数, 按像素连续存放: [H][W][C8]
+static size_t packed_index(int layout, int channels, int c, int cell, int grid) {
+    if (layout == Yolo::kLayoutCHW2) return ((size_t)(c / 2) * grid + cell) * 2 + c % 2;
+    if (layout == Yolo::kLayoutHWC8) return (size_t)cell * ((channels + 7) / 8 * 8) + c;
+    return (size_t)c * grid + cell;
+}
+
+static size_t packed_image_size(int layout, int channels, int grid) {
+    if (layout == Yolo::kLayoutCHW2) return (size_t)(channels + 1) / 2 * 2 * grid;
+    if (layout == Yolo::kLayoutHWC8) return (size_t)(channels + 7) / 8 * 8 * grid;
+    return (size_t)channels * grid;
+}
+
+// 按layout打包成half, 补齐的通道填8.0(当作logit读到时会改变结果)
+static std::vector<std::vector<Yolo::half_bits>> pack_half(const DecodeInput& in, int layout) {
+    const int channels = (5 + in.p.classes) * Yolo::CHECK_COUNT;
+    const Yolo::half_bits pad = { Yolo::float_to_half(8.f) };
+    std::vector<std::vector<Yolo::half_bits>> packed;
+    for (int h = 0; h < in.p.num_heads; h++) {
+        const int grid = in.p.heads[h].width * in.p.heads[h].height;
+        const size_t elems = packed_image_size(layout, channels, grid);
+        std::vector<Yolo::half_bits> out((size_t)in.p.batch * elems, pad);
+        for (int b = 0; b < in.p.batch; b++) {
+            const float* src = in.heads[h].data() + (size_t)b * channels * grid;
+            for (int c = 0; c < channels; c++) {
+                for (int cell = 0; cell < grid; cell++) {
+                    out[b * elems + packed_index(layout, channels, c, cell, grid)].x = Yolo::float_to_half(src[(size_t)c * grid + cell]);
+                }
+            }
+        }
+        packed.push_back(out);
+    }
+    return packed;
+}
+
+static std::vector<float> decode_half(const DecodeInput& in, int layout) {
+    std::vector<std::vector<Yolo::half_bits>> packed = pack_half(in, layout);
+    Yolo::DecodeParams p = in.p;
+    p.layout = layout;
+    for (int h = 0; h < p.num_heads; h++) p.inputs[h] = packed[h].data();
+    std::vector<float> output((size_t)p.batch * p.output_elem, -1.f);
+    Yolo::decode_host<Yolo::half_bits>(p, output.data());
+    return output;
+}
+
+// 两次解码的每张图框数相同, 每个框的坐标(abs_tol像素 + rel_tol相对值)和conf在容差内(输出顺序只由下标决定, 逐个比较)
+static int compare_outputs(const Yolo::DecodeParams& p, const std::vector<float>& a, const std::vector<float>& b, float abs_tol, float rel_tol, float conf_tol) {
+    int bad = 0;
+    for (int i = 0; i < p.batch; i++) {
+        const float* oa = &a[(size_t)i * p.output_elem];
+        const float* ob = &b[(size_t)i * p.output_elem];
+        if (oa[0] != ob[0]) {
+            bad++;
+            continue;
+        }
+        const Yolo::Detection* da = reinterpret_cast<const Yolo::Detection*>(oa + 1);
+        const Yolo::Detection* db = reinterpret_cast<const Yolo::Detection*>(ob + 1);
+        for (int j = 0; j < std::min((int)oa[0], p.max_out); j++) {
+            bool same = da[j].class_id == db[j].class_id && fabsf(da[j].conf - db[j].conf) <= conf_tol;
+            for (int k = 0; k < 4; k++) same = same && fabsf(da[j].bbox[k] - db[j].bbox[k]) <= abs_tol + rel_tol * fabsf(db[j].bbox[k]);
+            bad += !same;
+        }
+    }
+    return bad;
+}
+
+static void test_half_layouts(const std::vector<HeadSize>& sizes, int batch, int classes, std::mt19937& rng) {
+    DecodeInput in = make_input(sizes, batch, classes, 20000, rng);
+    separate_logits(in);
+    std::vector<float> ref((size_t)batch * in.p.output_elem, -1.f);
+    Yolo::decode_host<float>(in.p, ref.data());
+    const int layouts[] = { Yolo::kLayoutLinear, Yolo::kLayoutCHW2, Yolo::kLayoutHWC8 };
+    std::vector<std::vector<float>> halves;
+    for (int layout : layouts) halves.push_back(decode_half(in, layout));
+    // logit(绝对值约4以内)取整到half的误差不超过2^-10, sigmoid的斜率不超过0.25: 中心点的误差不超过约5e-4 x stride,
+    // stride最大为net_width(宽为1的head), 容差取net_width / 1000; 宽高的误差按相对值
+    const float abs_tol = in.p.net_width * 1e-3f;
+    for (size_t i = 0; i < halves.size(); i++) {
+        int bad = compare_outputs(in.p, halves[i], ref, abs_tol, 2e-3f, 2e-3f);
+        CHECK(bad == 0);
+        if (bad) std::cerr << "  layout " << layouts[i] << ", " << classes << " classes, batch " << batch << ": " << bad << " boxes differ from float" << std::endl;
+    }
+
+    // 先按half取整: 各布局与float的结果完全相同
+    for (auto& head : in.heads) {
+        for (float& v : head) v = Yolo::half_to_float(Yolo::float_to_half(v));
+    }
+    Yolo::decode_host<float>(in.p, ref.data());
+    for (int layout : layouts) CHECK(compare_outputs(in.p, decode_half(in, layout), ref, 0.f, 0.f, 0.f) == 0);
+}
+
+int main() {
+    std::mt19937 rng(0);
+    // P6(4个head, stride 8..64)和P5(3个head)的网格, 以及奇数尺寸和1xN的网格
+    const std::vector<std::vector<HeadSize>> configs = {
+        { { 76, 44 }, { 38, 22 }, { 19, 11 }, { 10, 6 } },
+        { { 13, 7 }, { 7, 5 }, { 5, 3 }, { 3, 1 } },
+        { { 76, 44 }, { 38, 22 }, { 19, 11 } },
+        { { 9, 11 }, { 5, 1 }, { 1, 3 } },
+    };
+    for (const auto& sizes : configs) {
+        for (int batch : { 1, 3, 16 }) {
+            for (int classes : { Yolo::CLASS_NUM, COCO_CLASSES, 3 }) {
+                // 大网格且80类时只跑batch 1和3, 控制运行时间
+                if (sizes[0].width > 40 && classes == COCO_CLASSES && batch == 16) continue;
+                DecodeInput in = make_input(sizes, batch, classes, 20000, rng);
+                check_mapping(in.p);
+                check_decode(in);
+            }
+        }
+    }
+    // 输出溢出: 只写出前max_out个, 与直接实现的前max_out个相同
+    DecodeInput small = make_input(configs[1], 3, Yolo::CLASS_NUM, 10, rng);
+    check_decode(small);
+
+    test_half_conversion();
+    // 通道数33、255、27: 都不是2或8的倍数
+    for (int classes : { Yolo::CLASS_NUM, COCO_CLASSES, 4 }) {
+        for (int batch : { 1, 3 }) {
+            test_half_layouts(configs[1], batch, classes, rng);
+            test_half_layouts(configs[3], batch, classes, rng);
+        }
+    }
+    test_half_layouts(configs[0], 2, Yolo::CLASS_NUM, rng);
+
+    if (test_failures()) std::cerr << test_failures() << " checks failed" << std::endl;
+    else std::cout << "decode_test passed" << std::endl;
+    return test_failures() ? 1 : 0;
+}
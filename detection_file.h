@@ -0,0 +1,78 @@
+#ifndef TRTX_YOLOV5_DETECTION_FILE_H_
+#define TRTX_YOLOV5_DETECTION_FILE_H_
+
+// 评估用的检测记录: ./yolov5 -e写出, coco_eval离线读取
+// 每张图保存engine的原始输出(NMS之前, 网络输入坐标的cx, cy, w, h)和letterbox参数, 评估时用与线上相同的nms/xywh2xyxy/scale_coords
+// 按不同的CONF_THRESH/NMS_THRESH重新后处理, 只需CPU; 推理耗时一并记录, 用于比较不同engine的速度
+// 文本格式, 文件名不能含空白:
+//   yolov5-dets 1 <host|gpu> <engine>       gpu表示engine带NMS插件, 输出已经过构建时阈值的NMS
+//   image <文件名> <原图宽> <原图高> <canvas_w> <canvas_h> <w> <h> <pad_x> <pad_y> <gain> <推理ms> <候选框总数> <行数>
+//   <cx> <cy> <w> <h> <conf> <class>         共<行数>行; 候选框总数大于行数时超出了MAX_OUTPUT_BBOX_COUNT
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "yolo_types.h"
+#include "letterbox.h"
+
+struct DetectionRecord {
+    std::string name;
+    int img_w = 0, img_h = 0;
+    Yolo::Letterbox lb;
+    float infer_ms = 0;
+    int candidates = 0;
+    std::vector<float> output; // 与engine输出相同的布局: [行数, Detection...]
+};
+
+static inline void write_detection_header(std::ostream& out, bool gpu_nms, const std::string& engine) {
+    out << "yolov5-dets 1 " << (gpu_nms ? "gpu" : "host") << " " << engine << "\n";
+}
+
+// output为一张图的engine输出, 最多写出max_rows行
+static inline void write_detection_record(std::ostream& out, const std::string& name, int img_w, int img_h, const Yolo::Letterbox& lb, float infer_ms, const float* output, int max_rows) {
+    const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+    int candidates = (int)output[0];
+    int rows = std::min(candidates, max_rows);
+    out << "image " << name << " " << img_w << " " << img_h << " " << lb.canvas_w << " " << lb.canvas_h << " " << lb.w << " " << lb.h << " "
+        << lb.pad_x << " " << lb.pad_y << " " << lb.gain << " " << infer_ms << " " << candidates << " " << rows << "\n";
+    for (int i = 0; i < rows; i++) {
+        const float* d = &output[1 + i * det_size];
+        out << d[0] << " " << d[1] << " " << d[2] << " " << d[3] << " " << d[4] << " " << (int)d[5] << "\n";
+    }
+}
+
+// 读取整个文件; gpu_nms返回记录时engine是否带NMS插件
+static inline bool read_detection_file(const std::string& path, std::vector<DetectionRecord>& records, bool& gpu_nms, std::string& engine) {
+    std::ifstream in(path);
+    std::string magic, mode;
+    int version = 0;
+    if (!(in >> magic >> version >> mode >> engine) || magic != "yolov5-dets" || version != 1) {
+        std::cerr << path << " is not a yolov5 detection file" << std::endl;
+        return false;
+    }
+    gpu_nms = mode == "gpu";
+    const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+    records.clear();
+    std::string tag;
+    while (in >> tag) {
+        DetectionRecord r;
+        Yolo::Letterbox& lb = r.lb;
+        int rows = 0;
+        if (tag != "image" || !(in >> r.name >> r.img_w >> r.img_h >> lb.canvas_w >> lb.canvas_h >> lb.w >> lb.h >> lb.pad_x >> lb.pad_y >> lb.gain >> r.infer_ms >> r.candidates >> rows) || rows < 0) {
+            std::cerr << path << ": bad record after " << records.size() << " images" << std::endl;
+            return false;
+        }
+        r.output.resize(1 + rows * det_size);
+        r.output[0] = (float)rows;
+        for (int i = 0; i < rows * det_size; i++) in >> r.output[1 + i];
+        if (!in) {
+            std::cerr << path << ": truncated record " << r.name << std::endl;
+            return false;
+        }
+        records.push_back(std::move(r));
+    }
+    return true;
+}
+
+#endif  // TRTX_YOLOV5_DETECTION_FILE_H_
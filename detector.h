@@ -0,0 +1,159 @@
+#ifndef TRTX_YOLOV5_DETECTOR_H_
+#define TRTX_YOLOV5_DETECTOR_H_
+
+// 与推理后端无关的检测流程: letterbox -> 按canvas分组成batch -> 推理 -> NMS -> 还原到原图坐标
+// Python扩展(pyyolov5.cpp)在释放GIL后调用Detector::detect; 推理由InferBackend完成:
+//   TrtBackend(pyyolov5.cpp, 需要TensorRT)运行engine, MockBackend只在CPU上输出构造时给定的框, 用来测试绑定和前后处理
+// NMS使用yolo_nms.h中与GPU NMS插件相同的规则(nms_host), 不依赖common.hpp
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "yolo_types.h"
+#include "yolo_nms.h"
+#include "letterbox.h"
+#include "utils.h"
+
+class InferBackend {
+public:
+    virtual ~InferBackend() {}
+    virtual int maxBatch() const = 0;
+    virtual int maxInput() const = 0;    // canvas宽高的上限(engine profile的kMAX)
+    virtual int outputSize() const = 0;  // 每张图输出的float数, 布局为[数量, Detection...]
+    virtual bool nmsInEngine() const = 0;
+    // input为batch张连续存放的3 x input_h x input_w图像, output为batch x outputSize()
+    virtual void infer(const float* input, int batch, int input_h, int input_w, float* output) = 0;
+};
+
+// 每张图都输出同一组框: bbox中的cx/w为相对canvas宽度的比例, cy/h为相对canvas高度的比例
+class MockBackend : public InferBackend {
+public:
+    MockBackend(const std::vector<Yolo::Detection>& boxes, int max_batch, int max_input)
+        : boxes_(boxes), max_batch_(max_batch), max_input_(max_input) {}
+
+    int maxBatch() const override { return max_batch_; }
+    int maxInput() const override { return max_input_; }
+    int outputSize() const override { return Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) / sizeof(float) + 1; }
+    bool nmsInEngine() const override { return false; }
+
+    void infer(const float* input, int batch, int input_h, int input_w, float* output) override {
+        (void)input;
+        int n = std::min((int)boxes_.size(), Yolo::MAX_OUTPUT_BBOX_COUNT);
+        for (int b = 0; b < batch; b++) {
+            float* out = output + (size_t)b * outputSize();
+            out[0] = n;
+            Yolo::Detection* dets = reinterpret_cast<Yolo::Detection*>(out + 1);
+            for (int i = 0; i < n; i++) {
+                dets[i] = boxes_[i];
+                dets[i].bbox[0] *= input_w;
+                dets[i].bbox[1] *= input_h;
+                dets[i].bbox[2] *= input_w;
+                dets[i].bbox[3] *= input_h;
+            }
+        }
+    }
+
+private:
+    std::vector<Yolo::Detection> boxes_;
+    int max_batch_;
+    int max_input_;
+};
+
+struct DetectorConfig {
+    float conf_thresh = 0.45f;
+    float nms_thresh = 0.5f;
+    bool rect = true;  // true: 长边缩放到long_side, canvas取最小的64倍数; false: 固定input_w x input_h
+    int input_w = Yolo::INPUT_W;
+    int input_h = Yolo::INPUT_H;
+};
+
+struct BatchRecord {
+    int batch, input_h, input_w;
+};
+
+class Detector {
+public:
+    Detector(std::shared_ptr<InferBackend> backend, const DetectorConfig& config) : backend_(backend), config_(config) {}
+
+    const DetectorConfig& config() const { return config_; }
+    InferBackend& backend() { return *backend_; }
+
+    // 上一次detect中每次推理的batch和canvas尺寸
+    const std::vector<BatchRecord>& lastBatches() const { return batches_; }
+
+    Yolo::Letterbox letterbox(int img_w, int img_h) const {
+        if (config_.rect) return rect_letterbox(img_w, img_h, std::min(std::max(config_.input_w, config_.input_h), backend_->maxInput()));
+        return fixed_letterbox(img_w, img_h, config_.input_w, config_.input_h);
+    }
+
+    // frames为BGR图像, 返回每帧的检测结果, bbox为原图坐标的x1,y1,x2,y2; 同一个Detector不能被多个线程同时调用
+    std::vector<std::vector<Yolo::Detection>> detect(const std::vector<cv::Mat>& frames) {
+        const int batch_max = backend_->maxBatch();
+        const int out_size = backend_->outputSize();
+        std::vector<std::vector<Yolo::Detection>> results(frames.size());
+        std::vector<Yolo::Letterbox> lbs(frames.size());
+        for (size_t i = 0; i < frames.size(); i++) lbs[i] = letterbox(frames[i].cols, frames[i].rows);
+        std::vector<std::vector<int>> groups;
+        group_by_canvas(lbs, groups);
+
+        batches_.clear();
+        for (const auto& group : groups) {
+            int canvas_w = lbs[group[0]].canvas_w;
+            int canvas_h = lbs[group[0]].canvas_h;
+            for (size_t first = 0; first < group.size(); first += batch_max) {
+                int n = std::min((int)(group.size() - first), batch_max);
+                data_.resize((size_t)n * 3 * canvas_h * canvas_w);
+                prob_.resize((size_t)n * out_size);
+                for (int k = 0; k < n; k++) {
+                    int i = group[first + k];
+                    cv::Mat canvas = letterbox_img(frames[i], lbs[i]);
+                    blob_from_img(canvas, &data_[(size_t)k * 3 * canvas_h * canvas_w], canvas_w, canvas_h);
+                }
+                backend_->infer(data_.data(), n, canvas_h, canvas_w, prob_.data());
+                batches_.push_back(BatchRecord{ n, canvas_h, canvas_w });
+                for (int k = 0; k < n; k++) {
+                    int i = group[first + k];
+                    postprocess(&prob_[(size_t)k * out_size], out_size, frames[i].cols, frames[i].rows, lbs[i], results[i]);
+                }
+            }
+        }
+        return results;
+    }
+
+    // 一张图的原始输出([数量, Detection...], 网络输入坐标的xywh) -> NMS后原图坐标的xyxy
+    void postprocess(const float* output, int output_size, int img_w, int img_h, const Yolo::Letterbox& lb, std::vector<Yolo::Detection>& res) const {
+        const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+        const int max_rows = (output_size - 1) / det_size;
+        const Yolo::Detection* dets;
+        int count;
+        if (backend_->nmsInEngine()) {
+            dets = reinterpret_cast<const Yolo::Detection*>(output + 1);
+            count = std::min((int)output[0], max_rows);
+        } else {
+            nms_out_.resize(1 + (size_t)max_rows * det_size);
+            Yolo::nms_host(output, nms_out_.data(), max_rows, config_.conf_thresh, config_.nms_thresh, max_rows);
+            dets = reinterpret_cast<const Yolo::Detection*>(nms_out_.data() + 1);
+            count = (int)nms_out_[0];
+        }
+        res.assign(dets, dets + count);
+        for (auto& det : res) {
+            float cx = det.bbox[0], cy = det.bbox[1], w = det.bbox[2], h = det.bbox[3];
+            det.bbox[0] = cx - w / 2.f;
+            det.bbox[1] = cy - h / 2.f;
+            det.bbox[2] = cx + w / 2.f;
+            det.bbox[3] = cy + h / 2.f;
+        }
+        scale_coords(res, img_w, img_h, lb);
+    }
+
+private:
+    std::shared_ptr<InferBackend> backend_;
+    DetectorConfig config_;
+    std::vector<float> data_;
+    std::vector<float> prob_;
+    mutable std::vector<float> nms_out_;
+    std::vector<BatchRecord> batches_;
+};
+
+#endif  // TRTX_YOLOV5_DETECTOR_H_
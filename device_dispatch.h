@@ -0,0 +1,231 @@
+#ifndef TRTX_YOLOV5_DEVICE_DISPATCH_H_
+#define TRTX_YOLOV5_DEVICE_DISPATCH_H_
+
+// 多GPU调度: 每个设备一个工作线程和一个BatchQueue, DeviceDispatcher决定每一帧进哪个设备的队列
+// - 粘性: 每路视频源第一次出现时分到预计负载(已分配的源数 x 每张图耗时)最小的设备, 之后一直留在该设备(engine/显存中的状态和缓存更热)
+// - 迁移: 源所在设备饱和(排队的图像数达到saturated_images, 或预计等待时间 = 排队数 x 每张图耗时达到max_wait_ms),
+//   且预计等待时间超过最空闲设备的rebalance_ratio倍时, 这一路迁到最空闲的设备; 每个设备每cooldown_ms最多迁出一路, 每一路每cooldown_ms最多迁移一次, 避免来回抖动
+// - 每张图耗时为各设备实测的EWMA, 还没有样本的设备用已知设备的平均值
+// 只依赖标准库, dispatch_sim.cpp用不同速度的模拟设备测试调度效果
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+// 有界的多生产者队列, 消费者一次取出一批
+template <class T>
+class BatchQueue {
+public:
+    explicit BatchQueue(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)), closed_(false) {}
+
+    // 队列满时等待; close之后返回false
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this] { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 队列满时不等待, 返回false且item不变
+    bool try_push(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (closed_ || items_.size() >= capacity_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // 等到至少有一项后取出最多max项到out(先清空); close且队列已空时返回false
+    bool pop_batch(std::vector<T>& out, size_t max) {
+        out.clear();
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        while (!items_.empty() && out.size() < max) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        not_full_.notify_all();
+        return true;
+    }
+
+    // 不再接受新项, 消费者取完剩余的项后退出
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+private:
+    const size_t capacity_;
+    bool closed_;
+    std::deque<T> items_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+struct DispatchConfig {
+    int saturated_images = 32;     // 设备排队(已路由未完成)的图像数达到该值, 或预计等待达到max_wait_ms时视为饱和, 可以迁出
+    float max_wait_ms = 50.f;
+    float rebalance_ratio = 1.5f;  // 预计等待时间超过目标设备的该倍数时才迁移, <=0关闭迁移(静态分配)
+    int cooldown_ms = 1000;
+    float latency_alpha = 0.2f;    // 每张图耗时的EWMA系数
+};
+
+struct DeviceLoad {
+    int sources = 0;            // 当前分在该设备上的源数
+    int queued = 0;             // 已路由未完成的图像数
+    double ms_per_image = 0;    // EWMA, 0为还没有样本
+    long long images = 0;
+    long long batches = 0;
+    long long migrated_in = 0;
+    long long migrated_out = 0;
+};
+
+class DeviceDispatcher {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit DeviceDispatcher(int num_devices, const DispatchConfig& cfg = DispatchConfig())
+        : cfg_(cfg), devices_(std::max(num_devices, 1)), last_out_(devices_.size()), migrations_(0) {}
+
+    int num_devices() const { return (int)devices_.size(); }
+
+    // source的下一帧应该进哪个设备的队列, 返回的设备计入一张排队的图像
+    // 之后必须对应一次done(推理完成)或cancel(没有放进队列)
+    int route(int source) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Clock::time_point now = Clock::now();
+        auto it = sources_.find(source);
+        if (it == sources_.end()) {
+            Placement p;
+            p.device = place();
+            devices_[p.device].sources++;
+            it = sources_.insert(std::make_pair(source, p)).first;
+        } else {
+            maybe_migrate(it->second, now);
+        }
+        int d = it->second.device;
+        devices_[d].queued++;
+        return d;
+    }
+
+    // route之后这一帧被丢弃(队列已满)
+    void cancel(int device) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        devices_[device].queued = std::max(0, devices_[device].queued - 1);
+    }
+
+    // 设备完成一个batch: images张图共耗时batch_ms
+    void done(int device, int images, float batch_ms) {
+        if (images <= 0) return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        DeviceLoad& d = devices_[device];
+        d.queued = std::max(0, d.queued - images);
+        double per_image = batch_ms / images;
+        d.ms_per_image = d.batches ? (1 - cfg_.latency_alpha) * d.ms_per_image + cfg_.latency_alpha * per_image : per_image;
+        d.images += images;
+        d.batches++;
+    }
+
+    // source当前所在的设备, 还没有分配时为-1
+    int device_of(int source) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = sources_.find(source);
+        return it == sources_.end() ? -1 : it->second.device;
+    }
+
+    DeviceLoad load(int device) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return devices_[device];
+    }
+
+    long long migrations() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return migrations_;
+    }
+
+private:
+    struct Placement {
+        int device = 0;
+        Clock::time_point moved_at;
+        bool moved = false;
+    };
+
+    // 每张图耗时的估计, 没有样本时用已知设备的平均值(都没有时为1, 只比较相对大小)
+    double speed(int device) const {
+        if (devices_[device].ms_per_image > 0) return devices_[device].ms_per_image;
+        double sum = 0;
+        int known = 0;
+        for (const DeviceLoad& d : devices_) {
+            if (d.ms_per_image > 0) {
+                sum += d.ms_per_image;
+                known++;
+            }
+        }
+        return known ? sum / known : 1.0;
+    }
+
+    // 再加一张图时的预计等待
+    double wait_ms(int device) const { return (devices_[device].queued + 1) * speed(device); }
+
+    // 新的源: 加上它之后稳态负载最小的设备, 相同时取源数少的
+    int place() const {
+        int best = 0;
+        double best_cost = 0;
+        for (int d = 0; d < (int)devices_.size(); d++) {
+            double cost = (devices_[d].sources + 1) * speed(d);
+            if (d == 0 || cost < best_cost || (cost == best_cost && devices_[d].sources < devices_[best].sources)) {
+                best = d;
+                best_cost = cost;
+            }
+        }
+        return best;
+    }
+
+    void maybe_migrate(Placement& p, Clock::time_point now) {
+        if (cfg_.rebalance_ratio <= 0 || devices_.size() < 2) return;
+        const int from = p.device;
+        if (devices_[from].queued < cfg_.saturated_images && wait_ms(from) < cfg_.max_wait_ms) return;
+        const std::chrono::milliseconds cooldown(cfg_.cooldown_ms);
+        if (p.moved && now - p.moved_at < cooldown) return;
+        if (last_out_[from].moved && now - last_out_[from].moved_at < cooldown) return;
+        int to = -1;
+        for (int d = 0; d < (int)devices_.size(); d++) {
+            if (d != from && (to < 0 || wait_ms(d) < wait_ms(to))) to = d;
+        }
+        if (wait_ms(from) <= wait_ms(to) * cfg_.rebalance_ratio) return;
+        devices_[from].sources--;
+        devices_[from].migrated_out++;
+        devices_[to].sources++;
+        devices_[to].migrated_in++;
+        p.device = to;
+        p.moved = true;
+        p.moved_at = now;
+        last_out_[from].moved = true;
+        last_out_[from].moved_at = now;
+        migrations_++;
+    }
+
+    DispatchConfig cfg_;
+    std::vector<DeviceLoad> devices_;
+    std::vector<Placement> last_out_;  // 每个设备最近一次迁出的时间
+    std::map<int, Placement> sources_;
+    long long migrations_;
+    mutable std::mutex mutex_;
+};
+
+#endif  // TRTX_YOLOV5_DEVICE_DISPATCH_H_
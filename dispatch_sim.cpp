@@ -0,0 +1,123 @@
+// 多GPU调度(device_dispatch.h)的模拟, 只用CPU: 每个模拟设备按给定的每张图耗时sleep来"推理"一个batch
+// 多路视频源按固定fps产生帧, 队列满时丢帧(与共享内存等实时源相同); 同样的负载分别用
+//   static:     只按源数均分, 不迁移(相当于每个GPU一个进程、固定分配摄像头)
+//   load-aware: 按实测耗时分配, 设备饱和时迁移
+// 各跑一次, 比较每个设备处理的图像数、丢帧数和帧延迟(产生 -> 推理完成)的p50/p99
+// ./dispatch_sim [每个设备每张图的ms, 如2,2,4,10] [源数] [每路fps] [秒数]
+
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "device_dispatch.h"
+
+#define SIM_BATCH 16           // 每个batch最多的图像数, 对应BATCH_SIZE
+#define SIM_BATCH_OVERHEAD 1.0 // 每个batch的固定耗时(ms)
+
+typedef std::chrono::steady_clock Clock;
+
+struct SimFrame {
+    int source;
+    Clock::time_point created;
+};
+
+struct SimResult {
+    std::vector<DeviceLoad> loads;
+    long long produced = 0, dropped = 0, migrations = 0;
+    double p50_ms = 0, p99_ms = 0;
+};
+
+static double percentile(std::vector<double>& values, double q) {
+    if (values.empty()) return 0;
+    size_t k = std::min(values.size() - 1, (size_t)(q * values.size()));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+static SimResult simulate(const std::vector<double>& ms_per_image, int num_sources, double fps, double seconds, const DispatchConfig& cfg) {
+    const int num_devices = (int)ms_per_image.size();
+    DeviceDispatcher dispatcher(num_devices, cfg);
+    std::vector<std::unique_ptr<BatchQueue<SimFrame>>> queues;
+    for (int d = 0; d < num_devices; d++) queues.emplace_back(new BatchQueue<SimFrame>(4 * SIM_BATCH));
+    std::mutex latency_mutex;
+    std::vector<double> latencies;
+
+    std::vector<std::thread> workers;
+    for (int d = 0; d < num_devices; d++) {
+        workers.emplace_back([&, d] {
+            std::vector<SimFrame> batch;
+            std::vector<double> local;
+            while (queues[d]->pop_batch(batch, SIM_BATCH)) {
+                auto start = Clock::now();
+                std::this_thread::sleep_for(std::chrono::microseconds((long long)((SIM_BATCH_OVERHEAD + batch.size() * ms_per_image[d]) * 1000)));
+                auto end = Clock::now();
+                dispatcher.done(d, (int)batch.size(), std::chrono::duration<float, std::milli>(end - start).count());
+                for (const SimFrame& f : batch) local.push_back(std::chrono::duration<double, std::milli>(end - f.created).count());
+            }
+            std::lock_guard<std::mutex> lock(latency_mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+        });
+    }
+
+    SimResult r;
+    const auto period = std::chrono::microseconds((long long)(1e6 / fps));
+    const auto stop = Clock::now() + std::chrono::microseconds((long long)(seconds * 1e6));
+    for (auto tick = Clock::now(); tick < stop; tick += period) {
+        std::this_thread::sleep_until(tick);
+        for (int s = 0; s < num_sources; s++) {
+            SimFrame f = { s, Clock::now() };
+            int d = dispatcher.route(s);
+            r.produced++;
+            if (!queues[d]->try_push(f)) {
+                dispatcher.cancel(d);
+                r.dropped++;
+            }
+        }
+    }
+    for (auto& q : queues) q->close();
+    for (auto& t : workers) t.join();
+
+    for (int d = 0; d < num_devices; d++) r.loads.push_back(dispatcher.load(d));
+    r.migrations = dispatcher.migrations();
+    r.p50_ms = percentile(latencies, 0.5);
+    r.p99_ms = percentile(latencies, 0.99);
+    return r;
+}
+
+static void print_result(const char* name, const std::vector<double>& ms_per_image, const SimResult& r) {
+    std::cout << name << ": " << r.produced << " frames, dropped " << r.dropped << " (" << (r.produced ? 100.0 * r.dropped / r.produced : 0.0)
+              << "%), latency p50 " << r.p50_ms << " ms, p99 " << r.p99_ms << " ms, " << r.migrations << " migrations" << std::endl;
+    for (size_t d = 0; d < r.loads.size(); d++) {
+        const DeviceLoad& l = r.loads[d];
+        std::cout << "  device " << d << " (" << ms_per_image[d] << " ms/image): " << l.sources << " sources, " << l.images << " images in "
+                  << l.batches << " batches, measured " << l.ms_per_image << " ms/image, in/out " << l.migrated_in << "/" << l.migrated_out << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<double> ms_per_image;
+    std::stringstream ss(argc > 1 ? argv[1] : "2,2,4,10");
+    std::string item;
+    while (std::getline(ss, item, ',')) ms_per_image.push_back(atof(item.c_str()));
+    int num_sources = argc > 2 ? atoi(argv[2]) : 16;
+    double fps = argc > 3 ? atof(argv[3]) : 25;
+    double seconds = argc > 4 ? atof(argv[4]) : 10;
+    if (ms_per_image.empty() || num_sources <= 0 || fps <= 0 || seconds <= 0) {
+        std::cerr << "./dispatch_sim [ms per image per device, e.g. 2,2,4,10] [sources] [fps] [seconds]" << std::endl;
+        return -1;
+    }
+
+    DispatchConfig cfg;
+    cfg.saturated_images = 2 * SIM_BATCH;
+    DispatchConfig static_cfg = cfg;
+    static_cfg.rebalance_ratio = 0;
+    print_result("static", ms_per_image, simulate(ms_per_image, num_sources, fps, seconds, static_cfg));
+    print_result("load-aware", ms_per_image, simulate(ms_per_image, num_sources, fps, seconds, cfg));
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include "ffmpeg_source.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+namespace
+{
+    static constexpr float PAD_VALUE = 128 / 255.0f; // 与letterbox_img的灰色canvas一致
+
+    // yuvj*是已废弃的"全范围yuv*", swscale会给出警告; 换成对应的格式并单独设置色彩范围
+    static AVPixelFormat plain_format(AVPixelFormat fmt, bool& full_range) {
+        switch (fmt) {
+        case AV_PIX_FMT_YUVJ420P: full_range = true; return AV_PIX_FMT_YUV420P;
+        case AV_PIX_FMT_YUVJ422P: full_range = true; return AV_PIX_FMT_YUV422P;
+        case AV_PIX_FMT_YUVJ444P: full_range = true; return AV_PIX_FMT_YUV444P;
+        case AV_PIX_FMT_YUVJ440P: full_range = true; return AV_PIX_FMT_YUV440P;
+        default: return fmt;
+        }
+    }
+
+    // 缩放后图像区域以外的部分填充padding
+    static void fill_padding(float* plane, const Yolo::Letterbox& lb) {
+        const int cw = lb.canvas_w;
+        std::fill(plane, plane + lb.pad_y * cw, PAD_VALUE);
+        std::fill(plane + (lb.pad_y + lb.h) * cw, plane + lb.canvas_h * cw, PAD_VALUE);
+        for (int y = lb.pad_y; y < lb.pad_y + lb.h; y++) {
+            float* row = plane + y * cw;
+            std::fill(row, row + lb.pad_x, PAD_VALUE);
+            std::fill(row + lb.pad_x + lb.w, row + cw, PAD_VALUE);
+        }
+    }
+}
+
+struct FfmpegSource::Impl
+{
+    AVFormatContext* fmt = nullptr;
+    AVCodecContext* codec = nullptr;
+    AVPacket* packet = nullptr;
+    AVFrame* frame = nullptr;
+    SwsContext* sws = nullptr;
+    int stream = -1;
+    bool loop = false;
+    bool draining = false; // 输入已读完, 正在取出解码器中缓存的帧
+    int64_t frames = 0;
+    // swscale(FFmpeg 4.4起)可以直接输出GBRPF32; 不支持时先输出8位GBRP(缩放后的大小)再转float
+    bool float_output = false;
+    std::vector<uint8_t> planes8;
+    // 当前sws上下文对应的输入格式/色彩参数, 变化时重新设置
+    int src_format = -1, src_space = -1, src_range = -1;
+};
+
+FfmpegSource::FfmpegSource() : impl_(new Impl) {}
+
+FfmpegSource::~FfmpegSource() {
+    close();
+    delete impl_;
+}
+
+bool FfmpegSource::open(const std::string& url, const VideoSourceOptions& options) {
+    close();
+    Impl& d = *impl_;
+    if (avformat_open_input(&d.fmt, url.c_str(), nullptr, nullptr) < 0 || avformat_find_stream_info(d.fmt, nullptr) < 0) {
+        std::cerr << "Can not open video " << url << std::endl;
+        close();
+        return false;
+    }
+    d.stream = av_find_best_stream(d.fmt, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+    if (d.stream < 0) {
+        std::cerr << url << " has no video stream" << std::endl;
+        close();
+        return false;
+    }
+    const AVCodecParameters* par = d.fmt->streams[d.stream]->codecpar;
+    const AVCodec* decoder = avcodec_find_decoder(par->codec_id);
+    d.codec = decoder ? avcodec_alloc_context3(decoder) : nullptr;
+    if (!d.codec || avcodec_parameters_to_context(d.codec, par) < 0) {
+        std::cerr << "No decoder for " << url << " (" << avcodec_get_name(par->codec_id) << ")" << std::endl;
+        close();
+        return false;
+    }
+    d.codec->thread_count = options.decode_threads;
+    d.codec->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+    if (avcodec_open2(d.codec, decoder, nullptr) < 0) {
+        std::cerr << "Can not open decoder for " << url << std::endl;
+        close();
+        return false;
+    }
+    d.packet = av_packet_alloc();
+    d.frame = av_frame_alloc();
+    d.loop = options.loop;
+    d.float_output = sws_isSupportedOutput(AV_PIX_FMT_GBRPF32) > 0;
+    return d.packet && d.frame;
+}
+
+void FfmpegSource::close() {
+    Impl& d = *impl_;
+    sws_freeContext(d.sws);
+    av_frame_free(&d.frame);
+    av_packet_free(&d.packet);
+    avcodec_free_context(&d.codec);
+    avformat_close_input(&d.fmt);
+    d = Impl();
+}
+
+int FfmpegSource::width() const { return impl_->codec ? impl_->codec->width : 0; }
+int FfmpegSource::height() const { return impl_->codec ? impl_->codec->height : 0; }
+int64_t FfmpegSource::frames() const { return impl_->frames; }
+
+double FfmpegSource::fps() const {
+    if (!impl_->fmt) return 0;
+    const AVStream* st = impl_->fmt->streams[impl_->stream];
+    AVRational rate = st->avg_frame_rate.num ? st->avg_frame_rate : st->r_frame_rate;
+    return rate.den ? av_q2d(rate) : 0;
+}
+
+int64_t FfmpegSource::pts() const {
+    const Impl& d = *impl_;
+    if (!d.frame || d.frame->best_effort_timestamp == AV_NOPTS_VALUE) return -1;
+    return av_rescale_q(d.frame->best_effort_timestamp, d.fmt->streams[d.stream]->time_base, AVRational{ 1, 1000000 });
+}
+
+// send/receive解码循环: 先取已解码的帧, 没有(EAGAIN)时再读一个包送入
+bool FfmpegSource::decode() {
+    Impl& d = *impl_;
+    if (!d.codec) return false;
+    while (true) {
+        int ret = avcodec_receive_frame(d.codec, d.frame);
+        if (ret == 0) {
+            d.frames++;
+            return true;
+        }
+        if (ret == AVERROR_EOF) {
+            if (!d.loop || av_seek_frame(d.fmt, d.stream, 0, AVSEEK_FLAG_BACKWARD) < 0) return false;
+            avcodec_flush_buffers(d.codec); // 清除EOF状态, 可以重新送包
+            d.draining = false;
+            continue;
+        }
+        if (ret != AVERROR(EAGAIN) || d.draining) return false;
+        if (av_read_frame(d.fmt, d.packet) < 0) {
+            // 输入结束(或读取失败): 送入空包, 之后receive依次返回缓存的帧和EOF
+            avcodec_send_packet(d.codec, nullptr);
+            d.draining = true;
+            continue;
+        }
+        // 损坏的包(AVERROR_INVALIDDATA等)跳过, 与cv::VideoCapture一样继续解码后面的帧
+        if (d.packet->stream_index == d.stream) avcodec_send_packet(d.codec, d.packet);
+        av_packet_unref(d.packet);
+    }
+}
+
+void FfmpegSource::convert(const Yolo::Letterbox& lb, float* dst) {
+    Impl& d = *impl_;
+    const AVFrame* f = d.frame;
+    const size_t plane = (size_t)lb.canvas_w * lb.canvas_h;
+    float* rgb[3] = { dst, dst + plane, dst + 2 * plane };
+    for (int c = 0; c < 3; c++) fill_padding(rgb[c], lb);
+
+    bool full_range = f->color_range == AVCOL_RANGE_JPEG;
+    AVPixelFormat src = plain_format((AVPixelFormat)f->format, full_range);
+    AVPixelFormat out = d.float_output ? AV_PIX_FMT_GBRPF32 : AV_PIX_FMT_GBRP;
+    // 缩放算法与letterbox_img的INTER_LINEAR一致; 尺寸和格式不变时返回原来的上下文
+    SwsContext* sws = sws_getCachedContext(d.sws, f->width, f->height, src, lb.w, lb.h, out, SWS_BILINEAR, nullptr, nullptr, nullptr);
+    if (!sws) {
+        std::cerr << "swscale does not support " << av_get_pix_fmt_name(src) << std::endl;
+        return;
+    }
+    if (sws != d.sws || d.src_format != src || d.src_space != f->colorspace || d.src_range != (int)full_range) {
+        // YUV->RGB系数按流标注的色彩空间(高清视频多为BT.709), 未标注时为BT.601; 输出为全范围RGB
+        int *inv_table, *table, src_full, dst_full, brightness, contrast, saturation;
+        sws_getColorspaceDetails(sws, &inv_table, &src_full, &table, &dst_full, &brightness, &contrast, &saturation);
+        int space = f->colorspace == AVCOL_SPC_UNSPECIFIED ? SWS_CS_DEFAULT : (int)f->colorspace;
+        sws_setColorspaceDetails(sws, sws_getCoefficients(space), full_range, table, 1, brightness, contrast, saturation);
+        d.src_format = src;
+        d.src_space = f->colorspace;
+        d.src_range = full_range;
+    }
+    d.sws = sws;
+
+    // GBRP的平面顺序为G、B、R
+    const size_t offset = (size_t)lb.pad_y * lb.canvas_w + lb.pad_x;
+    if (d.float_output) {
+        uint8_t* planes[4] = { (uint8_t*)(rgb[1] + offset), (uint8_t*)(rgb[2] + offset), (uint8_t*)(rgb[0] + offset), nullptr };
+        const int stride = lb.canvas_w * (int)sizeof(float);
+        int strides[4] = { stride, stride, stride, 0 };
+        sws_scale(sws, f->data, f->linesize, 0, f->height, planes, strides);
+        return;
+    }
+    const size_t area = (size_t)lb.w * lb.h;
+    d.planes8.resize(3 * area);
+    uint8_t* planes[4] = { &d.planes8[0], &d.planes8[area], &d.planes8[2 * area], nullptr };
+    int strides[4] = { lb.w, lb.w, lb.w, 0 };
+    sws_scale(sws, f->data, f->linesize, 0, f->height, planes, strides);
+    const uint8_t* src8[3] = { planes[2], planes[0], planes[1] };
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < lb.h; y++) {
+            const uint8_t* in = src8[c] + (size_t)y * lb.w;
+            float* row = rgb[c] + offset + (size_t)y * lb.canvas_w;
+            for (int x = 0; x < lb.w; x++) row[x] = in[x] / 255.0f;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef TRTX_YOLOV5_FFMPEG_SOURCE_H_
+#define TRTX_YOLOV5_FFMPEG_SOURCE_H_
+
+// 基于libavformat/libavcodec的视频输入, 替代cv::VideoCapture
+// cv::VideoCapture的路径: 解码(YUV) -> swscale转打包BGR(整帧) -> letterbox_img缩放到灰色canvas -> blob_from_img逐像素拆成RGB平面, 每帧多次整帧拷贝
+// 这里解码后由swscale一步完成缩放和YUV->RGB转换, 直接写入调用方的网络输入缓冲区(3个canvas_h x canvas_w的float平面, 与blob_from_img(letterbox_img(...))布局相同)
+// 每路一个解码上下文, decode_threads为libavcodec的解码线程数(帧级+slice级多线程, 帧级多线程会增加约decode_threads帧的延迟)
+// FFmpeg的类型只出现在ffmpeg_source.cpp中, cmake -DWITH_FFMPEG=ON时编译
+
+#include <stdint.h>
+#include <string>
+#include "letterbox.h"
+
+struct VideoSourceOptions {
+    int decode_threads = 0; // 0: 由libavcodec按CPU核数决定, 1: 单线程解码(延迟最小)
+    bool loop = false;      // 文件读完后从头开始(压测用)
+};
+
+class FfmpegSource {
+public:
+    FfmpegSource();
+    ~FfmpegSource();
+    FfmpegSource(const FfmpegSource&) = delete;
+    FfmpegSource& operator=(const FfmpegSource&) = delete;
+
+    // url为文件路径或rtsp://等FFmpeg支持的地址, 选取其中最佳的视频流
+    bool open(const std::string& url, const VideoSourceOptions& options);
+    void close();
+
+    int width() const;
+    int height() const;
+    double fps() const;
+    int64_t frames() const; // 已解码的帧数
+    int64_t pts() const;    // 最近一帧的时间戳(微秒), 没有时为-1
+
+    // 解码下一帧, 文件结束(loop为false)或出错时返回false
+    bool decode();
+    // 把最近解码的帧按lb缩放并居中写入dst: R、G、B三个平面, 值为/255, padding为128/255
+    void convert(const Yolo::Letterbox& lb, float* dst);
+    bool read(const Yolo::Letterbox& lb, float* dst) {
+        if (!decode()) return false;
+        convert(lb, dst);
+        return true;
+    }
+
+private:
+    struct Impl;
+    Impl* impl_;
+};
+
+#endif  // TRTX_YOLOV5_FFMPEG_SOURCE_H_
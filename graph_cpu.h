@@ -0,0 +1,378 @@
+#ifndef TRTX_YOLOV5_GRAPH_CPU_H_
+#define TRTX_YOLOV5_GRAPH_CPU_H_
+
+// graph_ir.h中网络图的CPU参考实现: 没有GPU时的推理后端, 以及和engine输出做一致性校验
+// 张量为NCHW float, 按节点顺序逐个计算, 中间结果在最后一次被使用后释放
+// 卷积: 按(图像, group, 输出行块, 输出像素块)切成任务在线程池上并行, 每个任务先im2col到线程私有的缓冲区
+// (1x1且stride为1时直接读输入), 再做分块GEMM; 最内层是对连续输出像素的乘加, 由编译器向量化(-O2以上)
+// YoloDecode调用yolo_decode.h中与kernel相同的decode_host, 输出布局与YoloLayer插件一致
+// 可选的INT8模拟(set_conv_int8)与逐节点观察(set_observer)供混合精度搜索使用, 见precision_search.h
+// 本文件不依赖TensorRT/CUDA
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <vector>
+#include "graph_ir.h"
+#include "thread_pool.h"
+#include "yolo_decode.h"
+
+struct CpuTensor {
+    std::vector<float> data;
+    int n = 0, c = 0, h = 0, w = 0;
+
+    size_t plane() const { return (size_t)h * w; }
+    size_t image() const { return (size_t)c * h * w; }
+};
+
+class CpuExecutor {
+public:
+    static constexpr int kBlockN = 256; // 每个任务的输出像素数
+    static constexpr int kBlockM = 64;  // 每个任务的输出通道数
+    static constexpr int kBlockK = 128; // GEMM中一次累加的输入行数, im2col块在L2内
+
+    CpuExecutor(const ir::Graph& graph, ThreadPool& pool) : graph_(graph), pool_(pool) {
+        const std::vector<ir::Node>& nodes = graph_.nodes();
+        last_use_.assign(nodes.size(), -1);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            for (int in : nodes[i].inputs) last_use_[in] = (int)i;
+        }
+        for (int out : graph_.outputs()) last_use_[out] = (int)nodes.size();
+    }
+
+    // input为batch张连续存放的C x h x w图像, h/w需为网络最大stride(64)的倍数
+    void run(const float* input, int batch, int h, int w) {
+        const std::vector<ir::Node>& nodes = graph_.nodes();
+        values_.assign(nodes.size(), CpuTensor());
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const ir::Node& n = nodes[i];
+            CpuTensor& y = values_[i];
+            switch (n.op) {
+            case ir::Op::kInput:
+                alloc(y, batch, n.channels, h, w);
+                memcpy(y.data.data(), input, y.data.size() * sizeof(float));
+                break;
+            case ir::Op::kConv:
+                if (!int8_amax_.empty() && int8_amax_[i] > 0.f) {
+                    CpuTensor qx = in(n, 0);
+                    parallel_range(qx.data.size(), [&](size_t begin, size_t end) { fake_quant(qx.data.data() + begin, end - begin, int8_amax_[i]); });
+                    conv(n, qx, int8_weight_[i].data(), y);
+                } else {
+                    conv(n, in(n, 0), n.weight.data, y);
+                }
+                break;
+            case ir::Op::kScale: scale(n, in(n, 0), y); break;
+            case ir::Op::kSigmoid:
+                unary(in(n, 0), y, [](float v) { return 1.0f / (1.0f + expf(-v)); });
+                break;
+            case ir::Op::kLeakyRelu: {
+                float alpha = n.alpha;
+                unary(in(n, 0), y, [alpha](float v) { return v > 0.f ? v : v * alpha; });
+                break;
+            }
+            case ir::Op::kAdd: binary(in(n, 0), in(n, 1), y, false); break;
+            case ir::Op::kMul: binary(in(n, 0), in(n, 1), y, true); break;
+            case ir::Op::kSlice2x: slice2x(n, in(n, 0), y); break;
+            case ir::Op::kConcat: concat(n, y); break;
+            case ir::Op::kResize: resize(n, in(n, 0), y); break;
+            case ir::Op::kMaxPool: max_pool(n, in(n, 0), y); break;
+            case ir::Op::kYoloDecode: yolo_decode(n, y); break;
+            }
+            if (observer_) observer_((int)i, y);
+            for (int x : n.inputs) {
+                if (last_use_[x] == (int)i) std::vector<float>().swap(values_[x].data);
+            }
+        }
+    }
+
+    // 第i个输出(graph.outputs()[i]), kYoloDecode的输出为batch x channels
+    const CpuTensor& output(int i) const { return values_[graph_.outputs()[i]]; }
+
+    // 卷积节点按INT8计算(模拟): 输入按input_amax逐张量、权重按输出通道做对称量化(与TensorRT相同, [-127, 127]), 之后仍以浮点计算
+    // input_amax <= 0时恢复为浮点
+    void set_conv_int8(int node, float input_amax) {
+        const ir::Node& n = graph_.node(node);
+        assert(n.op == ir::Op::kConv);
+        if (int8_amax_.empty()) {
+            int8_amax_.assign(graph_.nodes().size(), 0.f);
+            int8_weight_.resize(graph_.nodes().size());
+        }
+        int8_amax_[node] = input_amax;
+        if (input_amax <= 0.f || !int8_weight_[node].empty()) return;
+        const int M = n.channels;
+        const size_t K = (size_t)n.weight.count / M;
+        std::vector<float>& q = int8_weight_[node];
+        q.assign(n.weight.data, n.weight.data + n.weight.count);
+        for (int m = 0; m < M; m++) {
+            float amax = 0.f;
+            for (size_t k = 0; k < K; k++) amax = std::max(amax, fabsf(q[m * K + k]));
+            fake_quant(&q[m * K], K, amax);
+        }
+    }
+
+    // 每个节点计算完成后(释放其输入之前)调用fn(节点下标, 输出)
+    void set_observer(std::function<void(int, const CpuTensor&)> fn) { observer_ = fn; }
+
+    // 对称量化再反量化: round(x / s)截断到[-127, 127]后乘回s, s = amax / 127
+    static void fake_quant(float* x, size_t count, float amax) {
+        if (amax <= 0.f) return;
+        const float s = amax / 127.f, inv = 127.f / amax;
+        for (size_t i = 0; i < count; i++) x[i] = std::max(-127.f, std::min(127.f, nearbyintf(x[i] * inv))) * s;
+    }
+
+private:
+    const CpuTensor& in(const ir::Node& n, int i) const { return values_[n.inputs[i]]; }
+
+    static void alloc(CpuTensor& t, int n, int c, int h, int w) {
+        t.n = n;
+        t.c = c;
+        t.h = h;
+        t.w = w;
+        t.data.resize((size_t)n * c * h * w);
+    }
+
+    // [0, total)按块并行
+    void parallel_range(size_t total, const std::function<void(size_t, size_t)>& fn) {
+        const size_t block = 1 << 14;
+        int tasks = (int)((total + block - 1) / block);
+        pool_.parallel_for(tasks, [&](int t) {
+            size_t begin = (size_t)t * block;
+            fn(begin, std::min(total, begin + block));
+        });
+    }
+
+    template <typename F>
+    void unary(const CpuTensor& x, CpuTensor& y, F f) {
+        alloc(y, x.n, x.c, x.h, x.w);
+        const float* src = x.data.data();
+        float* dst = y.data.data();
+        parallel_range(y.data.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) dst[i] = f(src[i]);
+        });
+    }
+
+    void binary(const CpuTensor& a, const CpuTensor& b, CpuTensor& y, bool mul) {
+        assert(a.data.size() == b.data.size());
+        alloc(y, a.n, a.c, a.h, a.w);
+        const float* pa = a.data.data();
+        const float* pb = b.data.data();
+        float* dst = y.data.data();
+        parallel_range(y.data.size(), [&](size_t begin, size_t end) {
+            if (mul) {
+                for (size_t i = begin; i < end; i++) dst[i] = pa[i] * pb[i];
+            } else {
+                for (size_t i = begin; i < end; i++) dst[i] = pa[i] + pb[i];
+            }
+        });
+    }
+
+    void scale(const ir::Node& n, const CpuTensor& x, CpuTensor& y) {
+        alloc(y, x.n, x.c, x.h, x.w);
+        pool_.parallel_for(x.n * x.c, [&](int i) {
+            int c = i % x.c;
+            float s = n.weight.data[c], b = n.bias.data[c];
+            const float* src = x.data.data() + (size_t)i * x.plane();
+            float* dst = y.data.data() + (size_t)i * x.plane();
+            for (size_t k = 0; k < x.plane(); k++) dst[k] = src[k] * s + b;
+        });
+    }
+
+    void slice2x(const ir::Node& n, const CpuTensor& x, CpuTensor& y) {
+        alloc(y, x.n, x.c, x.h / 2, x.w / 2);
+        pool_.parallel_for(x.n * x.c, [&](int i) {
+            const float* src = x.data.data() + (size_t)i * x.plane();
+            float* dst = y.data.data() + (size_t)i * y.plane();
+            for (int r = 0; r < y.h; r++) {
+                const float* row = src + (size_t)(2 * r + n.offset_h) * x.w + n.offset_w;
+                for (int col = 0; col < y.w; col++) dst[r * y.w + col] = row[2 * col];
+            }
+        });
+    }
+
+    void concat(const ir::Node& n, CpuTensor& y) {
+        const CpuTensor& first = in(n, 0);
+        alloc(y, first.n, n.channels, first.h, first.w);
+        pool_.parallel_for(y.n * (int)n.inputs.size(), [&](int t) {
+            int b = t / (int)n.inputs.size();
+            int k = t % (int)n.inputs.size();
+            int c0 = 0;
+            for (int j = 0; j < k; j++) c0 += in(n, j).c;
+            const CpuTensor& x = in(n, k);
+            assert(x.h == y.h && x.w == y.w);
+            memcpy(y.data.data() + b * y.image() + c0 * y.plane(), x.data.data() + b * x.image(), x.image() * sizeof(float));
+        });
+    }
+
+    void resize(const ir::Node& n, const CpuTensor& x, CpuTensor& y) {
+        const int s = n.scale;
+        alloc(y, x.n, x.c, x.h * s, x.w * s);
+        pool_.parallel_for(x.n * x.c, [&](int i) {
+            const float* src = x.data.data() + (size_t)i * x.plane();
+            float* dst = y.data.data() + (size_t)i * y.plane();
+            for (int r = 0; r < y.h; r++) {
+                const float* row = src + (size_t)(r / s) * x.w;
+                for (int col = 0; col < y.w; col++) dst[r * y.w + col] = row[col / s];
+            }
+        });
+    }
+
+    void max_pool(const ir::Node& n, const CpuTensor& x, CpuTensor& y) {
+        const int p = n.kernel / 2;
+        alloc(y, x.n, x.c, x.h, x.w);
+        pool_.parallel_for(x.n * x.c, [&](int i) {
+            const float* src = x.data.data() + (size_t)i * x.plane();
+            float* dst = y.data.data() + (size_t)i * y.plane();
+            // 先按行再按列取最大值(可分离), padding不参与
+            std::vector<float> tmp(x.plane());
+            for (int r = 0; r < x.h; r++) {
+                for (int col = 0; col < x.w; col++) {
+                    float m = -std::numeric_limits<float>::infinity();
+                    for (int k = std::max(0, col - p); k <= std::min(x.w - 1, col + p); k++) m = std::max(m, src[r * x.w + k]);
+                    tmp[r * x.w + col] = m;
+                }
+            }
+            for (int r = 0; r < x.h; r++) {
+                for (int col = 0; col < x.w; col++) {
+                    float m = -std::numeric_limits<float>::infinity();
+                    for (int k = std::max(0, r - p); k <= std::min(x.h - 1, r + p); k++) m = std::max(m, tmp[k * x.w + col]);
+                    dst[r * x.w + col] = m;
+                }
+            }
+        });
+    }
+
+    // 卷积 = 每个(图像, group)上的GEMM: out[M x N] = W[M x K] * col[K x N] + bias
+    // M = outch / groups, K = inch / groups * k * k, N = 输出宽高
+    void conv(const ir::Node& n, const CpuTensor& x, const float* weights, CpuTensor& y) {
+        const int k = n.kernel, s = n.stride, p = k / 2;
+        const int oh = (x.h + 2 * p - k) / s + 1;
+        const int ow = (x.w + 2 * p - k) / s + 1;
+        alloc(y, x.n, n.channels, oh, ow);
+        const int groups = n.groups;
+        const int cin = x.c / groups;
+        const int M = n.channels / groups;
+        const int K = cin * k * k;
+        const int N = oh * ow;
+        const bool direct = k == 1 && s == 1;
+        const int nb = (N + kBlockN - 1) / kBlockN;
+        const int mb = (M + kBlockM - 1) / kBlockM;
+
+        pool_.parallel_for(x.n * groups * nb * mb, [&](int t) {
+            int m_blk = t % mb;
+            int n_blk = t / mb % nb;
+            int grp = t / mb / nb % groups;
+            int b = t / mb / nb / groups;
+            int n0 = n_blk * kBlockN, n1 = std::min(N, n0 + kBlockN), len = n1 - n0;
+            int m0 = m_blk * kBlockM, m1 = std::min(M, m0 + kBlockM);
+            const float* src = x.data.data() + b * x.image() + (size_t)grp * cin * x.plane();
+
+            // col的第r行为第r个(输入通道, ky, kx)在[n0, n1)上的取值, 行距为ld
+            const float* col;
+            size_t ld;
+            if (direct) {
+                col = src + n0;
+                ld = N;
+            } else {
+                thread_local std::vector<float> buf;
+                buf.resize((size_t)K * len);
+                for (int r = 0; r < K; r++) {
+                    int c = r / (k * k), ky = r / k % k, kx = r % k;
+                    const float* plane = src + (size_t)c * x.plane();
+                    float* dst = buf.data() + (size_t)r * len;
+                    for (int j = 0; j < len; j++) {
+                        int oy = (n0 + j) / ow, ox = (n0 + j) % ow;
+                        int iy = oy * s - p + ky, ix = ox * s - p + kx;
+                        dst[j] = (iy >= 0 && iy < x.h && ix >= 0 && ix < x.w) ? plane[iy * x.w + ix] : 0.f;
+                    }
+                }
+                col = buf.data();
+                ld = len;
+            }
+
+            const float* weight = weights + (size_t)grp * M * K;
+            float* out = y.data.data() + b * y.image() + (size_t)grp * M * y.plane() + n0;
+            for (int m = m0; m < m1; m++) {
+                float bias = n.bias.count ? n.bias.data[grp * M + m] : 0.f;
+                float* row = out + (size_t)m * N;
+                for (int j = 0; j < len; j++) row[j] = bias;
+            }
+            for (int k0 = 0; k0 < K; k0 += kBlockK) {
+                int k1 = std::min(K, k0 + kBlockK);
+                int m = m0;
+                // 4个输出通道一组, 每行col只读一次
+                for (; m + 4 <= m1; m += 4) {
+                    float* __restrict o0 = out + (size_t)m * N;
+                    float* __restrict o1 = o0 + N;
+                    float* __restrict o2 = o1 + N;
+                    float* __restrict o3 = o2 + N;
+                    const float* w0 = weight + (size_t)m * K;
+                    for (int r = k0; r < k1; r++) {
+                        const float* __restrict c = col + r * ld;
+                        float a0 = w0[r], a1 = w0[K + r], a2 = w0[2 * K + r], a3 = w0[3 * K + r];
+                        for (int j = 0; j < len; j++) {
+                            float v = c[j];
+                            o0[j] += a0 * v;
+                            o1[j] += a1 * v;
+                            o2[j] += a2 * v;
+                            o3[j] += a3 * v;
+                        }
+                    }
+                }
+                for (; m < m1; m++) {
+                    float* __restrict o = out + (size_t)m * N;
+                    const float* w0 = weight + (size_t)m * K;
+                    for (int r = k0; r < k1; r++) {
+                        const float* __restrict c = col + r * ld;
+                        float a = w0[r];
+                        for (int j = 0; j < len; j++) o[j] += a * c[j];
+                    }
+                }
+            }
+        });
+    }
+
+    void yolo_decode(const ir::Node& n, CpuTensor& y) {
+        const ir::YoloParams& params = n.yolo;
+        const int num_heads = (int)n.inputs.size();
+        assert(num_heads <= Yolo::MAX_HEADS);
+        const CpuTensor& first = in(n, 0);
+        Yolo::DecodeParams p;
+        memset(&p, 0, sizeof(p));
+        int cells = 0;
+        for (int i = 0; i < num_heads; i++) {
+            const CpuTensor& x = in(n, i);
+            p.inputs[i] = x.data.data();
+            p.heads[i].width = x.w;
+            p.heads[i].height = x.h;
+            p.heads[i].cell_offset = cells;
+            assert(params.heads[i].anchors.size() == Yolo::CHECK_COUNT * 2);
+            for (int a = 0; a < Yolo::CHECK_COUNT * 2; a++) p.heads[i].anchors[a] = params.heads[i].anchors[a];
+            cells += x.w * x.h;
+        }
+        // 与插件相同, 网络输入尺寸由第一个head的宽高和stride得到(动态尺寸下不是构建时的net_width)
+        p.num_heads = num_heads;
+        p.cells_per_image = cells;
+        p.batch = first.n;
+        p.classes = params.classes;
+        p.net_width = first.w * params.heads[0].stride;
+        p.net_height = first.h * params.heads[0].stride;
+        p.max_out = params.max_out;
+        p.output_elem = n.channels;
+        p.layout = Yolo::kLayoutLinear;
+        alloc(y, first.n, n.channels, 1, 1);
+        Yolo::decode_host<float>(p, y.data.data());
+    }
+
+    const ir::Graph& graph_;
+    ThreadPool& pool_;
+    std::vector<int> last_use_;
+    std::vector<CpuTensor> values_;
+    std::vector<float> int8_amax_;               // 每个节点, 0为浮点
+    std::vector<std::vector<float>> int8_weight_; // 量化后的卷积权重
+    std::function<void(int, const CpuTensor&)> observer_;
+};
+
+#endif  // TRTX_YOLOV5_GRAPH_CPU_H_
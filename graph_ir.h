@@ -0,0 +1,238 @@
+#ifndef TRTX_YOLOV5_GRAPH_IR_H_
+#define TRTX_YOLOV5_GRAPH_IR_H_
+
+// 与后端无关的网络图: yolov5_graph.h中的focus/convBlock/C3/SPP等只生成这里的节点,
+// 再由graph_trt.h降到TensorRT(INetworkDefinition), 或由graph_cpu.h在CPU上直接执行
+// 张量都是NCHW float, 节点只记录输出通道数, batch和宽高在运行时由输入决定(与engine的动态尺寸一致)
+// 权重只保存指针, 指向loadWeights/fuseConvBatchNorm的结果(WeightArena), 图的生命周期不能超过权重
+// 本文件不依赖TensorRT
+
+#include <assert.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace ir
+{
+    enum class Op
+    {
+        kInput,
+        kConv,       // 卷积, pad = kernel / 2, 可带bias
+        kScale,      // 逐通道 x * scale + shift (未折叠的BN)
+        kSigmoid,
+        kLeakyRelu,
+        kAdd,        // 逐元素相加, 两个输入形状相同
+        kMul,        // 逐元素相乘, 两个输入形状相同
+        kSlice2x,    // x[:, :, offset_h::2, offset_w::2], 输出宽高为输入的一半
+        kConcat,     // 按通道拼接
+        kResize,     // 最近邻放大scale倍
+        kMaxPool,    // stride 1, pad = kernel / 2, 宽高不变
+        kYoloDecode, // 各head的输出解码为[数量, Detection...], 见yolo_decode.h
+    };
+
+    inline const char* op_name(Op op)
+    {
+        switch (op) {
+        case Op::kInput: return "Input";
+        case Op::kConv: return "Conv";
+        case Op::kScale: return "Scale";
+        case Op::kSigmoid: return "Sigmoid";
+        case Op::kLeakyRelu: return "LeakyRelu";
+        case Op::kAdd: return "Add";
+        case Op::kMul: return "Mul";
+        case Op::kSlice2x: return "Slice2x";
+        case Op::kConcat: return "Concat";
+        case Op::kResize: return "Resize";
+        case Op::kMaxPool: return "MaxPool";
+        case Op::kYoloDecode: return "YoloDecode";
+        }
+        return "?";
+    }
+
+    struct Blob
+    {
+        const float* data;
+        int64_t count;
+    };
+
+    // .wts中blob的名称 -> 数据, 由TensorRT的weightMap或CPU端直接构造
+    typedef std::map<std::string, Blob> WeightTable;
+
+    struct YoloHead
+    {
+        int stride;                 // 该head相对网络输入的下采样倍数
+        std::vector<float> anchors; // 每个anchor的(w, h), 网络输入像素
+    };
+
+    struct YoloParams
+    {
+        int classes;
+        int max_out;
+        int net_width;  // 构建时的网络输入尺寸, TensorRT插件据此和head宽高算出下采样倍数
+        int net_height;
+        std::vector<YoloHead> heads; // 与节点的inputs一一对应
+    };
+
+    struct Node
+    {
+        Op op;
+        std::vector<int> inputs;
+        int channels = 0; // 输出通道数, kYoloDecode为每张图的输出长度
+        int kernel = 1, stride = 1, groups = 1;
+        Blob weight{ nullptr, 0 }; // kConv: 卷积核; kScale: scale
+        Blob bias{ nullptr, 0 };   // kConv: bias(可为空); kScale: shift
+        float alpha = 0.f;         // kLeakyRelu
+        int offset_h = 0, offset_w = 0; // kSlice2x
+        int scale = 1;             // kResize
+        YoloParams yolo;           // kYoloDecode
+        std::string module;        // 所属模块, 如"model.4", 由tag设置
+        std::string kind;          // 模块类型, 如"C3"
+    };
+
+    class Graph
+    {
+    public:
+        int input(int channels)
+        {
+            Node n = make(Op::kInput, {});
+            n.channels = channels;
+            return push(n);
+        }
+
+        int conv(int x, int outch, int kernel, int stride, int groups, Blob weight, Blob bias)
+        {
+            assert(weight.count == (int64_t)outch * (channels(x) / groups) * kernel * kernel);
+            assert(bias.count == 0 || bias.count == outch);
+            Node n = make(Op::kConv, { x });
+            n.channels = outch;
+            n.kernel = kernel;
+            n.stride = stride;
+            n.groups = groups;
+            n.weight = weight;
+            n.bias = bias;
+            return push(n);
+        }
+
+        int scale(int x, Blob scale, Blob shift)
+        {
+            assert(scale.count == channels(x) && shift.count == channels(x));
+            Node n = make(Op::kScale, { x });
+            n.channels = channels(x);
+            n.weight = scale;
+            n.bias = shift;
+            return push(n);
+        }
+
+        int sigmoid(int x) { return unary(Op::kSigmoid, x); }
+
+        int leaky_relu(int x, float alpha)
+        {
+            Node n = make(Op::kLeakyRelu, { x });
+            n.channels = channels(x);
+            n.alpha = alpha;
+            return push(n);
+        }
+
+        int add(int a, int b) { return binary(Op::kAdd, a, b); }
+        int mul(int a, int b) { return binary(Op::kMul, a, b); }
+
+        int slice2x(int x, int offset_h, int offset_w)
+        {
+            Node n = make(Op::kSlice2x, { x });
+            n.channels = channels(x);
+            n.offset_h = offset_h;
+            n.offset_w = offset_w;
+            return push(n);
+        }
+
+        int concat(const std::vector<int>& xs)
+        {
+            Node n = make(Op::kConcat, xs);
+            for (int x : xs) n.channels += channels(x);
+            return push(n);
+        }
+
+        int resize(int x, int scale)
+        {
+            Node n = make(Op::kResize, { x });
+            n.channels = channels(x);
+            n.scale = scale;
+            return push(n);
+        }
+
+        int max_pool(int x, int kernel)
+        {
+            Node n = make(Op::kMaxPool, { x });
+            n.channels = channels(x);
+            n.kernel = kernel;
+            return push(n);
+        }
+
+        // 每张图的输出为1 + max_out * 6个float, 与YoloLayer插件相同
+        int yolo_decode(const std::vector<int>& heads, const YoloParams& params)
+        {
+            assert(heads.size() == params.heads.size());
+            for (size_t i = 0; i < heads.size(); i++) {
+                assert(channels(heads[i]) == (int)(params.heads[i].anchors.size() / 2) * (params.classes + 5));
+            }
+            Node n = make(Op::kYoloDecode, heads);
+            n.channels = 1 + params.max_out * 6;
+            n.yolo = params;
+            return push(n);
+        }
+
+        void mark_output(int x) { outputs_.push_back(x); }
+
+        // 把上一次tag之后新增的节点归入module, 降到TensorRT时层名为"<module>:<kind>/<序号>"(见layer_profile.h)
+        void tag(const std::string& module, const std::string& kind)
+        {
+            for (; tagged_ < (int)nodes_.size(); tagged_++) {
+                nodes_[tagged_].module = module;
+                nodes_[tagged_].kind = kind;
+            }
+        }
+
+        int channels(int x) const { return nodes_[x].channels; }
+        const Node& node(int x) const { return nodes_[x]; }
+        const std::vector<Node>& nodes() const { return nodes_; }
+        const std::vector<int>& outputs() const { return outputs_; }
+
+    private:
+        static Node make(Op op, const std::vector<int>& inputs)
+        {
+            Node n;
+            n.op = op;
+            n.inputs = inputs;
+            return n;
+        }
+
+        int push(const Node& n)
+        {
+            for (int x : n.inputs) assert(x >= 0 && x < (int)nodes_.size());
+            nodes_.push_back(n);
+            return (int)nodes_.size() - 1;
+        }
+
+        int unary(Op op, int x)
+        {
+            Node n = make(op, { x });
+            n.channels = channels(x);
+            return push(n);
+        }
+
+        int binary(Op op, int a, int b)
+        {
+            assert(channels(a) == channels(b));
+            Node n = make(op, { a, b });
+            n.channels = channels(a);
+            return push(n);
+        }
+
+        std::vector<Node> nodes_;
+        std::vector<int> outputs_;
+        int tagged_ = 0;
+    };
+}
+
+#endif  // TRTX_YOLOV5_GRAPH_IR_H_
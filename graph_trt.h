@@ -0,0 +1,221 @@
+#ifndef TRTX_YOLOV5_GRAPH_TRT_H_
+#define TRTX_YOLOV5_GRAPH_TRT_H_
+
+// graph_ir.h中的网络图 -> TensorRT INetworkDefinition
+// 每个节点对应一到数层TensorRT层, 同一个tag(模块)下的层命名为"<module>:<kind>/<序号>", 逐层性能分析据此归并到model.N(见layer_profile.h)
+// YoloDecode降为YoloLayer_TRT插件, NMS插件(addNmsLayer)在图之外由build_engine按需追加
+
+#include <map>
+#include <string>
+#include <vector>
+#include "NvInfer.h"
+#include "yololayer.h"
+#include "graph_ir.h"
+
+using namespace nvinfer1;
+
+static inline Weights trt_weights(const ir::Blob& blob) {
+    return Weights{ DataType::kFLOAT, blob.data, blob.count };
+}
+
+// 把下标[first, network->getNbLayers())的层命名为"<module>:<kind>/<序号>", 返回下一次的first
+// 性能分析时据此把engine中(融合后)的层对应回model.N, 见layer_profile.h
+int name_module_layers(INetworkDefinition *network, int first, const std::string& module, const std::string& kind) {
+    int n = network->getNbLayers();
+    for (int i = first; i < n; i++) {
+        network->getLayer(i)->setName((module + ":" + kind + "/" + std::to_string(i - first)).c_str());
+    }
+    return n;
+}
+
+// YoloLayer_TRT插件, 输入依次为各head的卷积输出
+// 插件字段沿用原来的格式: netdata为[类别数, 网络宽, 网络高, 最大输出数], yolodata<k>为第k个尺度(k=1为stride最小的head)的[w, h, 6个anchor]
+IPluginV2Layer* addYoLoLayer(INetworkDefinition *network, const ir::YoloParams& params, const std::vector<ITensor*>& heads)
+{
+    // 通过getPluginRegistry获取所有TensorRT插件，creator即IPluginCreator对象
+    //                                                  (pluginName, pluginVersion)
+    auto creator = getPluginRegistry()->getPluginCreator("YoloLayer_TRT", "2");
+    const int num_heads = (int)params.heads.size();
+    // 包含插件属性字段名称和关联数据的结构：[name, data, type, length]
+    std::vector<PluginField> pluginMultidata(1 + num_heads);
+    int NetData[4];
+    NetData[0] = params.classes;
+    NetData[1] = params.net_width;
+    NetData[2] = params.net_height;
+    NetData[3] = params.max_out;
+    pluginMultidata[0].data = NetData;
+    pluginMultidata[0].length = 4; // data的长度
+    pluginMultidata[0].name = "netdata";
+    pluginMultidata[0].type = PluginFieldType::kFLOAT32;
+    std::vector<std::vector<int>> plugindata(num_heads); // 每个det[w, h, 6*anchor]
+    std::vector<std::string> names(num_heads);
+    for (int i = 0; i < num_heads; i++)
+    {
+        // 图中head按输入顺序(stride从大到小)给出, 字段按stride从小到大编号
+        const ir::YoloHead& head = params.heads[i];
+        int k = num_heads - i;
+        plugindata[i].push_back(params.net_width / head.stride);
+        plugindata[i].push_back(params.net_height / head.stride);
+        for (float a : head.anchors) plugindata[i].push_back(int(a));
+        pluginMultidata[k].data = plugindata[i].data();
+        pluginMultidata[k].length = (int)plugindata[i].size(); // data的长度
+        names[i] = "yolodata" + std::to_string(k);
+        pluginMultidata[k].name = names[i].c_str();
+        pluginMultidata[k].type = PluginFieldType::kFLOAT32;
+    }
+    PluginFieldCollection pluginData;
+    pluginData.nbFields = (int)pluginMultidata.size(); // 网络参数+各head
+    pluginData.fields = pluginMultidata.data();
+    IPluginV2 *pluginObj = creator->createPlugin("yololayer", &pluginData);
+    auto yolo = network->addPluginV2(heads.data(), num_heads, *pluginObj);
+    return yolo;
+}
+
+// 在YoloLayer之后加入GPU NMS插件, 输出每张图抑制后的前top_n个框
+IPluginV2Layer* addNmsLayer(INetworkDefinition *network, ITensor& yolo, float conf_thresh, float nms_thresh, int top_n)
+{
+    auto creator = getPluginRegistry()->getPluginCreator("NmsLayer_TRT", "2");
+    int max_in = Yolo::MAX_OUTPUT_BBOX_COUNT;
+    PluginField fields[4];
+    fields[0] = PluginField("max_in", &max_in, PluginFieldType::kINT32, 1);
+    fields[1] = PluginField("top_n", &top_n, PluginFieldType::kINT32, 1);
+    fields[2] = PluginField("conf_thresh", &conf_thresh, PluginFieldType::kFLOAT32, 1);
+    fields[3] = PluginField("nms_thresh", &nms_thresh, PluginFieldType::kFLOAT32, 1);
+    PluginFieldCollection pluginData;
+    pluginData.nbFields = 4;
+    pluginData.fields = fields;
+    IPluginV2 *pluginObj = creator->createPlugin("nmslayer", &pluginData);
+    ITensor* inputTensors[] = { &yolo };
+    auto nms_layer = network->addPluginV2(inputTensors, 1, *pluginObj);
+    return nms_layer;
+}
+
+// 输入为动态尺寸[N, C, H, W], 切片的输出维度在运行时由输入shape计算: [N, C, H/2, W/2]
+// INetworkDefinition::addShape(输入tensor): 得到输入维度的INT32 shape tensor
+static ITensor* half_size(INetworkDefinition *network, ITensor& input) {
+    static const int32_t halve[4] = { 1, 1, 2, 2 };
+    Dims shape_dims;
+    shape_dims.nbDims = 1;
+    shape_dims.d[0] = 4;
+    auto shape = network->addShape(input);
+    auto divisor = network->addConstant(shape_dims, Weights{ DataType::kINT32, halve, 4 });
+    auto size = network->addElementWise(*shape->getOutput(0), *divisor->getOutput(0), ElementWiseOperation::kDIV);
+    assert(shape && divisor && size);
+    return size->getOutput(0);
+}
+
+// 混合精度: profile为模块 -> "fp16"/"fp32"(precision_search.h的精度配置), 按层名"<module>:"前缀设置这些模块的层精度和输出类型
+// shape计算等非浮点的层不设置; 需要配合BuilderFlag::kSTRICT_TYPES(TensorRT 8.2起为kOBEY_PRECISION_CONSTRAINTS)才会强制生效, 返回设置的层数
+int apply_precision_profile(INetworkDefinition *network, const std::map<std::string, std::string>& profile) {
+    int pinned = 0;
+    for (int i = 0; i < network->getNbLayers(); i++) {
+        ILayer* layer = network->getLayer(i);
+        std::string name = layer->getName();
+        auto it = profile.find(name.substr(0, name.find(':')));
+        if (it == profile.end() || layer->getOutput(0)->getType() != DataType::kFLOAT) continue;
+        DataType type = it->second == "fp32" ? DataType::kFLOAT : DataType::kHALF;
+        layer->setPrecision(type);
+        for (int j = 0; j < layer->getNbOutputs(); j++) layer->setOutputType(j, type);
+        pinned++;
+    }
+    return pinned;
+}
+
+// 把graph降到network, input为网络的输入tensor(对应图中的kInput节点), 返回graph.outputs()对应的tensor
+std::vector<ITensor*> lower_to_trt(const ir::Graph& graph, INetworkDefinition *network, ITensor* input) {
+    const std::vector<ir::Node>& nodes = graph.nodes();
+    std::vector<ITensor*> t(nodes.size(), nullptr);
+    std::map<int, ITensor*> halved; // focus的4个切片共用一次shape计算
+    Weights emptywts{ DataType::kFLOAT, nullptr, 0 };
+    int named = network->getNbLayers();
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const ir::Node& n = nodes[i];
+        ITensor* x = n.inputs.empty() ? nullptr : t[n.inputs[0]];
+        ILayer* layer = nullptr;
+        switch (n.op) {
+        case ir::Op::kInput:
+            t[i] = input;
+            break;
+        case ir::Op::kConv: {
+            // INetworkDefinition::addConvolutionNd(输入tensor，输出维度，卷积核尺寸，卷积核权重，偏置权重)
+            auto conv = network->addConvolutionNd(*x, n.channels, DimsHW{ n.kernel, n.kernel }, trt_weights(n.weight), n.bias.count ? trt_weights(n.bias) : emptywts);
+            assert(conv);
+            conv->setStrideNd(DimsHW{ n.stride, n.stride });
+            conv->setPaddingNd(DimsHW{ n.kernel / 2, n.kernel / 2 });
+            conv->setNbGroups(n.groups);
+            layer = conv;
+            break;
+        }
+        case ir::Op::kScale:
+            // IScaleLayer: output=(input×scale+shift)^power, power为空时默认为1
+            layer = network->addScale(*x, ScaleMode::kCHANNEL, trt_weights(n.bias), trt_weights(n.weight), emptywts);
+            break;
+        case ir::Op::kSigmoid:
+            layer = network->addActivation(*x, ActivationType::kSIGMOID);
+            break;
+        case ir::Op::kLeakyRelu: {
+            auto lr = network->addActivation(*x, ActivationType::kLEAKY_RELU);
+            lr->setAlpha(n.alpha);
+            layer = lr;
+            break;
+        }
+        case ir::Op::kAdd:
+            layer = network->addElementWise(*x, *t[n.inputs[1]], ElementWiseOperation::kSUM);
+            break;
+        case ir::Op::kMul:
+            layer = network->addElementWise(*x, *t[n.inputs[1]], ElementWiseOperation::kPROD);
+            break;
+        case ir::Op::kSlice2x: {
+            if (!halved.count(n.inputs[0])) halved[n.inputs[0]] = half_size(network, *x);
+            // 构建时的输出维度只是占位, 由setInput(2, size)覆盖
+            auto slice = network->addSlice(*x, Dims4{ 0, 0, n.offset_h, n.offset_w }, Dims4{ 1, n.channels, 1, 1 }, Dims4{ 1, 1, 2, 2 });
+            slice->setInput(2, *halved[n.inputs[0]]);
+            layer = slice;
+            break;
+        }
+        case ir::Op::kConcat: {
+            std::vector<ITensor*> xs;
+            for (int in : n.inputs) xs.push_back(t[in]);
+            layer = network->addConcatenation(xs.data(), (int)xs.size());
+            break;
+        }
+        case ir::Op::kResize: {
+            // 按比例放大, 输入宽高为64的倍数时与另一支路的尺寸一致
+            const float scales[4] = { 1.0f, 1.0f, (float)n.scale, (float)n.scale };
+            auto resize = network->addResize(*x);
+            resize->setResizeMode(ResizeMode::kNEAREST);
+            resize->setScales(scales, 4);
+            layer = resize;
+            break;
+        }
+        case ir::Op::kMaxPool: {
+            auto pool = network->addPoolingNd(*x, PoolingType::kMAX, DimsHW{ n.kernel, n.kernel });
+            pool->setPaddingNd(DimsHW{ n.kernel / 2, n.kernel / 2 });
+            pool->setStrideNd(DimsHW{ 1, 1 });
+            layer = pool;
+            break;
+        }
+        case ir::Op::kYoloDecode: {
+            std::vector<ITensor*> heads;
+            for (int in : n.inputs) heads.push_back(t[in]);
+            layer = addYoLoLayer(network, n.yolo, heads);
+            break;
+        }
+        }
+        if (layer) {
+            assert(layer->getOutput(0));
+            t[i] = layer->getOutput(0);
+        }
+        // 一个模块的最后一个节点: 命名该模块新增的所有层
+        if (i + 1 == nodes.size() || nodes[i + 1].module != n.module || nodes[i + 1].kind != n.kind) {
+            if (!n.module.empty()) named = name_module_layers(network, named, n.module, n.kind);
+        }
+    }
+
+    std::vector<ITensor*> outputs;
+    for (int out : graph.outputs()) outputs.push_back(t[out]);
+    return outputs;
+}
+
+#endif  // TRTX_YOLOV5_GRAPH_TRT_H_
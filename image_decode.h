@@ -0,0 +1,88 @@
+#ifndef TRTX_YOLOV5_IMAGE_DECODE_H_
+#define TRTX_YOLOV5_IMAGE_DECODE_H_
+
+// 按网络输入尺寸解码图片: 远大于网络输入的JPEG(如12MP照片)在解码时由libjpeg(-turbo)做DCT缩放(1/2, 1/4, 1/8),
+// 只解码出需要的分辨率, 剩下的缩放由letterbox完成; OpenCV的cv::IMREAD_REDUCED_COLOR_*对JPEG即设置scale_denom
+// 选能覆盖letterbox结果的最大缩放: 缩小后的宽高都不小于原图 x letterbox gain, 所以letterbox仍然只是缩小, 清晰度不变
+// EXIF方向可能交换宽高, gain按两种方向中较大的取
+// 其他格式(PNG等)的IMREAD_REDUCED_*是完整解码后再缩小, 没有收益, 所以只对文件头为JPEG的文件使用, 其余完整解码
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// 从JPEG文件头(SOFn段)读取宽高, 不解码
+static inline bool jpeg_size(const std::vector<uchar>& buf, int& w, int& h) {
+    const size_t n = buf.size();
+    if (n < 4 || buf[0] != 0xFF || buf[1] != 0xD8) return false;
+    size_t i = 2;
+    while (i + 4 <= n) {
+        if (buf[i] != 0xFF) return false;
+        const uchar marker = buf[i + 1];
+        if (marker == 0xFF) { // 填充字节
+            i++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) { // 没有长度的标记
+            i += 2;
+            continue;
+        }
+        // SOF0..SOF15, 排除DHT(C4)、JPG(C8)、DAC(CC)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (i + 9 > n) return false;
+            h = (buf[i + 5] << 8) | buf[i + 6];
+            w = (buf[i + 7] << 8) | buf[i + 8];
+            return w > 0 && h > 0;
+        }
+        if (marker == 0xDA || marker == 0xD9) return false; // 到了扫描数据还没有SOF
+        i += 2 + ((buf[i + 2] << 8) | buf[i + 3]);
+    }
+    return false;
+}
+
+// letterbox到target_w x target_h时可用的最大DCT缩放倍数(1, 2, 4, 8)
+// rect模式(长边缩放到long_side)传long_side x long_side
+static inline int jpeg_scale_for(int w, int h, int target_w, int target_h) {
+    float gain = std::max(std::min(target_w / float(w), target_h / float(h)), std::min(target_w / float(h), target_h / float(w)));
+    int scale = 8;
+    while (scale > 1 && scale * gain > 1.0f) scale /= 2;
+    return scale;
+}
+
+static inline int reduced_flag(int scale) {
+    switch (scale) {
+    case 2: return cv::IMREAD_REDUCED_COLOR_2;
+    case 4: return cv::IMREAD_REDUCED_COLOR_4;
+    case 8: return cv::IMREAD_REDUCED_COLOR_8;
+    default: return cv::IMREAD_COLOR;
+    }
+}
+
+static inline bool read_file_bytes(const std::string& path, std::vector<uchar>& buf) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) return false;
+    file.seekg(0, file.end);
+    buf.resize((size_t)file.tellg());
+    file.seekg(0, file.beg);
+    file.read(reinterpret_cast<char*>(buf.data()), buf.size());
+    return file.good() && !buf.empty();
+}
+
+// 解码已读入内存的图片, scale为实际使用的缩放倍数(非JPEG为1)
+static inline cv::Mat decode_for_input(const std::vector<uchar>& buf, int target_w, int target_h, int* scale = nullptr) {
+    int w = 0, h = 0, s = 1;
+    if (jpeg_size(buf, w, h)) s = jpeg_scale_for(w, h, target_w, target_h);
+    if (scale) *scale = s;
+    return cv::imdecode(buf, reduced_flag(s));
+}
+
+// cv::imread(path)的替代: 结果为BGR, 尺寸可能是原图的1/scale; 检测框需要原图坐标时按原图尺寸(scale倍)换算
+static inline cv::Mat imread_for_input(const std::string& path, int target_w, int target_h, int* scale = nullptr) {
+    std::vector<uchar> buf;
+    if (!read_file_bytes(path, buf)) return cv::Mat();
+    return decode_for_input(buf, target_w, target_h, scale);
+}
+
+#endif  // TRTX_YOLOV5_IMAGE_DECODE_H_
@@ -0,0 +1,172 @@
+#ifndef TRTX_YOLOV5_JSON_READER_H_
+#define TRTX_YOLOV5_JSON_READER_H_
+
+// 顺序读取的JSON解析器(不建DOM): 调用方按结构逐层读取需要的字段, 其余的值用skip跳过
+// COCO标注文件中占大头的segmentation等字段只扫描不分配, instances_val2017.json可直接在内存中解析
+// 出错时ok()为false, 之后的读取都返回false, 调用方的循环随之结束
+
+#include <stdlib.h>
+#include <string>
+
+class JsonReader {
+public:
+    explicit JsonReader(const std::string& text) : p_(text.c_str()), end_(text.c_str() + text.size()), ok_(true) {}
+
+    bool ok() const { return ok_; }
+    // 下一个非空白字符, 不消耗
+    char peek() {
+        skip_ws();
+        return p_ < end_ ? *p_ : '\0';
+    }
+
+    bool begin_object() { return expect('{'); }
+    // 读取对象的下一个键(包括':'), 遇到'}'时消耗它并返回false
+    bool next_key(std::string& key) {
+        if (!next_member('}')) return false;
+        if (!read_string(key) || !expect(':')) return false;
+        return true;
+    }
+    bool begin_array() { return expect('['); }
+    // 数组还有下一个元素时返回true, 遇到']'时消耗它并返回false
+    bool next_element() { return next_member(']'); }
+
+    bool read_string(std::string& s) {
+        if (!expect('"')) return false;
+        s.clear();
+        while (p_ < end_ && *p_ != '"') {
+            char c = *p_++;
+            if (c != '\\') {
+                s += c;
+                continue;
+            }
+            if (p_ >= end_) return fail();
+            c = *p_++;
+            switch (c) {
+            case 'b': s += '\b'; break;
+            case 'f': s += '\f'; break;
+            case 'n': s += '\n'; break;
+            case 'r': s += '\r'; break;
+            case 't': s += '\t'; break;
+            case 'u': {
+                unsigned cp = 0;
+                if (!read_hex4(cp)) return false;
+                // UTF-16代理对
+                if (cp >= 0xD800 && cp < 0xDC00 && end_ - p_ >= 6 && p_[0] == '\\' && p_[1] == 'u') {
+                    unsigned lo = 0;
+                    p_ += 2;
+                    if (!read_hex4(lo)) return false;
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                }
+                append_utf8(s, cp);
+                break;
+            }
+            default: s += c; break; // \" \\ \/
+            }
+        }
+        if (p_ >= end_) return fail();
+        p_++;
+        return true;
+    }
+
+    bool read_number(double& v) {
+        skip_ws();
+        if (!ok_ || p_ >= end_) return fail();
+        char* after = nullptr;
+        v = strtod(p_, &after);
+        if (after == p_) return fail();
+        p_ = after;
+        return true;
+    }
+
+    // 跳过任意一个值(对象/数组递归跳过)
+    bool skip() {
+        char c = peek();
+        if (!ok_) return false;
+        if (c == '"') {
+            std::string tmp;
+            return read_string(tmp);
+        }
+        if (c == '{') {
+            std::string key;
+            begin_object();
+            while (next_key(key)) {
+                if (!skip()) return false;
+            }
+            return ok_;
+        }
+        if (c == '[') {
+            begin_array();
+            while (next_element()) {
+                if (!skip()) return false;
+            }
+            return ok_;
+        }
+        // 数字、true/false/null
+        const char* start = p_;
+        while (p_ < end_ && *p_ != ',' && *p_ != '}' && *p_ != ']' && *p_ != ' ' && *p_ != '\n' && *p_ != '\r' && *p_ != '\t') p_++;
+        return p_ > start || fail();
+    }
+
+private:
+    void skip_ws() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) p_++;
+    }
+    bool fail() {
+        ok_ = false;
+        return false;
+    }
+    bool expect(char c) {
+        if (peek() != c || !ok_) return fail();
+        p_++;
+        return true;
+    }
+    // 对象/数组中下一个成员: 跳过分隔的','; 遇到close时消耗并返回false
+    bool next_member(char close) {
+        char c = peek();
+        if (!ok_) return false;
+        if (c == close) {
+            p_++;
+            return false;
+        }
+        if (c == ',') {
+            p_++;
+            if (peek() == close) return fail();
+        }
+        return p_ < end_ || fail();
+    }
+    bool read_hex4(unsigned& cp) {
+        if (end_ - p_ < 4) return fail();
+        for (int i = 0; i < 4; i++) {
+            char h = *p_++;
+            cp <<= 4;
+            if (h >= '0' && h <= '9') cp |= h - '0';
+            else if (h >= 'a' && h <= 'f') cp |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') cp |= h - 'A' + 10;
+            else return fail();
+        }
+        return true;
+    }
+    static void append_utf8(std::string& s, unsigned cp) {
+        if (cp < 0x80) {
+            s += (char)cp;
+        } else if (cp < 0x800) {
+            s += (char)(0xC0 | (cp >> 6));
+            s += (char)(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            s += (char)(0xE0 | (cp >> 12));
+            s += (char)(0x80 | ((cp >> 6) & 0x3F));
+            s += (char)(0x80 | (cp & 0x3F));
+        } else {
+            s += (char)(0xF0 | (cp >> 18));
+            s += (char)(0x80 | ((cp >> 12) & 0x3F));
+            s += (char)(0x80 | ((cp >> 6) & 0x3F));
+            s += (char)(0x80 | (cp & 0x3F));
+        }
+    }
+
+    const char* p_;
+    const char* end_;
+    bool ok_;
+};
+
+#endif  // TRTX_YOLOV5_JSON_READER_H_
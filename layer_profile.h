@@ -0,0 +1,178 @@
+#ifndef TRTX_YOLOV5_LAYER_PROFILE_H_
+#define TRTX_YOLOV5_LAYER_PROFILE_H_
+
+// 逐层耗时统计: 汇总IProfiler::reportLayerTime报告的(层名, 毫秒), 按model.N模块聚合后输出排序表和JSON
+// build_engine把每个模块新增的层命名为"<模块>:<类型>/<序号>"(如"model.10:SPP/3", 见graph_trt.h的name_module_layers),
+// TensorRT融合后的层名为多个原始层名的组合(如"model.1:Conv/0 + model.1:Conv/2"、"{ForeignNode[model.3:Conv/0...model.5:Conv/1]}"),
+// 其中出现的每个不同模块平分该层的耗时; 找不到模块名的层(如未命名的reformat层)归入"other"
+// 不依赖TensorRT, 可以直接用构造的记录测试
+
+#include <ctype.h>
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct LayerModuleRef {
+    std::string module;  // 如"model.10"
+    std::string kind;    // 如"SPP"
+};
+
+// 从(可能融合过的)层名中按出现顺序取出不重复的模块
+static inline std::vector<LayerModuleRef> parse_layer_modules(const std::string& name) {
+    std::vector<LayerModuleRef> refs;
+    auto is_token = [](char c) { return isalnum((unsigned char)c) || c == '_' || c == '.'; };
+    for (size_t colon = name.find(':'); colon != std::string::npos; colon = name.find(':', colon + 1)) {
+        size_t begin = colon;
+        // 模块名中不会有连续的'.', 遇到"..."(ForeignNode的范围)即停止
+        while (begin > 0 && is_token(name[begin - 1]) && !(name[begin - 1] == '.' && name[begin] == '.')) begin--;
+        while (begin < colon && name[begin] == '.') begin++;
+        if (begin == colon || !isalpha((unsigned char)name[begin])) continue;
+        size_t end = colon + 1;
+        while (end < name.size() && isalnum((unsigned char)name[end])) end++;
+        if (end == colon + 1) continue;
+        LayerModuleRef ref{ name.substr(begin, colon - begin), name.substr(colon + 1, end - colon - 1) };
+        bool seen = false;
+        for (const auto& r : refs) seen = seen || r.module == ref.module;
+        if (!seen) refs.push_back(ref);
+    }
+    return refs;
+}
+
+class LayerProfile {
+public:
+    struct LayerStat {
+        std::string name;
+        std::string module;  // 融合了多个模块时为第一个
+        double total_ms, min_ms, max_ms;
+        int count;
+    };
+
+    struct ModuleStat {
+        std::string module;
+        std::string kind;
+        double total_ms;
+        int layers;  // 有耗时落在该模块上的engine层数
+    };
+
+    void add(const std::string& layer, float ms) {
+        auto it = index_.find(layer);
+        if (it == index_.end()) {
+            it = index_.emplace(layer, layers_.size()).first;
+            refs_.push_back(parse_layer_modules(layer));
+            layers_.push_back(LayerStat{ layer, refs_.back().empty() ? "other" : refs_.back()[0].module, 0, ms, ms, 0 });
+        }
+        LayerStat& s = layers_[it->second];
+        s.total_ms += ms;
+        s.min_ms = std::min(s.min_ms, (double)ms);
+        s.max_ms = std::max(s.max_ms, (double)ms);
+        s.count++;
+    }
+
+    // 每次推理结束后调用一次, 平均耗时按迭代次数计算
+    void end_iteration() { iterations_++; }
+
+    int iterations() const { return iterations_; }
+
+    double total_ms() const {
+        double t = 0;
+        for (const auto& s : layers_) t += s.total_ms;
+        return t;
+    }
+
+    // 按总耗时从大到小
+    std::vector<LayerStat> layers() const {
+        std::vector<LayerStat> out = layers_;
+        std::stable_sort(out.begin(), out.end(), [](const LayerStat& a, const LayerStat& b) { return a.total_ms > b.total_ms; });
+        return out;
+    }
+
+    std::vector<ModuleStat> modules() const {
+        std::vector<ModuleStat> out;
+        std::map<std::string, size_t> pos;
+        for (size_t i = 0; i < layers_.size(); i++) {
+            std::vector<LayerModuleRef> refs = refs_[i];
+            if (refs.empty()) refs.push_back(LayerModuleRef{ "other", "" });
+            for (const auto& r : refs) {
+                auto it = pos.find(r.module);
+                if (it == pos.end()) {
+                    it = pos.emplace(r.module, out.size()).first;
+                    out.push_back(ModuleStat{ r.module, r.kind, 0, 0 });
+                }
+                out[it->second].total_ms += layers_[i].total_ms / refs.size();
+                out[it->second].layers++;
+            }
+        }
+        std::stable_sort(out.begin(), out.end(), [](const ModuleStat& a, const ModuleStat& b) { return a.total_ms > b.total_ms; });
+        return out;
+    }
+
+    void print_table(std::ostream& os, int top_layers = 20) const {
+        double total = total_ms();
+        int iters = std::max(1, iterations_);
+        char line[512];
+        snprintf(line, sizeof(line), "Layer profile: %d iterations, %.3f ms per iteration\n", iterations_, total / iters);
+        os << line;
+        snprintf(line, sizeof(line), "%-14s %-10s %7s %12s %8s\n", "module", "kind", "layers", "ms/iter", "%");
+        os << line;
+        for (const auto& m : modules()) {
+            snprintf(line, sizeof(line), "%-14s %-10s %7d %12.4f %7.2f%%\n", m.module.c_str(), m.kind.c_str(), m.layers, m.total_ms / iters, total > 0 ? 100.0 * m.total_ms / total : 0.0);
+            os << line;
+        }
+        snprintf(line, sizeof(line), "top %d engine layers:\n%12s %10s %10s %8s  %s\n", top_layers, "ms/iter", "min", "max", "%", "name");
+        os << line;
+        std::vector<LayerStat> sorted = layers();
+        for (int i = 0; i < (int)sorted.size() && i < top_layers; i++) {
+            const LayerStat& s = sorted[i];
+            snprintf(line, sizeof(line), "%12.4f %10.4f %10.4f %7.2f%%  ", s.total_ms / iters, s.min_ms, s.max_ms, total > 0 ? 100.0 * s.total_ms / total : 0.0);
+            os << line << s.name << "\n";
+        }
+    }
+
+    void write_json(std::ostream& os) const {
+        double total = total_ms();
+        int iters = std::max(1, iterations_);
+        os << "{\"iterations\": " << iterations_ << ", \"ms_per_iteration\": " << total / iters << ",\n \"modules\": [";
+        std::vector<ModuleStat> mods = modules();
+        for (size_t i = 0; i < mods.size(); i++) {
+            os << (i ? ",\n  " : "\n  ") << "{\"module\": " << json_string(mods[i].module) << ", \"kind\": " << json_string(mods[i].kind)
+               << ", \"layers\": " << mods[i].layers << ", \"ms_per_iteration\": " << mods[i].total_ms / iters << "}";
+        }
+        os << "],\n \"layers\": [";
+        std::vector<LayerStat> sorted = layers();
+        for (size_t i = 0; i < sorted.size(); i++) {
+            const LayerStat& s = sorted[i];
+            os << (i ? ",\n  " : "\n  ") << "{\"name\": " << json_string(s.name) << ", \"module\": " << json_string(s.module)
+               << ", \"ms_per_iteration\": " << s.total_ms / iters << ", \"min_ms\": " << s.min_ms << ", \"max_ms\": " << s.max_ms
+               << ", \"calls\": " << s.count << "}";
+        }
+        os << "]}\n";
+    }
+
+private:
+    static std::string json_string(const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if ((unsigned char)c < 0x20) {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+        return out + "\"";
+    }
+
+    std::vector<LayerStat> layers_;
+    std::vector<std::vector<LayerModuleRef>> refs_;
+    std::map<std::string, size_t> index_;
+    int iterations_ = 0;
+};
+
+#endif  // TRTX_YOLOV5_LAYER_PROFILE_H_
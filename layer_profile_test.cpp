@@ -0,0 +1,136 @@
+// 逐层耗时统计(layer_profile.h)的测试, 用构造的(层名, 毫秒)记录, 只用CPU
+//   - parse_layer_modules: 融合层"model.1:Conv/0 + model.1:Conv/2"只算一个模块, "{ForeignNode[model.3:Conv/0...model.5:C3/1]}"取范围两端的模块,
+//     未命名的层和指向未命名层的reformat层没有模块
+//   - modules(): 融合了多个模块的层由这些模块平分, 没有模块的层归入"other"; 各模块之和等于total_ms, 按耗时从大到小
+//   - layers(): 每层的累计/最小/最大耗时和调用次数
+// ./layer_profile_test, 失败时返回非0
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "layer_profile.h"
+#include "test_check.h"
+
+static const char* FUSED = "model.1:Conv/0 + model.1:Conv/2";
+static const char* FOREIGN = "{ForeignNode[model.3:Conv/0...model.5:C3/1]}";
+static const char* C3 = "model.5:C3/4";
+static const char* SPP_FUSED = "model.10:SPP/3 + model.1:Conv/5";
+static const char* REFORMAT = "Reformatting CopyNode for Input Tensor 0 to (Unnamed Layer* 12) [Shuffle]";
+static const char* UNNAMED = "(Unnamed Layer* 7) [Shuffle]";
+
+static void check_refs(const char* name, const std::vector<std::string>& modules, const std::vector<std::string>& kinds) {
+    std::vector<LayerModuleRef> refs = parse_layer_modules(name);
+    CHECK(refs.size() == modules.size());
+    if (refs.size() != modules.size()) {
+        std::cerr << "  " << name << ": " << refs.size() << " modules" << std::endl;
+        return;
+    }
+    for (size_t i = 0; i < refs.size(); i++) CHECK(refs[i].module == modules[i] && refs[i].kind == kinds[i]);
+}
+
+static void test_parse() {
+    check_refs("model.10:SPP/3", { "model.10" }, { "SPP" });
+    check_refs(FUSED, { "model.1" }, { "Conv" });
+    check_refs(FOREIGN, { "model.3", "model.5" }, { "Conv", "C3" });
+    check_refs(SPP_FUSED, { "model.10", "model.1" }, { "SPP", "Conv" });
+    check_refs("PWN(model.2:C3/7 + model.2:C3/8)", { "model.2" }, { "C3" });
+    check_refs(REFORMAT, {}, {});
+    check_refs(UNNAMED, {}, {});
+    check_refs("data", {}, {});
+    // 指向已命名层的reformat层算到该模块上
+    check_refs("Reformatting CopyNode for Input Tensor 0 to model.24:YoloLayer/0", { "model.24" }, { "YoloLayer" });
+}
+
+static const LayerProfile::ModuleStat* find_module(const std::vector<LayerProfile::ModuleStat>& mods, const std::string& module) {
+    for (const auto& m : mods) {
+        if (m.module == module) return &m;
+    }
+    return nullptr;
+}
+
+static void test_split() {
+    // 两次迭代, 第二次每层的耗时为第一次的2倍; 每次迭代的耗时:
+    //   model.1: FUSED 1.0 + SPP_FUSED的一半 0.3, model.3: FOREIGN的一半 1.5, model.5: FOREIGN的一半 1.5 + C3 0.5,
+    //   model.10: SPP_FUSED的一半 0.3, other: REFORMAT 0.25 + UNNAMED 0.25
+    const char* names[] = { FUSED, FOREIGN, C3, SPP_FUSED, REFORMAT, UNNAMED };
+    const float ms[] = { 1.0f, 3.0f, 0.5f, 0.6f, 0.25f, 0.25f };
+    LayerProfile profile;
+    for (int iter = 1; iter <= 2; iter++) {
+        for (int i = 0; i < 6; i++) profile.add(names[i], ms[i] * iter);
+        profile.end_iteration();
+    }
+    CHECK(profile.iterations() == 2);
+    CHECK_NEAR(profile.total_ms(), 3 * 5.6, 1e-5);
+
+    std::vector<LayerProfile::ModuleStat> mods = profile.modules();
+    CHECK(mods.size() == 5);
+    double sum = 0;
+    for (const auto& m : mods) sum += m.total_ms;
+    CHECK_NEAR(sum, profile.total_ms(), 1e-5);
+    for (size_t i = 1; i < mods.size(); i++) CHECK(mods[i - 1].total_ms >= mods[i].total_ms);
+
+    struct Expected {
+        const char* module;
+        double ms_per_iter;
+        int layers;
+    };
+    const Expected expected[] = {
+        { "model.5", 2.0, 2 },
+        { "model.3", 1.5, 1 },
+        { "model.1", 1.3, 2 },
+        { "other", 0.5, 2 },
+        { "model.10", 0.3, 1 },
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        const Expected& e = expected[i];
+        const LayerProfile::ModuleStat* m = find_module(mods, e.module);
+        CHECK(m != nullptr);
+        if (!m) continue;
+        CHECK_NEAR(m->total_ms / profile.iterations(), e.ms_per_iter * 1.5, 1e-5);
+        CHECK(m->layers == e.layers);
+        CHECK(i >= mods.size() || mods[i].module == e.module);
+    }
+    // kind取该模块第一次出现时的类型
+    CHECK(find_module(mods, "model.5") && find_module(mods, "model.5")->kind == "C3");
+    CHECK(find_module(mods, "model.3") && find_module(mods, "model.3")->kind == "Conv");
+
+    std::vector<LayerProfile::LayerStat> layers = profile.layers();
+    CHECK(layers.size() == 6);
+    for (size_t i = 1; i < layers.size(); i++) CHECK(layers[i - 1].total_ms >= layers[i].total_ms);
+    if (layers.size() == 6) {
+        CHECK(layers[0].name == FOREIGN && layers[0].module == "model.3");
+        CHECK_NEAR(layers[0].total_ms, 9.0, 1e-5);
+        CHECK_NEAR(layers[0].min_ms, 3.0, 1e-5);
+        CHECK_NEAR(layers[0].max_ms, 6.0, 1e-5);
+        CHECK(layers[0].count == 2);
+        // 耗时相同的两层保持加入的顺序
+        CHECK(layers[4].name == REFORMAT && layers[4].module == "other");
+        CHECK(layers[5].name == UNNAMED && layers[5].module == "other");
+    }
+
+    std::ostringstream json, table;
+    profile.write_json(json);
+    profile.print_table(table);
+    CHECK(json.str().find("\"iterations\": 2") != std::string::npos);
+    CHECK(json.str().find("{\"module\": \"other\", \"kind\": \"\", \"layers\": 2") != std::string::npos);
+    CHECK(table.str().find("2 iterations") != std::string::npos);
+}
+
+static void test_empty() {
+    LayerProfile profile;
+    CHECK(profile.modules().empty() && profile.layers().empty());
+    CHECK(profile.total_ms() == 0);
+    std::ostringstream os;
+    profile.print_table(os);
+    profile.write_json(os);
+    CHECK(os.str().find("\"modules\": []") != std::string::npos);
+}
+
+int main() {
+    test_parse();
+    test_split();
+    test_empty();
+    if (test_failures()) std::cerr << test_failures() << " checks failed" << std::endl;
+    else std::cout << "layer_profile_test passed" << std::endl;
+    return test_failures() ? 1 : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef TRTX_YOLOV5_LETTERBOX_H_
+#define TRTX_YOLOV5_LETTERBOX_H_
+
+// 每帧的letterbox参数(Yolo::Letterbox, 定义在yolo_types.h): 网络输入(canvas)尺寸、缩放和padding
+// 固定模式: canvas恒为INPUT_W x INPUT_H, 与preprocess_img/scale_coords相同
+// rect模式: 长边缩放到long_side, canvas取能放下缩放后图像的最小64(P6的最大stride)倍数, padding最多63像素
+// 同一canvas的图像可以组成一个batch, engine的优化profile覆盖这些尺寸(见yolov5-p6.cpp)
+
+#include <algorithm>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "yolo_types.h"
+
+static inline Yolo::Letterbox fixed_letterbox(int img_w, int img_h, int input_w, int input_h) {
+    Yolo::Letterbox lb;
+    lb.canvas_w = input_w;
+    lb.canvas_h = input_h;
+    lb.gain = std::min(input_w / float(img_w), input_h / float(img_h));
+    // 与preprocess_img一致: 缩放后的尺寸取整, padding居中
+    lb.w = std::min(input_w, int(img_w * lb.gain));
+    lb.h = std::min(input_h, int(img_h * lb.gain));
+    lb.pad_x = (input_w - lb.w) / 2;
+    lb.pad_y = (input_h - lb.h) / 2;
+    return lb;
+}
+
+static inline Yolo::Letterbox rect_letterbox(int img_w, int img_h, int long_side) {
+    Yolo::Letterbox lb;
+    lb.gain = long_side / float(std::max(img_w, img_h));
+    lb.w = std::max(1, std::min(long_side, int(img_w * lb.gain + 0.5f)));
+    lb.h = std::max(1, std::min(long_side, int(img_h * lb.gain + 0.5f)));
+    lb.canvas_w = (lb.w + Yolo::CANVAS_STRIDE - 1) / Yolo::CANVAS_STRIDE * Yolo::CANVAS_STRIDE;
+    lb.canvas_h = (lb.h + Yolo::CANVAS_STRIDE - 1) / Yolo::CANVAS_STRIDE * Yolo::CANVAS_STRIDE;
+    lb.pad_x = (lb.canvas_w - lb.w) / 2;
+    lb.pad_y = (lb.canvas_h - lb.h) / 2;
+    return lb;
+}
+
+// 按lb缩放并居中放到灰色(128)canvas上, BGR
+static inline cv::Mat letterbox_img(const cv::Mat& img, const Yolo::Letterbox& lb) {
+    cv::Mat out(lb.canvas_h, lb.canvas_w, CV_8UC3, cv::Scalar(128, 128, 128));
+    cv::Mat roi = out(cv::Rect(lb.pad_x, lb.pad_y, lb.w, lb.h)); // 尺寸一致, resize直接写入canvas
+    cv::resize(img, roi, roi.size(), 0, 0, cv::INTER_LINEAR);
+    return out;
+}
+
+// xywh2xyxy之后调用, 网络输入坐标 -> 原图坐标, 并裁剪到原图范围内
+static inline void scale_coords(std::vector<Yolo::Detection>& res, int img_w, int img_h, const Yolo::Letterbox& lb) {
+    for (auto& det : res) {
+        det.bbox[0] = std::min(std::max((det.bbox[0] - lb.pad_x) / lb.gain, 0.f), float(img_w));
+        det.bbox[1] = std::min(std::max((det.bbox[1] - lb.pad_y) / lb.gain, 0.f), float(img_h));
+        det.bbox[2] = std::min(std::max((det.bbox[2] - lb.pad_x) / lb.gain, 0.f), float(img_w));
+        det.bbox[3] = std::min(std::max((det.bbox[3] - lb.pad_y) / lb.gain, 0.f), float(img_h));
+    }
+}
+
+// 按canvas尺寸分组, 每组内保持原来的顺序; groups[i]为同一canvas的下标列表
+static inline void group_by_canvas(const std::vector<Yolo::Letterbox>& lbs, std::vector<std::vector<int>>& groups) {
+    groups.clear();
+    for (int i = 0; i < (int)lbs.size(); i++) {
+        size_t g = 0;
+        for (; g < groups.size(); g++) {
+            const Yolo::Letterbox& first = lbs[groups[g][0]];
+            if (first.canvas_w == lbs[i].canvas_w && first.canvas_h == lbs[i].canvas_h) break;
+        }
+        if (g == groups.size()) groups.emplace_back();
+        groups[g].push_back(i);
+    }
+}
+
+#endif  // TRTX_YOLOV5_LETTERBOX_H_
@@ -0,0 +1,326 @@
+#ifndef TRTX_YOLOV5_METRICS_H_
+#define TRTX_YOLOV5_METRICS_H_
+
+// 进程内运行指标: 计数器(Counter)、瞬时值(Gauge)和HDR式对数-线性桶的直方图(Histogram)
+// 更新全部是无锁的原子操作, 可以在推理/解码线程中直接调用; 只有注册(第一次取某个指标)加锁
+// 导出为Prometheus文本格式(0.0.4): MetricsExporter在本机端口上提供HTTP(GET任意路径), 并可定期写入文件(先写临时文件再rename)
+// 直方图的原始值为整数(耗时用微秒), 导出时乘以scale(微秒 -> 秒); Prometheus的桶边界取2的幂, 文件中另外给出p50/p90/p99/max
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Counter {
+public:
+    void inc(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+    uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{ 0 };
+};
+
+class Gauge {
+public:
+    void set(double v) { value_.store(v, std::memory_order_relaxed); }
+    double value() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<double> value_{ 0.0 };
+};
+
+// 对数-线性桶: 小于SUB_BUCKETS的值每个整数一个桶, 之后每个2的幂区间等分为SUB_BUCKETS个桶, 相对误差不超过1/SUB_BUCKETS
+class Histogram {
+public:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+    explicit Histogram(double scale = 1.0) : scale_(scale) {
+        for (auto& b : buckets_) b.store(0, std::memory_order_relaxed);
+    }
+
+    void observe(uint64_t v) {
+        buckets_[bucket_of(v)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(v, std::memory_order_relaxed);
+        uint64_t max = max_.load(std::memory_order_relaxed);
+        while (v > max && !max_.compare_exchange_weak(max, v, std::memory_order_relaxed)) {}
+    }
+
+    static int bucket_of(uint64_t v) {
+        if (v < (uint64_t)SUB_BUCKETS) return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - SUB_BITS;
+        return (shift + 1) * SUB_BUCKETS + (int)((v >> shift) & (SUB_BUCKETS - 1));
+    }
+    // 桶i包含的最大值
+    static uint64_t bucket_upper(int i) {
+        if (i < SUB_BUCKETS) return (uint64_t)i;
+        int shift = i / SUB_BUCKETS - 1;
+        uint64_t lower = (uint64_t)(SUB_BUCKETS + i % SUB_BUCKETS) << shift;
+        return lower + ((uint64_t)1 << shift) - 1;
+    }
+
+    double scale() const { return scale_; }
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+    void snapshot(std::vector<uint64_t>& counts) const {
+        counts.resize(NUM_BUCKETS);
+        for (int i = 0; i < NUM_BUCKETS; i++) counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    // 分位数(原始单位), 取所在桶的上界
+    uint64_t quantile(double q) const {
+        std::vector<uint64_t> counts;
+        snapshot(counts);
+        uint64_t total = 0;
+        for (uint64_t c : counts) total += c;
+        if (total == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(q * total + 0.5)), seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= rank) return std::min(bucket_upper(i), max());
+        }
+        return max();
+    }
+
+private:
+    double scale_;
+    std::atomic<uint64_t> buckets_[NUM_BUCKETS];
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> sum_{ 0 };
+    std::atomic<uint64_t> max_{ 0 };
+};
+
+// 作用域计时, 析构时以微秒记入直方图
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& h) : h_(h), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedTimer() {
+        h_.observe((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_).count());
+    }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& h_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// 指标按(名称, 标签)注册, 返回的引用在registry的生命周期内有效; labels为Prometheus格式的标签串, 如source="0"
+class MetricsRegistry {
+public:
+    Counter& counter(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return get(counters_, name, help, labels, "counter", [] { return new Counter(); });
+    }
+    Gauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "") {
+        return get(gauges_, name, help, labels, "gauge", [] { return new Gauge(); });
+    }
+    Histogram& histogram(const std::string& name, const std::string& help, const std::string& labels = "", double scale = 1.0) {
+        return get(histograms_, name, help, labels, "histogram", [scale] { return new Histogram(scale); });
+    }
+
+    // Prometheus文本格式
+    std::string prometheus_text() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::ostringstream out;
+        out.precision(12);
+        std::vector<uint64_t> counts;
+        for (const auto& fam : families_) {
+            const std::string& name = fam.first;
+            out << "# HELP " << name << " " << fam.second.help << "\n# TYPE " << name << " " << fam.second.type << "\n";
+            for (const std::string& labels : fam.second.series) {
+                const std::string key = name + "{" + labels + "}";
+                const std::string braces = labels.empty() ? "" : "{" + labels + "}";
+                if (fam.second.type == "counter") {
+                    out << name << braces << " " << counters_.at(key)->value() << "\n";
+                } else if (fam.second.type == "gauge") {
+                    out << name << braces << " " << gauges_.at(key)->value() << "\n";
+                } else {
+                    const Histogram& h = *histograms_.at(key);
+                    h.snapshot(counts);
+                    write_buckets(out, name, labels, h, counts);
+                    out << name << "_sum" << braces << " " << h.sum() * h.scale() << "\n";
+                    out << name << "_count" << braces << " " << h.count() << "\n";
+                }
+            }
+        }
+        return out.str();
+    }
+
+    // 写入文件的格式: Prometheus文本 + 每个直方图的分位数(注释行, 不影响node_exporter textfile的解析)
+    std::string dump_text() const {
+        std::ostringstream out;
+        out << prometheus_text();
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& it : histograms_) {
+            const Histogram& h = *it.second;
+            if (h.count() == 0) continue;
+            out << "# " << it.first << " count " << h.count() << " p50 " << h.quantile(0.5) * h.scale() << " p90 " << h.quantile(0.9) * h.scale()
+                << " p99 " << h.quantile(0.99) * h.scale() << " max " << h.max() * h.scale() << "\n";
+        }
+        return out.str();
+    }
+
+private:
+    struct Family {
+        std::string help, type;
+        std::vector<std::string> series; // 标签串, 按注册顺序
+    };
+
+    template <typename T, typename Make>
+    T& get(std::map<std::string, std::unique_ptr<T>>& table, const std::string& name, const std::string& help, const std::string& labels, const char* type, Make make) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const std::string key = name + "{" + labels + "}";
+        auto it = table.find(key);
+        if (it != table.end()) return *it->second;
+        Family& fam = families_[name];
+        if (fam.type.empty()) {
+            fam.help = help;
+            fam.type = type;
+        }
+        fam.series.push_back(labels);
+        T* metric = make();
+        table[key].reset(metric);
+        return *metric;
+    }
+
+    // 累计桶: 边界取2的幂(原始单位), 只输出到最大值所在的边界为止, 最后是+Inf
+    static void write_buckets(std::ostringstream& out, const std::string& name, const std::string& labels, const Histogram& h, const std::vector<uint64_t>& counts) {
+        const std::string prefix = labels.empty() ? "" : labels + ",";
+        uint64_t cumulative = 0;
+        int i = 0;
+        for (uint64_t le = 1; ; le *= 2) {
+            while (i < Histogram::NUM_BUCKETS && Histogram::bucket_upper(i) <= le) cumulative += counts[i++];
+            out << name << "_bucket{" << prefix << "le=\"" << le * h.scale() << "\"} " << cumulative << "\n";
+            if (le >= h.max() || le >= ((uint64_t)1 << 62)) break;
+        }
+        out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << h.count() << "\n";
+    }
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Family> families_;
+    std::map<std::string, std::unique_ptr<Counter>> counters_;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges_;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms_;
+};
+
+// 进程内的全局registry
+static inline MetricsRegistry& metrics() {
+    static MetricsRegistry registry;
+    return registry;
+}
+
+// 后台线程: port > 0时在127.0.0.1:port上提供Prometheus文本, dump_path非空时每dump_sec秒写一次文件
+class MetricsExporter {
+public:
+    MetricsExporter(MetricsRegistry& registry, int port, const std::string& dump_path, int dump_sec)
+        : registry_(registry), dump_path_(dump_path), dump_sec_(std::max(1, dump_sec)), fd_(-1), stop_(false) {
+        if (port > 0) fd_ = listen_local(port);
+        if (fd_ >= 0) std::cout << "Metrics on http://127.0.0.1:" << port << "/metrics" << std::endl;
+        if (fd_ >= 0 || !dump_path_.empty()) thread_ = std::thread([this] { loop(); });
+    }
+    ~MetricsExporter() {
+        stop_ = true;
+        if (thread_.joinable()) thread_.join();
+        if (fd_ >= 0) close(fd_);
+        if (!dump_path_.empty()) dump();
+    }
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    bool dump() const {
+        std::string text = registry_.dump_text();
+        std::string tmp = dump_path_ + ".tmp";
+        {
+            std::ofstream file(tmp);
+            if (!file) return false;
+            file << text;
+            if (!file.good()) return false;
+        }
+        return rename(tmp.c_str(), dump_path_.c_str()) == 0;
+    }
+
+private:
+    static int listen_local(int port) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+            std::cerr << "Metrics: can not listen on port " << port << std::endl;
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // 每个连接读完请求头后回复一次并关闭(Connection: close)
+    void serve(int client) const {
+        char buf[2048];
+        std::string request;
+        pollfd p = { client, POLLIN, 0 };
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 16384 && poll(&p, 1, 1000) > 0) {
+            ssize_t n = recv(client, buf, sizeof(buf), 0);
+            if (n <= 0) break;
+            request.append(buf, n);
+        }
+        std::string body = registry_.prometheus_text();
+        std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+        close(client);
+    }
+
+    void loop() {
+        auto next_dump = std::chrono::steady_clock::now() + std::chrono::seconds(dump_sec_);
+        while (!stop_) {
+            if (fd_ >= 0) {
+                pollfd p = { fd_, POLLIN, 0 };
+                if (poll(&p, 1, 200) > 0) {
+                    int client = accept(fd_, nullptr, nullptr);
+                    if (client >= 0) serve(client);
+                }
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            }
+            if (!dump_path_.empty() && std::chrono::steady_clock::now() >= next_dump) {
+                dump();
+                next_dump += std::chrono::seconds(dump_sec_);
+            }
+        }
+    }
+
+    MetricsRegistry& registry_;
+    std::string dump_path_;
+    int dump_sec_;
+    int fd_;
+    std::atomic<bool> stop_;
+    std::thread thread_;
+};
+
+#endif  // TRTX_YOLOV5_METRICS_H_
@@ -0,0 +1,197 @@
+#ifndef TRTX_YOLOV5_MODEL_CONFIG_H_
+#define TRTX_YOLOV5_MODEL_CONFIG_H_
+
+// 模型结构配置: 与ultralytics/yolov5的模型yaml(models/yolov5s.yaml、yolov5s6.yaml等)相同的格式
+//   nc / depth_multiple / width_multiple: 标量
+//   anchors: 每个检测head一行[w1,h1, w2,h2, w3,h3](像素, 正好CHECK_COUNT个), 可以是"- [...]"的块序列或[[...], ...]
+//   backbone / head: 层表, 每层为[from, number, module, args], 两段按顺序拼接, 第i层对应权重中的model.i
+// 只解析上述字段, 不是通用的yaml解析器; #之后为注释
+// 支持的module见yolov5_graph.h的build_yolov5: Focus, Conv, C3, BottleneckCSP, SPP, nn.Upsample, Concat, Detect
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "yolo_types.h"
+
+// yaml中的值: 标量(text)或列表(items)
+struct CfgValue {
+    bool is_list;
+    std::string text;
+    std::vector<CfgValue> items;
+
+    int as_int() const { return atoi(text.c_str()); }
+    float as_float() const { return (float)atof(text.c_str()); }
+};
+
+struct LayerSpec {
+    std::vector<int> from; // 输入层, 负数为相对本层的偏移(-1为上一层)
+    int number;            // 重复次数, 乘depth_multiple前
+    std::string module;
+    CfgValue args;
+};
+
+struct ModelConfig {
+    int nc;
+    float depth_multiple;
+    float width_multiple;
+    std::vector<std::vector<float>> anchors; // 每个head一组
+    std::vector<LayerSpec> layers;
+};
+
+// 解析"[a, [b, c], 'd']"形式的流式列表, pos为当前位置
+static inline bool parse_cfg_value(const std::string& s, size_t& pos, CfgValue& value, std::string& err) {
+    while (pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+    if (pos >= s.size()) {
+        err = "unexpected end of list";
+        return false;
+    }
+    if (s[pos] == '[') {
+        value.is_list = true;
+        pos++;
+        while (true) {
+            while (pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+            if (pos < s.size() && s[pos] == ']') {
+                pos++;
+                return true;
+            }
+            CfgValue item;
+            if (!parse_cfg_value(s, pos, item, err)) return false;
+            value.items.push_back(item);
+            while (pos < s.size() && isspace((unsigned char)s[pos])) pos++;
+            if (pos < s.size() && s[pos] == ',') {
+                pos++;
+            } else if (pos >= s.size() || s[pos] != ']') {
+                err = "expected ',' or ']' near \"" + s.substr(pos, 20) + "\"";
+                return false;
+            }
+        }
+    }
+    value.is_list = false;
+    size_t begin = pos;
+    while (pos < s.size() && s[pos] != ',' && s[pos] != ']' && s[pos] != '[') pos++;
+    std::string text = s.substr(begin, pos - begin);
+    while (!text.empty() && isspace((unsigned char)text.back())) text.pop_back();
+    if (text.size() >= 2 && (text[0] == '\'' || text[0] == '"') && text.back() == text[0]) text = text.substr(1, text.size() - 2);
+    value.text = text;
+    return true;
+}
+
+// 顶层字段的值: 同一行冒号之后的内容加上其后缩进的行; "- x"块序列转成[x, ...]
+static inline std::string cfg_section(const std::vector<std::string>& lines, size_t& i) {
+    std::string first = lines[i].substr(lines[i].find(':') + 1);
+    std::vector<std::string> rest;
+    for (i++; i < lines.size() && (lines[i].empty() || isspace((unsigned char)lines[i][0])); i++) {
+        if (lines[i].find_first_not_of(" \t\r") != std::string::npos) rest.push_back(lines[i]);
+    }
+    std::string text = first;
+    bool block = !rest.empty() && first.find_first_not_of(" \t\r") == std::string::npos;
+    if (block && rest[0].find_first_not_of(" \t") != std::string::npos && rest[0][rest[0].find_first_not_of(" \t")] == '-') {
+        text = "[";
+        for (size_t k = 0; k < rest.size(); k++) {
+            size_t dash = rest[k].find('-');
+            text += (k ? ", " : "") + rest[k].substr(dash + 1);
+        }
+        return text + "]";
+    }
+    for (const auto& line : rest) text += " " + line;
+    return text;
+}
+
+static inline bool parse_model_config(const std::string& yaml, ModelConfig& cfg, std::string& err) {
+    std::vector<std::string> lines;
+    std::istringstream in(yaml);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t hash = line.find('#');
+        if (hash != std::string::npos) line = line.substr(0, hash);
+        lines.push_back(line);
+    }
+
+    cfg.nc = 0;
+    cfg.depth_multiple = 1.0f;
+    cfg.width_multiple = 1.0f;
+    cfg.anchors.clear();
+    cfg.layers.clear();
+    for (size_t i = 0; i < lines.size();) {
+        const std::string& l = lines[i];
+        size_t colon = l.find(':');
+        if (l.empty() || isspace((unsigned char)l[0]) || colon == std::string::npos) {
+            i++;
+            continue;
+        }
+        std::string key = l.substr(0, colon);
+        std::string text = cfg_section(lines, i);
+        if (key == "nc") {
+            cfg.nc = atoi(text.c_str());
+        } else if (key == "depth_multiple") {
+            cfg.depth_multiple = (float)atof(text.c_str());
+        } else if (key == "width_multiple") {
+            cfg.width_multiple = (float)atof(text.c_str());
+        } else if (key == "anchors" || key == "backbone" || key == "head") {
+            CfgValue value;
+            size_t pos = 0;
+            if (!parse_cfg_value(text, pos, value, err)) {
+                err = key + ": " + err;
+                return false;
+            }
+            if (!value.is_list) {
+                err = key + " must be a list (anchors given as a count are not supported)";
+                return false;
+            }
+            for (const auto& item : value.items) {
+                if (key == "anchors") {
+                    std::vector<float> a;
+                    for (const auto& v : item.items) a.push_back(v.as_float());
+                    // YoloLayer每个head解码CHECK_COUNT个anchor, 插件参数是定长的
+                    if ((int)a.size() != Yolo::CHECK_COUNT * 2) {
+                        err = "anchors: each head needs " + std::to_string(Yolo::CHECK_COUNT) + " anchors (" +
+                              std::to_string(Yolo::CHECK_COUNT * 2) + " values), got " + std::to_string(a.size()) + " values";
+                        return false;
+                    }
+                    cfg.anchors.push_back(a);
+                    continue;
+                }
+                if (!item.is_list || item.items.size() != 4) {
+                    err = key + ": each layer must be [from, number, module, args]";
+                    return false;
+                }
+                LayerSpec layer;
+                const CfgValue& from = item.items[0];
+                if (from.is_list) {
+                    for (const auto& f : from.items) layer.from.push_back(f.as_int());
+                } else {
+                    layer.from.push_back(from.as_int());
+                }
+                layer.number = item.items[1].as_int();
+                layer.module = item.items[2].text;
+                layer.args = item.items[3];
+                cfg.layers.push_back(layer);
+            }
+        }
+    }
+    if (cfg.nc <= 0 || cfg.layers.empty()) {
+        err = "nc and the backbone/head layer table are required";
+        return false;
+    }
+    return true;
+}
+
+static inline bool load_model_config(const std::string& path, ModelConfig& cfg, std::string& err) {
+    std::ifstream input(path);
+    if (!input.is_open()) {
+        err = "cannot open " + path;
+        return false;
+    }
+    std::stringstream ss;
+    ss << input.rdbuf();
+    if (!parse_model_config(ss.str(), cfg, err)) {
+        err = path + ": " + err;
+        return false;
+    }
+    return true;
+}
+
+#endif  // TRTX_YOLOV5_MODEL_CONFIG_H_
@@ -0,0 +1,167 @@
+// GPU NMS的host参考实现(yolo_nms.h的nms_host, 与NmsLayer的kernel步骤相同)与host端nms(postprocess.h)的随机对比测试, 只用CPU
+// 两者保留的框集合必须相同(输出顺序不同: nms_host按conf降序, nms按类别分组), 覆盖
+//   - conf相同的重叠框(conf只取少数几个值): 两边都保留下标小的那个
+//   - 不同类别的框完全重叠: 互不抑制
+//   - 候选数超过NMS_SORT_SIZE(1024)和MAX_OUTPUT_BBOX_COUNT: 两边都只看缓冲区中的前MAX_OUTPUT_BBOX_COUNT个
+//   - conf恰好等于conf_thresh的框: 两边都去掉
+// nms(按类别分桶)和nms_generic(std::map)都与nms_host比较, 类别数6/80/3
+// ./nms_test [随机轮数], 失败时返回非0
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "postprocess.h"
+#include "yolo_nms.h"
+#include "test_check.h"
+
+static const int DET_SIZE = sizeof(Yolo::Detection) / sizeof(float);
+static const float CONF_THRESH = 0.5f;
+static const float NMS_THRESH = 0.45f;
+static const int COCO_CLASSES = 80;
+
+// 比较用的全序: 类别, conf降序, 坐标
+static bool det_less(const Yolo::Detection& a, const Yolo::Detection& b) {
+    if (a.class_id != b.class_id) return a.class_id < b.class_id;
+    if (a.conf != b.conf) return a.conf > b.conf;
+    return memcmp(a.bbox, b.bbox, sizeof(a.bbox)) < 0;
+}
+
+// YoloLayer的输出缓冲: [数量, MAX_OUTPUT_BBOX_COUNT行Detection]; claimed可以大于实际写入的行数(YoloLayer计数溢出时)
+struct NmsInput {
+    std::vector<float> output;
+    int classes;
+};
+
+static NmsInput make_input(int rows, int claimed, int classes, std::mt19937& rng) {
+    NmsInput in;
+    in.classes = classes;
+    in.output.assign(1 + Yolo::MAX_OUTPUT_BBOX_COUNT * DET_SIZE, 0.f);
+    rows = std::min(rows, Yolo::MAX_OUTPUT_BBOX_COUNT);
+    in.output[0] = (float)claimed;
+    Yolo::Detection* dets = reinterpret_cast<Yolo::Detection*>(&in.output[1]);
+    std::uniform_real_distribution<float> x(0.f, (float)Yolo::INPUT_W), y(0.f, (float)Yolo::INPUT_H), size(8.f, 160.f), jitter(-6.f, 6.f), unit(0.f, 1.f);
+    std::uniform_int_distribution<int> cls(0, classes - 1), conf_level(0, 5), pick(0, std::max(rows - 1, 0));
+    for (int i = 0; i < rows; i++) {
+        Yolo::Detection& d = dets[i];
+        float r = unit(rng);
+        if (i > 0 && r < 0.5f) {
+            // 抖动一个已有的框: 同类(会互相抑制)或换一个类别(跨类别重叠)
+            const Yolo::Detection& src = dets[pick(rng) % i];
+            d = src;
+            for (int k = 0; k < 4; k++) d.bbox[k] += jitter(rng);
+            d.bbox[2] = std::max(d.bbox[2], 1.f);
+            d.bbox[3] = std::max(d.bbox[3], 1.f);
+            if (r < 0.1f) d.class_id = (float)cls(rng);
+        } else if (i > 0 && r < 0.6f) {
+            // 完全相同的框, 另一个类别
+            d = dets[pick(rng) % i];
+            d.class_id = (float)cls(rng);
+        } else {
+            d.bbox[0] = x(rng);
+            d.bbox[1] = y(rng);
+            d.bbox[2] = size(rng);
+            d.bbox[3] = size(rng);
+            d.class_id = (float)cls(rng);
+        }
+        // conf只取几个值, 大量相同的conf; 其中一档恰好等于CONF_THRESH
+        static const float levels[] = { 0.3f, CONF_THRESH, 0.6f, 0.75f, 0.75f, 0.9f };
+        d.conf = levels[conf_level(rng)];
+    }
+    return in;
+}
+
+static std::vector<Yolo::Detection> run_host_nms(const NmsInput& in) {
+    std::vector<float> kept(1 + Yolo::MAX_OUTPUT_BBOX_COUNT * DET_SIZE, 0.f);
+    Yolo::nms_host(in.output.data(), kept.data(), Yolo::MAX_OUTPUT_BBOX_COUNT, CONF_THRESH, NMS_THRESH, Yolo::MAX_OUTPUT_BBOX_COUNT);
+    const Yolo::Detection* dets = reinterpret_cast<const Yolo::Detection*>(&kept[1]);
+    std::vector<Yolo::Detection> res(dets, dets + (int)kept[0]);
+    // 输出按conf降序
+    for (size_t i = 1; i < res.size(); i++) CHECK(res[i - 1].conf >= res[i].conf);
+    return res;
+}
+
+static std::vector<Yolo::Detection> run_cpu_nms(NmsInput& in, int classes) {
+    std::vector<Yolo::Detection> res;
+    nms(res, in.output.data(), CONF_THRESH, NMS_THRESH, classes);
+    return res;
+}
+
+static bool same_set(std::vector<Yolo::Detection> a, std::vector<Yolo::Detection> b) {
+    if (a.size() != b.size()) return false;
+    std::sort(a.begin(), a.end(), det_less);
+    std::sort(b.begin(), b.end(), det_less);
+    return a.empty() || memcmp(a.data(), b.data(), a.size() * sizeof(Yolo::Detection)) == 0;
+}
+
+static void check_same(NmsInput& in, const char* what) {
+    std::vector<Yolo::Detection> host = run_host_nms(in);
+    std::vector<Yolo::Detection> cpu = run_cpu_nms(in, in.classes);
+    // 给的类别数小于实际的类别号时整张图回退到nms_generic, 不丢框
+    std::vector<Yolo::Detection> fallback = run_cpu_nms(in, 1);
+    std::vector<Yolo::Detection> generic;
+    nms_generic(generic, in.output.data(), CONF_THRESH, NMS_THRESH);
+    bool ok = same_set(host, cpu) && same_set(host, fallback) && same_set(host, generic);
+    CHECK(ok);
+    if (!ok) {
+        std::cerr << "  " << what << ": " << (int)in.output[0] << " candidates, " << in.classes << " classes, nms_host kept " << host.size()
+                  << ", nms " << cpu.size() << ", nms_generic " << generic.size() << std::endl;
+    }
+    for (const Yolo::Detection& d : host) CHECK(d.conf > CONF_THRESH);
+}
+
+// 相同conf的两个同类重叠框, 保留下标小的; 完全重叠的不同类别都保留
+static void test_ties() {
+    NmsInput in;
+    in.classes = Yolo::CLASS_NUM;
+    in.output.assign(1 + Yolo::MAX_OUTPUT_BBOX_COUNT * DET_SIZE, 0.f);
+    Yolo::Detection* dets = reinterpret_cast<Yolo::Detection*>(&in.output[1]);
+    const float boxes[][4] = { { 100, 100, 50, 50 }, { 102, 101, 50, 50 }, { 100, 100, 50, 50 }, { 300, 200, 40, 40 }, { 301, 200, 40, 40 } };
+    const float classes[] = { 1, 1, 2, 3, 3 };
+    const float confs[] = { 0.8f, 0.8f, 0.8f, 0.7f, 0.7f };
+    for (int i = 0; i < 5; i++) {
+        memcpy(dets[i].bbox, boxes[i], sizeof(boxes[i]));
+        dets[i].class_id = classes[i];
+        dets[i].conf = confs[i];
+    }
+    // 把下标大的放在前面再测一次: 保留的应该是新的下标小的那个
+    for (int swap = 0; swap < 2; swap++) {
+        if (swap) {
+            std::swap(dets[0], dets[1]);
+            std::swap(dets[3], dets[4]);
+        }
+        in.output[0] = 5;
+        std::vector<Yolo::Detection> host = run_host_nms(in), cpu = run_cpu_nms(in, in.classes);
+        CHECK(host.size() == 3 && same_set(host, cpu));
+        if (host.size() != 3) continue;
+        CHECK(host[0].class_id == 1 && host[0].bbox[0] == dets[0].bbox[0]);
+        CHECK(host[1].class_id == 2);
+        CHECK(host[2].class_id == 3 && host[2].bbox[0] == dets[3].bbox[0]);
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 300;
+    test_ties();
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<int> rows(0, Yolo::MAX_OUTPUT_BBOX_COUNT);
+    const int class_counts[] = { Yolo::CLASS_NUM, COCO_CLASSES, 3 };
+    for (int r = 0; r < rounds; r++) {
+        int classes = class_counts[r % 3];
+        int n = rows(rng);
+        NmsInput in = make_input(n, n, classes, rng);
+        check_same(in, "random");
+    }
+    // 候选数超过缓冲区(YoloLayer计数溢出): 数量为1024、1500、5000, 都只看前MAX_OUTPUT_BBOX_COUNT行
+    const int claimed[] = { Yolo::NMS_SORT_SIZE, 1500, 5000 };
+    for (int c : claimed) {
+        for (int classes : class_counts) {
+            NmsInput in = make_input(Yolo::MAX_OUTPUT_BBOX_COUNT, c, classes, rng);
+            check_same(in, "overflow");
+        }
+    }
+    if (test_failures()) std::cerr << test_failures() << " checks failed" << std::endl;
+    else std::cout << "nms_test passed" << std::endl;
+    return test_failures() ? 1 : 0;
+}
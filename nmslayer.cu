@@ -0,0 +1,259 @@
+#include <assert.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+#include "nmslayer.h"
+#include "yolo_nms.h"
+#include "cuda_utils.h"
+
+namespace
+{
+    template<typename T>
+    void write(char*& buffer, const T& val)
+    {
+        *reinterpret_cast<T*>(buffer) = val;
+        buffer += sizeof(T);
+    }
+
+    template<typename T>
+    void read(const char*& buffer, T& val)
+    {
+        val = *reinterpret_cast<const T*>(buffer);
+        buffer += sizeof(T);
+    }
+}
+
+using namespace Yolo;
+
+namespace nvinfer1
+{
+    NmsLayerPlugin::NmsLayerPlugin(int maxIn, int topN, float confThresh, float nmsThresh)
+    {
+        mMaxIn = maxIn;
+        mTopN = topN;
+        mConfThresh = confThresh;
+        mNmsThresh = nmsThresh;
+        assert(mMaxIn <= NMS_SORT_SIZE);
+    }
+
+    NmsLayerPlugin::NmsLayerPlugin(const void* data, size_t length)
+    {
+        const char *d = reinterpret_cast<const char *>(data), *a = d;
+        read(d, mThreadCount);
+        read(d, mMaxIn);
+        read(d, mTopN);
+        read(d, mConfThresh);
+        read(d, mNmsThresh);
+        assert(d == a + length);
+    }
+
+    void NmsLayerPlugin::serialize(void* buffer) const
+    {
+        char* d = static_cast<char*>(buffer), *a = d;
+        write(d, mThreadCount);
+        write(d, mMaxIn);
+        write(d, mTopN);
+        write(d, mConfThresh);
+        write(d, mNmsThresh);
+        assert(d == a + getSerializationSize());
+    }
+
+    size_t NmsLayerPlugin::getSerializationSize() const
+    {
+        return sizeof(mThreadCount) + sizeof(mMaxIn) + sizeof(mTopN) + sizeof(mConfThresh) + sizeof(mNmsThresh);
+    }
+
+    DimsExprs NmsLayerPlugin::getOutputDimensions(int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
+    {
+        int totalsize = mTopN * sizeof(Detection) / sizeof(float);
+        DimsExprs out;
+        out.nbDims = 4;
+        out.d[0] = inputs[0].d[0];
+        out.d[1] = exprBuilder.constant(totalsize + 1);
+        out.d[2] = exprBuilder.constant(1);
+        out.d[3] = exprBuilder.constant(1);
+        return out;
+    }
+
+    void NmsLayerPlugin::setPluginNamespace(const char* pluginNamespace)
+    {
+        mPluginNamespace = pluginNamespace;
+    }
+
+    const char* NmsLayerPlugin::getPluginNamespace() const
+    {
+        return mPluginNamespace;
+    }
+
+    DataType NmsLayerPlugin::getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const
+    {
+        return DataType::kFLOAT;
+    }
+
+    const char* NmsLayerPlugin::getPluginType() const
+    {
+        return "NmsLayer_TRT";
+    }
+
+    const char* NmsLayerPlugin::getPluginVersion() const
+    {
+        return "2";
+    }
+
+    void NmsLayerPlugin::destroy()
+    {
+        delete this;
+    }
+
+    IPluginV2DynamicExt* NmsLayerPlugin::clone() const
+    {
+        NmsLayerPlugin* p = new NmsLayerPlugin(mMaxIn, mTopN, mConfThresh, mNmsThresh);
+        p->setPluginNamespace(mPluginNamespace);
+        return p;
+    }
+
+    // 每个block处理一张图: 过滤 -> 双调排序 -> 贪心抑制 -> 紧凑输出, 规则见yolo_nms.h
+    __global__ void NmsKernel(const float* input, float* output, int inputElem, int outputElem, int maxIn,
+        float confThresh, float nmsThresh, int topN)
+    {
+        __shared__ Detection s_det[NMS_SORT_SIZE];
+        __shared__ float s_conf[NMS_SORT_SIZE];
+        __shared__ int s_idx[NMS_SORT_SIZE];
+        __shared__ char s_keep[NMS_SORT_SIZE];
+        __shared__ int s_valid;
+        __shared__ int s_kept;
+
+        const float* in = input + blockIdx.x * inputElem;
+        float* out = output + blockIdx.x * outputElem;
+        int n = min((int)in[0], maxIn);
+        if (threadIdx.x == 0) {
+            s_valid = 0;
+            s_kept = 0;
+        }
+        __syncthreads();
+
+        const Detection* dets = (const Detection*)(in + 1);
+        for (int t = threadIdx.x; t < NMS_SORT_SIZE; t += blockDim.x) {
+            float conf = -1.0f; // 无效框排在最后
+            if (t < n) {
+                s_det[t] = dets[t];
+                if (dets[t].conf > confThresh) {
+                    conf = dets[t].conf;
+                    atomicAdd(&s_valid, 1);
+                }
+            }
+            s_conf[t] = conf;
+            s_idx[t] = t;
+        }
+        __syncthreads();
+
+        // 双调排序, 按nms_before降序
+        for (int k = 2; k <= NMS_SORT_SIZE; k <<= 1) {
+            for (int j = k >> 1; j > 0; j >>= 1) {
+                for (int i = threadIdx.x; i < NMS_SORT_SIZE; i += blockDim.x) {
+                    int ixj = i ^ j;
+                    if (ixj <= i) continue;
+                    bool first = nms_before(s_conf[i], s_idx[i], s_conf[ixj], s_idx[ixj]);
+                    bool ascending = (i & k) != 0;
+                    if (first == ascending) {
+                        float c = s_conf[i]; s_conf[i] = s_conf[ixj]; s_conf[ixj] = c;
+                        int x = s_idx[i]; s_idx[i] = s_idx[ixj]; s_idx[ixj] = x;
+                    }
+                }
+                __syncthreads();
+            }
+        }
+
+        int valid = s_valid;
+        for (int t = threadIdx.x; t < valid; t += blockDim.x) s_keep[t] = 1;
+        __syncthreads();
+
+        for (int i = 0; i < valid; i++) {
+            if (s_kept >= topN) break;
+            if (s_keep[i]) {
+                const Detection& kept = s_det[s_idx[i]];
+                for (int j = i + 1 + threadIdx.x; j < valid; j += blockDim.x) {
+                    if (s_keep[j] && nms_suppresses(kept, s_det[s_idx[j]], nmsThresh)) s_keep[j] = 0;
+                }
+            }
+            __syncthreads();
+            if (threadIdx.x == 0 && s_keep[i]) s_kept++;
+            __syncthreads();
+        }
+
+        if (threadIdx.x == 0) {
+            Detection* outDets = (Detection*)(out + 1);
+            int count = 0;
+            for (int i = 0; i < valid && count < topN; i++) {
+                if (s_keep[i]) outDets[count++] = s_det[s_idx[i]];
+            }
+            out[0] = count;
+        }
+    }
+
+    int NmsLayerPlugin::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
+    {
+        int batchSize = inputDesc[0].dims.d[0];
+        int inputElem = 1 + mMaxIn * sizeof(Detection) / sizeof(float);
+        int outputElem = 1 + mTopN * sizeof(Detection) / sizeof(float);
+        NmsKernel <<< batchSize, mThreadCount, 0, stream >>>
+            ((const float*)inputs[0], (float*)outputs[0], inputElem, outputElem, mMaxIn, mConfThresh, mNmsThresh, mTopN);
+        return 0;
+    }
+
+    PluginFieldCollection NmsPluginCreator::mFC{};
+    std::vector<PluginField> NmsPluginCreator::mPluginAttributes;
+
+    NmsPluginCreator::NmsPluginCreator()
+    {
+        mPluginAttributes.clear();
+
+        mFC.nbFields = mPluginAttributes.size();
+        mFC.fields = mPluginAttributes.data();
+    }
+
+    const char* NmsPluginCreator::getPluginName() const
+    {
+        return "NmsLayer_TRT";
+    }
+
+    const char* NmsPluginCreator::getPluginVersion() const
+    {
+        return "2";
+    }
+
+    const PluginFieldCollection* NmsPluginCreator::getFieldNames()
+    {
+        return &mFC;
+    }
+
+    IPluginV2DynamicExt* NmsPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+    {
+        int max_in = MAX_OUTPUT_BBOX_COUNT;
+        int top_n = 100;
+        float conf_thresh = IGNORE_THRESH;
+        float nms_thresh = 0.5f;
+        const PluginField* fields = fc->fields;
+        for (int i = 0; i < fc->nbFields; i++) {
+            if (strcmp(fields[i].name, "max_in") == 0) {
+                max_in = *(const int*)(fields[i].data);
+            } else if (strcmp(fields[i].name, "top_n") == 0) {
+                top_n = *(const int*)(fields[i].data);
+            } else if (strcmp(fields[i].name, "conf_thresh") == 0) {
+                conf_thresh = *(const float*)(fields[i].data);
+            } else if (strcmp(fields[i].name, "nms_thresh") == 0) {
+                nms_thresh = *(const float*)(fields[i].data);
+            }
+        }
+        NmsLayerPlugin* obj = new NmsLayerPlugin(max_in, top_n, conf_thresh, nms_thresh);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+
+    IPluginV2DynamicExt* NmsPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
+    {
+        NmsLayerPlugin* obj = new NmsLayerPlugin(serialData, serialLength);
+        obj->setPluginNamespace(mNamespace.c_str());
+        return obj;
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef _NMS_LAYER_H
+#define _NMS_LAYER_H
+
+#include <string>
+#include <vector>
+#include "NvInfer.h"
+#include "yololayer.h"
+
+namespace nvinfer1
+{
+    // 接在YoloLayer之后的NMS插件, 在GPU上输出每张图已经抑制过的top-N检测结果
+    // 输出布局: [数量, Detection * topN], 框为xywh(网络输入坐标)
+    class NmsLayerPlugin : public IPluginV2DynamicExt
+    {
+    public:
+        NmsLayerPlugin(int maxIn, int topN, float confThresh, float nmsThresh);
+
+        // 反序列化时候需要用到
+        NmsLayerPlugin(const void* data, size_t length);
+        ~NmsLayerPlugin() {}
+
+        int getNbOutputs() const override
+        {
+            return 1;
+        }
+
+        DimsExprs getOutputDimensions(int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder) override;
+
+        int initialize() override { return 0; }
+
+        virtual void terminate() override {};
+
+        size_t getWorkspaceSize(const PluginTensorDesc* inputs, int nbInputs, const PluginTensorDesc* outputs, int nbOutputs) const override { return 0; }
+
+        int enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream) override;
+
+        virtual size_t getSerializationSize() const override;
+
+        virtual void serialize(void* buffer) const override;
+
+        bool supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs) override {
+            return inOut[pos].format == TensorFormat::kLINEAR && inOut[pos].type == DataType::kFLOAT;
+        }
+
+        const char* getPluginType() const override;
+
+        const char* getPluginVersion() const override;
+
+        void destroy() override;
+
+        IPluginV2DynamicExt* clone() const override;
+
+        void setPluginNamespace(const char* pluginNamespace) override;
+
+        const char* getPluginNamespace() const override;
+
+        DataType getOutputDataType(int index, const nvinfer1::DataType* inputTypes, int nbInputs) const override;
+
+        void attachToContext(
+            cudnnContext* cudnnContext, cublasContext* cublasContext, IGpuAllocator* gpuAllocator) override {}
+
+        void configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs) override {}
+
+        void detachFromContext() override {}
+
+    private:
+        int mThreadCount = 512;
+        const char* mPluginNamespace;
+        int mMaxIn; // 输入候选框的最大数量(YoloLayer的MAX_OUTPUT_BBOX_COUNT)
+        int mTopN; // 每张图最多输出的框数
+        float mConfThresh;
+        float mNmsThresh;
+    };
+
+    class NmsPluginCreator : public IPluginCreator
+    {
+    public:
+        NmsPluginCreator();
+
+        ~NmsPluginCreator() override = default;
+
+        const char* getPluginName() const override;
+
+        const char* getPluginVersion() const override;
+
+        const PluginFieldCollection* getFieldNames() override;
+
+        IPluginV2DynamicExt* createPlugin(const char* name, const PluginFieldCollection* fc) override;
+
+        IPluginV2DynamicExt* deserializePlugin(const char* name, const void* serialData, size_t serialLength) override;
+
+        void setPluginNamespace(const char* libNamespace) override
+        {
+            mNamespace = libNamespace;
+        }
+
+        const char* getPluginNamespace() const override
+        {
+            return mNamespace.c_str();
+        }
+
+    private:
+        std::string mNamespace;
+        static PluginFieldCollection mFC;
+        static std::vector<PluginField> mPluginAttributes;
+    };
+    REGISTER_TENSORRT_PLUGIN(NmsPluginCreator);
+};
+
+#endif
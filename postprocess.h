@@ -0,0 +1,222 @@
+#ifndef TRTX_YOLOV5_POSTPROCESS_H_
+#define TRTX_YOLOV5_POSTPROCESS_H_
+
+// YoloLayer输出的host端后处理: 坐标转换、nms、已做过GPU NMS的输出的读取和回传字节数模型
+// 只依赖标准库和yolo_types.h/yolo_decode.h, coco_eval等不链接TensorRT的工具直接包含本文件, engine相关的部分在common.hpp
+
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "yolo_types.h"
+#include "yolo_decode.h"
+
+void xywh2xyxy(std::vector<Yolo::Detection>& res){
+    for (std::size_t i = 0; i < res.size(); i++){
+        float box[4];
+        for (int j=0; j < 4; j++){
+            memcpy(&box[j], &res[i].bbox[j], sizeof(float));
+        }
+        res[i].bbox[0] = box[0] - box[2] / 2.0f; // top left x
+        res[i].bbox[1] = box[1] - box[3] / 2.0f; // top left y
+        res[i].bbox[2] = box[0] + box[2] / 2.0f; // bottom right x
+        res[i].bbox[3] = box[1] + box[3] / 2.0f; // bottom right y
+    }
+}
+
+
+void xyxy2xywh(std::vector<Yolo::Detection>& res){
+    for (std::size_t i = 0; i < res.size(); i++){
+        float box[4];
+        memcpy(&box, &res[i].bbox[0], 4 * sizeof(float));
+        res[i].bbox[0] = box[0] + (box[2] - box[0]) / 2.0f;
+        res[i].bbox[1] = box[1] + (box[3] - box[1]) / 2.0f;
+        res[i].bbox[2] = (box[2] - box[0]) / 2.0f;
+        res[i].bbox[3] = (box[3] - box[1]) / 2.0f;
+    }
+}
+
+
+void clamp(float& x, int min, int max){
+    if (x < min) {
+        x = min;
+    }
+    if (x > max) {
+        x = max;
+    }
+}
+
+
+void scale_coords(std::vector<Yolo::Detection>& res, int img_w, int img_h){
+    float gain = (std::min)(Yolo::INPUT_W / float(img_w), Yolo::INPUT_H / float(img_h)); // gain  = old / new
+    float pad[2];
+    pad[0] = (Yolo::INPUT_W - img_w * gain) / 2;
+    pad[1] = (Yolo::INPUT_H - img_h * gain) / 2; // wh padding
+    for (std::size_t i = 0; i < res.size(); i++){
+        float box[4];
+        for (int j = 0; j < 4; j++){
+            memcpy(&box[j], &res[i].bbox[j], sizeof(float));
+        } 
+        res[i].bbox[0] = (box[0] - pad[0]) / gain; // x paddingimg_w
+        res[i].bbox[1] = (box[1] - pad[1]) / gain; // y padding
+        res[i].bbox[2] = (box[2] - pad[0]) / gain; // x padding
+        res[i].bbox[3] = (box[3] - pad[1]) / gain; // y padding
+        clamp(res[i].bbox[0], 0, img_w);
+        clamp(res[i].bbox[1], 0, img_h);
+        clamp(res[i].bbox[2], 0, img_w);
+        clamp(res[i].bbox[3], 0, img_h);
+    }
+}
+
+
+float iou(float lbox[4], float rbox[4]) {
+    float interBox[] = {
+        (std::max)(lbox[0] - lbox[2] / 2.f , rbox[0] - rbox[2] / 2.f), //left
+        (std::min)(lbox[0] + lbox[2] / 2.f , rbox[0] + rbox[2] / 2.f), //right
+        (std::max)(lbox[1] - lbox[3] / 2.f , rbox[1] - rbox[3] / 2.f), //top
+        (std::min)(lbox[1] + lbox[3] / 2.f , rbox[1] + rbox[3] / 2.f), //bottom
+    };
+
+    if (interBox[2] > interBox[3] || interBox[0] > interBox[1])
+        return 0.0f;
+
+    float interBoxS = (interBox[1] - interBox[0])*(interBox[3] - interBox[2]);
+    return interBoxS / (lbox[2] * lbox[3] + rbox[2] * rbox[3] - interBoxS);
+}
+
+bool cmp(const Yolo::Detection& a, const Yolo::Detection& b) {
+    return a.conf > b.conf;
+}
+
+// std::map + erase的版本, 不限类别号, 作为nms的对照和回退
+void nms_generic(std::vector<Yolo::Detection>& res, float *output, float conf_thresh, float nms_thresh = 0.5) {
+    int det_size = sizeof(Yolo::Detection) / sizeof(float); // 4+1+1
+    std::map<float, std::vector<Yolo::Detection>> m;
+    
+    for (int i = 0; i < output[0] && i < Yolo::MAX_OUTPUT_BBOX_COUNT; i++) {
+        if (output[1 + det_size * i + 4] <= conf_thresh) continue;
+        Yolo::Detection det;
+        memcpy(&det, &output[1 + det_size * i], det_size * sizeof(float));
+        if (m.count(det.class_id) == 0) m.emplace(det.class_id, std::vector<Yolo::Detection>());
+        m[det.class_id].push_back(det);
+    }
+    for (auto it = m.begin(); it != m.end(); it++) {
+        //std::cout << it->second[0].class_id << " --- " << std::endl;
+        auto& dets = it->second;
+        std::stable_sort(dets.begin(), dets.end(), cmp); // conf相同时保持原始顺序, 与nms_host(yolo_nms.h)一致
+        for (size_t m = 0; m < dets.size(); ++m) {
+            auto& item = dets[m];
+            res.push_back(item);
+            for (size_t n = m + 1; n < dets.size(); ++n) {
+                if (iou(item.bbox, dets[n].bbox) > nms_thresh) {
+                    dets.erase(dets.begin() + n);
+                    --n;
+                }
+            }
+        }
+    }
+}
+
+// 按类别分桶(代替std::map), 桶内按conf排序后把框转成x1/y1/x2/y2/面积的连续数组(代替每次IoU从xywh重算),
+// 每保留一个框就把剩下的框一遍压缩(代替逐个erase). IoU的计算步骤与iou()相同, 保留的框逐位相同
+// 保留的框和输出顺序与nms_generic相同(类别升序, 类内conf降序). classes为engine的类别数, 出现超出范围的类别号时整张图改用nms_generic
+void nms(std::vector<Yolo::Detection>& res, float *output, float conf_thresh, float nms_thresh = 0.5, int classes = Yolo::CLASS_NUM) {
+    static thread_local std::vector<std::vector<Yolo::Detection>> buckets;
+    static thread_local std::vector<float> x1, y1, x2, y2, area;
+    static thread_local std::vector<int> index;
+    if (classes <= 0) {
+        nms_generic(res, output, conf_thresh, nms_thresh);
+        return;
+    }
+    if ((int)buckets.size() < classes) buckets.resize(classes);
+    for (int c = 0; c < classes; c++) buckets[c].clear();
+    const Yolo::Detection* dets = reinterpret_cast<const Yolo::Detection*>(&output[1]);
+    int count = (std::min)((int)output[0], Yolo::MAX_OUTPUT_BBOX_COUNT);
+    for (int i = 0; i < count; i++) {
+        if (dets[i].conf <= conf_thresh) continue;
+        int cls = (int)dets[i].class_id;
+        if (cls < 0 || cls >= classes) {
+            // 类别号超出engine的类别数(调用时给的类别数不对): 整张图改用nms_generic, 不丢框
+            nms_generic(res, output, conf_thresh, nms_thresh);
+            return;
+        }
+        buckets[cls].push_back(dets[i]);
+    }
+    for (int c = 0; c < classes; c++) {
+        std::vector<Yolo::Detection>& bucket = buckets[c];
+        if (bucket.empty()) continue;
+        std::stable_sort(bucket.begin(), bucket.end(), cmp);
+        size_t alive = bucket.size();
+        x1.resize(alive);
+        y1.resize(alive);
+        x2.resize(alive);
+        y2.resize(alive);
+        area.resize(alive);
+        index.resize(alive);
+        for (size_t i = 0; i < alive; i++) {
+            const float* b = bucket[i].bbox;
+            x1[i] = b[0] - b[2] / 2.f;
+            x2[i] = b[0] + b[2] / 2.f;
+            y1[i] = b[1] - b[3] / 2.f;
+            y2[i] = b[1] + b[3] / 2.f;
+            area[i] = b[2] * b[3];
+            index[i] = (int)i;
+        }
+        for (size_t m = 0; m < alive; ++m) {
+            res.push_back(bucket[index[m]]);
+            const float mx1 = x1[m], my1 = y1[m], mx2 = x2[m], my2 = y2[m], marea = area[m];
+            // 没被m抑制的框原地前移, 之后的扫描只看剩下的框; 无分支地写入, 由w决定是否保留
+            size_t w = m + 1;
+            for (size_t k = m + 1; k < alive; ++k) {
+                float iw = (std::max)(0.f, (std::min)(mx2, x2[k]) - (std::max)(mx1, x1[k]));
+                float ih = (std::max)(0.f, (std::min)(my2, y2[k]) - (std::max)(my1, y1[k]));
+                float inter = iw * ih;
+                bool keep = !(inter / (marea + area[k] - inter) > nms_thresh);
+                x1[w] = x1[k];
+                y1[w] = y1[k];
+                x2[w] = x2[k];
+                y2[w] = y2[k];
+                area[w] = area[k];
+                index[w] = index[k];
+                w += keep;
+            }
+            alive = w;
+        }
+    }
+}
+
+// 一张图输出([数量, Detection...])的只读视图, 不拷贝. 两阶段回传时只有前count行是有效的
+struct DetectionView {
+    const Yolo::Detection* dets;
+    int count;
+
+    const Yolo::Detection* begin() const { return dets; }
+    const Yolo::Detection* end() const { return dets + count; }
+};
+
+DetectionView detection_view(const float *output, int max_count) {
+    DetectionView view;
+    view.dets = reinterpret_cast<const Yolo::Detection*>(&output[1]);
+    view.count = (std::min)((int)output[0], max_count);
+    return view;
+}
+
+// 读取已经在GPU上做过NMS的输出(NmsLayer): output[0]为数量, 之后是紧凑排列的Detection
+void read_detections(std::vector<Yolo::Detection>& res, float *output, int max_count) {
+    DetectionView view = detection_view(output, max_count);
+    res.insert(res.end(), view.begin(), view.end());
+}
+
+// 每帧D2H拷贝的字节数模型: 全量拷贝 vs 两阶段(数量 + batch中最多的那张图用到的行)
+size_t full_readback_bytes(int batch, int output_size) {
+    return (size_t)batch * output_size * sizeof(float);
+}
+
+size_t compact_readback_bytes(const std::vector<int>& counts, int max_rows) {
+    int rows = 0;
+    for (int c : counts) rows = (std::max)(rows, (std::min)(c, max_rows));
+    size_t batch = counts.size();
+    return batch * sizeof(float) + batch * (1 + rows * sizeof(Yolo::Detection) / sizeof(float)) * sizeof(float);
+}
+
+#endif  // TRTX_YOLOV5_POSTPROCESS_H_
@@ -0,0 +1,270 @@
+#ifndef TRTX_YOLOV5_PRECISION_SEARCH_H_
+#define TRTX_YOLOV5_PRECISION_SEARCH_H_
+
+// 混合精度搜索: 在CPU参考实现(graph_cpu.h)上模拟INT8, 找出对量化最敏感的model.N模块, 只让这些模块保持FP16, 其余层INT8
+// 1. 校准: 浮点推理校准集, 统计每个卷积输入的|x|分布, 取percentile分位数为amax; 同时保存浮点的head输出和NMS后的框作为参考
+// 2. 敏感度: 每次只把一个模块的卷积按INT8模拟, 以Detect各head卷积输出相对参考的误差(sum|q-r|^2 / sum|r|^2)排序
+// 3. 搜索: 按敏感度从高到低固定前k个模块为FP16, 其余全部INT8, 用与参考框的一致性(F1, 同类别且IoU>0.5)衡量精度,
+//    二分查找满足 F1 >= 1 - budget 的最小k(假设固定的模块越多一致性越高)
+// 结果写成精度配置文件, build_engine在USE_INT8时按模块设置层精度(见graph_trt.h的apply_precision_profile)
+// 模拟与TensorRT的差异: 激活只在卷积输入处量化, 校准用分位数而不是熵校准, FP16按浮点计算; 用于排序和估计, 最终精度以engine为准
+// 不依赖TensorRT/CUDA
+
+#include <math.h>
+#include <stdio.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "graph_cpu.h"
+#include "yolo_nms.h"
+
+struct PrecisionSearchConfig {
+    float budget = 0.02f;         // 允许的一致性下降, F1 >= 1 - budget
+    float percentile = 99.99f;    // 激活amax取|x|的分位数
+    float conf_thresh = 0.45f;    // 比较检测结果时的NMS参数
+    float nms_thresh = 0.5f;
+    float match_iou = 0.5f;
+};
+
+struct ModuleSensitivity {
+    std::string module;  // 如"model.10"
+    std::string kind;    // 如"SPP"
+    int convs;           // 模块中的卷积数
+    double error;        // 只量化该模块时head输出的相对误差
+};
+
+struct PrecisionPlan {
+    std::vector<ModuleSensitivity> ranking;  // 按敏感度从高到低
+    std::vector<std::string> pinned;         // 保持FP16的模块, 即ranking的前pinned.size()个
+    double int8_f1 = 0;                      // 全部INT8时的一致性
+    double final_f1 = 0;                     // 固定pinned之后的一致性
+    int int8_convs = 0;
+    int total_convs = 0;
+};
+
+class PrecisionSearch {
+public:
+    // images为count张连续存放的3 x h x w输入(预处理与推理时相同)
+    PrecisionSearch(const ir::Graph& graph, ThreadPool& pool, const std::vector<float>& images, int count, int h, int w, const PrecisionSearchConfig& config)
+        : graph_(graph), executor_(graph, pool), images_(images), count_(count), h_(h), w_(w), config_(config) {
+        const std::vector<ir::Node>& nodes = graph_.nodes();
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i].op == ir::Op::kConv) {
+                convs_.push_back((int)i);
+                modules_[nodes[i].module].push_back((int)i);
+            }
+            if (nodes[i].op == ir::Op::kYoloDecode) heads_ = nodes[i].inputs;
+        }
+        assert(!heads_.empty() && "graph has no YoloDecode node");
+        // head卷积的输出是YoloDecode的输入, run结束时已释放, 在这里保存; 校准时另外统计激活
+        executor_.set_observer([this](int node, const CpuTensor& t) {
+            if (std::find(heads_.begin(), heads_.end(), node) != heads_.end()) saved_[node] = t.data;
+            if (stats_) stats_(node, t);
+        });
+    }
+
+    PrecisionPlan run() {
+        calibrate();
+        PrecisionPlan plan;
+        plan.total_convs = (int)convs_.size();
+        for (const auto& m : modules_) {
+            std::set<std::string> only{ m.first };
+            ModuleSensitivity s{ m.first, graph_.node(m.second[0]).kind, (int)m.second.size(), evaluate(only, false).error };
+            std::cout << "  " << s.module << " (" << s.kind << ", " << s.convs << " convs): output error " << s.error << std::endl;
+            plan.ranking.push_back(s);
+        }
+        std::sort(plan.ranking.begin(), plan.ranking.end(), [](const ModuleSensitivity& a, const ModuleSensitivity& b) { return a.error > b.error; });
+
+        // 固定前k个模块时的一致性, 记录已算过的k
+        std::map<int, double> f1;
+        auto score = [&](int k) {
+            if (!f1.count(k)) {
+                std::set<std::string> int8;
+                for (size_t i = k; i < plan.ranking.size(); i++) int8.insert(plan.ranking[i].module);
+                f1[k] = evaluate(int8, true).f1;
+                std::cout << "  " << k << " modules pinned: F1 " << f1[k] << std::endl;
+            }
+            return f1[k];
+        };
+        const double target = 1.0 - config_.budget;
+        int lo = 0, hi = (int)plan.ranking.size(); // 固定全部模块时与参考相同
+        plan.int8_f1 = score(0);
+        if (plan.int8_f1 >= target) hi = 0;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (score(mid) >= target) {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        plan.final_f1 = hi < (int)plan.ranking.size() ? score(hi) : 1.0;
+        plan.int8_convs = plan.total_convs;
+        for (int i = 0; i < hi; i++) {
+            plan.pinned.push_back(plan.ranking[i].module);
+            plan.int8_convs -= plan.ranking[i].convs;
+        }
+        return plan;
+    }
+
+private:
+    struct Score {
+        double error; // head输出的相对误差
+        double f1;    // 检测结果与参考的一致性
+    };
+
+    const float* image(int i) const { return images_.data() + (size_t)i * 3 * h_ * w_; }
+
+    // 浮点推理两遍: 第一遍得到每个卷积输入的最大值和参考输出, 第二遍在[0, max]上统计直方图取分位数
+    void calibrate() {
+        static const int kBins = 2048;
+        std::map<int, float> max_abs;  // 卷积输入节点 -> max|x|
+        std::map<int, std::vector<double>> hist;
+        for (int c : convs_) max_abs[graph_.node(c).inputs[0]] = 0.f;
+        for (int pass = 0; pass < 2; pass++) {
+            stats_ = [&](int node, const CpuTensor& t) {
+                auto it = max_abs.find(node);
+                if (it == max_abs.end()) return;
+                if (pass == 0) {
+                    for (float v : t.data) it->second = std::max(it->second, fabsf(v));
+                    return;
+                }
+                std::vector<double>& h = hist[node];
+                h.resize(kBins);
+                if (it->second <= 0.f) return;
+                const float scale = kBins / it->second;
+                for (float v : t.data) h[std::min(kBins - 1, (int)(fabsf(v) * scale))] += 1;
+            };
+            for (int i = 0; i < count_; i++) {
+                executor_.run(image(i), 1, h_, w_);
+                if (pass == 0) reference(i);
+            }
+        }
+        stats_ = nullptr;
+        for (auto& m : max_abs) {
+            const std::vector<double>& h = hist[m.first];
+            double total = 0, acc = 0;
+            for (double v : h) total += v;
+            int bin = kBins - 1;
+            for (int b = 0; b < kBins && total > 0; b++) {
+                acc += h[b];
+                if (acc >= total * config_.percentile / 100.0) {
+                    bin = b;
+                    break;
+                }
+            }
+            amax_[m.first] = m.second * (bin + 1) / kBins;
+        }
+    }
+
+    void reference(int i) {
+        ref_heads_.resize(count_);
+        ref_dets_.resize(count_);
+        ref_heads_[i].clear();
+        for (int h : heads_) ref_heads_[i].push_back(head(h));
+        ref_dets_[i] = detections();
+    }
+
+    std::vector<float> head(int node) const {
+        auto it = saved_.find(node);
+        return it == saved_.end() ? std::vector<float>() : it->second;
+    }
+
+    std::vector<Yolo::Detection> detections() const {
+        const CpuTensor& out = executor_.output(0);
+        std::vector<float> kept(out.data.size());
+        Yolo::nms_host(out.data.data(), kept.data(), Yolo::MAX_OUTPUT_BBOX_COUNT, config_.conf_thresh, config_.nms_thresh, Yolo::MAX_OUTPUT_BBOX_COUNT);
+        const Yolo::Detection* dets = reinterpret_cast<const Yolo::Detection*>(kept.data() + 1);
+        return std::vector<Yolo::Detection>(dets, dets + (int)kept[0]);
+    }
+
+    // int8中模块的卷积按INT8模拟, 在整个校准集上与参考比较; with_f1为false时只算head误差
+    Score evaluate(const std::set<std::string>& int8, bool with_f1) {
+        for (int c : convs_) {
+            executor_.set_conv_int8(c, int8.count(graph_.node(c).module) ? amax_[graph_.node(c).inputs[0]] : 0.f);
+        }
+        double err = 0, norm = 0;
+        int matched = 0, total = 0;
+        for (int i = 0; i < count_; i++) {
+            executor_.run(image(i), 1, h_, w_);
+            for (size_t k = 0; k < heads_.size(); k++) {
+                const std::vector<float> q = head(heads_[k]);
+                const std::vector<float>& r = ref_heads_[i][k];
+                for (size_t j = 0; j < r.size() && j < q.size(); j++) {
+                    err += (double)(q[j] - r[j]) * (q[j] - r[j]);
+                    norm += (double)r[j] * r[j];
+                }
+            }
+            if (!with_f1) continue;
+            std::vector<Yolo::Detection> dets = detections();
+            matched += match(ref_dets_[i], dets);
+            total += (int)(ref_dets_[i].size() + dets.size());
+        }
+        return Score{ norm > 0 ? err / norm : 0, total ? 2.0 * matched / total : 1.0 };
+    }
+
+    // 按conf顺序贪心匹配: 同类别且IoU > match_iou
+    int match(const std::vector<Yolo::Detection>& ref, const std::vector<Yolo::Detection>& dets) const {
+        std::vector<char> used(dets.size(), 0);
+        int matched = 0;
+        for (const auto& r : ref) {
+            for (size_t j = 0; j < dets.size(); j++) {
+                if (!used[j] && dets[j].class_id == r.class_id && Yolo::nms_iou(r.bbox, dets[j].bbox) > config_.match_iou) {
+                    used[j] = 1;
+                    matched++;
+                    break;
+                }
+            }
+        }
+        return matched;
+    }
+
+    const ir::Graph& graph_;
+    CpuExecutor executor_;
+    const std::vector<float>& images_;
+    int count_, h_, w_;
+    PrecisionSearchConfig config_;
+    std::vector<int> convs_;
+    std::map<std::string, std::vector<int>> modules_;
+    std::vector<int> heads_;
+    std::map<int, float> amax_;
+    std::map<int, std::vector<float>> saved_;  // 最近一次run的head卷积输出
+    std::function<void(int, const CpuTensor&)> stats_;
+    std::vector<std::vector<std::vector<float>>> ref_heads_;
+    std::vector<std::vector<Yolo::Detection>> ref_dets_;
+};
+
+// 精度配置文件: 每行"<模块> <fp16|fp32>", #之后为注释; 未列出的模块使用INT8
+static inline bool write_precision_profile(const std::string& path, const PrecisionPlan& plan, const PrecisionSearchConfig& config) {
+    std::ofstream out(path);
+    if (!out) return false;
+    out << "# mixed precision profile: listed modules stay FP16 in the INT8 engine, all other layers run INT8\n";
+    out << "# budget " << config.budget << ", F1 vs FP32 (CPU simulation): all INT8 " << plan.int8_f1 << ", with this profile " << plan.final_f1
+        << ", INT8 convs " << plan.int8_convs << "/" << plan.total_convs << "\n";
+    for (size_t i = 0; i < plan.ranking.size(); i++) {
+        const ModuleSensitivity& s = plan.ranking[i];
+        out << (i < plan.pinned.size() ? "" : "# ") << s.module << " " << (i < plan.pinned.size() ? "fp16" : "int8")
+            << "  # " << s.kind << ", output error " << s.error << "\n";
+    }
+    return out.good();
+}
+
+static inline std::map<std::string, std::string> read_precision_profile(const std::string& path) {
+    std::map<std::string, std::string> profile;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string module, precision;
+        if (fields >> module >> precision) profile[module] = precision;
+    }
+    return profile;
+}
+
+#endif  // TRTX_YOLOV5_PRECISION_SEARCH_H_
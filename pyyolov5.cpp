@@ -0,0 +1,233 @@
+// Python扩展模块pyyolov5, 替代yolov5_trt.py中逐张图的NumPy预处理/后处理和pycuda推理
+// - 帧为HxWx3的uint8 BGR数组(NumPy或任何支持buffer协议的对象), 直接包装成cv::Mat, 不拷贝
+// - letterbox、推理和NMS期间释放GIL; 一次传入多帧时按canvas分组成batch推理(见detector.h)
+// - 每帧返回一个NumPy结构化数组, 字段x1, y1, x2, y2(原图坐标), conf, class_id
+// - 定义PYYOLOV5_TRT时带TensorRT backend(Detector.tensorrt), 否则只有CPU上的MockBackend(Detector.mock)
+
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include "detector.h"
+
+#ifdef PYYOLOV5_TRT
+#include <fstream>
+#include "cuda_utils.h"
+#include "logging.h"
+#include "trt_bindings.h"
+#endif
+
+namespace py = pybind11;
+
+struct PyDetection {
+    float x1, y1, x2, y2, conf;
+    int32_t class_id;
+};
+
+#ifdef PYYOLOV5_TRT
+static Logger gLogger;
+static const char* INPUT_BLOB_NAME = "data";
+static const char* OUTPUT_BLOB_NAME = "prob";
+
+// 运行yolov5-p6.cpp构建的engine(需先加载libmyplugins.so), 输入/输出binding名与yolov5-p6.cpp相同
+// 输出大小从engine读取: 与YoloLayer的输出大小不同时认为engine中带NMS插件(USE_GPU_NMS)
+class TrtBackend : public InferBackend {
+public:
+    explicit TrtBackend(const std::string& engine_path) {
+        std::ifstream file(engine_path, std::ios::binary);
+        if (!file.good()) throw std::runtime_error("read " + engine_path + " error!");
+        std::string plan((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        runtime_ = createInferRuntime(gLogger);
+        engine_ = runtime_->deserializeCudaEngine(plan.data(), plan.size());
+        if (!engine_) throw std::runtime_error("deserialize " + engine_path + " failed");
+        context_ = engine_->createExecutionContext();
+
+        int input_index = engine_->getBindingIndex(INPUT_BLOB_NAME);
+        Dims max = engine_->getProfileDimensions(input_index, 0, OptProfileSelector::kMAX);
+        max_batch_ = max.d[0];
+        max_input_ = std::max(max.d[2], max.d[3]);
+        output_size_ = engine_->getBindingDimensions(engine_->getBindingIndex(OUTPUT_BLOB_NAME)).d[1];
+        nms_in_engine_ = output_size_ != Yolo::MAX_OUTPUT_BBOX_COUNT * (int)(sizeof(Yolo::Detection) / sizeof(float)) + 1;
+        CUDA_CHECK(cudaMalloc(&buffers_[0], (size_t)max_batch_ * 3 * max_input_ * max_input_ * sizeof(float)));
+        CUDA_CHECK(cudaMalloc(&buffers_[1], (size_t)max_batch_ * output_size_ * sizeof(float)));
+        CUDA_CHECK(cudaStreamCreate(&stream_));
+    }
+
+    ~TrtBackend() override {
+        cudaStreamDestroy(stream_);
+        cudaFree(buffers_[0]);
+        cudaFree(buffers_[1]);
+        context_->destroy();
+        engine_->destroy();
+        runtime_->destroy();
+    }
+
+    int maxBatch() const override { return max_batch_; }
+    int maxInput() const override { return max_input_; }
+    int outputSize() const override { return output_size_; }
+    bool nmsInEngine() const override { return nms_in_engine_; }
+
+    void infer(const float* input, int batch, int input_h, int input_w, float* output) override {
+        std::vector<void*> bindings = bind_buffers(*context_, INPUT_BLOB_NAME, OUTPUT_BLOB_NAME, buffers_, batch, input_h, input_w);
+        CUDA_CHECK(cudaMemcpyAsync(buffers_[0], input, (size_t)batch * 3 * input_h * input_w * sizeof(float), cudaMemcpyHostToDevice, stream_));
+        context_->enqueueV2(bindings.data(), stream_, nullptr);
+        CUDA_CHECK(cudaMemcpyAsync(output, buffers_[1], (size_t)batch * output_size_ * sizeof(float), cudaMemcpyDeviceToHost, stream_));
+        CUDA_CHECK(cudaStreamSynchronize(stream_));
+    }
+
+private:
+    IRuntime* runtime_ = nullptr;
+    ICudaEngine* engine_ = nullptr;
+    IExecutionContext* context_ = nullptr;
+    cudaStream_t stream_;
+    void* buffers_[2];
+    int max_batch_, max_input_, output_size_;
+    bool nms_in_engine_;
+};
+#endif
+
+// Detector加锁后可以在多个Python线程中共享
+class PyDetector {
+public:
+    PyDetector(std::shared_ptr<InferBackend> backend, const DetectorConfig& config) : detector_(backend, config) {}
+
+    // frames为单帧或帧的list/tuple, 返回结构化数组或数组的list
+    py::object detect(py::object frames) {
+        bool single = !py::isinstance<py::list>(frames) && !py::isinstance<py::tuple>(frames);
+        std::vector<py::buffer_info> infos;
+        std::vector<cv::Mat> mats;
+        if (single) {
+            infos.push_back(request_frame(frames));
+        } else {
+            for (py::handle item : frames.cast<py::sequence>()) infos.push_back(request_frame(py::reinterpret_borrow<py::object>(item)));
+        }
+        for (const auto& info : infos) mats.push_back(frame_mat(info));
+
+        std::vector<std::vector<Yolo::Detection>> results;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(mutex_);
+            results = detector_.detect(mats);
+        }
+        if (single) return to_array(results[0]);
+        py::list out;
+        for (const auto& res : results) out.append(to_array(res));
+        return out;
+    }
+
+    // 上一次detect中每次推理的(batch, input_h, input_w)
+    std::vector<std::tuple<int, int, int>> last_batches() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<std::tuple<int, int, int>> out;
+        for (const auto& b : detector_.lastBatches()) out.emplace_back(b.batch, b.input_h, b.input_w);
+        return out;
+    }
+
+    // 与detect相同的预处理: 返回(3 x canvas_h x canvas_w的RGB float32数组, (gain, pad_x, pad_y))
+    py::tuple preprocess(py::object frame) {
+        py::buffer_info info = request_frame(frame);
+        cv::Mat img = frame_mat(info);
+        Yolo::Letterbox lb = detector_.letterbox(img.cols, img.rows);
+        py::array_t<float> blob({ 3, lb.canvas_h, lb.canvas_w });
+        float* dst = blob.mutable_data();
+        {
+            py::gil_scoped_release release;
+            cv::Mat canvas = letterbox_img(img, lb);
+            blob_from_img(canvas, dst, lb.canvas_w, lb.canvas_h);
+        }
+        return py::make_tuple(blob, py::make_tuple(lb.gain, lb.pad_x, lb.pad_y));
+    }
+
+    // 对一张图的原始输出([数量, Detection...])做NMS, 返回网络输入坐标的xyxy
+    py::array nms(py::array_t<float, py::array::c_style | py::array::forcecast> output) {
+        if (output.ndim() != 1 || output.shape(0) < 1) throw std::invalid_argument("output must be a 1-D float array");
+        std::vector<Yolo::Detection> res;
+        const float* ptr = output.data();
+        int size = (int)output.shape(0);
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(mutex_);
+            // 单位letterbox: 不缩放、不平移, 裁剪到一个足够大的范围
+            Yolo::Letterbox lb{ 0, 0, 0, 0, 0, 0, 1.f };
+            detector_.postprocess(ptr, size, 1 << 20, 1 << 20, lb, res);
+        }
+        return to_array(res);
+    }
+
+private:
+    static py::buffer_info request_frame(const py::object& obj) {
+        py::buffer_info info = py::reinterpret_borrow<py::buffer>(obj).request();
+        if (info.ndim != 3 || info.shape[2] != 3 || info.itemsize != 1 || info.format != py::format_descriptor<uint8_t>::format())
+            throw std::invalid_argument("frames must be HxWx3 uint8 BGR arrays");
+        if (info.strides[2] != 1 || info.strides[1] != 3)
+            throw std::invalid_argument("frame pixels must be contiguous within a row");
+        return info;
+    }
+
+    // 行之间可以有padding(例如切片后的数组), 用strides[0]作为cv::Mat的step
+    static cv::Mat frame_mat(const py::buffer_info& info) {
+        return cv::Mat((int)info.shape[0], (int)info.shape[1], CV_8UC3, info.ptr, (size_t)info.strides[0]);
+    }
+
+    static py::array to_array(const std::vector<Yolo::Detection>& res) {
+        py::array_t<PyDetection> out(res.size());
+        PyDetection* dst = out.mutable_data();
+        for (size_t i = 0; i < res.size(); i++) {
+            dst[i] = PyDetection{ res[i].bbox[0], res[i].bbox[1], res[i].bbox[2], res[i].bbox[3], res[i].conf, (int32_t)res[i].class_id };
+        }
+        return out;
+    }
+
+    Detector detector_;
+    std::mutex mutex_;
+};
+
+static DetectorConfig make_config(float conf_thresh, float nms_thresh, bool rect, int input_w, int input_h) {
+    DetectorConfig config;
+    config.conf_thresh = conf_thresh;
+    config.nms_thresh = nms_thresh;
+    config.rect = rect;
+    config.input_w = input_w;
+    config.input_h = input_h;
+    return config;
+}
+
+PYBIND11_MODULE(pyyolov5, m) {
+    m.doc() = "yolov5-p6 TensorRT preprocessing, batched inference and NMS";
+    PYBIND11_NUMPY_DTYPE(PyDetection, x1, y1, x2, y2, conf, class_id);
+
+    m.attr("INPUT_W") = Yolo::INPUT_W;
+    m.attr("INPUT_H") = Yolo::INPUT_H;
+    m.attr("CLASS_NUM") = Yolo::CLASS_NUM;
+#ifdef PYYOLOV5_TRT
+    m.attr("HAS_TENSORRT") = true;
+#else
+    m.attr("HAS_TENSORRT") = false;
+#endif
+
+    py::class_<PyDetector>(m, "Detector")
+#ifdef PYYOLOV5_TRT
+        .def_static("tensorrt", [](const std::string& engine_path, float conf_thresh, float nms_thresh, bool rect, int input_w, int input_h) {
+                return new PyDetector(std::make_shared<TrtBackend>(engine_path), make_config(conf_thresh, nms_thresh, rect, input_w, input_h));
+            }, py::arg("engine_path"), py::arg("conf_thresh") = 0.45f, py::arg("nms_thresh") = 0.5f, py::arg("rect") = true,
+            py::arg("input_w") = Yolo::INPUT_W, py::arg("input_h") = Yolo::INPUT_H,
+            "Load a serialized engine, libmyplugins.so must already be loaded (e.g. ctypes.CDLL)")
+#endif
+        .def_static("mock", [](py::array_t<float, py::array::c_style | py::array::forcecast> boxes, int max_batch, int max_input, float conf_thresh, float nms_thresh, bool rect, int input_w, int input_h) {
+                if (boxes.ndim() != 2 || boxes.shape(1) != 6) throw std::invalid_argument("boxes must be N x 6: cx, cy, w, h, conf, class_id");
+                std::vector<Yolo::Detection> dets(boxes.shape(0));
+                for (size_t i = 0; i < dets.size(); i++) memcpy(&dets[i], boxes.data(i, 0), sizeof(Yolo::Detection));
+                return new PyDetector(std::make_shared<MockBackend>(dets, max_batch, max_input), make_config(conf_thresh, nms_thresh, rect, input_w, input_h));
+            }, py::arg("boxes"), py::arg("max_batch") = 16, py::arg("max_input") = std::max(Yolo::INPUT_W, Yolo::INPUT_H),
+            py::arg("conf_thresh") = 0.45f, py::arg("nms_thresh") = 0.5f, py::arg("rect") = true,
+            py::arg("input_w") = Yolo::INPUT_W, py::arg("input_h") = Yolo::INPUT_H,
+            "CPU-only backend that outputs `boxes` for every image, cx/w relative to the canvas width and cy/h to its height")
+        .def("detect", &PyDetector::detect, py::arg("frames"),
+            "Detect on one HxWx3 uint8 BGR frame or a list of frames, returns structured arrays in original image coordinates")
+        .def("preprocess", &PyDetector::preprocess, py::arg("frame"))
+        .def("nms", &PyDetector::nms, py::arg("output"))
+        .def_property_readonly("last_batches", &PyDetector::last_batches);
+}
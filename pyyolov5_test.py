@@ -0,0 +1,180 @@
+"""
+Tests for the pyyolov5 extension (pyyolov5.cpp) on the CPU mock backend, no GPU or engine needed.
+Covers the structured result arrays, letterbox and coordinate mapping, NMS, batching by canvas,
+frames with padded rows and the input checks.
+Run by ctest when built with `cmake -DBUILD_PYTHON=ON ..` (needs numpy), or with build/ on PYTHONPATH:
+    python3 pyyolov5_test.py
+"""
+import threading
+import unittest
+
+import numpy as np
+
+import pyyolov5
+
+CONF_THRESH = 0.45
+NMS_THRESH = 0.5
+CANVAS_STRIDE = 64  # Yolo::CANVAS_STRIDE
+
+# cx, cy, w, h relative to the canvas, conf, class_id
+BOXES = np.array([
+    [0.5, 0.5, 0.25, 0.25, 0.9, 1],
+    [0.52, 0.5, 0.25, 0.25, 0.8, 1],  # overlaps the first box, same class: suppressed
+    [0.5, 0.5, 0.25, 0.25, 0.7, 2],   # same box, another class: kept
+    [0.1, 0.1, 0.1, 0.1, 0.3, 0],     # below CONF_THRESH
+], dtype=np.float32)
+KEPT = [0, 2]
+
+
+def rect_letterbox(img_w, img_h, long_side):
+    """letterbox.h rect_letterbox, float32 like the C++ code: (gain, w, h, canvas_w, canvas_h, pad_x, pad_y)"""
+    gain = np.float32(long_side) / np.float32(max(img_w, img_h))
+    w = max(1, min(long_side, int(np.float32(img_w) * gain + np.float32(0.5))))
+    h = max(1, min(long_side, int(np.float32(img_h) * gain + np.float32(0.5))))
+    canvas_w = (w + CANVAS_STRIDE - 1) // CANVAS_STRIDE * CANVAS_STRIDE
+    canvas_h = (h + CANVAS_STRIDE - 1) // CANVAS_STRIDE * CANVAS_STRIDE
+    return gain, w, h, canvas_w, canvas_h, (canvas_w - w) // 2, (canvas_h - h) // 2
+
+
+def expected_boxes(img_w, img_h, long_side=None):
+    """The mock boxes that survive NMS, mapped back to the original image as x1, y1, x2, y2"""
+    long_side = long_side or max(pyyolov5.INPUT_W, pyyolov5.INPUT_H)
+    gain, _, _, canvas_w, canvas_h, pad_x, pad_y = rect_letterbox(img_w, img_h, long_side)
+    out = []
+    for i in KEPT:
+        cx, cy, w, h = BOXES[i, 0] * canvas_w, BOXES[i, 1] * canvas_h, BOXES[i, 2] * canvas_w, BOXES[i, 3] * canvas_h
+        xyxy = [(cx - w / 2 - pad_x) / gain, (cy - h / 2 - pad_y) / gain, (cx + w / 2 - pad_x) / gain, (cy + h / 2 - pad_y) / gain]
+        xyxy = [min(max(v, 0), lim) for v, lim in zip(xyxy, [img_w, img_h, img_w, img_h])]
+        out.append(xyxy + [BOXES[i, 4], int(BOXES[i, 5])])
+    return out
+
+
+def frame(h, w, value=0):
+    return np.full((h, w, 3), value, dtype=np.uint8)
+
+
+class MockDetectorTest(unittest.TestCase):
+    def make(self, **kwargs):
+        kwargs.setdefault("conf_thresh", CONF_THRESH)
+        kwargs.setdefault("nms_thresh", NMS_THRESH)
+        return pyyolov5.Detector.mock(BOXES, **kwargs)
+
+    def check_dets(self, dets, img_w, img_h):
+        self.assertEqual(dets.dtype.names, ("x1", "y1", "x2", "y2", "conf", "class_id"))
+        expected = expected_boxes(img_w, img_h)
+        self.assertEqual(len(dets), len(expected))
+        # nms_host keeps the boxes in descending conf order
+        for det, exp in zip(dets, expected):
+            for key, value in zip(("x1", "y1", "x2", "y2"), exp[:4]):
+                self.assertAlmostEqual(float(det[key]), value, delta=1e-2)
+            self.assertAlmostEqual(float(det["conf"]), exp[4], places=5)
+            self.assertEqual(int(det["class_id"]), exp[5])
+
+    def test_single_frame(self):
+        detector = self.make()
+        self.assertFalse(isinstance(detector.detect(frame(480, 640)), list))
+        self.check_dets(detector.detect(frame(480, 640)), 640, 480)
+        self.check_dets(detector.detect(frame(240, 320)), 320, 240)
+        self.check_dets(detector.detect(frame(1080, 1920)), 1920, 1080)
+
+    def test_batches_by_canvas(self):
+        detector = self.make(max_batch=2)
+        frames = [frame(480, 640), frame(640, 480), frame(240, 320), frame(960, 1280)]
+        results = detector.detect(frames)
+        self.assertIsInstance(results, list)
+        self.assertEqual(len(results), len(frames))
+        for dets, f in zip(results, frames):
+            self.check_dets(dets, f.shape[1], f.shape[0])
+        # 640x480, 320x240 and 1280x960 share a canvas and are split by max_batch, 480x640 is its own batch
+        _, _, _, cw, ch, _, _ = rect_letterbox(640, 480, max(pyyolov5.INPUT_W, pyyolov5.INPUT_H))
+        self.assertEqual(sorted(detector.last_batches), sorted([(2, ch, cw), (1, ch, cw), (1, cw, ch)]))
+
+        results = detector.detect((frame(480, 640),))
+        self.assertEqual(len(results), 1)
+        self.assertEqual(detector.last_batches, [(1, ch, cw)])
+
+    def test_fixed_input(self):
+        detector = self.make(rect=False)
+        dets = detector.detect(frame(480, 640))
+        self.assertEqual(detector.last_batches, [(1, pyyolov5.INPUT_H, pyyolov5.INPUT_W)])
+        self.assertEqual(len(dets), len(KEPT))
+
+    def test_padded_rows(self):
+        # a crop of a wider frame: rows are not contiguous, pixels within a row are
+        detector = self.make()
+        big = frame(480, 800, 37)
+        crop = big[:, 100:740]
+        self.assertNotEqual(crop.strides[0], 640 * 3)
+        self.check_dets(detector.detect(crop), 640, 480)
+        blob, _ = detector.preprocess(crop)
+        contiguous, _ = detector.preprocess(np.ascontiguousarray(crop))
+        np.testing.assert_array_equal(blob, contiguous)
+
+    def test_preprocess(self):
+        detector = self.make()
+        img = frame(480, 640)
+        img[..., 0] = 255  # blue
+        blob, (gain, pad_x, pad_y) = detector.preprocess(img)
+        exp_gain, w, h, cw, ch, exp_pad_x, exp_pad_y = rect_letterbox(640, 480, max(pyyolov5.INPUT_W, pyyolov5.INPUT_H))
+        self.assertEqual(blob.dtype, np.float32)
+        self.assertEqual(blob.shape, (3, ch, cw))
+        self.assertAlmostEqual(gain, float(exp_gain), places=5)
+        self.assertEqual((pad_x, pad_y), (exp_pad_x, exp_pad_y))
+        # RGB planes: blue in the last plane, gray 128 padding
+        center = (exp_pad_y + h // 2, exp_pad_x + w // 2)
+        self.assertAlmostEqual(float(blob[2][center]), 1.0, places=5)
+        self.assertAlmostEqual(float(blob[0][center]), 0.0, places=5)
+        if exp_pad_y > 0:
+            self.assertAlmostEqual(float(blob[0, 0, 0]), 128 / 255.0, places=5)
+
+    def test_nms(self):
+        detector = self.make()
+        # [count, cx, cy, w, h, conf, class_id, ...] in network input coordinates
+        output = np.concatenate([[len(BOXES)], (BOXES * [100, 100, 100, 100, 1, 1]).ravel()]).astype(np.float32)
+        dets = detector.nms(output)
+        self.assertEqual(len(dets), len(KEPT))
+        self.assertEqual([int(d["class_id"]) for d in dets], [int(BOXES[i, 5]) for i in KEPT])
+        self.assertAlmostEqual(float(dets[0]["x1"]), 37.5, places=4)
+        self.assertAlmostEqual(float(dets[0]["y2"]), 62.5, places=4)
+        self.assertEqual(len(detector.nms(np.zeros(1, dtype=np.float32))), 0)
+        with self.assertRaises(ValueError):
+            detector.nms(np.zeros((2, 6), dtype=np.float32))
+
+    def test_thresholds(self):
+        self.assertEqual(len(self.make(conf_thresh=0.95).detect(frame(480, 640))), 0)
+        # with a high IoU threshold the overlapping box of the same class is kept
+        self.assertEqual(len(self.make(nms_thresh=0.99).detect(frame(480, 640))), len(KEPT) + 1)
+
+    def test_invalid_frames(self):
+        detector = self.make()
+        for bad in (np.zeros((480, 640), np.uint8), np.zeros((480, 640, 4), np.uint8),
+                    np.zeros((480, 640, 3), np.float32), frame(480, 1280)[:, ::2]):
+            with self.assertRaises(ValueError):
+                detector.detect(bad)
+        with self.assertRaises(ValueError):
+            pyyolov5.Detector.mock(np.zeros((2, 5), np.float32))
+
+    def test_threads(self):
+        # the GIL is released during detect, a shared detector is serialized by its mutex
+        detector = self.make(max_batch=4)
+        frames = [frame(480, 640), frame(720, 1280), frame(640, 480)]
+        errors = []
+
+        def run():
+            try:
+                for _ in range(20):
+                    for dets, f in zip(detector.detect(frames), frames):
+                        self.check_dets(dets, f.shape[1], f.shape[0])
+            except Exception as e:  # reported by the main thread
+                errors.append(e)
+
+        threads = [threading.Thread(target=run) for _ in range(4)]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual(errors, [])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,110 @@
+// 推理后D2H回传(doInference)的字节数和耗时: 全量拷贝(full_readback_bytes) vs 两阶段拷贝(compact_readback_bytes, 先拷各图的数量, 再拷batch中最多的那张图用到的行), 只用CPU
+// 每张图的框数按几种场景随机生成(YoloLayer输出的候选数, 或GPU NMS后的NMS_TOP_N以内), 对每个batch大小报告
+//   - 每张图的平均字节数和压缩比
+//   - host上按同样的布局做strided拷贝的实测耗时(两阶段为两次拷贝), 代表拷贝本身的开销
+//   - 按PCIe带宽和每次cudaMemcpy + 同步的固定延迟估算的传输时间: 全量为1次, 两阶段为2次; 框很多且batch小时两阶段可能更慢
+//     doInference按这里的交叉点(省下的字节超过 延迟 x 带宽)选择COMPACT_READBACK_MIN_BYTES, 小于该值时全量拷贝
+// ./readback_bench [batch大小, 默认1,4,16] [PCIe GB/s, 默认12] [每次拷贝的延迟us, 默认10] [重复次数]
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "postprocess.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const int DET_SIZE = sizeof(Yolo::Detection) / sizeof(float);
+static const int GPU_NMS_TOP_N = 100; // yolov5-p6.cpp中的NMS_TOP_N
+
+struct Scenario {
+    const char* name;
+    int min_count, max_count; // 每张图的框数范围
+    int output_size;          // 每张图输出的float数(OUTPUT_SIZE)
+};
+
+// 与doInference相同的布局: 每张图output_size个float, 第一个为数量
+static double copy_us(int reps, const std::vector<float>& src, std::vector<float>& dst, int batch, int output_size, bool compact) {
+    const size_t pitch = output_size;
+    const int max_rows = (output_size - 1) / DET_SIZE;
+    float count_buf[64];
+    auto start = Clock::now();
+    for (int r = 0; r < reps; r++) {
+        if (!compact) {
+            memcpy(dst.data(), src.data(), (size_t)batch * output_size * sizeof(float));
+            continue;
+        }
+        for (int b = 0; b < batch; b++) count_buf[b] = src[b * pitch];
+        int rows = 0;
+        for (int b = 0; b < batch; b++) rows = std::max(rows, std::min((int)count_buf[b], max_rows));
+        size_t width = 1 + (size_t)rows * DET_SIZE;
+        for (int b = 0; b < batch; b++) memcpy(&dst[b * pitch], &src[b * pitch], width * sizeof(float));
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / reps;
+}
+
+static void bench(const Scenario& s, int batch, double gbps, double latency_us, int reps, std::mt19937& rng) {
+    const int frames = 200; // 每个场景随机生成的batch数
+    std::uniform_int_distribution<int> count(s.min_count, s.max_count);
+    const int max_rows = (s.output_size - 1) / DET_SIZE;
+    std::vector<float> src((size_t)batch * s.output_size, 0.f), dst(src.size());
+    double full_bytes = 0, compact_bytes = 0, full_copy = 0, compact_copy = 0;
+    std::vector<int> counts(batch);
+    for (int f = 0; f < frames; f++) {
+        for (int b = 0; b < batch; b++) {
+            counts[b] = count(rng);
+            src[(size_t)b * s.output_size] = (float)counts[b];
+        }
+        full_bytes += full_readback_bytes(batch, s.output_size);
+        compact_bytes += compact_readback_bytes(counts, max_rows);
+        full_copy += copy_us(reps, src, dst, batch, s.output_size, false);
+        compact_copy += copy_us(reps, src, dst, batch, s.output_size, true);
+    }
+    full_bytes /= frames;
+    compact_bytes /= frames;
+    full_copy /= frames;
+    compact_copy /= frames;
+    // GB/s -> bytes/us
+    const double bytes_per_us = gbps * 1e3;
+    double full_pcie = latency_us + full_bytes / bytes_per_us;
+    double compact_pcie = 2 * latency_us + compact_bytes / bytes_per_us;
+    std::cout << "  batch " << batch << ": " << full_bytes / batch << " -> " << compact_bytes / batch << " bytes/image (x" << full_bytes / compact_bytes
+              << "), host copy " << full_copy << " -> " << compact_copy << " us/batch, PCIe model " << full_pcie << " -> " << compact_pcie << " us/batch" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> batches;
+    std::stringstream ss(argc > 1 ? argv[1] : "1,4,16");
+    std::string item;
+    while (std::getline(ss, item, ',')) batches.push_back(atoi(item.c_str()));
+    double gbps = argc > 2 ? atof(argv[2]) : 12;
+    double latency_us = argc > 3 ? atof(argv[3]) : 10;
+    int reps = argc > 4 ? atoi(argv[4]) : 20;
+    bool valid = !batches.empty() && gbps > 0 && latency_us >= 0 && reps > 0;
+    for (int b : batches) valid = valid && b > 0 && b <= 64;
+    if (!valid) {
+        std::cerr << "./readback_bench [batch sizes, e.g. 1,4,16] [PCIe GB/s] [latency per copy in us] [repetitions]" << std::endl;
+        return -1;
+    }
+
+    const int yolo_output = Yolo::MAX_OUTPUT_BBOX_COUNT * DET_SIZE + 1;
+    const int nms_output = GPU_NMS_TOP_N * DET_SIZE + 1;
+    const Scenario scenarios[] = {
+        { "sparse (0-50 YoloLayer candidates)", 0, 50, yolo_output },
+        { "typical (50-300 candidates)", 50, 300, yolo_output },
+        { "crowded (500-1000 candidates)", 500, 1000, yolo_output },
+        { "overflow (>= MAX_OUTPUT_BBOX_COUNT)", Yolo::MAX_OUTPUT_BBOX_COUNT, 2 * Yolo::MAX_OUTPUT_BBOX_COUNT, yolo_output },
+        { "GPU NMS (0-NMS_TOP_N boxes)", 0, GPU_NMS_TOP_N, nms_output },
+    };
+    std::mt19937 rng(0);
+    for (const Scenario& s : scenarios) {
+        std::cout << s.name << ", full copy " << s.output_size * sizeof(float) << " bytes/image" << std::endl;
+        for (int b : batches) bench(s, b, gbps, latency_us, reps, rng);
+    }
+    return 0;
+}
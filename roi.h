@@ -0,0 +1,147 @@
+#ifndef TRTX_YOLOV5_ROI_H_
+#define TRTX_YOLOV5_ROI_H_
+
+// 每路视频源的多边形感兴趣区域(ROI)
+// 1. 推理前把帧裁剪到所有多边形的外接矩形再letterbox, 目标占的像素更多, padding更少
+// 2. nms之前直接在yololayer的原始输出上丢掉中心点不在任何多边形内的候选框, 减少nms的计算量
+//    (ffmpeg输入由swscale缩放整帧, 只做这一步; USE_GPU_NMS时engine输出已经过NMS, 这一步在NMS之后, 多边形外的框可能已经抑制了多边形内的同类框)
+//
+// 配置文件格式, 每行一个多边形(原图坐标), #开头为注释:
+//   <source_id> x1,y1 x2,y2 x3,y3 ...
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "yolo_types.h"
+#include "letterbox.h"
+
+namespace Yolo
+{
+    struct RoiPolygon {
+        std::vector<float> xs, ys;
+        float min_x, min_y, max_x, max_y; // 外接矩形, 用于快速排除
+    };
+
+    struct SourceRoi {
+        std::vector<RoiPolygon> polygons; // 为空表示整帧
+    };
+
+    struct RoiCrop {
+        int x, y, w, h; // 裁剪区域(原图坐标)
+    };
+}
+
+static inline bool read_roi_file(const std::string& path, std::vector<Yolo::SourceRoi>& rois) {
+    std::ifstream input(path);
+    if (!input.is_open()) return false;
+    std::string line;
+    while (std::getline(input, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ls(line);
+        int source;
+        if (!(ls >> source) || source < 0) continue;
+        Yolo::RoiPolygon poly;
+        std::string pt;
+        while (ls >> pt) {
+            float x, y;
+            char comma;
+            std::istringstream ps(pt);
+            if (ps >> x >> comma >> y && comma == ',') {
+                poly.xs.push_back(x);
+                poly.ys.push_back(y);
+            }
+        }
+        if (poly.xs.size() < 3) continue;
+        poly.min_x = *std::min_element(poly.xs.begin(), poly.xs.end());
+        poly.max_x = *std::max_element(poly.xs.begin(), poly.xs.end());
+        poly.min_y = *std::min_element(poly.ys.begin(), poly.ys.end());
+        poly.max_y = *std::max_element(poly.ys.begin(), poly.ys.end());
+        if ((int)rois.size() <= source) rois.resize(source + 1);
+        rois[source].polygons.push_back(poly);
+    }
+    return true;
+}
+
+// 射线法(crossing number)判断点是否在多边形内
+static inline bool point_in_polygon(const Yolo::RoiPolygon& poly, float x, float y) {
+    if (x < poly.min_x || x > poly.max_x || y < poly.min_y || y > poly.max_y) return false;
+    bool inside = false;
+    size_t n = poly.xs.size();
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        float yi = poly.ys[i], yj = poly.ys[j];
+        if ((yi > y) != (yj > y)) {
+            float xc = poly.xs[j] + (y - yj) * (poly.xs[i] - poly.xs[j]) / (yi - yj);
+            if (x < xc) inside = !inside;
+        }
+    }
+    return inside;
+}
+
+static inline bool point_in_roi(const Yolo::SourceRoi& roi, float x, float y) {
+    for (const auto& poly : roi.polygons) {
+        if (point_in_polygon(poly, x, y)) return true;
+    }
+    return roi.polygons.empty();
+}
+
+// 所有多边形的外接矩形, 裁剪到图像范围内; 没有ROI时为整帧
+static inline Yolo::RoiCrop roi_crop(const Yolo::SourceRoi& roi, int img_w, int img_h) {
+    Yolo::RoiCrop c = { 0, 0, img_w, img_h };
+    if (roi.polygons.empty()) return c;
+    float x0 = img_w, y0 = img_h, x1 = 0, y1 = 0;
+    for (const auto& poly : roi.polygons) {
+        x0 = std::min(x0, poly.min_x);
+        y0 = std::min(y0, poly.min_y);
+        x1 = std::max(x1, poly.max_x);
+        y1 = std::max(y1, poly.max_y);
+    }
+    c.x = std::max(0, (int)x0);
+    c.y = std::max(0, (int)y0);
+    c.w = std::min(img_w, (int)x1 + 1) - c.x;
+    c.h = std::min(img_h, (int)y1 + 1) - c.y;
+    if (c.w <= 0 || c.h <= 0) {
+        c.x = 0;
+        c.y = 0;
+        c.w = img_w;
+        c.h = img_h;
+    }
+    return c;
+}
+
+// 在yololayer原始输出(output[0]为数量, 之后是Detection数组, 网络输入坐标xywh)上原地过滤,
+// 中心点映射回原图后不在ROI内的候选框被移除, 剩余的框紧凑排列. lb为裁剪区域letterbox到网络输入的参数
+static inline void filter_roi(float* output, const Yolo::SourceRoi& roi, const Yolo::RoiCrop& crop, const Yolo::Letterbox& lb) {
+    if (roi.polygons.empty()) return;
+    float gain = lb.gain;
+    float pad_x = lb.pad_x;
+    float pad_y = lb.pad_y;
+    Yolo::Detection* dets = reinterpret_cast<Yolo::Detection*>(&output[1]);
+    int count = std::min((int)output[0], Yolo::MAX_OUTPUT_BBOX_COUNT);
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        float x = (dets[i].bbox[0] - pad_x) / gain + crop.x;
+        float y = (dets[i].bbox[1] - pad_y) / gain + crop.y;
+        if (!point_in_roi(roi, x, y)) continue;
+        if (kept != i) dets[kept] = dets[i];
+        kept++;
+    }
+    output[0] = kept;
+}
+
+static inline void filter_roi(float* output, const Yolo::SourceRoi& roi, const Yolo::RoiCrop& crop) {
+    filter_roi(output, roi, crop, fixed_letterbox(crop.w, crop.h, Yolo::INPUT_W, Yolo::INPUT_H));
+}
+
+// scale_coords(res, crop.w, crop.h)之后调用, 把裁剪区域内的坐标平移回原图
+static inline void offset_coords(std::vector<Yolo::Detection>& res, const Yolo::RoiCrop& crop) {
+    for (auto& det : res) {
+        det.bbox[0] += crop.x;
+        det.bbox[1] += crop.y;
+        det.bbox[2] += crop.x;
+        det.bbox[3] += crop.y;
+    }
+}
+
+#endif  // TRTX_YOLOV5_ROI_H_
@@ -0,0 +1,99 @@
+#ifndef TRTX_YOLOV5_SCHEDULER_H_
+#define TRTX_YOLOV5_SCHEDULER_H_
+
+// 跳帧/关键帧调度: 每路视频源只在关键帧上跑完整网络, 中间帧用Tracker::predict传播上一帧的框
+// 关键帧条件: 距上次推理已满interval帧, 或者帧差(运动)分数超过阈值
+// interval根据实测的推理耗时自动调整, 使该路的GPU占用保持在预算以内
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+
+struct SchedulerConfig {
+    int max_interval = 5;          // 最多每max_interval帧推理一次, 1表示每帧都推理
+    float motion_thresh = 0.04f;   // 缩略图平均绝对差(0~1)超过该值时强制推理
+    float gpu_budget_ms = 100.f;   // 每秒允许该路占用的GPU时间(ms)
+    int thumb_w = 64;              // 计算运动分数用的灰度缩略图尺寸
+    int thumb_h = 36;
+};
+
+struct SchedulerMetrics {
+    long long frames = 0;
+    long long inferred = 0;
+    float interval = 1.f;          // 当前关键帧间隔
+    float inference_rate = 0.f;    // 每秒实际推理次数
+    float motion = 0.f;            // 最近一帧的运动分数
+
+    float skipRatio() const { return frames ? 1.f - (float)inferred / frames : 0.f; }
+};
+
+class KeyframeScheduler
+{
+public:
+    explicit KeyframeScheduler(const SchedulerConfig& cfg = SchedulerConfig())
+        : cfg_(cfg), interval_(1), since_key_(0), infer_ms_(0.f), frame_s_(0.f), rate_(0.f)
+    {
+        metrics_.interval = 1.f;
+    }
+
+    // 每帧调用一次, 返回true表示这一帧需要跑完整推理
+    bool decide(const cv::Mat& frame) {
+        auto now = std::chrono::steady_clock::now();
+        if (metrics_.frames > 0) {
+            float dt = std::chrono::duration<float>(now - last_frame_).count();
+            frame_s_ = frame_s_ > 0.f ? 0.9f * frame_s_ + 0.1f * dt : dt;
+        }
+        last_frame_ = now;
+        metrics_.frames++;
+        since_key_++;
+
+        cv::Mat small, gray;
+        cv::resize(frame, small, cv::Size(cfg_.thumb_w, cfg_.thumb_h), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+        float motion = 0.f;
+        if (!key_thumb_.empty()) {
+            motion = cv::norm(gray, key_thumb_, cv::NORM_L1) / (255.0 * gray.total());
+        }
+        metrics_.motion = motion;
+
+        bool run = key_thumb_.empty() || since_key_ >= interval_ || motion > cfg_.motion_thresh;
+        if (run) {
+            gray.copyTo(key_thumb_);
+            since_key_ = 0;
+            metrics_.inferred++;
+            float dt = std::chrono::duration<float>(now - last_key_).count();
+            if (metrics_.inferred > 1 && dt > 0.f) rate_ = rate_ > 0.f ? 0.9f * rate_ + 0.1f / dt : 1.f / dt;
+            last_key_ = now;
+            metrics_.inference_rate = rate_;
+        }
+        return run;
+    }
+
+    // 关键帧推理完成后调用, gpu_ms为该路分摊到的推理耗时(batch耗时 / batch内的图像数)
+    void onInference(float gpu_ms) {
+        infer_ms_ = infer_ms_ > 0.f ? 0.8f * infer_ms_ + 0.2f * gpu_ms : gpu_ms;
+        if (frame_s_ <= 0.f) return;
+        // 每秒GPU耗时 = infer_ms * fps / interval <= budget
+        float fps = 1.f / frame_s_;
+        float need = infer_ms_ * fps / std::max(cfg_.gpu_budget_ms, 1e-3f);
+        interval_ = std::min(cfg_.max_interval, std::max(1, (int)std::ceil(need)));
+        metrics_.interval = interval_;
+    }
+
+    const SchedulerMetrics& metrics() const { return metrics_; }
+
+private:
+    SchedulerConfig cfg_;
+    SchedulerMetrics metrics_;
+    int interval_;
+    int since_key_;
+    float infer_ms_;  // EWMA
+    float frame_s_;   // EWMA 帧间隔
+    float rate_;      // EWMA 推理频率
+    cv::Mat key_thumb_;
+    std::chrono::steady_clock::time_point last_frame_;
+    std::chrono::steady_clock::time_point last_key_;
+};
+
+#endif  // TRTX_YOLOV5_SCHEDULER_H_
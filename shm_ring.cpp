@@ -0,0 +1,234 @@
+#include <atomic>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "shm_ring.h"
+
+namespace
+{
+    static constexpr uint32_t SHM_RING_MAGIC = 0x59355352; // "Y5SR"
+    static constexpr uint32_t SHM_RING_VERSION = 1;
+    static constexpr size_t SHM_RING_ALIGN = 64;
+
+    // 段头，位于共享内存起始处
+    struct alignas(SHM_RING_ALIGN) RingHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slots;
+        uint32_t width;
+        uint32_t height;
+        uint32_t stride;
+        uint64_t slot_bytes; // slot header + pixels, multiple of SHM_RING_ALIGN
+        std::atomic<uint64_t> write_seq; // last reserved frame
+        std::atomic<uint64_t> published; // last published frame
+        std::atomic<uint32_t> futex_word; // bumped on every publish
+    };
+
+    // 每个slot的头: state = seq << 1 | writing
+    struct alignas(SHM_RING_ALIGN) SlotHeader
+    {
+        std::atomic<uint64_t> state;
+        uint64_t timestamp_us;
+    };
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shm ring needs lock-free 64-bit atomics");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2, "shm ring needs lock-free 32-bit atomics");
+
+    static inline size_t align_up(size_t x, size_t a) { return (x + a - 1) / a * a; }
+
+    static inline int futex_wait(std::atomic<uint32_t>* addr, uint32_t expected, const struct timespec* timeout)
+    {
+        // 不使用FUTEX_PRIVATE_FLAG, 以便跨进程唤醒
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected, timeout, nullptr, 0);
+    }
+
+    static inline int futex_wake(std::atomic<uint32_t>* addr)
+    {
+        return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    }
+}
+
+struct shm_ring
+{
+    RingHeader* header;
+    size_t map_size;
+};
+
+static inline SlotHeader* slot_at(const shm_ring_t* ring, uint64_t seq)
+{
+    char* base = reinterpret_cast<char*>(ring->header) + sizeof(RingHeader);
+    return reinterpret_cast<SlotHeader*>(base + (seq % ring->header->slots) * ring->header->slot_bytes);
+}
+
+static inline uint8_t* slot_pixels(SlotHeader* slot)
+{
+    return reinterpret_cast<uint8_t*>(slot) + sizeof(SlotHeader);
+}
+
+static shm_ring_t* map_ring(int fd, size_t size)
+{
+    void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return nullptr;
+    shm_ring_t* ring = new shm_ring;
+    ring->header = static_cast<RingHeader*>(addr);
+    ring->map_size = size;
+    return ring;
+}
+
+shm_ring_t* shm_ring_create(const char* name, uint32_t slots, uint32_t width, uint32_t height)
+{
+    if (slots < 2 || width == 0 || height == 0) return nullptr;
+    uint32_t stride = align_up(width * 3, SHM_RING_ALIGN);
+    size_t slot_bytes = align_up(sizeof(SlotHeader) + (size_t)stride * height, SHM_RING_ALIGN);
+    size_t size = sizeof(RingHeader) + slot_bytes * slots;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0660);
+    if (fd < 0) return nullptr;
+    if (ftruncate(fd, size) != 0) {
+        close(fd);
+        return nullptr;
+    }
+    shm_ring_t* ring = map_ring(fd, size);
+    if (!ring) return nullptr;
+
+    RingHeader* h = ring->header;
+    h->slots = slots;
+    h->width = width;
+    h->height = height;
+    h->stride = stride;
+    h->slot_bytes = slot_bytes;
+    h->write_seq.store(0, std::memory_order_relaxed);
+    h->published.store(0, std::memory_order_relaxed);
+    h->futex_word.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slots; i++) {
+        slot_at(ring, i)->state.store(0, std::memory_order_relaxed);
+    }
+    h->version = SHM_RING_VERSION;
+    // magic最后写入, open端据此判断段已初始化
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = SHM_RING_MAGIC;
+    return ring;
+}
+
+shm_ring_t* shm_ring_open(const char* name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(RingHeader)) {
+        close(fd);
+        return nullptr;
+    }
+    shm_ring_t* ring = map_ring(fd, st.st_size);
+    if (!ring) return nullptr;
+    const RingHeader* h = ring->header;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (h->magic != SHM_RING_MAGIC || h->version != SHM_RING_VERSION ||
+        sizeof(RingHeader) + h->slot_bytes * h->slots > ring->map_size) {
+        shm_ring_close(ring);
+        return nullptr;
+    }
+    return ring;
+}
+
+void shm_ring_close(shm_ring_t* ring)
+{
+    if (!ring) return;
+    munmap(ring->header, ring->map_size);
+    delete ring;
+}
+
+int shm_ring_unlink(const char* name)
+{
+    return shm_unlink(name);
+}
+
+uint32_t shm_ring_width(const shm_ring_t* ring) { return ring->header->width; }
+uint32_t shm_ring_height(const shm_ring_t* ring) { return ring->header->height; }
+uint32_t shm_ring_stride(const shm_ring_t* ring) { return ring->header->stride; }
+
+uint8_t* shm_ring_write_begin(shm_ring_t* ring, uint64_t* seq)
+{
+    uint64_t s = ring->header->write_seq.fetch_add(1, std::memory_order_relaxed) + 1;
+    SlotHeader* slot = slot_at(ring, s);
+    // 奇数状态表示写入中, 读端看到后会丢弃该帧
+    slot->state.store((s << 1) | 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    *seq = s;
+    return slot_pixels(slot);
+}
+
+int shm_ring_write_end(shm_ring_t* ring, uint64_t seq, uint64_t timestamp_us)
+{
+    RingHeader* h = ring->header;
+    SlotHeader* slot = slot_at(ring, seq);
+    if (slot->state.load(std::memory_order_relaxed) != ((seq << 1) | 1)) return -1; // overtaken by another writer
+    slot->timestamp_us = timestamp_us;
+    slot->state.store(seq << 1, std::memory_order_release);
+
+    uint64_t prev = h->published.load(std::memory_order_relaxed);
+    while (prev < seq && !h->published.compare_exchange_weak(prev, seq, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    h->futex_word.fetch_add(1, std::memory_order_release);
+    futex_wake(&h->futex_word);
+    return 0;
+}
+
+uint64_t shm_ring_wait(shm_ring_t* ring, uint64_t last_seq, int timeout_ms)
+{
+    RingHeader* h = ring->header;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    if (timeout_ms >= 0) {
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+    while (true) {
+        // 先读futex值再检查published, 避免丢失唤醒
+        uint32_t word = h->futex_word.load(std::memory_order_acquire);
+        uint64_t seq = h->published.load(std::memory_order_acquire);
+        if (seq > last_seq) return seq;
+
+        struct timespec rel;
+        const struct timespec* timeout = nullptr;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long ns = (deadline.tv_sec - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+            if (ns <= 0) return 0;
+            rel.tv_sec = ns / 1000000000LL;
+            rel.tv_nsec = ns % 1000000000LL;
+            timeout = &rel;
+        }
+        if (futex_wait(&h->futex_word, word, timeout) != 0 && errno == ETIMEDOUT) {
+            seq = h->published.load(std::memory_order_acquire);
+            return seq > last_seq ? seq : 0;
+        }
+    }
+}
+
+const uint8_t* shm_ring_read_begin(shm_ring_t* ring, uint64_t seq, uint64_t* timestamp_us)
+{
+    SlotHeader* slot = slot_at(ring, seq);
+    if (slot->state.load(std::memory_order_acquire) != (seq << 1)) return nullptr;
+    if (timestamp_us) *timestamp_us = slot->timestamp_us;
+    return slot_pixels(slot);
+}
+
+int shm_ring_read_end(shm_ring_t* ring, uint64_t seq)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot_at(ring, seq)->state.load(std::memory_order_relaxed) == (seq << 1);
+}
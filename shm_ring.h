@@ -0,0 +1,50 @@
+#ifndef TRTX_YOLOV5_SHM_RING_H_
+#define TRTX_YOLOV5_SHM_RING_H_
+
+// 共享内存帧环形缓冲区(C API)，供独立进程中的解码器直接写入BGR帧
+// Shared-memory frame ring: a POSIX shm segment holding a fixed number of
+// BGR8 frame slots. One producer writes frames in place, the consumer maps
+// the same slots and reads them without copying. Each slot is guarded by a
+// sequence number (odd while being written), so a reader can detect a frame
+// that was overwritten while it was still in use. New frames are signalled
+// through a process-shared futex in the segment header.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct shm_ring shm_ring_t;
+
+// create (or truncate) the segment /name; called by the producer
+shm_ring_t* shm_ring_create(const char* name, uint32_t slots, uint32_t width, uint32_t height);
+// map an existing segment; called by the consumer (or additional producers of the same ring)
+shm_ring_t* shm_ring_open(const char* name);
+void shm_ring_close(shm_ring_t* ring);
+int shm_ring_unlink(const char* name);
+
+uint32_t shm_ring_width(const shm_ring_t* ring);
+uint32_t shm_ring_height(const shm_ring_t* ring);
+// bytes per row of a slot (width * 3, rounded up to 64 bytes)
+uint32_t shm_ring_stride(const shm_ring_t* ring);
+
+// producer: reserve the next slot and return a pointer to its BGR pixels, *seq receives the frame sequence
+uint8_t* shm_ring_write_begin(shm_ring_t* ring, uint64_t* seq);
+// producer: publish the frame reserved by shm_ring_write_begin and wake waiting readers
+int shm_ring_write_end(shm_ring_t* ring, uint64_t seq, uint64_t timestamp_us);
+
+// consumer: wait until a frame newer than last_seq is published, return its sequence (0 on timeout)
+// timeout_ms < 0 waits forever
+uint64_t shm_ring_wait(shm_ring_t* ring, uint64_t last_seq, int timeout_ms);
+// consumer: pointer to the pixels of frame seq, or NULL if the slot already holds a different frame
+const uint8_t* shm_ring_read_begin(shm_ring_t* ring, uint64_t seq, uint64_t* timestamp_us);
+// consumer: returns 1 if frame seq was not overwritten while it was being read, 0 otherwise
+int shm_ring_read_end(shm_ring_t* ring, uint64_t seq);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // TRTX_YOLOV5_SHM_RING_H_
@@ -0,0 +1,155 @@
+// 共享内存帧环(shm_ring.h)的测试, 只用CPU
+//   - 单进程: 读取期间slot被覆盖时read_end返回0, 已被覆盖或正在写入的slot上read_begin返回NULL
+//   - fork出生产者进程连续写帧, 每帧的像素全部填成由seq决定的值; 消费者在读取中途停顿, 让生产者覆盖正在读的slot
+//     检查: 跨进程唤醒正常, seq单调递增, read_end通过的帧内容完整(没有读到一半被覆盖的帧), 被覆盖的帧都被read_end拒绝
+// ./shm_ring_test, 失败时返回非0
+
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include "shm_ring.h"
+#include "test_check.h"
+
+static const uint32_t TEST_W = 64;
+static const uint32_t TEST_H = 48;
+static const uint64_t TEST_FRAMES = 400;
+
+static uint8_t frame_value(uint64_t seq) {
+    return (uint8_t)(seq * 7 + 1);
+}
+
+static void write_frame(shm_ring_t* ring) {
+    uint64_t seq;
+    uint8_t* px = shm_ring_write_begin(ring, &seq);
+    for (uint32_t y = 0; y < TEST_H; y++) memset(px + (size_t)y * shm_ring_stride(ring), frame_value(seq), TEST_W * 3);
+    shm_ring_write_end(ring, seq, seq * 1000);
+}
+
+// 按行拷贝一帧, 拷贝到一半时停顿pause_us
+static void copy_frame(shm_ring_t* ring, const uint8_t* px, std::vector<uint8_t>& out, int pause_us) {
+    out.resize((size_t)TEST_W * 3 * TEST_H);
+    for (uint32_t y = 0; y < TEST_H; y++) {
+        if (y == TEST_H / 2 && pause_us > 0) std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+        memcpy(&out[(size_t)y * TEST_W * 3], px + (size_t)y * shm_ring_stride(ring), TEST_W * 3);
+    }
+}
+
+static bool uniform(const std::vector<uint8_t>& pixels, uint8_t value) {
+    for (uint8_t p : pixels) {
+        if (p != value) return false;
+    }
+    return true;
+}
+
+static void test_overwrite_detected(const std::string& name) {
+    shm_ring_t* ring = shm_ring_create(name.c_str(), 2, TEST_W, TEST_H);
+    CHECK(ring != nullptr);
+    if (!ring) return;
+    CHECK(shm_ring_stride(ring) % 64 == 0 && shm_ring_stride(ring) >= TEST_W * 3);
+    CHECK(shm_ring_wait(ring, 0, 0) == 0);
+
+    write_frame(ring);
+    CHECK(shm_ring_wait(ring, 0, 0) == 1);
+    uint64_t ts = 0;
+    const uint8_t* px = shm_ring_read_begin(ring, 1, &ts);
+    CHECK(px != nullptr && ts == 1000);
+    CHECK(shm_ring_read_end(ring, 1) == 1);
+
+    // 读取期间生产者绕回到同一个slot(2个slot: 帧3覆盖帧1)
+    px = shm_ring_read_begin(ring, 1, nullptr);
+    CHECK(px != nullptr);
+    write_frame(ring);
+    CHECK(shm_ring_read_end(ring, 1) == 1);
+    write_frame(ring);
+    CHECK(shm_ring_read_end(ring, 1) == 0);
+    CHECK(shm_ring_read_begin(ring, 1, nullptr) == nullptr);
+    CHECK(shm_ring_wait(ring, 1, 0) == 3);
+
+    // 正在写入(write_begin之后, write_end之前)的slot不能读
+    uint64_t seq = 0;
+    shm_ring_write_begin(ring, &seq);
+    CHECK(seq == 4);
+    CHECK(shm_ring_read_begin(ring, 4, nullptr) == nullptr);
+    CHECK(shm_ring_wait(ring, 3, 0) == 0);
+    shm_ring_write_end(ring, seq, 0);
+    CHECK(shm_ring_read_begin(ring, 4, nullptr) != nullptr);
+
+    // 消费者进程打开同一个段
+    shm_ring_t* reader = shm_ring_open(name.c_str());
+    CHECK(reader != nullptr);
+    if (reader) {
+        CHECK(shm_ring_width(reader) == TEST_W && shm_ring_height(reader) == TEST_H);
+        CHECK(shm_ring_wait(reader, 0, 0) == 4);
+        shm_ring_close(reader);
+    }
+    shm_ring_close(ring);
+    shm_ring_unlink(name.c_str());
+}
+
+static void test_fork_producer(const std::string& name) {
+    shm_ring_t* ring = shm_ring_create(name.c_str(), 3, TEST_W, TEST_H);
+    CHECK(ring != nullptr);
+    if (!ring) return;
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid < 0) return;
+    if (pid == 0) {
+        // 生产者: 打开已有的段, 每100us写一帧
+        shm_ring_t* producer = shm_ring_open(name.c_str());
+        if (!producer) _exit(2);
+        for (uint64_t i = 0; i < TEST_FRAMES; i++) {
+            write_frame(producer);
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        shm_ring_close(producer);
+        _exit(0);
+    }
+
+    uint64_t last = 0;
+    long long accepted = 0, torn = 0, overwritten = 0, bad = 0, reads = 0;
+    std::vector<uint8_t> pixels;
+    while (last < TEST_FRAMES) {
+        uint64_t seq = shm_ring_wait(ring, last, 2000);
+        CHECK(seq != 0);
+        if (seq == 0) break;
+        CHECK(seq > last && seq <= TEST_FRAMES);
+        last = seq;
+        const uint8_t* px = shm_ring_read_begin(ring, seq, nullptr);
+        if (!px) {
+            overwritten++;
+            continue;
+        }
+        // 每隔一帧在读取中途停顿约5帧的时间, 3个slot时该帧几乎总会被覆盖
+        copy_frame(ring, px, pixels, reads++ % 2 ? 500 : 0);
+        if (!shm_ring_read_end(ring, seq)) {
+            torn++;
+            continue;
+        }
+        accepted++;
+        if (!uniform(pixels, frame_value(seq))) bad++;
+    }
+    int status = 0;
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(last == TEST_FRAMES);
+    CHECK(bad == 0);
+    CHECK(accepted > 0);
+    CHECK(torn > 0);
+    std::cout << "fork producer: " << TEST_FRAMES << " frames, " << reads << " reads, " << accepted << " accepted, " << torn
+              << " overwritten during read, " << overwritten << " overwritten before read" << std::endl;
+    shm_ring_close(ring);
+    shm_ring_unlink(name.c_str());
+}
+
+int main() {
+    const std::string name = "/yolov5_shm_ring_test_" + std::to_string(getpid());
+    test_overwrite_detected(name);
+    test_fork_producer(name);
+    if (test_failures()) std::cerr << test_failures() << " checks failed" << std::endl;
+    else std::cout << "shm_ring_test passed" << std::endl;
+    return test_failures() ? 1 : 0;
+}
@@ -0,0 +1,32 @@
+#ifndef TRTX_YOLOV5_TEST_CHECK_H_
+#define TRTX_YOLOV5_TEST_CHECK_H_
+
+// *_test.cpp共用的检查宏: 失败时打印位置并计数, main最后返回test_failures()作为退出码(ctest据此判断)
+
+#include <math.h>
+#include <iostream>
+
+static inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(cond)                                                                              \
+    do {                                                                                         \
+        if (!(cond)) {                                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+            test_failures()++;                                                                   \
+        }                                                                                        \
+    } while (0)
+
+#define CHECK_NEAR(a, b, eps)                                                                                        \
+    do {                                                                                                             \
+        double va_ = (a), vb_ = (b);                                                                                 \
+        if (!(fabs(va_ - vb_) <= (eps))) {                                                                           \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_NEAR(" #a ", " #b ") failed: " << va_ << " vs " << vb_ \
+                      << std::endl;                                                                                  \
+            test_failures()++;                                                                                       \
+        }                                                                                                            \
+    } while (0)
+
+#endif  // TRTX_YOLOV5_TEST_CHECK_H_
@@ -0,0 +1,94 @@
+#ifndef TRTX_YOLOV5_THREAD_POOL_H_
+#define TRTX_YOLOV5_THREAD_POOL_H_
+
+// 构建engine时CPU部分(解析权重、BN折叠)用的固定大小线程池
+// 只有parallel_for一种用法: 把[0, n)分给所有线程(包括调用线程), 全部完成后返回
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads = 0) {
+        if (threads <= 0) threads = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int i = 1; i < threads; i++) {
+            workers_.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& t : workers_) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return (int)workers_.size() + 1; }
+
+    // fn(i)对每个i只调用一次, 不同i之间不能有依赖
+    void parallel_for(int n, const std::function<void(int)>& fn) {
+        if (n <= 0) return;
+        if (workers_.empty() || n == 1) {
+            for (int i = 0; i < n; i++) fn(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            fn_ = &fn;
+            n_ = n;
+            next_.store(0);
+            active_ = (int)workers_.size();
+            generation_++;
+        }
+        wake_.notify_all();
+        runTasks();
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return active_ == 0; });
+        fn_ = nullptr;
+    }
+
+private:
+    void runTasks() {
+        for (int i = next_.fetch_add(1); i < n_; i = next_.fetch_add(1)) (*fn_)(i);
+    }
+
+    void workerLoop() {
+        unsigned long long seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+                if (stop_) return;
+                seen = generation_;
+            }
+            runTasks();
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (--active_ == 0) done_.notify_one();
+            }
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(int)>* fn_ = nullptr;
+    int n_ = 0;
+    std::atomic<int> next_{0};
+    int active_ = 0;
+    unsigned long long generation_ = 0;
+    bool stop_ = false;
+};
+
+#endif  // TRTX_YOLOV5_THREAD_POOL_H_
@@ -0,0 +1,129 @@
+#ifndef TRTX_YOLOV5_TILING_H_
+#define TRTX_YOLOV5_TILING_H_
+
+// 大图切片推理: 把高分辨率帧切成互相重叠的INPUT_W x INPUT_H小块(可选再加一张整图缩小的全局视图),
+// 所有小块一起送进BATCH_SIZE的engine, 再把每块的框映射回原图坐标, 做跨块NMS或WBF合并
+// 这里只有切片规划和合并逻辑, 不依赖OpenCV/CUDA
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "yolo_types.h"
+
+namespace Yolo
+{
+    // 原图上的一块区域, letterbox到网络输入后的缩放和padding
+    struct Tile {
+        int x, y, w, h;     // 原图坐标
+        float gain;         // 网络输入 / 原图
+        float pad_x, pad_y; // letterbox padding(网络输入坐标)
+        bool global;        // 整图缩小视图
+    };
+
+    enum class TileMerge { kNMS, kWBF };
+}
+
+static inline Yolo::Tile make_tile(int x, int y, int w, int h, int input_w, int input_h, bool global) {
+    Yolo::Tile t;
+    t.x = x;
+    t.y = y;
+    t.w = w;
+    t.h = h;
+    t.gain = std::min(input_w / float(w), input_h / float(h));
+    // 与preprocess_img一致: 缩放后的尺寸取整, padding居中
+    t.pad_x = (input_w - int(w * t.gain)) / 2;
+    t.pad_y = (input_h - int(h * t.gain)) / 2;
+    t.global = global;
+    return t;
+}
+
+// 一个方向上的切片起点: 相邻块重叠至少overlap, 最后一块贴齐边缘
+static inline void tile_starts(int len, int tile, float overlap, std::vector<int>& starts) {
+    starts.clear();
+    if (len <= tile) {
+        starts.push_back(0);
+        return;
+    }
+    int step = std::max(1, int(tile * (1.f - overlap)));
+    int n = (len - tile + step - 1) / step + 1;
+    for (int i = 0; i < n; i++) {
+        // 均匀分布, 避免最后一块只有很窄的重叠
+        starts.push_back(int(std::round(i * (len - tile) / float(n - 1))));
+    }
+}
+
+// 规划切片: 原图不大于网络输入时只返回一张全局视图
+static inline std::vector<Yolo::Tile> plan_tiles(int img_w, int img_h, int input_w, int input_h, float overlap, bool add_global) {
+    std::vector<Yolo::Tile> tiles;
+    if (img_w <= input_w && img_h <= input_h) {
+        tiles.push_back(make_tile(0, 0, img_w, img_h, input_w, input_h, true));
+        return tiles;
+    }
+    std::vector<int> xs, ys;
+    tile_starts(img_w, input_w, overlap, xs);
+    tile_starts(img_h, input_h, overlap, ys);
+    for (int y : ys) {
+        for (int x : xs) {
+            tiles.push_back(make_tile(x, y, std::min(input_w, img_w - x), std::min(input_h, img_h - y), input_w, input_h, false));
+        }
+    }
+    if (add_global) tiles.push_back(make_tile(0, 0, img_w, img_h, input_w, input_h, true));
+    return tiles;
+}
+
+// nms输出的框(网络输入坐标, xywh) -> 原图坐标(xyxy), 并裁剪到该块范围内
+static inline void tile_to_frame(std::vector<Yolo::Detection>& res, const Yolo::Tile& t) {
+    for (auto& det : res) {
+        float cx = det.bbox[0], cy = det.bbox[1], w = det.bbox[2], h = det.bbox[3];
+        float x1 = (cx - w / 2.f - t.pad_x) / t.gain;
+        float y1 = (cy - h / 2.f - t.pad_y) / t.gain;
+        float x2 = (cx + w / 2.f - t.pad_x) / t.gain;
+        float y2 = (cy + h / 2.f - t.pad_y) / t.gain;
+        det.bbox[0] = std::min(std::max(x1, 0.f), float(t.w)) + t.x;
+        det.bbox[1] = std::min(std::max(y1, 0.f), float(t.h)) + t.y;
+        det.bbox[2] = std::min(std::max(x2, 0.f), float(t.w)) + t.x;
+        det.bbox[3] = std::min(std::max(y2, 0.f), float(t.h)) + t.y;
+    }
+}
+
+static inline float iou_xyxy(const float* a, const float* b) {
+    float iw = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+    float ih = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+    if (iw <= 0.f || ih <= 0.f) return 0.f;
+    float inter = iw * ih;
+    return inter / ((a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter);
+}
+
+// 跨块合并(原图坐标, xyxy). kNMS: 按类别贪心抑制; kWBF: 同一簇内按conf加权平均框坐标
+static inline void merge_tiles(std::vector<Yolo::Detection>& dets, float iou_thresh, Yolo::TileMerge mode) {
+    std::stable_sort(dets.begin(), dets.end(), [](const Yolo::Detection& a, const Yolo::Detection& b) {
+        return a.class_id < b.class_id || (a.class_id == b.class_id && a.conf > b.conf);
+    });
+    std::vector<Yolo::Detection> out;
+    std::vector<char> removed(dets.size(), 0);
+    for (size_t i = 0; i < dets.size(); i++) {
+        if (removed[i]) continue;
+        Yolo::Detection fused = dets[i];
+        float wsum = dets[i].conf;
+        float box[4];
+        for (int k = 0; k < 4; k++) box[k] = dets[i].bbox[k] * dets[i].conf;
+        int members = 1;
+        for (size_t j = i + 1; j < dets.size() && dets[j].class_id == dets[i].class_id; j++) {
+            if (removed[j] || iou_xyxy(dets[i].bbox, dets[j].bbox) <= iou_thresh) continue;
+            removed[j] = 1;
+            if (mode == Yolo::TileMerge::kWBF) {
+                for (int k = 0; k < 4; k++) box[k] += dets[j].bbox[k] * dets[j].conf;
+                wsum += dets[j].conf;
+                members++;
+            }
+        }
+        if (mode == Yolo::TileMerge::kWBF && members > 1) {
+            for (int k = 0; k < 4; k++) fused.bbox[k] = box[k] / wsum;
+            fused.conf = wsum / members;
+        }
+        out.push_back(fused);
+    }
+    dets.swap(out);
+}
+
+#endif  // TRTX_YOLOV5_TILING_H_
@@ -0,0 +1,112 @@
+// 切片推理(tiling.h)的CPU侧开销, 只用CPU
+// 每种分辨率: plan_tiles规划切片(TILE_OVERLAP 0.2, 加全局视图), 每块给出若干个网络输入坐标的框(一部分目标落在重叠区, 在相邻块和全局视图中重复出现),
+// 再tile_to_frame映射回原图并merge_tiles合并; 报告每帧的切片数、tiles/s(规划 + 映射, 不含推理)和kNMS/kWBF每帧的合并耗时
+// ./tiling_bench [分辨率, 默认1920x1080,3840x2160,7680x4320] [每块的框数, 默认30] [重复次数]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "tiling.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const int NET_W = Yolo::INPUT_W;
+static const int NET_H = Yolo::INPUT_H;
+static const float OVERLAP = 0.2f;
+
+template <class F>
+static double time_us(int reps, F f) {
+    auto start = Clock::now();
+    for (int r = 0; r < reps; r++) f();
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / reps;
+}
+
+// 原图上均匀分布的目标, 每块取完整落在块内的目标(最多per_tile个)转成网络输入坐标(xywh), 模拟各块nms后的输出
+static std::vector<std::vector<Yolo::Detection>> make_tile_outputs(int img_w, int img_h, const std::vector<Yolo::Tile>& tiles, int per_tile, std::mt19937& rng) {
+    std::uniform_real_distribution<float> x(0.f, img_w - 128.f), y(0.f, img_h - 128.f), size(16.f, 128.f), conf(0.3f, 1.f), jitter(-2.f, 2.f);
+    std::uniform_int_distribution<int> cls(0, 5);
+    const int objects = per_tile * (int)tiles.size();
+    std::vector<Yolo::Detection> scene(objects);
+    for (Yolo::Detection& o : scene) {
+        o.bbox[0] = x(rng);
+        o.bbox[1] = y(rng);
+        o.bbox[2] = o.bbox[0] + size(rng);
+        o.bbox[3] = o.bbox[1] + size(rng);
+        o.conf = conf(rng);
+        o.class_id = (float)cls(rng);
+    }
+    std::vector<std::vector<Yolo::Detection>> outputs(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++) {
+        const Yolo::Tile& t = tiles[i];
+        for (const Yolo::Detection& o : scene) {
+            if ((int)outputs[i].size() >= per_tile) break;
+            if (o.bbox[0] < t.x || o.bbox[1] < t.y || o.bbox[2] > t.x + t.w || o.bbox[3] > t.y + t.h) continue;
+            Yolo::Detection det = o;
+            float x1 = (o.bbox[0] - t.x) * t.gain + t.pad_x + jitter(rng), y1 = (o.bbox[1] - t.y) * t.gain + t.pad_y + jitter(rng);
+            float x2 = (o.bbox[2] - t.x) * t.gain + t.pad_x + jitter(rng), y2 = (o.bbox[3] - t.y) * t.gain + t.pad_y + jitter(rng);
+            det.bbox[0] = (x1 + x2) * 0.5f;
+            det.bbox[1] = (y1 + y2) * 0.5f;
+            det.bbox[2] = x2 - x1;
+            det.bbox[3] = y2 - y1;
+            outputs[i].push_back(det);
+        }
+    }
+    return outputs;
+}
+
+static void bench(int img_w, int img_h, int per_tile, int reps, std::mt19937& rng) {
+    std::vector<Yolo::Tile> tiles = plan_tiles(img_w, img_h, NET_W, NET_H, OVERLAP, true);
+    std::vector<std::vector<Yolo::Detection>> outputs = make_tile_outputs(img_w, img_h, tiles, per_tile, rng);
+
+    // 规划 + 每块的框映射回原图, 即每帧除推理和合并外的切片开销
+    std::vector<Yolo::Detection> frame, tile_res;
+    double map_us = time_us(reps, [&] {
+        std::vector<Yolo::Tile> planned = plan_tiles(img_w, img_h, NET_W, NET_H, OVERLAP, true);
+        frame.clear();
+        for (size_t i = 0; i < planned.size(); i++) {
+            tile_res = outputs[i];
+            tile_to_frame(tile_res, planned[i]);
+            frame.insert(frame.end(), tile_res.begin(), tile_res.end());
+        }
+    });
+
+    std::vector<Yolo::Detection> merged;
+    double nms_us = time_us(reps, [&] {
+        merged = frame;
+        merge_tiles(merged, 0.45f, Yolo::TileMerge::kNMS);
+    });
+    size_t nms_kept = merged.size();
+    double wbf_us = time_us(reps, [&] {
+        merged = frame;
+        merge_tiles(merged, 0.45f, Yolo::TileMerge::kWBF);
+    });
+
+    std::cout << img_w << "x" << img_h << ": " << tiles.size() << " tiles (" << NET_W << "x" << NET_H << ", overlap " << OVERLAP << ", incl. global view), "
+              << frame.size() << " boxes before merge" << std::endl;
+    std::cout << "  plan + tile_to_frame: " << map_us << " us/frame, " << tiles.size() * 1e6 / map_us << " tiles/s" << std::endl;
+    std::cout << "  merge kNMS: " << nms_us << " us/frame (" << nms_kept << " kept), kWBF: " << wbf_us << " us/frame (" << merged.size() << " kept)" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::pair<int, int>> sizes;
+    std::stringstream ss(argc > 1 ? argv[1] : "1920x1080,3840x2160,7680x4320");
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        int w = 0, h = 0;
+        if (sscanf(item.c_str(), "%dx%d", &w, &h) == 2 && w > 0 && h > 0) sizes.push_back(std::make_pair(w, h));
+    }
+    int per_tile = argc > 2 ? atoi(argv[2]) : 30;
+    int reps = argc > 3 ? atoi(argv[3]) : 200;
+    if (sizes.empty() || per_tile < 0 || reps <= 0) {
+        std::cerr << "./tiling_bench [resolutions, e.g. 1920x1080,3840x2160] [boxes per tile] [repetitions]" << std::endl;
+        return -1;
+    }
+    std::mt19937 rng(0);
+    for (const auto& s : sizes) bench(s.first, s.second, per_tile, reps, rng);
+    return 0;
+}
@@ -0,0 +1,192 @@
+// 切片规划和跨块合并(tiling.h)的测试, 只用CPU
+//   - plan_tiles: 小图只有一张全局视图; 大图的切片覆盖整张图, 都在图内, 相邻块重叠不少于overlap, 最后一块贴齐边缘
+//   - tile_to_frame: 网络输入坐标映射回原图, 裁剪到该块范围内
+//   - merge_tiles: kNMS保留同类重叠框中conf最高的, 不同类别不合并; kWBF按conf加权平均
+//   - 端到端: 模拟每块只检测出完整落在块内的目标(加上全局视图), 合并后每个目标恰好剩一个框
+// ./tiling_test, 失败时返回非0
+
+#include <vector>
+#include "tiling.h"
+#include "test_check.h"
+
+static const int NET_W = 640;
+static const int NET_H = 384;
+
+static Yolo::Detection make_det(float x1, float y1, float x2, float y2, float conf, int cls) {
+    Yolo::Detection det;
+    det.bbox[0] = x1;
+    det.bbox[1] = y1;
+    det.bbox[2] = x2;
+    det.bbox[3] = y2;
+    det.conf = conf;
+    det.class_id = (float)cls;
+    return det;
+}
+
+// 原图坐标(xyxy) -> 该块的网络输入坐标(xywh), 即tile_to_frame的逆映射
+static Yolo::Detection frame_to_tile(const Yolo::Detection& det, const Yolo::Tile& t) {
+    Yolo::Detection out = det;
+    float x1 = (det.bbox[0] - t.x) * t.gain + t.pad_x, y1 = (det.bbox[1] - t.y) * t.gain + t.pad_y;
+    float x2 = (det.bbox[2] - t.x) * t.gain + t.pad_x, y2 = (det.bbox[3] - t.y) * t.gain + t.pad_y;
+    out.bbox[0] = (x1 + x2) * 0.5f;
+    out.bbox[1] = (y1 + y2) * 0.5f;
+    out.bbox[2] = x2 - x1;
+    out.bbox[3] = y2 - y1;
+    return out;
+}
+
+static void check_plan(int img_w, int img_h, float overlap) {
+    std::vector<Yolo::Tile> tiles = plan_tiles(img_w, img_h, NET_W, NET_H, overlap, true);
+    CHECK(!tiles.empty());
+    if (tiles.empty()) return;
+    const Yolo::Tile& global = tiles.back();
+    CHECK(global.global && global.x == 0 && global.y == 0 && global.w == img_w && global.h == img_h);
+    CHECK(global.gain <= 1.f || (img_w <= NET_W && img_h <= NET_H));
+    if (img_w <= NET_W && img_h <= NET_H) {
+        CHECK(tiles.size() == 1);
+        return;
+    }
+    // 每个像素至少被一块覆盖(按行、列分别检查起点), 块都在图内
+    std::vector<int> cover_x(img_w, 0), cover_y(img_h, 0);
+    for (size_t i = 0; i + 1 < tiles.size(); i++) {
+        const Yolo::Tile& t = tiles[i];
+        CHECK(!t.global);
+        CHECK(t.x >= 0 && t.y >= 0 && t.x + t.w <= img_w && t.y + t.h <= img_h);
+        CHECK(t.w == std::min(NET_W, img_w) && t.h == std::min(NET_H, img_h));
+        CHECK_NEAR(t.gain, 1.0, 1e-6);
+        for (int x = t.x; x < t.x + t.w; x++) cover_x[x] = 1;
+        for (int y = t.y; y < t.y + t.h; y++) cover_y[y] = 1;
+    }
+    int uncovered = 0;
+    for (int c : cover_x) uncovered += !c;
+    for (int c : cover_y) uncovered += !c;
+    CHECK(uncovered == 0);
+
+    std::vector<int> xs, ys;
+    tile_starts(img_w, NET_W, overlap, xs);
+    tile_starts(img_h, NET_H, overlap, ys);
+    CHECK(tiles.size() == xs.size() * ys.size() + 1);
+    CHECK(xs.front() == 0 && xs.back() == std::max(0, img_w - NET_W));
+    CHECK(ys.front() == 0 && ys.back() == std::max(0, img_h - NET_H));
+    for (size_t i = 1; i < xs.size(); i++) CHECK(xs[i] > xs[i - 1] && NET_W - (xs[i] - xs[i - 1]) >= int(NET_W * overlap));
+    for (size_t i = 1; i < ys.size(); i++) CHECK(ys[i] > ys[i - 1] && NET_H - (ys[i] - ys[i - 1]) >= int(NET_H * overlap));
+}
+
+static void test_plan_tiles() {
+    check_plan(320, 240, 0.2f);
+    check_plan(NET_W, NET_H, 0.2f);
+    check_plan(NET_W + 1, NET_H, 0.2f);
+    check_plan(1920, 1080, 0.2f);
+    check_plan(3840, 2160, 0.2f);
+    check_plan(3840, 2160, 0.5f);
+    check_plan(4000, 300, 0.1f); // 只有一个方向需要切
+    std::vector<Yolo::Tile> no_global = plan_tiles(1920, 1080, NET_W, NET_H, 0.2f, false);
+    CHECK(!no_global.empty() && !no_global.back().global);
+
+    // 小图: 只有一张居中letterbox的全局视图
+    std::vector<Yolo::Tile> small = plan_tiles(320, 320, NET_W, NET_H, 0.2f, true);
+    CHECK(small.size() == 1);
+    CHECK_NEAR(small[0].gain, 1.2, 1e-6);
+    CHECK_NEAR(small[0].pad_x, (NET_W - 384) / 2, 1e-6);
+    CHECK_NEAR(small[0].pad_y, 0, 1e-6);
+}
+
+static void test_tile_to_frame() {
+    // 切片(gain 1)和全局视图(gain < 1, 有padding)都能映射回原图
+    std::vector<Yolo::Tile> tiles = plan_tiles(1920, 1080, NET_W, NET_H, 0.2f, true);
+    const Yolo::Tile& t = tiles[1];
+    const Yolo::Tile& global = tiles.back();
+    Yolo::Detection truth = make_det(t.x + 100.f, t.y + 50.f, t.x + 180.f, t.y + 200.f, 0.9f, 2);
+    for (const Yolo::Tile* tile : { &t, &global }) {
+        std::vector<Yolo::Detection> res(1, frame_to_tile(truth, *tile));
+        tile_to_frame(res, *tile);
+        for (int k = 0; k < 4; k++) CHECK_NEAR(res[0].bbox[k], truth.bbox[k], 1e-2);
+        CHECK(res[0].conf == truth.conf && res[0].class_id == truth.class_id);
+    }
+    // 超出块的部分被裁掉
+    Yolo::Detection edge = make_det(t.x - 30.f, t.y + 10.f, t.x + 40.f, t.y + t.h + 25.f, 0.5f, 0);
+    std::vector<Yolo::Detection> res(1, frame_to_tile(edge, t));
+    tile_to_frame(res, t);
+    CHECK_NEAR(res[0].bbox[0], t.x, 1e-2);
+    CHECK_NEAR(res[0].bbox[1], edge.bbox[1], 1e-2);
+    CHECK_NEAR(res[0].bbox[2], edge.bbox[2], 1e-2);
+    CHECK_NEAR(res[0].bbox[3], t.y + t.h, 1e-2);
+}
+
+static void test_merge_tiles() {
+    std::vector<Yolo::Detection> dets;
+    dets.push_back(make_det(100, 100, 200, 200, 0.6f, 0));
+    dets.push_back(make_det(102, 98, 204, 202, 0.9f, 0));  // 与上一个同类重叠, 保留这个
+    dets.push_back(make_det(101, 101, 199, 199, 0.7f, 1)); // 不同类别, 保留
+    dets.push_back(make_det(400, 400, 450, 450, 0.3f, 0)); // 不重叠, 保留
+    std::vector<Yolo::Detection> nms = dets;
+    merge_tiles(nms, 0.5f, Yolo::TileMerge::kNMS);
+    CHECK(nms.size() == 3);
+    if (nms.size() == 3) {
+        // 按类别, 同类按conf从高到低
+        CHECK(nms[0].class_id == 0 && nms[0].conf == 0.9f && nms[0].bbox[0] == 102.f);
+        CHECK(nms[1].class_id == 0 && nms[1].conf == 0.3f);
+        CHECK(nms[2].class_id == 1 && nms[2].conf == 0.7f);
+    }
+
+    std::vector<Yolo::Detection> wbf = dets;
+    merge_tiles(wbf, 0.5f, Yolo::TileMerge::kWBF);
+    CHECK(wbf.size() == 3);
+    if (wbf.size() == 3) {
+        CHECK_NEAR(wbf[0].bbox[0], (102 * 0.9 + 100 * 0.6) / 1.5, 1e-3);
+        CHECK_NEAR(wbf[0].bbox[3], (202 * 0.9 + 200 * 0.6) / 1.5, 1e-3);
+        CHECK_NEAR(wbf[0].conf, 0.75, 1e-6);
+        CHECK(wbf[1].bbox[0] == 400.f && wbf[1].conf == 0.3f);
+    }
+
+    std::vector<Yolo::Detection> empty;
+    merge_tiles(empty, 0.5f, Yolo::TileMerge::kNMS);
+    CHECK(empty.empty());
+}
+
+// 端到端: 4K帧上的目标, 每块只"检测"出完整落在块内的目标, 全局视图检测出所有目标(坐标有缩放误差)
+static void test_end_to_end(Yolo::TileMerge mode) {
+    const int img_w = 3840, img_h = 2160;
+    std::vector<Yolo::Detection> objects;
+    for (int i = 0; i < 40; i++) {
+        float x = 37.f + (i * 613) % (img_w - 200), y = 23.f + (i * 331) % (img_h - 200);
+        objects.push_back(make_det(x, y, x + 40.f + i % 7 * 20.f, y + 60.f + i % 5 * 25.f, 0.5f + 0.01f * i, i % 3));
+    }
+    std::vector<Yolo::Tile> tiles = plan_tiles(img_w, img_h, NET_W, NET_H, 0.2f, true);
+    std::vector<Yolo::Detection> res;
+    int detections = 0;
+    for (const Yolo::Tile& t : tiles) {
+        std::vector<Yolo::Detection> tile_res;
+        for (const Yolo::Detection& o : objects) {
+            bool inside = o.bbox[0] >= t.x && o.bbox[1] >= t.y && o.bbox[2] <= t.x + t.w && o.bbox[3] <= t.y + t.h;
+            if (!inside) continue;
+            Yolo::Detection det = frame_to_tile(o, t);
+            if (t.global) det.conf *= 0.8f;
+            tile_res.push_back(det);
+        }
+        tile_to_frame(tile_res, t);
+        detections += (int)tile_res.size();
+        res.insert(res.end(), tile_res.begin(), tile_res.end());
+    }
+    CHECK(detections > (int)objects.size()); // 重叠区域和全局视图产生重复框
+    merge_tiles(res, 0.5f, mode);
+    CHECK(res.size() == objects.size());
+    for (const Yolo::Detection& o : objects) {
+        int matched = 0;
+        for (const Yolo::Detection& d : res) {
+            if (d.class_id == o.class_id && iou_xyxy(d.bbox, o.bbox) > 0.95f) matched++;
+        }
+        CHECK(matched == 1);
+    }
+}
+
+int main() {
+    test_plan_tiles();
+    test_tile_to_frame();
+    test_merge_tiles();
+    test_end_to_end(Yolo::TileMerge::kNMS);
+    test_end_to_end(Yolo::TileMerge::kWBF);
+    if (test_failures()) std::cerr << test_failures() << " checks failed" << std::endl;
+    else std::cout << "tiling_test passed" << std::endl;
+    return test_failures() ? 1 : 0;
+}
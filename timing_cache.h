@@ -0,0 +1,198 @@
+#ifndef TRTX_YOLOV5_TIMING_CACHE_H_
+#define TRTX_YOLOV5_TIMING_CACHE_H_
+
+// 构建engine时的tactic计时缓存(TensorRT 8+的ITimingCache)
+// buildEngineWithConfig会对每层的每个候选tactic在GPU上计时, 这是构建耗时的大头; 计时结果只与层的配置、GPU型号和TensorRT版本有关,
+// 同一文件可以被s/m/l/x、不同batch和精度的构建共用, 只有缓存中没有的层才需要重新计时(只更新权重时全部命中)
+// build_engine构建前从文件加载, 构建后与文件中已有的内容(可能是并行构建期间写入的)合并再写回:
+//   "读-合并-写"在<path>.lock上用flock串行化, 写入先写临时文件再rename, 其他进程不会读到写了一半的文件
+// 多台同型号机器各自产生的缓存可用merge_timing_cache_files(./yolov5 -m)合并后分发
+// TensorRT 7没有该接口, 只打印提示, 构建不受影响
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "NvInfer.h"
+
+static inline bool read_binary_file(const std::string& path, std::vector<char>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good()) return false;
+    file.seekg(0, file.end);
+    data.resize((size_t)file.tellg());
+    file.seekg(0, file.beg);
+    file.read(data.data(), data.size());
+    return file.good() || data.empty();
+}
+
+// 先写<path>.tmp.<pid>再rename覆盖
+static inline bool write_file_atomic(const std::string& path, const void* data, size_t size) {
+    std::string tmp = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(tmp, std::ios::binary);
+        if (!file) return false;
+        file.write(static_cast<const char*>(data), size);
+        if (!file.good()) return false;
+    }
+    if (rename(tmp.c_str(), path.c_str()) != 0) {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// <path>.lock上的独占锁, 析构时释放; 锁文件打不开时不加锁(只失去并行写入的保护)
+class FileLock {
+public:
+    explicit FileLock(const std::string& path) : fd_(open((path + ".lock").c_str(), O_RDWR | O_CREAT, 0644)) {
+        if (fd_ >= 0) flock(fd_, LOCK_EX);
+    }
+    ~FileLock() {
+        if (fd_ < 0) return;
+        flock(fd_, LOCK_UN);
+        close(fd_);
+    }
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_;
+};
+
+#if NV_TENSORRT_MAJOR >= 8
+
+// 缓存中的条目数(每条为一个层配置的最优tactic), TensorRT 10之前没有查询接口, 返回-1
+static inline int64_t timing_cache_entries(const nvinfer1::ITimingCache& cache) {
+#if NV_TENSORRT_MAJOR >= 10
+    return cache.queryKeys(nullptr, 0);
+#else
+    (void)cache;
+    return -1;
+#endif
+}
+
+static inline void print_cache_size(const char* what, size_t bytes, int64_t entries) {
+    std::cout << what << " " << bytes / 1024.0 << " KB";
+    if (entries >= 0) std::cout << " (" << entries << " entries)";
+}
+
+// 读取缓存文件并合并到cache; 文件不存在返回true, 内容与当前GPU/TensorRT版本不符时返回false
+static inline bool combine_timing_cache_file(nvinfer1::IBuilderConfig* config, nvinfer1::ITimingCache& cache, const std::string& path, size_t* bytes = nullptr) {
+    std::vector<char> blob;
+    if (bytes) *bytes = 0;
+    if (!read_binary_file(path, blob) || blob.empty()) return true;
+    nvinfer1::ITimingCache* other = config->createTimingCache(blob.data(), blob.size());
+    bool ok = other && cache.combine(*other, false);
+    delete other;
+    if (ok && bytes) *bytes = blob.size();
+    return ok;
+}
+
+// 一次engine构建使用的计时缓存: 构造时加载path并设置到config, 构建成功后调用save写回
+class BuildTimingCache {
+public:
+    BuildTimingCache(nvinfer1::IBuilderConfig* config, const std::string& path) : config_(config), path_(path), cache_(nullptr), loaded_bytes_(0), loaded_entries_(-1) {
+        if (path_.empty()) return;
+        cache_ = config_->createTimingCache(nullptr, 0);
+        if (!cache_) return;
+        {
+            FileLock lock(path_);
+            if (!combine_timing_cache_file(config_, *cache_, path_, &loaded_bytes_)) {
+                std::cout << "Timing cache " << path_ << " was built for another GPU or TensorRT version, starting from an empty cache" << std::endl;
+            }
+        }
+        loaded_entries_ = timing_cache_entries(*cache_);
+        config_->setTimingCache(*cache_, false);
+        std::cout << "Timing cache " << path_ << ": loaded";
+        print_cache_size("", loaded_bytes_, loaded_entries_);
+        std::cout << std::endl;
+    }
+    ~BuildTimingCache() { delete cache_; }
+    BuildTimingCache(const BuildTimingCache&) = delete;
+    BuildTimingCache& operator=(const BuildTimingCache&) = delete;
+
+    // 与文件当前内容(其他进程可能在本次构建期间写入过)合并后写回, 并打印本次构建新增的计时数
+    bool save() {
+        if (!cache_) return false;
+        nvinfer1::IHostMemory* built = cache_->serialize();
+        int64_t built_entries = timing_cache_entries(*cache_);
+        size_t built_bytes = built ? built->size() : 0;
+        delete built;
+
+        FileLock lock(path_);
+        if (!combine_timing_cache_file(config_, *cache_, path_)) {
+            std::cout << "Timing cache " << path_ << " on disk does not match this GPU/TensorRT version, overwriting it" << std::endl;
+        }
+        nvinfer1::IHostMemory* merged = cache_->serialize();
+        bool ok = merged && write_file_atomic(path_, merged->data(), merged->size());
+        // 命中情况: 新增的条目即本次构建中缓存未命中、实际计时的层配置, 为0时所有tactic都来自缓存
+        std::cout << "Timing cache " << path_ << ": this build added";
+        if (built_entries >= 0 && loaded_entries_ >= 0) {
+            std::cout << " " << built_entries - loaded_entries_ << " timed layer configs (misses),";
+        }
+        std::cout << " " << ((double)built_bytes - (double)loaded_bytes_) / 1024.0 << " KB;";
+        print_cache_size(ok ? " saved" : " FAILED to save", merged ? merged->size() : 0, timing_cache_entries(*cache_));
+        std::cout << std::endl;
+        delete merged;
+        return ok;
+    }
+
+private:
+    nvinfer1::IBuilderConfig* config_;
+    std::string path_;
+    nvinfer1::ITimingCache* cache_;
+    size_t loaded_bytes_;
+    int64_t loaded_entries_;
+};
+
+// 把多个缓存文件(同一GPU型号/TensorRT版本)合并到out, out已存在时其内容也保留; 不兼容的输入跳过
+static inline bool merge_timing_cache_files(nvinfer1::IBuilder* builder, const std::string& out, const std::vector<std::string>& inputs) {
+    nvinfer1::IBuilderConfig* config = builder->createBuilderConfig();
+    nvinfer1::ITimingCache* cache = config->createTimingCache(nullptr, 0);
+    bool ok = cache != nullptr;
+    FileLock lock(out);
+    std::vector<std::string> files(1, out);
+    files.insert(files.end(), inputs.begin(), inputs.end());
+    for (size_t i = 0; ok && i < files.size(); i++) {
+        size_t bytes = 0;
+        bool merged = combine_timing_cache_file(config, *cache, files[i], &bytes);
+        if (i > 0 || bytes > 0) {
+            std::cout << files[i] << ": " << (merged ? (bytes ? "merged" : "missing, skipped") : "incompatible, skipped");
+            if (merged && bytes) print_cache_size(",", bytes, -1);
+            std::cout << std::endl;
+        }
+    }
+    nvinfer1::IHostMemory* blob = ok ? cache->serialize() : nullptr;
+    ok = blob && write_file_atomic(out, blob->data(), blob->size());
+    if (ok) {
+        print_cache_size((out + ":").c_str(), blob->size(), timing_cache_entries(*cache));
+        std::cout << std::endl;
+    }
+    delete blob;
+    delete cache;
+    delete config;
+    return ok;
+}
+
+#else  // TensorRT 7
+
+class BuildTimingCache {
+public:
+    BuildTimingCache(nvinfer1::IBuilderConfig*, const std::string& path) {
+        if (!path.empty()) std::cout << "Timing cache needs TensorRT 8 or newer, " << path << " is not used" << std::endl;
+    }
+    bool save() { return false; }
+};
+
+static inline bool merge_timing_cache_files(nvinfer1::IBuilder*, const std::string&, const std::vector<std::string>&) {
+    std::cerr << "Timing cache needs TensorRT 8 or newer" << std::endl;
+    return false;
+}
+
+#endif  // NV_TENSORRT_MAJOR >= 8
+
+#endif  // TRTX_YOLOV5_TIMING_CACHE_H_
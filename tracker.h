@@ -0,0 +1,399 @@
+#ifndef TRTX_YOLOV5_TRACKER_H_
+#define TRTX_YOLOV5_TRACKER_H_
+
+// 多目标跟踪(SORT/ByteTrack风格), 接在nms + scale_coords之后
+// 每个视频源一个Tracker. 所有缓冲区在构造时按容量一次性分配, update过程中不再申请内存
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include "yolo_types.h"
+
+namespace Yolo
+{
+    struct TrackedDetection {
+        Detection det; // bbox为xyxy(原图坐标)
+        int track_id;
+    };
+}
+
+// 单坐标的匀速卡尔曼滤波(位置+速度)
+// SORT中的8维状态在过程/观测噪声按坐标独立时可以精确分解为4个2x2滤波器
+struct KalmanAxis {
+    float x, v;         // 状态: 位置, 速度
+    float p00, p01, p11; // 协方差(对称)
+
+    void init(float z, float pos_var, float vel_var) {
+        x = z;
+        v = 0.f;
+        p00 = pos_var;
+        p01 = 0.f;
+        p11 = vel_var;
+    }
+
+    void predict(float q_pos, float q_vel) {
+        x += v;
+        // P = F P F^T + Q, F = [[1, 1], [0, 1]]
+        p00 += 2.f * p01 + p11 + q_pos;
+        p01 += p11;
+        p11 += q_vel;
+    }
+
+    void update(float z, float r) {
+        float s = p00 + r;
+        float k0 = p00 / s;
+        float k1 = p01 / s;
+        float y = z - x;
+        x += k0 * y;
+        v += k1 * y;
+        float np00 = (1.f - k0) * p00;
+        float np01 = (1.f - k0) * p01;
+        float np11 = p11 - k1 * p01;
+        p00 = np00;
+        p01 = np01;
+        p11 = np11;
+    }
+};
+
+struct TrackerConfig {
+    int max_tracks = 512;      // 轨迹池容量, 同时也是单帧最大检测数
+    float high_thresh = 0.6f;  // ByteTrack: conf高于该值的检测参与第一轮匹配, 其余参与第二轮
+    float match_iou = 0.3f;    // 第一轮最小iou
+    float low_match_iou = 0.5f; // 第二轮最小iou
+    int max_age = 30;          // 连续丢失多少帧后删除
+    int min_hits = 3;          // 累计命中多少帧后输出(中间丢失过的帧不清零)
+    float pos_noise = 1.f / 20; // 噪声与框尺寸成比例(同DeepSORT)
+    float vel_noise = 1.f / 160;
+};
+
+class Tracker
+{
+public:
+    explicit Tracker(const TrackerConfig& cfg = TrackerConfig())
+        : cfg_(cfg), next_id_(1)
+    {
+        int n = cfg_.max_tracks;
+        pool_.resize(n);
+        free_.reserve(n);
+        for (int i = n - 1; i >= 0; i--) free_.push_back(i);
+        active_.reserve(n);
+        det_idx_.reserve(n);
+        trk_idx_.reserve(n);
+        pred_.resize(n * 4);
+        cost_.resize((size_t)n * n);
+        sub_.resize((size_t)n * n);
+        parent_.resize(2 * n);
+        order_.resize(2 * n);
+        start_.resize(2 * n + 1);
+        u_.resize(n + 1);
+        v_.resize(n + 1);
+        minv_.resize(n + 1);
+        p_.resize(n + 1);
+        way_.resize(n + 1);
+        used_.resize(n + 1);
+        assign_.resize(n);
+        det_used_.resize(n);
+        trk_used_.resize(n);
+    }
+
+    // 只做预测, 用于跳帧时传播上一帧的框(见scheduler.h)
+    // 输出条件与update相同: 上一次update中没有匹配到的(已丢失的)轨迹不输出
+    void predict(std::vector<Yolo::TrackedDetection>& out) {
+        predictAll();
+        out.clear();
+        for (int t : active_) {
+            const Track& trk = pool_[t];
+            if (trk.time_since_update > 0 || trk.hits < cfg_.min_hits) continue;
+            out.push_back(makeOutput(trk, &pred_[t * 4]));
+        }
+    }
+
+    // dets: nms + xywh2xyxy + scale_coords之后的检测结果
+    void update(const std::vector<Yolo::Detection>& dets, std::vector<Yolo::TrackedDetection>& out) {
+        predictAll();
+
+        int nd = std::min((int)dets.size(), cfg_.max_tracks);
+        std::fill(det_used_.begin(), det_used_.begin() + nd, 0);
+        for (int t : active_) trk_used_[t] = 0;
+
+        // 第一轮: 高分检测 vs 所有轨迹; 第二轮: 低分检测 vs 剩余轨迹
+        associate(dets, nd, true, cfg_.match_iou);
+        associate(dets, nd, false, cfg_.low_match_iou);
+
+        // 未匹配的轨迹: 老化/删除
+        for (size_t i = 0; i < active_.size();) {
+            int t = active_[i];
+            Track& trk = pool_[t];
+            if (!trk_used_[t]) {
+                trk.time_since_update++;
+                if (trk.time_since_update > cfg_.max_age) {
+                    free_.push_back(t);
+                    active_[i] = active_.back();
+                    active_.pop_back();
+                    continue;
+                }
+            }
+            i++;
+        }
+
+        // 未匹配的高分检测: 新建轨迹
+        for (int d = 0; d < nd; d++) {
+            if (det_used_[d] || dets[d].conf < cfg_.high_thresh || free_.empty()) continue;
+            int t = free_.back();
+            free_.pop_back();
+            startTrack(pool_[t], dets[d]);
+            active_.push_back(t);
+            trk_used_[t] = 1;
+        }
+
+        out.clear();
+        for (int t : active_) {
+            const Track& trk = pool_[t];
+            if (trk.time_since_update > 0 || trk.hits < cfg_.min_hits) continue;
+            out.push_back(makeOutput(trk, nullptr));
+        }
+    }
+
+    int activeCount() const { return (int)active_.size(); }
+
+private:
+    struct Track {
+        KalmanAxis axis[4]; // cx, cy, w, h
+        float conf;
+        float class_id;
+        int id;
+        int hits;
+        int time_since_update;
+    };
+
+    void startTrack(Track& trk, const Yolo::Detection& det) {
+        float cx = (det.bbox[0] + det.bbox[2]) * 0.5f;
+        float cy = (det.bbox[1] + det.bbox[3]) * 0.5f;
+        float w = det.bbox[2] - det.bbox[0];
+        float h = det.bbox[3] - det.bbox[1];
+        float sp = 2.f * cfg_.pos_noise * std::max(w, h);
+        float sv = 10.f * cfg_.vel_noise * std::max(w, h);
+        trk.axis[0].init(cx, sp * sp, sv * sv);
+        trk.axis[1].init(cy, sp * sp, sv * sv);
+        trk.axis[2].init(w, sp * sp, sv * sv);
+        trk.axis[3].init(h, sp * sp, sv * sv);
+        trk.conf = det.conf;
+        trk.class_id = det.class_id;
+        trk.id = next_id_++;
+        trk.hits = 1;
+        trk.time_since_update = 0;
+    }
+
+    void updateTrack(Track& trk, const Yolo::Detection& det) {
+        float z[4] = { (det.bbox[0] + det.bbox[2]) * 0.5f, (det.bbox[1] + det.bbox[3]) * 0.5f,
+                       det.bbox[2] - det.bbox[0], det.bbox[3] - det.bbox[1] };
+        float s = cfg_.pos_noise * std::max(z[2], z[3]);
+        for (int k = 0; k < 4; k++) trk.axis[k].update(z[k], s * s);
+        trk.conf = det.conf;
+        trk.hits++;
+        trk.time_since_update = 0;
+    }
+
+    void predictAll() {
+        for (int t : active_) {
+            Track& trk = pool_[t];
+            float size = std::max(trk.axis[2].x, trk.axis[3].x);
+            float qp = cfg_.pos_noise * size;
+            float qv = cfg_.vel_noise * size;
+            for (int k = 0; k < 4; k++) trk.axis[k].predict(qp * qp, qv * qv);
+            // 宽高不能为负
+            if (trk.axis[2].x < 1.f) trk.axis[2].x = 1.f;
+            if (trk.axis[3].x < 1.f) trk.axis[3].x = 1.f;
+            float* b = &pred_[t * 4];
+            b[0] = trk.axis[0].x - trk.axis[2].x * 0.5f;
+            b[1] = trk.axis[1].x - trk.axis[3].x * 0.5f;
+            b[2] = trk.axis[0].x + trk.axis[2].x * 0.5f;
+            b[3] = trk.axis[1].x + trk.axis[3].x * 0.5f;
+        }
+    }
+
+    Yolo::TrackedDetection makeOutput(const Track& trk, const float* box) const {
+        Yolo::TrackedDetection o;
+        if (box) {
+            for (int k = 0; k < 4; k++) o.det.bbox[k] = box[k];
+        } else {
+            o.det.bbox[0] = trk.axis[0].x - trk.axis[2].x * 0.5f;
+            o.det.bbox[1] = trk.axis[1].x - trk.axis[3].x * 0.5f;
+            o.det.bbox[2] = trk.axis[0].x + trk.axis[2].x * 0.5f;
+            o.det.bbox[3] = trk.axis[1].x + trk.axis[3].x * 0.5f;
+        }
+        o.det.conf = trk.conf;
+        o.det.class_id = trk.class_id;
+        o.track_id = trk.id;
+        return o;
+    }
+
+    static float iouXYXY(const float* a, const float* b) {
+        float iw = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+        float ih = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+        if (iw <= 0.f || ih <= 0.f) return 0.f;
+        float inter = iw * ih;
+        return inter / ((a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter);
+    }
+
+    // 只有同类别且iou >= min_iou的(轨迹, 检测)对可以匹配. 按这些候选对把轨迹和检测分成互不相连的组, 每组单独求最优匹配:
+    // 组之间的配对代价都是1(等价于不匹配), 结果与对整个矩阵求解相同, 但O(n^3)只作用在很小的组上
+    void associate(const std::vector<Yolo::Detection>& dets, int nd, bool high, float min_iou) {
+        det_idx_.clear();
+        trk_idx_.clear();
+        for (int d = 0; d < nd; d++) {
+            if (!det_used_[d] && (dets[d].conf >= cfg_.high_thresh) == high) det_idx_.push_back(d);
+        }
+        for (int t : active_) {
+            if (!trk_used_[t]) trk_idx_.push_back(t);
+        }
+        int rows = (int)trk_idx_.size();
+        int cols = (int)det_idx_.size();
+        if (rows == 0 || cols == 0) return;
+
+        // cost = 1 - iou (rows x cols), 类别不同或iou不够时为1; 节点0..rows-1为轨迹, rows..rows+cols-1为检测
+        for (int k = 0; k < rows + cols; k++) parent_[k] = k;
+        for (int i = 0; i < rows; i++) {
+            float* row = &cost_[(size_t)i * cols];
+            const Track& trk = pool_[trk_idx_[i]];
+            for (int j = 0; j < cols; j++) {
+                const Yolo::Detection& det = dets[det_idx_[j]];
+                float c = 1.f;
+                if (trk.class_id == det.class_id) {
+                    float o = iouXYXY(&pred_[trk_idx_[i] * 4], det.bbox);
+                    if (o >= min_iou) {
+                        c = 1.f - o;
+                        unite(i, rows + j);
+                    }
+                }
+                row[j] = c;
+            }
+        }
+
+        // 按组的根节点排序(计数排序), 同一组的节点在order_中连续
+        int nodes = rows + cols;
+        std::fill(start_.begin(), start_.begin() + nodes + 1, 0);
+        for (int k = 0; k < nodes; k++) {
+            parent_[k] = find(k);
+            start_[parent_[k] + 1]++;
+        }
+        for (int k = 0; k < nodes; k++) start_[k + 1] += start_[k];
+        for (int k = 0; k < nodes; k++) order_[start_[parent_[k]]++] = k;
+        for (int k = nodes; k > 0; k--) start_[k] = start_[k - 1];
+        start_[0] = 0;
+
+        for (int g = 0; g < nodes; g++) {
+            int begin = start_[g], end = start_[g + 1];
+            if (end - begin < 2) continue; // 单个节点: 没有候选对
+            // 组内轨迹在前(节点号小), 检测在后
+            int r = 0;
+            while (begin + r < end && order_[begin + r] < rows) r++;
+            int c = end - begin - r;
+            const int* grp_rows = &order_[begin];
+            const int* grp_cols = &order_[begin + r];
+            if (r == 1 && c == 1) {
+                assign_[0] = 0;
+            } else {
+                int m = std::max(r, c);
+                for (int a = 0; a < m; a++) {
+                    for (int b = 0; b < m; b++) {
+                        sub_[(size_t)a * m + b] = a < r && b < c ? cost_[(size_t)grp_rows[a] * cols + grp_cols[b] - rows] : 1.f;
+                    }
+                }
+                hungarian(m);
+            }
+            for (int a = 0; a < r; a++) {
+                int b = assign_[a];
+                if (b < 0 || b >= c) continue;
+                int i = grp_rows[a], j = grp_cols[b] - rows;
+                if (cost_[(size_t)i * cols + j] >= 1.f) continue;
+                int t = trk_idx_[i];
+                int d = det_idx_[j];
+                updateTrack(pool_[t], dets[d]);
+                trk_used_[t] = 1;
+                det_used_[d] = 1;
+            }
+        }
+    }
+
+    int find(int k) {
+        while (parent_[k] != k) {
+            parent_[k] = parent_[parent_[k]];
+            k = parent_[k];
+        }
+        return k;
+    }
+
+    void unite(int a, int b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent_[std::max(a, b)] = std::min(a, b);
+    }
+
+    // Kuhn-Munkres(最小代价), 代价矩阵为sub_中的n x n, O(n^3), 使用预分配的缓冲区. assign_[i] = 第i行匹配的列
+    void hungarian(int n) {
+        const float INF = std::numeric_limits<float>::max();
+        std::fill(u_.begin(), u_.begin() + n + 1, 0.f);
+        std::fill(v_.begin(), v_.begin() + n + 1, 0.f);
+        std::fill(p_.begin(), p_.begin() + n + 1, 0);
+        std::fill(way_.begin(), way_.begin() + n + 1, 0);
+        for (int i = 1; i <= n; i++) {
+            p_[0] = i;
+            int j0 = 0;
+            std::fill(minv_.begin(), minv_.begin() + n + 1, INF);
+            std::fill(used_.begin(), used_.begin() + n + 1, 0);
+            do {
+                used_[j0] = 1;
+                int i0 = p_[j0], j1 = 0;
+                float delta = INF;
+                const float* row = &sub_[(size_t)(i0 - 1) * n];
+                for (int j = 1; j <= n; j++) {
+                    if (used_[j]) continue;
+                    float cur = row[j - 1] - u_[i0] - v_[j];
+                    if (cur < minv_[j]) {
+                        minv_[j] = cur;
+                        way_[j] = j0;
+                    }
+                    if (minv_[j] < delta) {
+                        delta = minv_[j];
+                        j1 = j;
+                    }
+                }
+                for (int j = 0; j <= n; j++) {
+                    if (used_[j]) {
+                        u_[p_[j]] += delta;
+                        v_[j] -= delta;
+                    } else {
+                        minv_[j] -= delta;
+                    }
+                }
+                j0 = j1;
+            } while (p_[j0] != 0);
+            do {
+                int j1 = way_[j0];
+                p_[j0] = p_[j1];
+                j0 = j1;
+            } while (j0);
+        }
+        for (int j = 1; j <= n; j++) {
+            if (p_[j] > 0) assign_[p_[j] - 1] = j - 1;
+        }
+    }
+
+    TrackerConfig cfg_;
+    int next_id_;
+    std::vector<Track> pool_;
+    std::vector<int> free_;
+    std::vector<int> active_;
+    std::vector<int> det_idx_;
+    std::vector<int> trk_idx_;
+    std::vector<float> pred_; // 每个轨迹预测框(xyxy), 按pool下标存放
+    std::vector<float> cost_; // 本轮的轨迹 x 检测代价
+    std::vector<float> sub_;  // 一个组的方阵, hungarian的输入
+    std::vector<int> parent_, order_, start_; // 分组: 并查集, 按组排列的节点, 每组在order_中的起点
+    std::vector<float> u_, v_, minv_;
+    std::vector<int> p_, way_, assign_;
+    std::vector<char> used_, det_used_, trk_used_;
+};
+
+#endif  // TRTX_YOLOV5_TRACKER_H_
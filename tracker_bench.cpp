@@ -0,0 +1,87 @@
+// Tracker(tracker.h)的吞吐量, 只用CPU
+// 每个场景N个匀速运动的目标, 每帧的检测带位置噪声, 5%漏检, 另有N/20个随机误检; 跑若干帧后报告
+// 每次update的平均/最大耗时和tracks/ms(每帧输出的轨迹数之和 / 总耗时)
+// ./tracker_bench [每帧目标数, 默认50,200,500] [帧数]
+
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "tracker.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+struct BenchObject {
+    float cx, cy, vx, vy, w, h;
+    int cls;
+};
+
+static void bench(int objects, int frames) {
+    std::mt19937 rng(objects);
+    std::uniform_real_distribution<float> pos(0.f, 1920.f), vel(-3.f, 3.f), size(20.f, 120.f), unit(0.f, 1.f), noise(-1.5f, 1.5f);
+    std::vector<BenchObject> scene(objects);
+    for (int i = 0; i < objects; i++) scene[i] = BenchObject{ pos(rng), pos(rng) * 0.5625f, vel(rng), vel(rng), size(rng), size(rng), i % 6 };
+
+    TrackerConfig cfg;
+    cfg.max_tracks = std::max(cfg.max_tracks, 2 * objects);
+    Tracker tracker(cfg);
+    std::vector<Yolo::Detection> dets;
+    std::vector<Yolo::TrackedDetection> tracks;
+    double total_ms = 0, max_ms = 0;
+    long long outputs = 0;
+    for (int f = 0; f < frames; f++) {
+        dets.clear();
+        for (BenchObject& o : scene) {
+            o.cx += o.vx;
+            o.cy += o.vy;
+            if (unit(rng) < 0.05f) continue;
+            Yolo::Detection det;
+            det.bbox[0] = o.cx - o.w * 0.5f + noise(rng);
+            det.bbox[1] = o.cy - o.h * 0.5f + noise(rng);
+            det.bbox[2] = o.cx + o.w * 0.5f + noise(rng);
+            det.bbox[3] = o.cy + o.h * 0.5f + noise(rng);
+            det.conf = 0.5f + 0.5f * unit(rng);
+            det.class_id = (float)o.cls;
+            dets.push_back(det);
+        }
+        for (int i = 0; i < objects / 20; i++) {
+            Yolo::Detection det;
+            det.bbox[0] = pos(rng);
+            det.bbox[1] = pos(rng) * 0.5625f;
+            det.bbox[2] = det.bbox[0] + size(rng);
+            det.bbox[3] = det.bbox[1] + size(rng);
+            det.conf = unit(rng);
+            det.class_id = (float)(i % 6);
+            dets.push_back(det);
+        }
+        auto start = Clock::now();
+        tracker.update(dets, tracks);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        total_ms += ms;
+        max_ms = std::max(max_ms, ms);
+        outputs += tracks.size();
+    }
+    std::cout << objects << " objects/frame, " << frames << " frames: " << total_ms / frames << " ms/update (max " << max_ms << "), "
+              << outputs / (double)frames << " tracks/frame, " << (total_ms > 0 ? outputs / total_ms : 0) << " tracks/ms, "
+              << tracker.activeCount() << " active" << std::endl;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> objects;
+    std::stringstream ss(argc > 1 ? argv[1] : "50,200,500");
+    std::string item;
+    while (std::getline(ss, item, ',')) objects.push_back(atoi(item.c_str()));
+    int frames = argc > 2 ? atoi(argv[2]) : 300;
+    if (objects.empty() || frames <= 0) {
+        std::cerr << "./tracker_bench [objects per frame, e.g. 50,200,500] [frames]" << std::endl;
+        return -1;
+    }
+    for (int n : objects) {
+        if (n > 0) bench(n, frames);
+    }
+    return 0;
+}
@@ -0,0 +1,180 @@
+// Tracker(tracker.h)的确定性回放测试, 只用CPU
+// 合成场景: 几个匀速运动的目标, 其中一个中途被遮挡几帧, 另一个中途出现; 检查
+//   - 命中min_hits帧之前不输出, 之后每个真实目标始终对应同一个track id, 不同目标的id不同
+//   - 遮挡期间不输出该目标(update和跳帧时的predict都一样), 重新出现后沿用原来的id
+//   - 同样的输入回放两次, 输出逐字节相同
+// ./tracker_test, 失败时返回非0
+
+#include <string.h>
+#include <iterator>
+#include <map>
+#include <vector>
+#include "tracker.h"
+#include "test_check.h"
+
+struct SceneObject {
+    int cls;
+    float x, y, vx, vy, w, h; // 第0帧的中心点和每帧的速度
+    int first, last;          // 出现的帧范围[first, last]
+    int hidden_from, hidden_to; // 遮挡的帧范围, 没有遮挡时为-1
+};
+
+static const int SCENE_FRAMES = 60;
+
+static std::vector<SceneObject> make_scene() {
+    std::vector<SceneObject> scene;
+    scene.push_back(SceneObject{ 0, 100.f, 100.f, 4.f, 0.f, 40.f, 80.f, 0, SCENE_FRAMES - 1, 20, 24 });
+    scene.push_back(SceneObject{ 1, 400.f, 50.f, 0.f, 3.f, 60.f, 60.f, 0, SCENE_FRAMES - 1, -1, -1 });
+    scene.push_back(SceneObject{ 0, 300.f, 300.f, -2.f, -1.f, 50.f, 50.f, 10, SCENE_FRAMES - 1, -1, -1 });
+    return scene;
+}
+
+static bool visible(const SceneObject& o, int frame) {
+    return frame >= o.first && frame <= o.last && !(frame >= o.hidden_from && frame <= o.hidden_to);
+}
+
+static Yolo::Detection truth_box(const SceneObject& o, int frame) {
+    Yolo::Detection det;
+    float cx = o.x + o.vx * frame, cy = o.y + o.vy * frame;
+    det.bbox[0] = cx - o.w * 0.5f;
+    det.bbox[1] = cy - o.h * 0.5f;
+    det.bbox[2] = cx + o.w * 0.5f;
+    det.bbox[3] = cy + o.h * 0.5f;
+    det.conf = 0.9f;
+    det.class_id = (float)o.cls;
+    return det;
+}
+
+static std::vector<Yolo::Detection> detections(const std::vector<SceneObject>& scene, int frame) {
+    std::vector<Yolo::Detection> dets;
+    for (const SceneObject& o : scene) {
+        if (visible(o, frame)) dets.push_back(truth_box(o, frame));
+    }
+    return dets;
+}
+
+static float iou_xyxy(const float* a, const float* b) {
+    float iw = std::min(a[2], b[2]) - std::max(a[0], b[0]);
+    float ih = std::min(a[3], b[3]) - std::max(a[1], b[1]);
+    if (iw <= 0.f || ih <= 0.f) return 0.f;
+    float inter = iw * ih;
+    return inter / ((a[2] - a[0]) * (a[3] - a[1]) + (b[2] - b[0]) * (b[3] - b[1]) - inter);
+}
+
+// 输出框对应的真实目标(IoU最大且超过0.5), 没有时为-1
+static int match_truth(const std::vector<SceneObject>& scene, int frame, const Yolo::TrackedDetection& t) {
+    int best = -1;
+    float best_iou = 0.5f;
+    for (size_t k = 0; k < scene.size(); k++) {
+        float o = iou_xyxy(truth_box(scene[k], frame).bbox, t.det.bbox);
+        if (o > best_iou) {
+            best = (int)k;
+            best_iou = o;
+        }
+    }
+    return best;
+}
+
+static std::vector<std::vector<Yolo::TrackedDetection>> replay(const std::vector<SceneObject>& scene) {
+    Tracker tracker;
+    std::vector<std::vector<Yolo::TrackedDetection>> frames(SCENE_FRAMES);
+    for (int f = 0; f < SCENE_FRAMES; f++) tracker.update(detections(scene, f), frames[f]);
+    return frames;
+}
+
+static void test_replay() {
+    const std::vector<SceneObject> scene = make_scene();
+    const int min_hits = TrackerConfig().min_hits;
+    std::vector<std::vector<Yolo::TrackedDetection>> frames = replay(scene);
+    std::map<int, int> id_of; // 真实目标 -> track id
+    for (int f = 0; f < SCENE_FRAMES; f++) {
+        std::vector<char> seen(scene.size(), 0);
+        for (const Yolo::TrackedDetection& t : frames[f]) {
+            int k = match_truth(scene, f, t);
+            CHECK(k >= 0);
+            if (k < 0) continue;
+            CHECK(visible(scene[k], f));
+            CHECK(!seen[k]);
+            seen[k] = 1;
+            CHECK(t.det.class_id == scene[k].cls);
+            if (id_of.count(k)) CHECK(id_of[k] == t.track_id);
+            else id_of[k] = t.track_id;
+        }
+        for (size_t k = 0; k < scene.size(); k++) {
+            // 出现后第min_hits帧开始输出, 遮挡结束后马上恢复
+            bool expected = visible(scene[k], f) && f - scene[k].first >= min_hits - 1;
+            CHECK(seen[k] == expected);
+        }
+    }
+    CHECK(id_of.size() == scene.size());
+    for (auto a = id_of.begin(); a != id_of.end(); ++a) {
+        for (auto b = std::next(a); b != id_of.end(); ++b) CHECK(a->second != b->second);
+    }
+}
+
+static void test_deterministic() {
+    const std::vector<SceneObject> scene = make_scene();
+    std::vector<std::vector<Yolo::TrackedDetection>> a = replay(scene), b = replay(scene);
+    for (int f = 0; f < SCENE_FRAMES; f++) {
+        CHECK(a[f].size() == b[f].size());
+        if (a[f].size() == b[f].size() && !a[f].empty()) CHECK(memcmp(a[f].data(), b[f].data(), a[f].size() * sizeof(Yolo::TrackedDetection)) == 0);
+    }
+}
+
+// 跳帧(predict)时只传播上一次update中匹配到的轨迹, 丢失的轨迹不能作为幽灵框继续输出
+static void test_predict_hides_lost_tracks() {
+    const std::vector<SceneObject> scene = make_scene();
+    Tracker tracker;
+    std::vector<Yolo::TrackedDetection> out;
+    for (int f = 0; f < 5; f++) tracker.update(detections(scene, f), out);
+    CHECK(out.size() == 2);
+    int kept_id = -1;
+    for (const Yolo::TrackedDetection& t : out) {
+        if (match_truth(scene, 4, t) == 1) kept_id = t.track_id;
+    }
+    CHECK(kept_id > 0);
+
+    // 第5帧只有目标1被检测到, 目标0丢失
+    std::vector<Yolo::Detection> dets;
+    dets.push_back(truth_box(scene[1], 5));
+    tracker.update(dets, out);
+    CHECK(out.size() == 1);
+    for (int f = 6; f < 9; f++) {
+        tracker.predict(out);
+        CHECK(out.size() == 1);
+        if (out.size() != 1) continue;
+        CHECK(out[0].track_id == kept_id);
+        // 匀速预测: 与真实位置相差不到1个像素每帧
+        Yolo::Detection truth = truth_box(scene[1], f);
+        CHECK_NEAR((out[0].det.bbox[1] + out[0].det.bbox[3]) * 0.5f, (truth.bbox[1] + truth.bbox[3]) * 0.5f, f - 5);
+    }
+    CHECK(tracker.activeCount() == 2); // 丢失的轨迹仍保留到max_age, 重新出现时沿用id
+}
+
+// min_hits按累计命中计数: 中间丢失一帧不清零
+static void test_min_hits_cumulative() {
+    const std::vector<SceneObject> scene = make_scene();
+    Tracker tracker;
+    std::vector<Yolo::TrackedDetection> out;
+    std::vector<Yolo::Detection> none, one(1, truth_box(scene[1], 0));
+    tracker.update(one, out);
+    CHECK(out.empty());
+    tracker.update(none, out);
+    CHECK(out.empty());
+    one[0] = truth_box(scene[1], 2);
+    tracker.update(one, out);
+    CHECK(out.empty());
+    one[0] = truth_box(scene[1], 3);
+    tracker.update(one, out);
+    CHECK(out.size() == 1);
+}
+
+int main() {
+    test_replay();
+    test_deterministic();
+    test_predict_hides_lost_tracks();
+    test_min_hits_cumulative();
+    if (test_failures()) std::cerr << test_failures() << " checks failed" << std::endl;
+    else std::cout << "tracker_test passed" << std::endl;
+    return test_failures() ? 1 : 0;
+}
@@ -0,0 +1,69 @@
+#ifndef TRTX_YOLOV5_TRT_BINDINGS_H_
+#define TRTX_YOLOV5_TRT_BINDINGS_H_
+
+// 多优化profile engine的binding设置, yolov5-p6.cpp和Python扩展(pyyolov5.cpp)共用
+// engine每个profile各有一组(输入, 输出)binding, 按本次输入的batch和宽高选择profile
+// 模型的类别数在构建时写进network名称, 随engine一起序列化, 见engine_class_count
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "NvInfer.h"
+
+using namespace nvinfer1;
+
+// 选择能容纳batchSize x 3 x input_h x input_w的profile中opt尺寸最接近的一个, 没有则返回-1
+static inline int select_profile(const ICudaEngine& engine, const char* input_name, int batchSize, int input_h, int input_w) {
+    int per_profile = engine.getNbBindings() / engine.getNbOptimizationProfiles();
+    int best = -1;
+    int best_dist = 0;
+    for (int k = 0; k < engine.getNbOptimizationProfiles(); k++) {
+        int index = k * per_profile + engine.getBindingIndex(input_name);
+        Dims min = engine.getProfileDimensions(index, k, OptProfileSelector::kMIN);
+        Dims opt = engine.getProfileDimensions(index, k, OptProfileSelector::kOPT);
+        Dims max = engine.getProfileDimensions(index, k, OptProfileSelector::kMAX);
+        if (batchSize < min.d[0] || batchSize > max.d[0] || input_h < min.d[2] || input_h > max.d[2] || input_w < min.d[3] || input_w > max.d[3]) continue;
+        int dist = std::abs(opt.d[2] - input_h) + std::abs(opt.d[3] - input_w);
+        if (best < 0 || dist < best_dist) {
+            best = k;
+            best_dist = dist;
+        }
+    }
+    return best;
+}
+
+// 切换到能容纳本次输入的profile并设置输入尺寸, 返回enqueueV2/executeV2用的bindings
+// buffers[0]/buffers[1]为输入/输出的device内存
+// 该profile的binding下标为 profile * 每个profile的binding数 + profile 0中的下标
+static inline std::vector<void*> bind_buffers(IExecutionContext& context, const char* input_name, const char* output_name, void** buffers, int batchSize, int input_h, int input_w) {
+    const ICudaEngine& engine = context.getEngine();
+    int profile = select_profile(engine, input_name, batchSize, input_h, input_w);
+    assert(profile >= 0);
+    if (context.getOptimizationProfile() != profile) context.setOptimizationProfile(profile);
+    int per_profile = engine.getNbBindings() / engine.getNbOptimizationProfiles();
+    int input_index = profile * per_profile + engine.getBindingIndex(input_name);
+    int output_index = profile * per_profile + engine.getBindingIndex(output_name);
+    std::vector<void*> bindings(engine.getNbBindings(), nullptr);
+    bindings[input_index] = buffers[0];
+    bindings[output_index] = buffers[1];
+    context.setBindingDimensions(input_index, Dims4{ batchSize, 3, input_h, input_w });
+    assert(context.allInputDimensionsSpecified());
+    return bindings;
+}
+
+// 构建时作为INetworkDefinition的名称, 反序列化后由ICudaEngine::getName()读回
+static inline std::string engine_network_name(int nc) {
+    return "yolov5 nc=" + std::to_string(nc);
+}
+
+// engine的类别数(host端nms据此选择实例), 名称中没有nc(旧的engine)时返回fallback
+static inline int engine_class_count(const ICudaEngine& engine, int fallback) {
+    const char* name = engine.getName();
+    const char* nc = name ? strstr(name, "nc=") : nullptr;
+    int classes = nc ? atoi(nc + 3) : 0;
+    return classes > 0 ? classes : fallback;
+}
+
+#endif  // TRTX_YOLOV5_TRT_BINDINGS_H_
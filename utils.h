@@ -28,6 +28,21 @@ static inline cv::Mat preprocess_img(cv::Mat& img, int input_w, int input_h) {
     return out;
 }
 
+// letterbox后的BGR图像 -> RGB planar float(0~1), dst指向一张图在batch中的起始位置
+static inline void blob_from_img(const cv::Mat& pr_img, float* dst, int input_w, int input_h) {
+    int i = 0;
+    for (int row = 0; row < input_h; ++row) {
+        const uchar* uc_pixel = pr_img.data + row * pr_img.step;
+        for (int col = 0; col < input_w; ++col) {
+            dst[i] = (float)uc_pixel[2] / 255.0;
+            dst[i + input_h * input_w] = (float)uc_pixel[1] / 255.0;
+            dst[i + 2 * input_h * input_w] = (float)uc_pixel[0] / 255.0;
+            uc_pixel += 3;
+            ++i;
+        }
+    }
+}
+
 static inline int read_files_in_dir(const char *p_dir_name, std::vector<std::string> &file_names) {
     DIR *p_dir = opendir(p_dir_name);
     if (p_dir == nullptr) {
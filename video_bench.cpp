@@ -0,0 +1,83 @@
+// 视频输入吞吐量(只用CPU, 不需要GPU/TensorRT): 对每个本地视频分别测
+//   decode:       FfmpegSource只解码
+//   ffmpeg+input: FfmpegSource解码 + swscale直接写成letterbox后的planar float网络输入
+//   opencv+input: cv::VideoCapture(BGR) + letterbox_img + blob_from_img, 即原来的路径
+// ffmpeg的两项按解码线程数1, 2, 4和自动(0)分别测, 每项最多BENCH_FRAMES帧
+// ./video_bench a.mp4 [b.mp4 ...]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "utils.h"
+#include "letterbox.h"
+#include "ffmpeg_source.h"
+
+#define BENCH_FRAMES 300
+
+struct BenchResult {
+    int64_t frames = 0;
+    double seconds = 0;
+    double fps() const { return seconds > 0 ? frames / seconds : 0; }
+};
+
+// rect推理(RECT_INFER)时的letterbox: 长边缩放到max(INPUT_W, INPUT_H)
+static Yolo::Letterbox bench_letterbox(int w, int h) {
+    return rect_letterbox(w, h, std::max(Yolo::INPUT_W, Yolo::INPUT_H));
+}
+
+static BenchResult bench_ffmpeg(const std::string& path, int threads, bool to_input, std::vector<float>& input) {
+    BenchResult r;
+    FfmpegSource source;
+    VideoSourceOptions options;
+    options.decode_threads = threads;
+    if (!source.open(path, options)) return r;
+    Yolo::Letterbox lb = bench_letterbox(source.width(), source.height());
+    input.resize((size_t)3 * lb.canvas_w * lb.canvas_h);
+    auto start = std::chrono::high_resolution_clock::now();
+    while (r.frames < BENCH_FRAMES && (to_input ? source.read(lb, input.data()) : source.decode())) r.frames++;
+    r.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return r;
+}
+
+static BenchResult bench_opencv(const std::string& path, std::vector<float>& input) {
+    BenchResult r;
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened()) return r;
+    cv::Mat frame;
+    auto start = std::chrono::high_resolution_clock::now();
+    while (r.frames < BENCH_FRAMES && cap.read(frame)) {
+        Yolo::Letterbox lb = bench_letterbox(frame.cols, frame.rows);
+        input.resize((size_t)3 * lb.canvas_w * lb.canvas_h);
+        blob_from_img(letterbox_img(frame, lb), input.data(), lb.canvas_w, lb.canvas_h);
+        r.frames++;
+    }
+    r.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    return r;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "usage: ./video_bench a.mp4 [b.mp4 ...]" << std::endl;
+        return -1;
+    }
+    const int threads[] = { 1, 2, 4, 0 };
+    std::vector<float> input;
+    for (int i = 1; i < argc; i++) {
+        FfmpegSource probe;
+        if (!probe.open(argv[i], VideoSourceOptions())) continue;
+        Yolo::Letterbox lb = bench_letterbox(probe.width(), probe.height());
+        std::cout << argv[i] << ": " << probe.width() << "x" << probe.height() << " @ " << probe.fps() << " fps -> "
+                  << lb.canvas_w << "x" << lb.canvas_h << " input" << std::endl;
+        probe.close();
+        for (int t : threads) {
+            BenchResult dec = bench_ffmpeg(argv[i], t, false, input);
+            BenchResult full = bench_ffmpeg(argv[i], t, true, input);
+            std::cout << "  threads " << (t ? std::to_string(t) : std::string("auto")) << ": decode " << dec.fps()
+                      << " fps, ffmpeg+input " << full.fps() << " fps (" << full.frames << " frames)" << std::endl;
+        }
+        BenchResult cv_path = bench_opencv(argv[i], input);
+        std::cout << "  opencv+input: " << cv_path.fps() << " fps (" << cv_path.frames << " frames)" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+#ifndef TRTX_YOLOV5_WEIGHT_ARENA_H_
+#define TRTX_YOLOV5_WEIGHT_ARENA_H_
+
+// 构建engine期间所有权重和派生常量(BN折叠结果、scale/shift等)的内存池
+// 按64字节对齐顺序分配(bump), 不单独释放, engine构建完成后随arena析构一次性释放
+// common.hpp中的loadWeights/fuseConvBatchNorm和yolov5_graph.h中的batchNorm2d从WeightArena::current()分配,
+// 由build_engine中的ArenaScope指定; 分配本身不是线程安全的, 并行阶段先串行分配再并行填充
+
+#include <assert.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <vector>
+
+class WeightArena {
+public:
+    static constexpr size_t kAlignment = 64;
+
+    explicit WeightArena(size_t block_bytes = 16 << 20) : block_bytes_(block_bytes) {}
+
+    ~WeightArena() { release(); }
+
+    WeightArena(const WeightArena&) = delete;
+    WeightArena& operator=(const WeightArena&) = delete;
+
+    // 保证之后至少bytes字节可以不换块连续分配
+    void reserve(size_t bytes) {
+        size_t offset = align(offset_);
+        if (!blocks_.empty() && offset + bytes <= blocks_.back().size) return;
+        newBlock(std::max(block_bytes_, bytes));
+    }
+
+    void* allocate(size_t bytes) {
+        if (bytes == 0) return nullptr;
+        size_t offset = align(offset_);
+        if (blocks_.empty() || offset + bytes > blocks_.back().size) {
+            newBlock(std::max(block_bytes_, bytes));
+            offset = 0;
+        }
+        offset_ = offset + bytes;
+        used_ += bytes;
+        return blocks_.back().data + offset;
+    }
+
+    template <typename T>
+    T* allocate_array(size_t count) {
+        return static_cast<T*>(allocate(sizeof(T) * count));
+    }
+
+    void release() {
+        for (auto& b : blocks_) free(b.data);
+        blocks_.clear();
+        offset_ = 0;
+        used_ = 0;
+        reserved_ = 0;
+    }
+
+    size_t used() const { return used_; }
+    size_t reserved() const { return reserved_; }
+    size_t peakReserved() const { return peak_reserved_; }
+    int blocks() const { return (int)blocks_.size(); }
+
+    // 当前线程正在使用的arena, 由ArenaScope设置
+    static WeightArena*& current() {
+        static thread_local WeightArena* arena = nullptr;
+        return arena;
+    }
+
+private:
+    struct Block {
+        char* data;
+        size_t size;
+    };
+
+    static size_t align(size_t x) { return (x + kAlignment - 1) & ~(kAlignment - 1); }
+
+    void newBlock(size_t bytes) {
+        bytes = align(bytes);
+        void* p = nullptr;
+        int ret = posix_memalign(&p, kAlignment, bytes);
+        assert(ret == 0 && p);
+        (void)ret;
+        blocks_.push_back(Block{ static_cast<char*>(p), bytes });
+        offset_ = 0;
+        reserved_ += bytes;
+        peak_reserved_ = std::max(peak_reserved_, reserved_);
+    }
+
+    size_t block_bytes_;
+    std::vector<Block> blocks_;
+    size_t offset_ = 0;
+    size_t used_ = 0;
+    size_t reserved_ = 0;
+    size_t peak_reserved_ = 0;
+};
+
+class ArenaScope {
+public:
+    explicit ArenaScope(WeightArena& arena) : prev_(WeightArena::current()) { WeightArena::current() = &arena; }
+    ~ArenaScope() { WeightArena::current() = prev_; }
+
+private:
+    WeightArena* prev_;
+};
+
+static inline WeightArena& builder_arena() {
+    assert(WeightArena::current() && "builder weights must be allocated inside an ArenaScope");
+    return *WeightArena::current();
+}
+
+// 进程的峰值常驻内存(MB)
+static inline double peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+#endif  // TRTX_YOLOV5_WEIGHT_ARENA_H_
@@ -0,0 +1,241 @@
+#ifndef _YOLO_DECODE_H
+#define _YOLO_DECODE_H
+
+// YoloLayer解码的公共部分: 启动配置、线程下标 -> (batch, head, cell)的映射、单个anchor的解码
+// 同一份代码既被yololayer.cu中的kernel调用, 也被decode_host调用, 可以在CPU上对任意head尺寸和batch数做校验
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "yolo_types.h"
+
+#ifdef __CUDACC__
+#include <cuda_fp16.h>
+#define YOLO_HD __host__ __device__
+#else
+#define YOLO_HD
+#endif
+
+namespace Yolo
+{
+    static constexpr int MAX_HEADS = 8;
+
+    // head输入的内存布局, 对应TensorFormat::kLINEAR / kCHW2 / kHWC8
+    enum DecodeLayout
+    {
+        kLayoutLinear = 0,
+        kLayoutCHW2 = 1, // 通道两两打包(FP16)
+        kLayoutHWC8 = 2  // 通道补齐到8的倍数, 按像素连续存放(FP16)
+    };
+
+    // IEEE half的位模式, host端不依赖cuda_fp16.h
+    struct half_bits
+    {
+        uint16_t x;
+    };
+
+    YOLO_HD inline float half_to_float(uint16_t h)
+    {
+        uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+        uint32_t exp = (h >> 10) & 0x1f;
+        uint32_t mant = h & 0x3ff;
+        uint32_t bits;
+        if (exp == 0) {
+            if (mant == 0) {
+                bits = sign;
+            } else {
+                // subnormal: 规格化
+                exp = 127 - 15 + 1;
+                while (!(mant & 0x400)) {
+                    mant <<= 1;
+                    exp--;
+                }
+                bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+            }
+        } else if (exp == 0x1f) {
+            bits = sign | 0x7f800000 | (mant << 13);
+        } else {
+            bits = sign | ((exp + 127 - 15) << 23) | (mant << 13);
+        }
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    // 按round-to-nearest-even把float转成half, 用于构造对照数据(decode_test.cpp)
+    inline uint16_t float_to_half(float f)
+    {
+        uint32_t x;
+        memcpy(&x, &f, sizeof(x));
+        uint32_t sign = (x >> 16) & 0x8000;
+        int exp = (int)((x >> 23) & 0xff) - 127 + 15;
+        uint32_t mant = x & 0x7fffff;
+        if (((x >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mant ? 0x200 : 0);
+        if (exp >= 0x1f) return sign | 0x7c00;
+        if (exp <= 0) {
+            if (exp < -10) return sign;
+            mant |= 0x800000;
+            int shift = 14 - exp;
+            uint32_t h = mant >> shift;
+            uint32_t rem = mant & ((1u << shift) - 1);
+            uint32_t half = 1u << (shift - 1);
+            if (rem > half || (rem == half && (h & 1))) h++;
+            return sign | h;
+        }
+        uint32_t h = sign | (exp << 10) | (mant >> 13);
+        uint32_t rem = mant & 0x1fff;
+        if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) h++;
+        return h;
+    }
+
+    template <typename T> YOLO_HD inline float load_input(const T* p);
+
+    template <> YOLO_HD inline float load_input<float>(const float* p) { return *p; }
+
+    template <> YOLO_HD inline float load_input<half_bits>(const half_bits* p)
+    {
+#ifdef __CUDA_ARCH__
+        return __half2float(*reinterpret_cast<const __half*>(p));
+#else
+        return half_to_float(p->x);
+#endif
+    }
+
+    struct DecodeHead
+    {
+        int width;
+        int height;
+        int cell_offset; // 该head第一个cell在一张图所有cell中的下标
+        float anchors[CHECK_COUNT * 2];
+    };
+
+    // 一次kernel启动覆盖所有head和整个batch, 按值传给kernel
+    struct DecodeParams
+    {
+        const void* inputs[MAX_HEADS]; // float或half_bits, 由kernel的模板参数决定
+        DecodeHead heads[MAX_HEADS];
+        int num_heads;
+        int cells_per_image; // 所有head的cell总数
+        int batch;
+        int classes;
+        int net_width;
+        int net_height;
+        int max_out;
+        int output_elem; // 每张图的输出长度: 1 + max_out * sizeof(Detection) / sizeof(float)
+        int layout;      // DecodeLayout
+    };
+
+    // 第c个通道、第cell个格子在一张图中的元素偏移, 以及一张图的元素数(含通道补齐)
+    YOLO_HD inline int channel_offset(int layout, int channels, int c, int cell, int total_grid)
+    {
+        if (layout == kLayoutCHW2) return (c / 2) * total_grid * 2 + cell * 2 + (c & 1);
+        if (layout == kLayoutHWC8) return cell * ((channels + 7) / 8 * 8) + c;
+        return c * total_grid + cell;
+    }
+
+    YOLO_HD inline int image_elements(int layout, int channels, int total_grid)
+    {
+        if (layout == kLayoutCHW2) return (channels + 1) / 2 * 2 * total_grid;
+        if (layout == kLayoutHWC8) return (channels + 7) / 8 * 8 * total_grid;
+        return channels * total_grid;
+    }
+
+    struct LaunchGeometry
+    {
+        int blocks;
+        int threads;
+    };
+
+    // 不修改调用者的线程数, 总数小于线程数时只缩小本次启动
+    YOLO_HD inline LaunchGeometry decode_geometry(const DecodeParams& p, int max_threads)
+    {
+        LaunchGeometry g;
+        int total = p.cells_per_image * p.batch;
+        g.threads = total < max_threads ? (total > 0 ? total : 1) : max_threads;
+        g.blocks = (total + g.threads - 1) / g.threads;
+        return g;
+    }
+
+    YOLO_HD inline bool locate_cell(const DecodeParams& p, int idx, int& b, int& head, int& cell)
+    {
+        if (idx < 0 || idx >= p.cells_per_image * p.batch) return false;
+        b = idx / p.cells_per_image;
+        int local = idx - b * p.cells_per_image;
+        head = 0;
+        while (head + 1 < p.num_heads && local >= p.heads[head + 1].cell_offset) head++;
+        cell = local - p.heads[head].cell_offset;
+        return true;
+    }
+
+    YOLO_HD inline float logist(float data) { return 1.0f / (1.0f + expf(-data)); }
+
+    // 解码batch中第b张图、第head个尺度、第cell个格子的第k个anchor, 低于IGNORE_THRESH返回false
+    // Anchors为每个cell的anchor数(决定head的通道数)
+    template <typename T, int Anchors = CHECK_COUNT>
+    YOLO_HD inline bool decode_anchor(const DecodeParams& p, int b, int head, int cell, int k, Detection& det)
+    {
+        static_assert(Anchors > 0 && Anchors <= CHECK_COUNT, "unsupported decode configuration");
+        const int classes = p.classes;
+        const DecodeHead& h = p.heads[head];
+        int total_grid = h.width * h.height;
+        int info_len_i = 5 + classes;
+        int channels = info_len_i * Anchors;
+        const T* img = static_cast<const T*>(p.inputs[head]) + b * image_elements(p.layout, channels, total_grid);
+        int c0 = k * info_len_i;
+#define YOLO_IN(i) load_input<T>(img + channel_offset(p.layout, channels, c0 + (i), cell, total_grid))
+
+        float box_prob = logist(YOLO_IN(4));
+        if (box_prob < IGNORE_THRESH) return false;
+        // sigmoid单调递增, 在logit上取最大的类别, 只对它计算一次sigmoid(conf与逐类计算sigmoid后取最大相同)
+        int class_id = 0;
+        float max_logit = YOLO_IN(5);
+        for (int i = 1; i < classes; ++i) {
+            float logit = YOLO_IN(5 + i);
+            if (logit > max_logit) {
+                max_logit = logit;
+                class_id = i;
+            }
+        }
+
+        int row = cell / h.width;
+        int col = cell % h.width;
+        // pytorch:
+        //  y = x[i].sigmoid()
+        //  y[..., 0:2] = (y[..., 0:2] * 2. - 0.5 + self.grid[i].to(x[i].device)) * self.stride[i]  # xy
+        //  y[..., 2:4] = (y[..., 2:4] * 2) ** 2 * self.anchor_grid[i]  # wh
+        det.bbox[0] = (col - 0.5f + 2.0f * logist(YOLO_IN(0))) * p.net_width / h.width;
+        det.bbox[1] = (row - 0.5f + 2.0f * logist(YOLO_IN(1))) * p.net_height / h.height;
+        det.bbox[2] = 2.0f * logist(YOLO_IN(2));
+        det.bbox[2] = det.bbox[2] * det.bbox[2] * h.anchors[2 * k];
+        det.bbox[3] = 2.0f * logist(YOLO_IN(3));
+        det.bbox[3] = det.bbox[3] * det.bbox[3] * h.anchors[2 * k + 1];
+#undef YOLO_IN
+        det.conf = logist(max_logit) * box_prob;
+        det.class_id = class_id;
+        return true;
+    }
+
+    // 与kernel相同的host实现, output布局与plugin输出一致(每张图: 数量 + Detection数组)
+    // GPU上写入顺序由atomicAdd决定, 比较时应按集合比较. T为float或half_bits(FP16输入)
+    template <typename T, int Anchors = CHECK_COUNT>
+    inline void decode_host(const DecodeParams& p, float* output)
+    {
+        for (int b = 0; b < p.batch; b++) output[b * p.output_elem] = 0.0f;
+        for (int idx = 0; idx < p.cells_per_image * p.batch; idx++) {
+            int b, head, cell;
+            if (!locate_cell(p, idx, b, head, cell)) continue;
+            for (int k = 0; k < Anchors; ++k) {
+                Detection det;
+                if (!decode_anchor<T, Anchors>(p, b, head, cell, k, det)) continue;
+                float* res_count = output + b * p.output_elem;
+                int count = (int)(*res_count);
+                *res_count += 1;
+                if (count >= p.max_out) break;
+                Detection* dst = reinterpret_cast<Detection*>(res_count + 1) + count;
+                *dst = det;
+            }
+        }
+    }
+}
+
+#endif
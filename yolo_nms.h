@@ -0,0 +1,74 @@
+#ifndef _YOLO_NMS_H
+#define _YOLO_NMS_H
+
+// GPU NMS插件(nmslayer.cu)与host参考实现共用的抑制规则
+// 1. 去掉conf <= conf_thresh的候选框
+// 2. 按conf从大到小排序(conf相同时按原始下标), 保证GPU与CPU的顺序一致
+// 3. 依次保留每个未被抑制的框, 同类别且iou > nms_thresh的后续框被抑制, 保留top_n个后停止
+// 输入/输出布局与YoloLayer一致: [数量, Detection...], 框为xywh(网络输入坐标)
+// 与postprocess.h中的nms保留的框集合相同, 只是输出按conf排序而不是按类别分组(nms_test.cpp随机对比)
+
+#include "yolo_decode.h"
+
+namespace Yolo
+{
+    static constexpr int NMS_SORT_SIZE = 1024; // 单张图参与排序的最大候选数, 需 >= MAX_OUTPUT_BBOX_COUNT
+
+    YOLO_HD inline float nms_iou(const float* lbox, const float* rbox)
+    {
+        float left = fmaxf(lbox[0] - lbox[2] / 2.f, rbox[0] - rbox[2] / 2.f);
+        float right = fminf(lbox[0] + lbox[2] / 2.f, rbox[0] + rbox[2] / 2.f);
+        float top = fmaxf(lbox[1] - lbox[3] / 2.f, rbox[1] - rbox[3] / 2.f);
+        float bottom = fminf(lbox[1] + lbox[3] / 2.f, rbox[1] + rbox[3] / 2.f);
+        if (top > bottom || left > right) return 0.0f;
+        float inter = (right - left) * (bottom - top);
+        return inter / (lbox[2] * lbox[3] + rbox[2] * rbox[3] - inter);
+    }
+
+    // 排序规则: a是否应排在b前面
+    YOLO_HD inline bool nms_before(float conf_a, int idx_a, float conf_b, int idx_b)
+    {
+        return conf_a > conf_b || (conf_a == conf_b && idx_a < idx_b);
+    }
+
+    YOLO_HD inline bool nms_suppresses(const Detection& kept, const Detection& other, float nms_thresh)
+    {
+        return kept.class_id == other.class_id && nms_iou(kept.bbox, other.bbox) > nms_thresh;
+    }
+
+    // host参考实现, 与NmsLayer的kernel执行相同的步骤
+    inline void nms_host(const float* input, float* output, int max_in, float conf_thresh, float nms_thresh, int top_n)
+    {
+        const Detection* dets = reinterpret_cast<const Detection*>(input + 1);
+        int n = (int)input[0] < max_in ? (int)input[0] : max_in;
+        int order[NMS_SORT_SIZE];
+        char keep[NMS_SORT_SIZE];
+        int valid = 0;
+        for (int i = 0; i < n && i < NMS_SORT_SIZE; i++) {
+            if (dets[i].conf > conf_thresh) order[valid++] = i;
+        }
+        // 插入排序, 规则与kernel中的双调排序相同
+        for (int i = 1; i < valid; i++) {
+            int cur = order[i];
+            int j = i - 1;
+            while (j >= 0 && nms_before(dets[cur].conf, cur, dets[order[j]].conf, order[j])) {
+                order[j + 1] = order[j];
+                j--;
+            }
+            order[j + 1] = cur;
+        }
+        for (int i = 0; i < valid; i++) keep[i] = 1;
+        int kept = 0;
+        Detection* out = reinterpret_cast<Detection*>(output + 1);
+        for (int i = 0; i < valid && kept < top_n; i++) {
+            if (!keep[i]) continue;
+            out[kept++] = dets[order[i]];
+            for (int j = i + 1; j < valid; j++) {
+                if (keep[j] && nms_suppresses(dets[order[i]], dets[order[j]], nms_thresh)) keep[j] = 0;
+            }
+        }
+        output[0] = kept;
+    }
+}
+
+#endif
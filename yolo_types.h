@@ -0,0 +1,41 @@
+#ifndef TRTX_YOLOV5_YOLO_TYPES_H_
+#define TRTX_YOLOV5_YOLO_TYPES_H_
+
+// 网络常量、检测框和letterbox参数, 只依赖标准库
+// YoloLayer插件(yololayer.h)和只在CPU上运行的工具(yolov5_cpu, coco_eval, pyyolov5的mock backend)共用, 不要在这里包含NvInfer.h
+
+namespace Yolo
+{
+    static constexpr int CHECK_COUNT = 3; // 每个尺度anchor个数
+    static constexpr float IGNORE_THRESH = 0.45f;
+    struct YoloKernel
+    {
+        int width;
+        int height;
+        float anchors[CHECK_COUNT * 2];
+    };
+    static constexpr int MAX_OUTPUT_BBOX_COUNT = 1000;
+    static constexpr int CLASS_NUM = 6;
+    static constexpr int INPUT_H = 384;
+    static constexpr int INPUT_W = 640;
+
+    static constexpr int LOCATIONS = 4;
+    struct alignas(float) Detection {
+        //center_x center_y w h
+        float bbox[LOCATIONS];
+        float conf;  // bbox_conf * cls_conf
+        float class_id;
+    };
+
+    // 每帧的letterbox参数, 计算和使用见letterbox.h
+    static constexpr int CANVAS_STRIDE = 64;
+
+    struct Letterbox {
+        int canvas_w, canvas_h; // 网络输入尺寸
+        int w, h;               // 缩放后的图像尺寸
+        int pad_x, pad_y;       // 缩放后图像在canvas中的左上角
+        float gain;             // 网络输入 / 原图
+    };
+}
+
+#endif  // TRTX_YOLOV5_YOLO_TYPES_H_
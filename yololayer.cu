@@ -2,6 +2,7 @@
 #include <vector>
 #include <iostream>
 #include "yololayer.h"
+#include "yolo_decode.h"
 #include "cuda_utils.h"
 
 namespace Tn
@@ -31,25 +32,12 @@ namespace nvinfer1
         mYoloV5NetWidth = netWidth;
         mYoloV5NetHeight = netHeight;
         mMaxOutObject = maxOut;
-        mYoloKernel = vYoloKernel; // 4个head(xl,l,m,s), 包含：特征图w,h,anchors
-        mKernelCount = vYoloKernel.size(); // 4尺度输出
-
-        CUDA_CHECK(cudaMallocHost(&mAnchor, mKernelCount * sizeof(void*)));
-        size_t AnchorLen = sizeof(float)* CHECK_COUNT * 2;
-        for (int ii = 0; ii < mKernelCount; ii++)
-        {
-            CUDA_CHECK(cudaMalloc(&mAnchor[ii], AnchorLen));
-            const auto& yolo = mYoloKernel[ii];
-            CUDA_CHECK(cudaMemcpy(mAnchor[ii], yolo.anchors, AnchorLen, cudaMemcpyHostToDevice));
-        }
+        mYoloKernel = vYoloKernel; // 各head按stride从大到小(P6: xl,l,m,s), 包含：特征图w,h,anchors
+        mKernelCount = vYoloKernel.size(); // 输出尺度数, P5为3, P6为4
+        assert(mKernelCount <= MAX_HEADS);
     }
     YoloLayerPlugin::~YoloLayerPlugin()
     {
-        for (int ii = 0; ii < mKernelCount; ii++)
-        {
-            CUDA_CHECK(cudaFree(mAnchor[ii]));
-        }
-        CUDA_CHECK(cudaFreeHost(mAnchor));
     }
 
     // create the plugin at runtime from a byte stream
@@ -67,14 +55,7 @@ namespace nvinfer1
         auto kernelSize = mKernelCount * sizeof(YoloKernel);
         memcpy(mYoloKernel.data(), d, kernelSize);
         d += kernelSize;
-        CUDA_CHECK(cudaMallocHost(&mAnchor, mKernelCount * sizeof(void*)));
-        size_t AnchorLen = sizeof(float)* CHECK_COUNT * 2;
-        for (int ii = 0; ii < mKernelCount; ii++)
-        {
-            CUDA_CHECK(cudaMalloc(&mAnchor[ii], AnchorLen));
-            const auto& yolo = mYoloKernel[ii];
-            CUDA_CHECK(cudaMemcpy(mAnchor[ii], yolo.anchors, AnchorLen, cudaMemcpyHostToDevice));
-        }
+        assert(mKernelCount <= MAX_HEADS);
         assert(d == a + length);
     }
 
@@ -105,12 +86,18 @@ namespace nvinfer1
         return 0;
     }
 
-    Dims YoloLayerPlugin::getOutputDimensions(int index, const Dims* inputs, int nbInputDims)
+    DimsExprs YoloLayerPlugin::getOutputDimensions(int outputIndex, const DimsExprs* inputs, int nbInputs, IExprBuilder& exprBuilder)
     {
         //output the result to channel
         int totalsize = mMaxOutObject * sizeof(Detection) / sizeof(float);
 
-        return Dims3(totalsize + 1, 1, 1);
+        DimsExprs out;
+        out.nbDims = 4;
+        out.d[0] = inputs[0].d[0];
+        out.d[1] = exprBuilder.constant(totalsize + 1);
+        out.d[2] = exprBuilder.constant(1);
+        out.d[3] = exprBuilder.constant(1);
+        return out;
     }
 
     // Set plugin namespace
@@ -130,19 +117,34 @@ namespace nvinfer1
         return DataType::kFLOAT;
     }
 
-    // Return true if output tensor is broadcast across a batch.
-    bool YoloLayerPlugin::isOutputBroadcastAcrossBatch(int outputIndex, const bool* inputIsBroadcasted, int nbInputs) const
+    bool YoloLayerPlugin::supportsFormatCombination(int pos, const PluginTensorDesc* inOut, int nbInputs, int nbOutputs)
     {
+        const PluginTensorDesc& desc = inOut[pos];
+        if (pos >= nbInputs) {
+            return desc.format == TensorFormat::kLINEAR && desc.type == DataType::kFLOAT;
+        }
+        // 所有head使用同一种类型和布局, kernel只需要一个实例
+        if (pos > 0 && (desc.type != inOut[0].type || desc.format != inOut[0].format)) {
+            return false;
+        }
+        if (desc.type == DataType::kFLOAT) {
+            return desc.format == TensorFormat::kLINEAR;
+        }
+        if (desc.type == DataType::kHALF) {
+            return desc.format == TensorFormat::kLINEAR || desc.format == TensorFormat::kCHW2 || desc.format == TensorFormat::kHWC8;
+        }
         return false;
     }
 
-    // Return true if plugin can use input that is broadcast across batch without replication.
-    bool YoloLayerPlugin::canBroadcastInputAcrossBatch(int inputIndex) const
+    static int decode_layout(TensorFormat format)
     {
-        return false;
+        if (format == TensorFormat::kCHW2) return kLayoutCHW2;
+        if (format == TensorFormat::kHWC8) return kLayoutHWC8;
+        return kLayoutLinear;
     }
 
-    void YoloLayerPlugin::configurePlugin(const PluginTensorDesc* in, int nbInput, const PluginTensorDesc* out, int nbOutput)
+    // 类型和布局在enqueue时从PluginTensorDesc读取; 插件前实际剩下的reformat层数在build后从engine中统计(见build_engine)
+    void YoloLayerPlugin::configurePlugin(const DynamicPluginTensorDesc* in, int nbInputs, const DynamicPluginTensorDesc* out, int nbOutputs)
     {
     }
 
@@ -161,7 +163,7 @@ namespace nvinfer1
 
     const char* YoloLayerPlugin::getPluginVersion() const
     {
-        return "1";
+        return "2";
     }
 
     void YoloLayerPlugin::destroy()
@@ -170,96 +172,73 @@ namespace nvinfer1
     }
 
     // Clone the plugin
-    IPluginV2IOExt* YoloLayerPlugin::clone() const
+    IPluginV2DynamicExt* YoloLayerPlugin::clone() const
     {
         YoloLayerPlugin* p = new YoloLayerPlugin(mClassCount, mYoloV5NetWidth, mYoloV5NetHeight, mMaxOutObject, mYoloKernel);
         p->setPluginNamespace(mPluginNamespace);
         return p;
     }
 
-    // GPU调用
-    inline __device__ float Logist(float data) { return 1.0f / (1.0f + expf(-data)); };
-
-    // GPU或CPU都可调用
-    __global__ void CalDetection(const float *input, float *output, int noElements,
-        const int netwidth, const int netheight, int maxoutobject, int yoloWidth, int yoloHeight, const float anchors[CHECK_COUNT * 2], int classes, int outputElem)
+    // 一次启动覆盖所有head和整个batch, 下标映射和解码见yolo_decode.h(与decode_host共用)
+    template <typename T>
+    __global__ void CalDetection(const DecodeParams params, float *output)
     {
         // threadIdx线程索引，blockIdx线程块索引，blockDim线程块大小
         int idx = threadIdx.x + blockDim.x * blockIdx.x;
-        // noElements一个尺度特征图的cell数量
-        if (idx >= noElements) return;
-        // printf("threadIdx.x:%d, blockDim.x:%d, blockIdx.x:%d, noElements:%d\n", threadIdx.x, blockDim.x, blockIdx.x, noElements);
-        int total_grid = yoloWidth * yoloHeight;
-        int bnIdx = idx / total_grid;
-        idx = idx - total_grid * bnIdx;
-        int info_len_i = 5 + classes;
-        const float* curInput = input + bnIdx * (info_len_i * total_grid * CHECK_COUNT);
+        int b, head, cell;
+        if (!locate_cell(params, idx, b, head, cell)) return;
 
         for (int k = 0; k < CHECK_COUNT; ++k) {
-            float box_prob = Logist(curInput[idx + k * info_len_i * total_grid + 4 * total_grid]);
-            if (box_prob < IGNORE_THRESH) continue;
-            int class_id = 0;
-            float max_cls_prob = 0.0;
-            for (int i = 5; i < info_len_i; ++i) {
-                float p = Logist(curInput[idx + k * info_len_i * total_grid + i * total_grid]) * box_prob;
-                if (p > max_cls_prob) {
-                    max_cls_prob = p;
-                    class_id = i - 5;
-                }
-            }
-            float *res_count = output + bnIdx * outputElem;
+            Detection det;
+            if (!decode_anchor<T>(params, b, head, cell, k, det)) continue;
+            float *res_count = output + b * params.output_elem;
             int count = (int)atomicAdd(res_count, 1);
-            if (count >= maxoutobject) return;
-            char* data = (char *)res_count + sizeof(float) + count * sizeof(Detection);
-            Detection* det = (Detection*)(data);
-
-            int row = idx / yoloWidth;
-            int col = idx % yoloWidth;
-
-            //Location
-            // pytorch:
-            //  y = x[i].sigmoid()
-            //  y[..., 0:2] = (y[..., 0:2] * 2. - 0.5 + self.grid[i].to(x[i].device)) * self.stride[i]  # xy
-            //  y[..., 2:4] = (y[..., 2:4] * 2) ** 2 * self.anchor_grid[i]  # wh 
-            //  X: (sigmoid(tx) + cx)/FeaturemapW *  netwidth 
-            det->bbox[0] = (col - 0.5f + 2.0f * Logist(curInput[idx + k * info_len_i * total_grid + 0 * total_grid])) * netwidth / yoloWidth;
-            det->bbox[1] = (row - 0.5f + 2.0f * Logist(curInput[idx + k * info_len_i * total_grid + 1 * total_grid])) * netheight / yoloHeight;
-            // printf("k:%d yoloHeight:%d yoloWidth:%d idx:%d row:%d col:%d det->bbox[0]:%f det->bbox[1]:%f\n", k, yoloHeight, yoloWidth, idx, row, col, det->bbox[0], det->bbox[1]);
-            // W: (Pw * e^tw) / FeaturemapW * netwidth  
-            // v5: https://github.com/ultralytics/yolov5/issues/471
-            det->bbox[2] = 2.0f * Logist(curInput[idx + k * info_len_i * total_grid + 2 * total_grid]);
-            det->bbox[2] = det->bbox[2] * det->bbox[2] * anchors[2 * k];
-            det->bbox[3] = 2.0f * Logist(curInput[idx + k * info_len_i * total_grid + 3 * total_grid]);
-            det->bbox[3] = det->bbox[3] * det->bbox[3] * anchors[2 * k + 1];
-            det->conf = max_cls_prob;
-            det->class_id = class_id;
+            if (count >= params.max_out) return;
+            Detection* dst = (Detection*)(res_count + 1) + count;
+            *dst = det;
         }
-    } 
+    }
 
-    void YoloLayerPlugin::forwardGpu(const float *const * inputs, float* output, cudaStream_t stream, int batchSize)
+    // 特征图宽高取自本次推理的输入维度[N, C, H, W]; 下采样倍数由构建时的网络尺寸和特征图尺寸确定
+    void YoloLayerPlugin::forwardGpu(const PluginTensorDesc* inputDesc, const void *const * inputs, float* output, cudaStream_t stream)
     {
-        int outputElem = 1 + mMaxOutObject * sizeof(Detection) / sizeof(float);
-        for (int idx = 0; idx < batchSize; ++idx) {
-            CUDA_CHECK(cudaMemset(output + idx * outputElem, 0, sizeof(float)));
-        }
-        int numElem = 0;
-        for (unsigned int i = 0; i < mYoloKernel.size(); ++i)
+        int batchSize = inputDesc[0].dims.d[0];
+        DecodeParams params;
+        params.num_heads = mKernelCount;
+        params.batch = batchSize;
+        params.classes = mClassCount;
+        params.net_width = inputDesc[0].dims.d[3] * (mYoloV5NetWidth / mYoloKernel[0].width);
+        params.net_height = inputDesc[0].dims.d[2] * (mYoloV5NetHeight / mYoloKernel[0].height);
+        params.max_out = mMaxOutObject;
+        params.output_elem = 1 + mMaxOutObject * sizeof(Detection) / sizeof(float);
+        params.layout = decode_layout(inputDesc[0].format);
+        int cells = 0;
+        for (int i = 0; i < mKernelCount; ++i)
         {
             const auto& yolo = mYoloKernel[i];
-            numElem = yolo.width*yolo.height*batchSize; // 每个尺度特征图的cell数量
-            if (numElem < mThreadCount)
-                mThreadCount = numElem;
-
-            // printf("Net: %d  %d \n", mYoloV5NetWidth, mYoloV5NetHeight);
-            CalDetection <<< (yolo.width*yolo.height*batchSize + mThreadCount - 1) / mThreadCount, mThreadCount >>>
-                (inputs[i], output, numElem, mYoloV5NetWidth, mYoloV5NetHeight, mMaxOutObject, yolo.width, yolo.height, (float *)mAnchor[i], mClassCount, outputElem);
+            params.inputs[i] = inputs[i];
+            params.heads[i].width = inputDesc[i].dims.d[3];
+            params.heads[i].height = inputDesc[i].dims.d[2];
+            params.heads[i].cell_offset = cells;
+            memcpy(params.heads[i].anchors, yolo.anchors, sizeof(yolo.anchors));
+            cells += params.heads[i].width * params.heads[i].height;
+        }
+        params.cells_per_image = cells;
+
+        // 每张图的计数器是输出的第0个float, 间隔output_elem, 用一次2D memset在同一个stream上全部清零
+        CUDA_CHECK(cudaMemset2DAsync(output, params.output_elem * sizeof(float), 0, sizeof(float), batchSize, stream));
+        LaunchGeometry g = decode_geometry(params, mThreadCount);
+        if (inputDesc[0].type == DataType::kHALF) {
+            CalDetection<half_bits> <<< g.blocks, g.threads, 0, stream >>> (params, output);
+        } else {
+            CalDetection<float> <<< g.blocks, g.threads, 0, stream >>> (params, output);
         }
     }
 
 
-    int YoloLayerPlugin::enqueue(int batchSize, const void*const * inputs, void** outputs, void* workspace, cudaStream_t stream)
+    int YoloLayerPlugin::enqueue(const PluginTensorDesc* inputDesc, const PluginTensorDesc* outputDesc, const void* const* inputs, void* const* outputs, void* workspace, cudaStream_t stream)
     {
-        forwardGpu((const float *const *)inputs, (float*)outputs[0], stream, batchSize);
+        forwardGpu(inputDesc, inputs, (float*)outputs[0], stream);
         return 0;
     }
 
@@ -281,7 +260,7 @@ namespace nvinfer1
 
     const char* YoloPluginCreator::getPluginVersion() const
     {
-        return "1";
+        return "2";
     }
 
     const PluginFieldCollection* YoloPluginCreator::getFieldNames()
@@ -289,17 +268,22 @@ namespace nvinfer1
         return &mFC;
     }
 
-    IPluginV2IOExt* YoloPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
+    IPluginV2DynamicExt* YoloPluginCreator::createPlugin(const char* name, const PluginFieldCollection* fc)
     {
         int class_count = -1;
         int input_w = -1;
         int input_h = -1;
         int max_output_object_count = -1;
-        std::vector<Yolo::YoloKernel> yolo_kernels(4); // 4个head(xl,l,m,s)
-
         const PluginField* fields = fc->fields; // pluginMultidata: [name, data, type, length]
+        int num_heads = 0; // yolodata<k>字段数, 即检测head数
+        for (int i = 0; i < fc->nbFields; i++) {
+            if (strstr(fields[i].name, "yolodata") != NULL) num_heads++;
+        }
+        assert(num_heads > 0 && num_heads <= MAX_HEADS);
+        std::vector<Yolo::YoloKernel> yolo_kernels(num_heads); // stride从大到小
+
         // 提取pluginMultidata的输入宽高和anchor参数
-        for (int i = 0; i < fc->nbFields; i++) { // nbFields=5
+        for (int i = 0; i < fc->nbFields; i++) { // nbFields=1+num_heads
             if (strcmp(fields[i].name, "netdata") == 0) { // 网络参数
                 assert(fields[i].type == PluginFieldType::kFLOAT32);
                 int *tmp = (int*)(fields[i].data);
@@ -313,11 +297,15 @@ namespace nvinfer1
                 YoloKernel kernel;
                 kernel.width = tmp[0]; // 特征图宽度
                 kernel.height = tmp[1]; // 特征图高度
-                for (int j = 0; j < fields[i].length - 2; j++) {
+                // 每个head正好CHECK_COUNT对anchor(w, h): 多了会写出kernel.anchors, 少了kernel会读到未赋值的anchor
+                assert(fields[i].length - 2 == CHECK_COUNT * 2);
+                for (int j = 0; j < fields[i].length - 2 && j < CHECK_COUNT * 2; j++) {
                     kernel.anchors[j] = tmp[j + 2]; // anchor尺寸
                 }
-                // fields[i].name[8]: 1,2,3,4->0,1,2,3->3,2,1,0(s,m,l,xl)
-                yolo_kernels[3 - (fields[i].name[8] - '1')] = kernel;
+                // yolodata<k>, k=1为stride最小的head: k=1..num_heads -> num_heads-1..0
+                int k = atoi(fields[i].name + 8);
+                assert(k >= 1 && k <= num_heads);
+                yolo_kernels[num_heads - k] = kernel;
             }
         }
         assert(class_count && input_w && input_h && max_output_object_count);
@@ -326,7 +314,7 @@ namespace nvinfer1
         return obj;
     }
 
-    IPluginV2IOExt* YoloPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
+    IPluginV2DynamicExt* YoloPluginCreator::deserializePlugin(const char* name, const void* serialData, size_t serialLength)
     {
         // This object will be deleted when the network is destroyed, which will
         // call YoloLayerPlugin::destroy()
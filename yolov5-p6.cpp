@@ -1,13 +1,39 @@
 #include <iostream>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
 #include "cuda_utils.h"
 #include "logging.h"
 #include "common.hpp"
 #include "utils.h"
 #include "calibrator.h"
+#include "shm_ring.h"
+#include "tracker.h"
+#include "scheduler.h"
+#include "tiling.h"
+#include "roi.h"
+#include "letterbox.h"
+#include "layer_profile.h"
+#include "trt_bindings.h"
+#include "yolov5_graph.h"
+#include "graph_trt.h"
+#include "graph_cpu.h"
+#include "timing_cache.h"
+#include "precision_search.h"
+#include "metrics.h"
+#include "detection_file.h"
+#include "device_dispatch.h"
+#ifdef USE_FFMPEG
+#include "ffmpeg_source.h"
+#endif
 
 #define USE_FP32  // set USE_INT8 or USE_FP16 or USE_FP32
 #define DEVICE 0  // GPU id
+// 多GPU: 逗号分隔的GPU id(如"0,1,2,3"), 每个GPU反序列化一份同一个engine(需为相同型号的GPU), shm:/ffmpeg:输入的各路视频源按负载分到各GPU(device_dispatch.h)
+// 空字符串时只用DEVICE. 某个GPU上预计的排队等待超过DISPATCH_MAX_WAIT_MS时, 其上的一路迁到更空闲的GPU; 0为按源数固定分配, 不迁移
+#define DEVICES ""
+#define DISPATCH_MAX_WAIT_MS 50
 // 过滤规则: 
 // 1.先在网络输出时进行一次过滤，将前景置信(box_prob)<0.1(IGNORE_THRESH)滤掉，同时conf=obj_conf*cls_conf, box的类别选取概率(conf)最大的类别
 // 此规则可在yololayer.cu的CalDetection中修改
@@ -15,121 +41,123 @@
 #define NMS_THRESH 0.5 // iou阈值
 #define CONF_THRESH 0.45
 #define BATCH_SIZE 16
+// #define USE_GPU_NMS  // 在engine中YoloLayer之后加入NMS插件(阈值为构建时的CONF_THRESH/NMS_THRESH), 输出每张图前NMS_TOP_N个框
+#define NMS_TOP_N 100
+// 一个batch的输出超过该字节数时两阶段回传(先拷回各图的数量, 再只拷回用到的行), 否则一次全量拷贝; USE_GPU_NMS时输出很小, 总是全量拷贝
+// 第二次拷贝多一次同步(约10us), 按readback_bench的模型(12GB/s, 10us)省下的字节超过约120KB才划算: batch 8(192KB)起的稀疏/一般场景
+#define COMPACT_READBACK_MIN_BYTES (180 * 1024)
+// 跳帧模式: 每路最多每KEYFRAME_MAX_INTERVAL帧推理一次(1为每帧推理), 运动分数超过MOTION_THRESH时立即推理
+// 间隔会自动调整, 使每路每秒占用的GPU时间不超过GPU_BUDGET_MS
+#define KEYFRAME_MAX_INTERVAL 1
+#define MOTION_THRESH 0.04
+#define GPU_BUDGET_MS 100
+// 切片模式: 1时大图切成重叠的INPUT_W x INPUT_H小块(加一张全局缩小视图)分批推理, 跨块用NMS合并
+#define TILE_MODE 0
+#define TILE_OVERLAP 0.2
+// 每路视频源的多边形ROI配置(格式见roi.h), 文件不存在时使用整帧
+#define ROI_FILE "roi.txt"
+// rect推理: 1时每路按长边MAX_INPUT_SIZE缩放, 输入取最小的64倍数canvas(padding最少), 相同canvas的源组成一个batch
+// 0时所有源都letterbox到固定的INPUT_W x INPUT_H
+#define RECT_INFER 1
+// 构建时的tactic计时缓存文件(TensorRT 8+, 见timing_cache.h), 同一GPU型号的所有构建共用; 空字符串时不使用
+#define TIMING_CACHE "yolov5.timing.cache"
+// USE_INT8时的混合精度配置(由./yolov5_cpu -q生成, 见precision_search.h): 列出的model.N模块保持FP16/FP32, 文件不存在时全部INT8
+#define PRECISION_PROFILE "precision_profile.txt"
+// ffmpeg:视频源(cmake -DWITH_FFMPEG=ON)每路的默认解码线程数, 0为按CPU核数自动; 单路可用"地址@N"指定
+#define FFMPEG_DECODE_THREADS 0
+// 运行指标(metrics.h): -d时在127.0.0.1:METRICS_PORT提供Prometheus文本(0为关闭), METRICS_FILE非空时每METRICS_DUMP_SEC秒写入该文件
+#define METRICS_PORT 9464
+#define METRICS_FILE ""
+#define METRICS_DUMP_SEC 10
 
 // stuff we know about the network and the input/output blobs
 static const int INPUT_H = Yolo::INPUT_H;
 static const int INPUT_W = Yolo::INPUT_W;
 static const int CLASS_NUM = Yolo::CLASS_NUM;
+#ifdef USE_GPU_NMS
+static const int OUTPUT_SIZE = NMS_TOP_N * sizeof(Yolo::Detection) / sizeof(float) + 1;  // NmsLayer outputs no more than NMS_TOP_N boxes
+#else
 static const int OUTPUT_SIZE = Yolo::MAX_OUTPUT_BBOX_COUNT * sizeof(Yolo::Detection) / sizeof(float) + 1;  // we assume the yololayer outputs no more than MAX_OUTPUT_BBOX_COUNT boxes that conf >= 0.1
+#endif
+// explicit batch + 动态尺寸: 每个优化profile覆盖batch 1..BATCH_SIZE、宽高[MIN_INPUT_SIZE, MAX_INPUT_SIZE](需为64的倍数)
+// PROFILE_SHAPES为各profile调优时使用的输入高宽(opt): 横向、纵向、正方形
+static const int MIN_INPUT_SIZE = 64;
+static const int MAX_INPUT_SIZE = INPUT_H > INPUT_W ? INPUT_H : INPUT_W;
+static const int PROFILE_SHAPES[][2] = { { INPUT_H, INPUT_W }, { INPUT_W, INPUT_H }, { MAX_INPUT_SIZE, MAX_INPUT_SIZE } };
+static const int NUM_PROFILES = sizeof(PROFILE_SHAPES) / sizeof(PROFILE_SHAPES[0]);
 const char* INPUT_BLOB_NAME = "data";
 const char* OUTPUT_BLOB_NAME = "prob";
 static Logger gLogger;
 
-static int get_width(int x, float gw, int divisor = 8) {
-    //return math.ceil(x / divisor) * divisor
-    if (int(x * gw) % divisor == 0) {
-        return int(x * gw);
+#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR >= 2)
+// engine中输入为layer的reformat层数, 层名形如"Reformatting CopyNode for Input Tensor 0 to <layer>", 默认的kLAYER_NAMES_ONLY即可
+static int count_reformats_before(ICudaEngine& engine, const std::string& layer) {
+    IEngineInspector* inspector = engine.createEngineInspector();
+    if (!inspector) return 0;
+    const std::string target = " to " + layer;
+    int n = 0;
+    for (int i = 0; i < engine.getNbLayers(); i++) {
+        const char* info = inspector->getLayerInformation(i, LayerInformationFormat::kONELINE);
+        if (info && strstr(info, "Reformat") && strstr(info, target.c_str())) n++;
     }
-    return (int(x * gw / divisor) + 1) * divisor;
+    delete inspector;
+    return n;
 }
+#endif
 
-static int get_depth(int x, float gd) {
-    if (x == 1) {
-        return 1;
-    } else {
-        return round(x * gd) > 1 ? round(x * gd) : 1;
-    }
-}
-
-
-ICudaEngine* build_engine_p6(unsigned int maxBatchSize, IBuilder* builder, IBuilderConfig* config, DataType dt, float& gd, float& gw, std::string& wts_name) {
-    // IBuilder::createNetworkV2(0U)创建一个空的INetWork
-    INetworkDefinition* network = builder->createNetworkV2(0U);
+ICudaEngine* build_engine(unsigned int maxBatchSize, IBuilder* builder, IBuilderConfig* config, DataType dt, const ModelConfig& model, std::string& wts_name) {
+    // IBuilder::createNetworkV2(kEXPLICIT_BATCH)创建一个空的INetWork, batch维度显式出现在tensor中
+    const auto explicitBatch = 1U << static_cast<uint32_t>(NetworkDefinitionCreationFlag::kEXPLICIT_BATCH);
+    INetworkDefinition* network = builder->createNetworkV2(explicitBatch);
 
-    // Create input tensor of shape {3, INPUT_H, INPUT_W} with name INPUT_BLOB_NAME
+    // Create input tensor of shape {-1, 3, -1, -1} with name INPUT_BLOB_NAME, batch和宽高在运行时确定
     // INetworkDefinition::addInput(名称，数据类型，维度)：为网络增加一个输入
-    ITensor* data = network->addInput(INPUT_BLOB_NAME, dt, Dims3{ 3, INPUT_H, INPUT_W });
+    ITensor* data = network->addInput(INPUT_BLOB_NAME, dt, Dims4{ -1, 3, -1, -1 });
     assert(data);
 
-    std::map<std::string, Weights> weightMap = loadWeights(wts_name);
-    // Weights emptywts{ DataType::kFLOAT, nullptr, 0 };
-
-    /* ------ yolov5 backbone------ */
-    auto focus0 = focus(network, weightMap, *data, 3, get_width(64, gw), 3, "model.0");
-    auto conv1 = convBlock(network, weightMap, *focus0->getOutput(0), get_width(128, gw), 3, 2, 1, "model.1");
-    auto c3_2 = C3(network, weightMap, *conv1->getOutput(0), get_width(128, gw), get_width(128, gw), get_depth(3, gd), true, 1, 0.5, "model.2");
-    auto conv3 = convBlock(network, weightMap, *c3_2->getOutput(0), get_width(256, gw), 3, 2, 1, "model.3");
-    auto c3_4 = C3(network, weightMap, *conv3->getOutput(0), get_width(256, gw), get_width(256, gw), get_depth(9, gd), true, 1, 0.5, "model.4");
-    auto conv5 = convBlock(network, weightMap, *c3_4->getOutput(0), get_width(512, gw), 3, 2, 1, "model.5");
-    auto c3_6 = C3(network, weightMap, *conv5->getOutput(0), get_width(512, gw), get_width(512, gw), get_depth(9, gd), true, 1, 0.5, "model.6");
-    auto conv7 = convBlock(network, weightMap, *c3_6->getOutput(0), get_width(768, gw), 3, 2, 1, "model.7");
-    auto c3_8 = C3(network, weightMap, *conv7->getOutput(0), get_width(768, gw), get_width(768, gw), get_depth(3, gd), true, 1, 0.5, "model.8");
-    auto conv9 = convBlock(network, weightMap, *c3_8->getOutput(0), get_width(1024, gw), 3, 2, 1, "model.9");
-    auto spp10 = SPP(network, weightMap, *conv9->getOutput(0), get_width(1024, gw), get_width(1024, gw), 3, 5, 7, "model.10");
-    auto c3_11 = C3(network, weightMap, *spp10->getOutput(0), get_width(1024, gw), get_width(1024, gw), get_depth(3, gd), false, 1, 0.5, "model.11");
-
-    /* ------ yolov5 head6 ------ */
-    auto conv12 = convBlock(network, weightMap, *c3_11->getOutput(0), get_width(768, gw), 1, 1, 1, "model.12");
-    // INetworkDefinition::addResize(输入tensor)：增加一层resize层
-    auto upsample13 = network->addResize(*conv12->getOutput(0));
-    assert(upsample13);
-    upsample13->setResizeMode(ResizeMode::kNEAREST);
-    upsample13->setOutputDimensions(c3_8->getOutput(0)->getDimensions());
-    ITensor* inputTensors14[] = { upsample13->getOutput(0), c3_8->getOutput(0) };
-    auto cat14 = network->addConcatenation(inputTensors14, 2);
-    auto c3_15 = C3(network, weightMap, *cat14->getOutput(0), get_width(1536, gw), get_width(768, gw), get_depth(3, gd), false, 1, 0.5, "model.15");
-    
-    auto conv16 = convBlock(network, weightMap, *c3_15->getOutput(0), get_width(512, gw), 1, 1, 1, "model.16");
-    auto upsample17 = network->addResize(*conv16->getOutput(0));
-    assert(upsample17);
-    upsample17->setResizeMode(ResizeMode::kNEAREST);
-    upsample17->setOutputDimensions(c3_6->getOutput(0)->getDimensions());
-    ITensor* inputTensors18[] = { upsample17->getOutput(0), c3_6->getOutput(0) };
-    auto cat18 = network->addConcatenation(inputTensors18, 2);
-    auto c3_19 = C3(network, weightMap, *cat18->getOutput(0), get_width(1024, gw), get_width(512, gw), get_depth(3, gd), false, 1, 0.5, "model.19");
-    
-    auto conv20 = convBlock(network, weightMap, *c3_19->getOutput(0), get_width(256, gw), 1, 1, 1, "model.20");
-    auto upsample21 = network->addResize(*conv20->getOutput(0));
-    assert(upsample21);
-    upsample21->setResizeMode(ResizeMode::kNEAREST);
-    upsample21->setOutputDimensions(c3_4->getOutput(0)->getDimensions());
-    ITensor* inputTensors21[] = { upsample21->getOutput(0), c3_4->getOutput(0) };
-    auto cat22 = network->addConcatenation(inputTensors21, 2);
-    auto c3_23 = C3(network, weightMap, *cat22->getOutput(0), get_width(512, gw), get_width(256, gw), get_depth(3, gd), false, 1, 0.5, "model.23");
-
-    
-    
-    auto conv24 = convBlock(network, weightMap, *c3_23->getOutput(0), get_width(256, gw), 3, 2, 1, "model.24");
-    ITensor* inputTensors25[] = { conv24->getOutput(0), conv20->getOutput(0) };
-    auto cat25 = network->addConcatenation(inputTensors25, 2);
-    auto c3_26 = C3(network, weightMap, *cat25->getOutput(0), get_width(1024, gw), get_width(512, gw), get_depth(3, gd), false, 1, 0.5, "model.26");
-    
-    
-    auto conv27 = convBlock(network, weightMap, *c3_26->getOutput(0), get_width(512, gw), 3, 2, 1, "model.27");
-    ITensor* inputTensors28[] = { conv27->getOutput(0), conv16->getOutput(0) };
-    auto cat28 = network->addConcatenation(inputTensors28, 2);
-    auto c3_29 = C3(network, weightMap, *cat28->getOutput(0), get_width(1536, gw), get_width(768, gw), get_depth(3, gd), false, 1, 0.5, "model.29");
-    
-    auto conv30 = convBlock(network, weightMap, *c3_29->getOutput(0), get_width(768, gw), 3, 2, 1, "model.30");
-    ITensor* inputTensors31[] = { conv30->getOutput(0), conv12->getOutput(0) };
-    auto cat31 = network->addConcatenation(inputTensors31, 2);
-    auto c3_32 = C3(network, weightMap, *cat31->getOutput(0), get_width(2048, gw), get_width(1024, gw), get_depth(3, gd), false, 1, 0.5, "model.32");
-    
-    // yolo layer small
-    IConvolutionLayer* det_s = network->addConvolutionNd(*c3_23->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{ 1, 1 }, weightMap["model.33.m.0.weight"], weightMap["model.33.m.0.bias"]);
-    //yolo layer medium
-    IConvolutionLayer* det_m = network->addConvolutionNd(*c3_26->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{ 1, 1 }, weightMap["model.33.m.1.weight"], weightMap["model.33.m.1.bias"]);
-    //yolo layer large
-    IConvolutionLayer* det_l = network->addConvolutionNd(*c3_29->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{ 1, 1 }, weightMap["model.33.m.2.weight"], weightMap["model.33.m.2.bias"]);
-    //yolo layer xlarge
-    IConvolutionLayer* det_xl = network->addConvolutionNd(*c3_32->getOutput(0), 3 * (Yolo::CLASS_NUM + 5), DimsHW{ 1, 1 }, weightMap["model.33.m.3.weight"], weightMap["model.33.m.3.bias"]);
-
-    auto yolo = addYoLoLayer(network, weightMap, det_s, det_m, det_l, det_xl);
-    yolo->getOutput(0)->setName(OUTPUT_BLOB_NAME);
-    network->markOutput(*yolo->getOutput(0));
+    // 权重解析和BN折叠在线程池上并行, convBlock中不再有scale节点
+    // 所有权重和派生常量都分配在arena中, 函数返回时随arena一起释放
+    WeightArena arena;
+    ArenaScope arena_scope(arena);
+    ThreadPool pool;
+    auto t_weights = std::chrono::high_resolution_clock::now();
+    std::map<std::string, Weights> weightMap = loadWeights(wts_name, &pool);
+    fuseConvBatchNorm(weightMap, pool, 1e-3);
+    std::cout << "Weights ready in " << std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - t_weights).count() << " ms" << std::endl;
+    // 网络按模型配置的层表生成与后端无关的图(yolov5_graph.h), 再降到TensorRT; 同一张图也可以由graph_cpu.h在CPU上执行
+    // 每个模块的层命名为"model.N:<类型>/<序号>", 逐层性能分析(-p)时据此归并到model.N
+    ir::Graph graph;
+    build_yolov5(graph, weight_table(weightMap), model, INPUT_W, INPUT_H, Yolo::MAX_OUTPUT_BBOX_COUNT);
+    const ir::YoloParams& yolo_params = graph.node(graph.outputs()[0]).yolo;
+    std::cout << "Model: " << model.layers.size() << " layers, " << yolo_params.heads.size() << " detection heads, strides";
+    for (const auto& head : yolo_params.heads) std::cout << " " << head.stride;
+    std::cout << std::endl;
+    // 类别数随engine保存, 运行时host端nms按engine的类别数分派(engine_class_count)
+    network->setName(engine_network_name(model.nc).c_str());
+    ITensor* yolo = lower_to_trt(graph, network, data)[0];
+    std::string yolo_layer;
+    for (int i = 0; i < network->getNbLayers(); i++) {
+        if (network->getLayer(i)->getOutput(0) == yolo) yolo_layer = network->getLayer(i)->getName();
+    }
+#ifdef USE_GPU_NMS
+    auto nms = addNmsLayer(network, *yolo, CONF_THRESH, NMS_THRESH, NMS_TOP_N);
+    name_module_layers(network, network->getNbLayers() - 1, "nms", "NmsLayer");
+    ITensor* output = nms->getOutput(0);
+#else
+    ITensor* output = yolo;
+#endif
+    output->setName(OUTPUT_BLOB_NAME);
+    network->markOutput(*output);
 
     // Build engine
-    builder->setMaxBatchSize(maxBatchSize);
+    // 每个profile: min为1张MIN_INPUT_SIZE x MIN_INPUT_SIZE, opt为maxBatchSize张PROFILE_SHAPES[k], max为maxBatchSize张MAX_INPUT_SIZE x MAX_INPUT_SIZE
+    for (int k = 0; k < NUM_PROFILES; k++) {
+        IOptimizationProfile* profile = builder->createOptimizationProfile();
+        profile->setDimensions(INPUT_BLOB_NAME, OptProfileSelector::kMIN, Dims4{ 1, 3, MIN_INPUT_SIZE, MIN_INPUT_SIZE });
+        profile->setDimensions(INPUT_BLOB_NAME, OptProfileSelector::kOPT, Dims4{ (int)maxBatchSize, 3, PROFILE_SHAPES[k][0], PROFILE_SHAPES[k][1] });
+        profile->setDimensions(INPUT_BLOB_NAME, OptProfileSelector::kMAX, Dims4{ (int)maxBatchSize, 3, MAX_INPUT_SIZE, MAX_INPUT_SIZE });
+        config->addOptimizationProfile(profile);
+    }
     config->setMaxWorkspaceSize(16 * (1 << 20));  // 16MB
 
 
@@ -141,31 +169,56 @@ ICudaEngine* build_engine_p6(unsigned int maxBatchSize, IBuilder* builder, IBuil
     config->setFlag(BuilderFlag::kINT8);
     Int8EntropyCalibrator2* calibrator = new Int8EntropyCalibrator2(1, INPUT_W, INPUT_H, "./coco_calib/", "int8calib.table", INPUT_BLOB_NAME);
     config->setInt8Calibrator(calibrator);
+    // 动态尺寸下标定使用固定的1 x 3 x INPUT_H x INPUT_W
+    IOptimizationProfile* calibProfile = builder->createOptimizationProfile();
+    calibProfile->setDimensions(INPUT_BLOB_NAME, OptProfileSelector::kMIN, Dims4{ 1, 3, INPUT_H, INPUT_W });
+    calibProfile->setDimensions(INPUT_BLOB_NAME, OptProfileSelector::kOPT, Dims4{ 1, 3, INPUT_H, INPUT_W });
+    calibProfile->setDimensions(INPUT_BLOB_NAME, OptProfileSelector::kMAX, Dims4{ 1, 3, INPUT_H, INPUT_W });
+    config->setCalibrationProfile(calibProfile);
+    std::map<std::string, std::string> precision = read_precision_profile(PRECISION_PROFILE);
+    if (!precision.empty()) {
+        config->setFlag(BuilderFlag::kFP16);
+#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR >= 2)
+        config->setFlag(BuilderFlag::kOBEY_PRECISION_CONSTRAINTS);
+#else
+        config->setFlag(BuilderFlag::kSTRICT_TYPES);
+#endif
+        int pinned = apply_precision_profile(network, precision);
+        std::cout << "Mixed precision (" << PRECISION_PROFILE << "): " << precision.size() << " modules, " << pinned << " layers kept out of INT8" << std::endl;
+    }
 #endif
 
+    // 缓存中已有的层配置不再重新计时tactic
+    BuildTimingCache timing_cache(config, TIMING_CACHE);
     std::cout << "Building engine, please wait for a while..." << std::endl;
+    auto t_build = std::chrono::high_resolution_clock::now();
     ICudaEngine* engine = builder->buildEngineWithConfig(*network, *config);
-    std::cout << "Build engine successfully!" << std::endl;
+    std::cout << "Build engine successfully in " << std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - t_build).count() << " s!" << std::endl;
+    if (engine) timing_cache.save();
+#if NV_TENSORRT_MAJOR > 8 || (NV_TENSORRT_MAJOR == 8 && NV_TENSORRT_MINOR >= 2)
+    // FP16 engine中head可以直接以FP16(kLINEAR/kCHW2/kHWC8)输入YoloLayer, 这里确认插件前实际剩下的reformat层
+    if (engine) std::cout << "YoloLayer: " << count_reformats_before(*engine, yolo_layer) << " reformat layers before the plugin" << std::endl;
+#endif
 
     // Don't need the network any more
     network->destroy();
 
-    // Release host memory
-    for (auto& mem : weightMap)
-    {
-        free((void*)(mem.second.values));
-    }
+    // Release host memory: weightMap中的指针都属于arena, 返回时一次性释放
+    // 不同模型大小(s/m/l/x)构建时的主机内存占用在这里对比
+    std::cout << "Builder host memory (gd=" << model.depth_multiple << ", gw=" << model.width_multiple << "): weights " << arena.used() / (1024.0 * 1024.0)
+              << " MB in " << arena.blocks() << " arena blocks, arena peak " << arena.peakReserved() / (1024.0 * 1024.0)
+              << " MB, process peak RSS " << peak_rss_mb() << " MB" << std::endl;
 
     return engine;
 }
 
-void APIToModel(unsigned int maxBatchSize, IHostMemory** modelStream, float& gd, float& gw, std::string& wts_name) {
+void APIToModel(unsigned int maxBatchSize, IHostMemory** modelStream, const ModelConfig& model, std::string& wts_name) {
     // Create builder
     IBuilder* builder = createInferBuilder(gLogger);
     IBuilderConfig* config = builder->createBuilderConfig();
 
     // Create model to populate the network, then set the outputs and create an engine
-    ICudaEngine* engine = build_engine_p6(maxBatchSize, builder, config, DataType::kFLOAT, gd, gw, wts_name);
+    ICudaEngine* engine = build_engine(maxBatchSize, builder, config, DataType::kFLOAT, model, wts_name);
     assert(engine != nullptr);
 
     // Serialize the engine
@@ -177,41 +230,954 @@ void APIToModel(unsigned int maxBatchSize, IHostMemory** modelStream, float& gd,
     config->destroy();
 }
 
-void doInference(IExecutionContext& context, cudaStream_t& stream, void **buffers, float* input, float* output, int batchSize) {
-    // DMA input batch data to device, infer on the batch asynchronously, and DMA output back to host
-    CUDA_CHECK(cudaMemcpyAsync(buffers[0], input, batchSize * 3 * INPUT_H * INPUT_W * sizeof(float), cudaMemcpyHostToDevice, stream));
-    context.enqueue(batchSize, buffers, stream, nullptr);
-    CUDA_CHECK(cudaMemcpyAsync(output, buffers[1], batchSize * OUTPUT_SIZE * sizeof(float), cudaMemcpyDeviceToHost, stream));
-    cudaStreamSynchronize(stream);
+// 推理流水线的指标, 第一次调用时注册; 耗时的原始单位为微秒, 导出为秒
+struct PipelineMetrics {
+    Histogram& infer_latency = metrics().histogram("yolov5_inference_seconds", "Engine latency per batch: H2D copy, enqueue and D2H readback", "", 1e-6);
+    Histogram& batch_size = metrics().histogram("yolov5_inference_batch_size", "Images per engine call");
+    Counter& images = metrics().counter("yolov5_inference_images_total", "Images run through the engine");
+    Counter& d2h_bytes = metrics().counter("yolov5_d2h_bytes_total", "Bytes read back from the engine output");
+    Gauge& queue_depth = metrics().gauge("yolov5_inference_queue_depth", "Frames waiting for the current engine call");
+    Histogram& yolo_boxes = metrics().histogram("yolov5_yolo_boxes", "Boxes per image in the engine output (YoloLayer candidates, or NMS output with USE_GPU_NMS)");
+    Counter& yolo_overflow = metrics().counter("yolov5_yolo_overflow_total", "Images with more YoloLayer candidates than MAX_OUTPUT_BBOX_COUNT, the rest were dropped");
+    Histogram& nms_latency = metrics().histogram("yolov5_nms_seconds", "Host NMS latency per image", "", 1e-6);
+    Counter& detections = metrics().counter("yolov5_detections_total", "Detections after NMS");
+};
+
+static PipelineMetrics& pipeline_metrics() {
+    static PipelineMetrics m;
+    return m;
+}
+
+// 每路视频源的指标, 标签source="<序号>"
+struct SourceMetrics {
+    explicit SourceMetrics(int source)
+        : labels("source=\"" + std::to_string(source) + "\""),
+          frames(metrics().counter("yolov5_source_frames_total", "Frames read from the source", labels)),
+          inferred(metrics().counter("yolov5_source_inferred_total", "Frames that went through the engine", labels)),
+          dropped(metrics().counter("yolov5_source_dropped_total", "Frames lost before reading (overwritten shm slots)", labels)),
+          fps(metrics().gauge("yolov5_source_fps", "Frames per second read from the source", labels)),
+          tracks(metrics().gauge("yolov5_source_tracks", "Active tracks", labels)),
+          interval(metrics().gauge("yolov5_source_keyframe_interval", "Current keyframe interval of the scheduler", labels)),
+          frame_latency(metrics().histogram("yolov5_frame_seconds", "Time from frame read to tracker update", labels, 1e-6)),
+          window_frames_(0) {}
+
+    // 每读到一帧调用, fps按约1秒的窗口更新
+    void on_frame() {
+        frames.inc();
+        auto now = std::chrono::steady_clock::now();
+        if (window_frames_++ == 0) window_start_ = now;
+        double dt = std::chrono::duration<double>(now - window_start_).count();
+        if (dt >= 1.0) {
+            fps.set((window_frames_ - 1) / dt);
+            window_frames_ = 1;
+            window_start_ = now;
+        }
+    }
+    // 跟踪器更新后调用, read_at为该帧读入的时间
+    void on_tracked(size_t num_tracks, std::chrono::steady_clock::time_point read_at) {
+        tracks.set(num_tracks);
+        frame_latency.observe((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - read_at).count());
+    }
+
+    std::string labels;
+    Counter& frames;
+    Counter& inferred;
+    Counter& dropped;
+    Gauge& fps;
+    Gauge& tracks;
+    Gauge& interval;
+    Histogram& frame_latency;
+
+private:
+    int window_frames_;
+    std::chrono::steady_clock::time_point window_start_;
+};
+
+// 输入为batchSize张连续存放的3 x input_h x input_w图像, input_h/input_w需为64的倍数
+// 输出超过COMPACT_READBACK_MIN_BYTES时两阶段回传: 先拷回每张图的检测数量, 再用一次2D拷贝只拷回batch中最多的那张图用到的行, 未用到的行不会被写入
+// 否则一次拷回全部输出. output的布局不变(每张图OUTPUT_SIZE个float). 返回本次D2H拷贝的字节数
+size_t doInference(IExecutionContext& context, cudaStream_t& stream, void **buffers, float* input, float* output, int batchSize, int input_h = INPUT_H, int input_w = INPUT_W) {
+    PipelineMetrics& pm = pipeline_metrics();
+    ScopedTimer timer(pm.infer_latency);
+
+    std::vector<void*> bindings = bind_buffers(context, INPUT_BLOB_NAME, OUTPUT_BLOB_NAME, buffers, batchSize, input_h, input_w);
+
+    // DMA input batch data to device, infer on the batch asynchronously
+    CUDA_CHECK(cudaMemcpyAsync(buffers[0], input, batchSize * 3 * input_h * input_w * sizeof(float), cudaMemcpyHostToDevice, stream));
+    context.enqueueV2(bindings.data(), stream, nullptr);
+    size_t bytes = full_readback_bytes(batchSize, OUTPUT_SIZE);
+#ifndef USE_GPU_NMS
+    if (bytes > COMPACT_READBACK_MIN_BYTES) {
+        static thread_local float counts[BATCH_SIZE]; // 多GPU时每个工作线程各一份
+        const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+        const int max_rows = (OUTPUT_SIZE - 1) / det_size;
+        const size_t pitch = OUTPUT_SIZE * sizeof(float);
+        CUDA_CHECK(cudaMemcpy2DAsync(counts, sizeof(float), buffers[1], pitch, sizeof(float), batchSize, cudaMemcpyDeviceToHost, stream));
+        CUDA_CHECK(cudaStreamSynchronize(stream));
+        int rows = 0;
+        for (int b = 0; b < batchSize; b++) rows = std::max(rows, std::min((int)counts[b], max_rows));
+        size_t width = (1 + rows * det_size) * sizeof(float);
+        CUDA_CHECK(cudaMemcpy2DAsync(output, pitch, buffers[1], pitch, width, batchSize, cudaMemcpyDeviceToHost, stream));
+        bytes = batchSize * sizeof(float) + batchSize * width;
+    } else
+#endif
+    {
+        CUDA_CHECK(cudaMemcpyAsync(output, buffers[1], bytes, cudaMemcpyDeviceToHost, stream));
+    }
+    CUDA_CHECK(cudaStreamSynchronize(stream));
+    for (int b = 0; b < batchSize; b++) {
+        const float count = output[(size_t)b * OUTPUT_SIZE];
+        // YoloLayer对每个候选框都累加计数(atomicAdd), 超过MAX_OUTPUT_BBOX_COUNT的框不写出; GPU NMS时计数为NMS的输出数
+        pm.yolo_boxes.observe((uint64_t)count);
+#ifndef USE_GPU_NMS
+        if ((int)count > Yolo::MAX_OUTPUT_BBOX_COUNT) pm.yolo_overflow.inc();
+#endif
+    }
+    pm.batch_size.observe(batchSize);
+    pm.images.inc(batchSize);
+    pm.d2h_bytes.inc(bytes);
+    return bytes;
+}
+
+// 反序列化engine后由engine_class_count设置
+static int engine_nc = CLASS_NUM;
+
+// engine中带NMS插件时输出已经是抑制后的结果, 只需拷贝
+static void run_nms(std::vector<Yolo::Detection>& res, float* output) {
+    PipelineMetrics& pm = pipeline_metrics();
+    {
+        ScopedTimer timer(pm.nms_latency);
+#ifdef USE_GPU_NMS
+        read_detections(res, output, NMS_TOP_N);
+#else
+        nms(res, output, CONF_THRESH, NMS_THRESH, engine_nc);
+#endif
+    }
+    pm.detections.inc(res.size());
+}
+
+// 读取ROI_FILE, 每路一项, 文件中没有配置的路为整帧
+// USE_GPU_NMS时engine输出已经是NMS之后的框, ROI只能在NMS之后过滤: 裁剪区域内、多边形外的框仍可能抑制多边形内的同类框
+static std::vector<Yolo::SourceRoi> load_rois(size_t sources) {
+    std::vector<Yolo::SourceRoi> rois;
+    if (read_roi_file(ROI_FILE, rois)) {
+        std::cout << "loaded ROI from " << ROI_FILE << std::endl;
+#ifdef USE_GPU_NMS
+        std::cout << "USE_GPU_NMS: ROI polygons are applied after the engine's NMS, boxes outside the polygons can still suppress boxes inside" << std::endl;
+#endif
+    }
+    rois.resize(sources);
+    return rois;
+}
+
+// 一张图的engine输出 -> 原图坐标(xyxy)的检测框: nms前丢掉中心不在ROI内的候选框, 再从裁剪区域的letterbox映射回原图
+// 没有裁剪的源(ffmpeg)传整帧的crop
+static void roi_detections(std::vector<Yolo::Detection>& res, float* output, const Yolo::SourceRoi& roi, const Yolo::RoiCrop& crop, const Yolo::Letterbox& lb) {
+    filter_roi(output, roi, crop, lb);
+    run_nms(res, output);
+    xywh2xyxy(res);
+    scale_coords(res, crop.w, crop.h, lb);
+    offset_coords(res, crop);
+}
+
+// 切片推理: 一帧的所有切片按BATCH_SIZE分批推理, res为原图坐标(xyxy)
+void infer_tiled(IExecutionContext& context, cudaStream_t& stream, void** buffers, float* data, float* prob, cv::Mat& img, std::vector<Yolo::Detection>& res) {
+    std::vector<Yolo::Tile> tiles = plan_tiles(img.cols, img.rows, INPUT_W, INPUT_H, TILE_OVERLAP, true);
+    res.clear();
+    for (size_t first = 0; first < tiles.size(); first += BATCH_SIZE) {
+        int n = std::min((int)(tiles.size() - first), BATCH_SIZE);
+        for (int i = 0; i < n; i++) {
+            const Yolo::Tile& t = tiles[first + i];
+            cv::Mat crop = img(cv::Rect(t.x, t.y, t.w, t.h));
+            cv::Mat pr_img = preprocess_img(crop, INPUT_W, INPUT_H); // letterbox, 原图足够大时切片本身就是INPUT_W x INPUT_H
+            blob_from_img(pr_img, &data[i * 3 * INPUT_H * INPUT_W], INPUT_W, INPUT_H);
+        }
+        doInference(context, stream, buffers, data, prob, n);
+        for (int i = 0; i < n; i++) {
+            std::vector<Yolo::Detection> tile_res;
+            run_nms(tile_res, &prob[i * OUTPUT_SIZE]);
+            tile_to_frame(tile_res, tiles[first + i]);
+            res.insert(res.end(), tile_res.begin(), tile_res.end());
+        }
+    }
+    merge_tiles(res, NMS_THRESH, Yolo::TileMerge::kNMS);
+}
+
+static Yolo::Letterbox make_letterbox(int img_w, int img_h) {
+#if RECT_INFER
+    return rect_letterbox(img_w, img_h, MAX_INPUT_SIZE);
+#else
+    return fixed_letterbox(img_w, img_h, INPUT_W, INPUT_H);
+#endif
+}
+
+// canvas尺寸相同的图像组成一个batch(每批最多BATCH_SIZE张), 不同尺寸分开推理
+// canvases[i]为按lbs[i] letterbox后的图像, 输出写到prob[i * OUTPUT_SIZE]. 返回D2H拷贝的字节数
+size_t infer_canvases(IExecutionContext& context, cudaStream_t& stream, void** buffers, float* data, float* prob, const std::vector<cv::Mat>& canvases, const std::vector<Yolo::Letterbox>& lbs) {
+    static thread_local float group_prob[BATCH_SIZE * OUTPUT_SIZE];
+    const int det_size = sizeof(Yolo::Detection) / sizeof(float);
+    assert((int)canvases.size() <= BATCH_SIZE);
+    std::vector<std::vector<int>> groups;
+    group_by_canvas(lbs, groups);
+    size_t bytes = 0;
+    for (const auto& group : groups) {
+        int canvas_w = lbs[group[0]].canvas_w;
+        int canvas_h = lbs[group[0]].canvas_h;
+        for (size_t first = 0; first < group.size(); first += BATCH_SIZE) {
+            int n = std::min((int)(group.size() - first), BATCH_SIZE);
+            for (int i = 0; i < n; i++) {
+                blob_from_img(canvases[group[first + i]], &data[i * 3 * canvas_h * canvas_w], canvas_w, canvas_h);
+            }
+            // 组内下标连续时直接写到prob, 否则先写到group_prob, 再按每张图用到的行数拷贝
+            bool contiguous = group[first + n - 1] - group[first] == n - 1;
+            float* out = contiguous ? &prob[group[first] * OUTPUT_SIZE] : group_prob;
+            bytes += doInference(context, stream, buffers, data, out, n, canvas_h, canvas_w);
+            if (contiguous) continue;
+            for (int i = 0; i < n; i++) {
+                const float* src = &group_prob[i * OUTPUT_SIZE];
+                int rows = std::min((int)src[0], (OUTPUT_SIZE - 1) / det_size);
+                memcpy(&prob[group[first + i] * OUTPUT_SIZE], src, (1 + rows * det_size) * sizeof(float));
+            }
+        }
+    }
+    return bytes;
+}
+
+// spec为"shm:/ring0,/ring1,...", 每个ring对应一路视频源
+static bool open_shm_rings(const std::string& spec, std::vector<shm_ring_t*>& rings) {
+    std::stringstream ss(spec.substr(4));
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        shm_ring_t* ring = shm_ring_open(name.c_str());
+        if (!ring) {
+            std::cerr << "Can not open shm ring " << name << std::endl;
+            return false;
+        }
+        rings.push_back(ring);
+    }
+    return true;
+}
+
+// 每路视频源一个关键帧调度器(见scheduler.h), KEYFRAME_MAX_INTERVAL为1时每帧都推理
+static SchedulerConfig scheduler_config() {
+    SchedulerConfig cfg;
+    cfg.max_interval = KEYFRAME_MAX_INTERVAL;
+    cfg.motion_thresh = MOTION_THRESH;
+    cfg.gpu_budget_ms = GPU_BUDGET_MS;
+    return cfg;
+}
+
+// 共享内存输入: 每轮检查一遍所有ring(不等待), 有新帧的直接在共享内存上做letterbox(无拷贝), 组成一个batch推理
+// 一轮都没有新帧时在下一个ring上最多等1ms, 与多GPU版本相同; 一路停止写入不会拖慢其他路
+// 非关键帧只在共享内存上算运动分数, 不做letterbox和推理, 由跟踪器预测
+int run_shm_sources(IExecutionContext& context, cudaStream_t& stream, void** buffers, float* data, float* prob, const std::string& spec) {
+    std::vector<shm_ring_t*> rings;
+    if (!open_shm_rings(spec, rings)) return -1;
+    if (rings.empty() || (int)rings.size() > BATCH_SIZE) {
+        std::cerr << "shm sources must be between 1 and BATCH_SIZE(" << BATCH_SIZE << ")" << std::endl;
+        return -1;
+    }
+
+    std::vector<uint64_t> last_seq(rings.size(), 0);
+    std::vector<Yolo::SourceRoi> rois = load_rois(rings.size());
+    std::vector<Yolo::RoiCrop> crops(rings.size());
+    for (size_t b = 0; b < rings.size(); b++) crops[b] = roi_crop(rois[b], shm_ring_width(rings[b]), shm_ring_height(rings[b]));
+    std::vector<Tracker> trackers(rings.size());
+    std::vector<KeyframeScheduler> schedulers(rings.size(), KeyframeScheduler(scheduler_config()));
+    std::vector<std::unique_ptr<SourceMetrics>> sm;
+    for (size_t b = 0; b < rings.size(); b++) sm.emplace_back(new SourceMetrics(b));
+    std::vector<std::chrono::steady_clock::time_point> read_at(rings.size());
+    std::vector<Yolo::TrackedDetection> tracks;
+    std::vector<cv::Mat> canvases;
+    std::vector<Yolo::Letterbox> lbs;
+    std::vector<int> batch_src;
+    size_t idle_ring = 0;
+    while (1) {
+        canvases.clear();
+        lbs.clear();
+        batch_src.clear();
+        bool any = false;
+        for (size_t b = 0; b < rings.size(); b++) {
+            uint64_t seq = shm_ring_wait(rings[b], last_seq[b], 0);
+            if (seq == 0) continue;
+            any = true;
+            // 只读最新的一帧, 中间被跳过的帧计为丢帧
+            if (last_seq[b] > 0 && seq > last_seq[b] + 1) sm[b]->dropped.inc(seq - last_seq[b] - 1);
+            last_seq[b] = seq;
+            read_at[b] = std::chrono::steady_clock::now();
+            const uint8_t* pixels = shm_ring_read_begin(rings[b], seq, nullptr);
+            if (!pixels) {
+                sm[b]->dropped.inc();
+                continue;
+            }
+            cv::Mat img(shm_ring_height(rings[b]), shm_ring_width(rings[b]), CV_8UC3, const_cast<uint8_t*>(pixels), shm_ring_stride(rings[b]));
+            const bool key = schedulers[b].decide(img);
+            Yolo::Letterbox lb;
+            cv::Mat pr_img;
+            if (key) {
+                const Yolo::RoiCrop& crop = crops[b];
+                lb = make_letterbox(crop.w, crop.h);
+                pr_img = letterbox_img(img(cv::Rect(crop.x, crop.y, crop.w, crop.h)), lb); // 直接读取共享内存
+            }
+            // 读取期间该slot被生产者覆盖, 丢弃这一帧
+            if (!shm_ring_read_end(rings[b], seq)) {
+                sm[b]->dropped.inc();
+                continue;
+            }
+            sm[b]->on_frame();
+            if (!key) {
+                trackers[b].predict(tracks);
+                sm[b]->on_tracked(tracks.size(), read_at[b]);
+                std::cout << "source " << b << " frame " << seq << ": skipped, " << tracks.size() << " tracks" << std::endl;
+                continue;
+            }
+            canvases.push_back(pr_img);
+            lbs.push_back(lb);
+            batch_src.push_back(b);
+        }
+        if (!any) {
+            shm_ring_wait(rings[idle_ring], last_seq[idle_ring], 1);
+            idle_ring = (idle_ring + 1) % rings.size();
+        }
+        if (batch_src.empty()) continue;
+
+        pipeline_metrics().queue_depth.set(batch_src.size());
+        auto t_start = std::chrono::high_resolution_clock::now();
+        infer_canvases(context, stream, buffers, data, prob, canvases, lbs);
+        float infer_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - t_start).count();
+        for (size_t i = 0; i < batch_src.size(); i++) {
+            int b = batch_src[i];
+            std::vector<Yolo::Detection> res;
+            roi_detections(res, &prob[i * OUTPUT_SIZE], rois[b], crops[b], lbs[i]);
+            trackers[b].update(res, tracks);
+            schedulers[b].onInference(infer_ms / batch_src.size());
+            sm[b]->interval.set(schedulers[b].metrics().interval);
+            sm[b]->inferred.inc();
+            sm[b]->on_tracked(tracks.size(), read_at[b]);
+            std::cout << "source " << b << " frame " << last_seq[b] << ": " << res.size() << " objects, " << tracks.size() << " tracks" << std::endl;
+        }
+    }
+
+    for (auto ring : rings) shm_ring_close(ring);
+    return 0;
+}
+
+#ifdef USE_FFMPEG
+// spec为"ffmpeg:a.mp4,rtsp://host/cam1@2,...", 每个地址一路视频源, 结尾的"@N"为该路的解码线程数
+static bool open_ffmpeg_sources(const std::string& spec, std::vector<std::unique_ptr<FfmpegSource>>& sources) {
+    std::stringstream ss(spec.substr(7));
+    std::string url;
+    while (std::getline(ss, url, ',')) {
+        VideoSourceOptions options;
+        options.decode_threads = FFMPEG_DECODE_THREADS;
+        size_t at = url.rfind('@');
+        if (at != std::string::npos && at + 1 < url.size() && url.find_first_not_of("0123456789", at + 1) == std::string::npos) {
+            options.decode_threads = atoi(url.c_str() + at + 1);
+            url.resize(at);
+        }
+        sources.emplace_back(new FfmpegSource);
+        if (!sources.back()->open(url, options)) return false;
+    }
+    return true;
+}
+
+// FFmpeg视频输入: 每路的letterbox只在打开时算一次, 相同canvas的源为一组; 解码后由swscale直接写入data中该帧在batch里的位置(见ffmpeg_source.h), 不经过cv::Mat
+// 所有源都结束后返回
+int run_ffmpeg_sources(IExecutionContext& context, cudaStream_t& stream, void** buffers, float* data, float* prob, const std::string& spec) {
+    std::vector<std::unique_ptr<FfmpegSource>> sources;
+    if (!open_ffmpeg_sources(spec, sources)) return -1;
+    if (sources.empty() || (int)sources.size() > BATCH_SIZE) {
+        std::cerr << "ffmpeg sources must be between 1 and BATCH_SIZE(" << BATCH_SIZE << ")" << std::endl;
+        return -1;
+    }
+
+    std::vector<Yolo::Letterbox> lbs;
+    for (const auto& source : sources) lbs.push_back(make_letterbox(source->width(), source->height()));
+    // swscale缩放整帧, 不按ROI裁剪, 只在nms前过滤
+    std::vector<Yolo::SourceRoi> rois = load_rois(sources.size());
+    std::vector<Yolo::RoiCrop> frames;
+    for (const auto& source : sources) frames.push_back(Yolo::RoiCrop{ 0, 0, source->width(), source->height() });
+    std::vector<std::vector<int>> groups;
+    group_by_canvas(lbs, groups);
+    std::vector<bool> running(sources.size(), true);
+    size_t remaining = sources.size();
+    std::vector<Tracker> trackers(sources.size());
+    std::vector<Yolo::TrackedDetection> tracks;
+    std::vector<int> batch_src;
+    std::vector<std::unique_ptr<SourceMetrics>> sm;
+    for (size_t b = 0; b < sources.size(); b++) sm.emplace_back(new SourceMetrics(b));
+    std::vector<std::chrono::steady_clock::time_point> read_at(sources.size());
+    while (remaining > 0) {
+        for (const auto& group : groups) {
+            const Yolo::Letterbox& canvas = lbs[group[0]];
+            const size_t input_size = (size_t)3 * canvas.canvas_w * canvas.canvas_h;
+            batch_src.clear();
+            for (int b : group) {
+                if (!running[b]) continue;
+                read_at[b] = std::chrono::steady_clock::now();
+                if (!sources[b]->read(lbs[b], &data[batch_src.size() * input_size])) {
+                    std::cout << "source " << b << " ended after " << sources[b]->frames() << " frames" << std::endl;
+                    running[b] = false;
+                    remaining--;
+                    continue;
+                }
+                sm[b]->on_frame();
+                batch_src.push_back(b);
+            }
+            if (batch_src.empty()) continue;
+
+            pipeline_metrics().queue_depth.set(batch_src.size());
+            doInference(context, stream, buffers, data, prob, (int)batch_src.size(), canvas.canvas_h, canvas.canvas_w);
+            for (size_t i = 0; i < batch_src.size(); i++) {
+                int b = batch_src[i];
+                std::vector<Yolo::Detection> res;
+                roi_detections(res, &prob[i * OUTPUT_SIZE], rois[b], frames[b], lbs[b]);
+                trackers[b].update(res, tracks);
+                sm[b]->inferred.inc();
+                sm[b]->on_tracked(tracks.size(), read_at[b]);
+                std::cout << "source " << b << " frame " << sources[b]->frames() << " (" << sources[b]->pts() / 1000 << " ms): "
+                          << res.size() << " objects, " << tracks.size() << " tracks" << std::endl;
+            }
+        }
+    }
+    return 0;
+}
+#endif
+
+// 多GPU: 每个GPU一份engine/context/显存/stream和主机缓冲, 只由该GPU的工作线程使用
+struct DeviceEngine {
+    int device = 0;
+    IRuntime* runtime = nullptr;
+    ICudaEngine* engine = nullptr;
+    IExecutionContext* context = nullptr;
+    void* buffers[2] = { nullptr, nullptr };
+    cudaStream_t stream = nullptr;
+    std::vector<float> data;  // 按batch实际的canvas尺寸增长
+    std::vector<float> prob;
+};
+
+static bool open_device_engine(int device, const char* plan, size_t size, DeviceEngine& d) {
+    d.device = device;
+    if (cudaSetDevice(device) != cudaSuccess) {
+        std::cerr << "can not use GPU " << device << std::endl;
+        return false;
+    }
+    d.runtime = createInferRuntime(gLogger);
+    d.engine = d.runtime->deserializeCudaEngine(plan, size);
+    if (!d.engine) {
+        std::cerr << "deserialize engine on GPU " << device << " failed" << std::endl;
+        return false;
+    }
+    engine_nc = engine_class_count(*d.engine, CLASS_NUM);  // 所有设备是同一个engine
+    d.context = d.engine->createExecutionContext();
+    assert(d.context != nullptr);
+    CUDA_CHECK(cudaMalloc(&d.buffers[0], BATCH_SIZE * 3 * MAX_INPUT_SIZE * MAX_INPUT_SIZE * sizeof(float)));
+    CUDA_CHECK(cudaMalloc(&d.buffers[1], BATCH_SIZE * OUTPUT_SIZE * sizeof(float)));
+    CUDA_CHECK(cudaStreamCreate(&d.stream));
+    d.prob.resize(BATCH_SIZE * OUTPUT_SIZE);
+    return true;
+}
+
+static void close_device_engine(DeviceEngine& d) {
+    cudaSetDevice(d.device);
+    if (d.stream) cudaStreamDestroy(d.stream);
+    if (d.buffers[0]) CUDA_CHECK(cudaFree(d.buffers[0]));
+    if (d.buffers[1]) CUDA_CHECK(cudaFree(d.buffers[1]));
+    if (d.context) d.context->destroy();
+    if (d.engine) d.engine->destroy();
+    if (d.runtime) d.runtime->destroy();
+}
+
+// 每个GPU的指标, 标签device="<GPU id>"; 只在该GPU的工作线程中更新
+struct DeviceMetrics {
+    explicit DeviceMetrics(int device)
+        : labels("device=\"" + std::to_string(device) + "\""),
+          queued(metrics().gauge("yolov5_device_queued_images", "Images routed to the GPU and not finished yet", labels)),
+          ms_per_image(metrics().gauge("yolov5_device_ms_per_image", "Smoothed engine time per image on the GPU", labels)),
+          sources(metrics().gauge("yolov5_device_sources", "Sources currently assigned to the GPU", labels)),
+          migrations(metrics().counter("yolov5_device_migrations_total", "Sources moved off the GPU because it was saturated", labels)),
+          reported_out_(0) {}
+
+    void update(const DeviceLoad& load) {
+        queued.set(load.queued);
+        ms_per_image.set(load.ms_per_image);
+        sources.set(load.sources);
+        migrations.inc(load.migrated_out - reported_out_);
+        reported_out_ = load.migrated_out;
+    }
+
+    std::string labels;
+    Gauge& queued;
+    Gauge& ms_per_image;
+    Gauge& sources;
+    Counter& migrations;
+
+private:
+    long long reported_out_;
+};
+
+// 读取线程产生的一帧, 已letterbox并转成planar float的网络输入
+struct FrameJob {
+    int source = 0;
+    uint64_t frame = 0;  // 该路的帧序号, 递增
+    Yolo::Letterbox lb;        // 裁剪区域(SourceSlot::crop)的letterbox
+    std::vector<float> input;  // 3 x canvas_h x canvas_w
+    std::chrono::steady_clock::time_point read_at;
+    bool infer = true;         // false: 非关键帧, 没有input, 只用跟踪器预测
+};
+
+// 每路的跟踪器和关键帧调度器, 只在持有该路的锁时使用: 读取线程做关键帧判断, GPU工作线程更新跟踪器
+// 迁移期间同一路可能有两个GPU上的帧在推理; roi和crop在run_multi_device之前设置, 之后只读, 不需要加锁
+struct SourceSlot {
+    Yolo::SourceRoi roi;
+    Yolo::RoiCrop crop;
+    std::mutex mutex;
+    Tracker tracker;
+    KeyframeScheduler scheduler{ scheduler_config() };
+    uint64_t last_frame = 0;
+};
+
+// 多GPU流水线: 调用线程反复调用read取一帧, 按DeviceDispatcher的路由放进该GPU的队列; 每个GPU一个工作线程,
+// 一次取出最多BATCH_SIZE帧, 按canvas分组推理, NMS后交给该路的跟踪器. read返回false(所有源结束)后等队列清空再返回
+// live为true时(实时源)目标队列已满就丢掉这一帧, 否则等待; sm[b]为第b路的指标, read中负责on_frame和读取时的丢帧
+// read给出的非关键帧(infer为false)放进该路当前所在GPU的队列但不计入调度负载, 工作线程在同一批的推理之后做跟踪器预测, 保持帧的先后顺序
+static int run_multi_device(std::vector<DeviceEngine>& engines, std::vector<std::unique_ptr<SourceMetrics>>& sm,
+                            std::vector<std::unique_ptr<SourceSlot>>& slots, bool live, const std::function<bool(FrameJob&)>& read) {
+    DispatchConfig cfg;
+    cfg.saturated_images = 2 * BATCH_SIZE;
+    cfg.max_wait_ms = DISPATCH_MAX_WAIT_MS;
+    if (DISPATCH_MAX_WAIT_MS <= 0) cfg.rebalance_ratio = 0;
+    DeviceDispatcher dispatcher((int)engines.size(), cfg);
+    std::vector<std::unique_ptr<BatchQueue<FrameJob>>> queues;
+    std::vector<std::unique_ptr<DeviceMetrics>> dm;
+    for (const DeviceEngine& d : engines) {
+        queues.emplace_back(new BatchQueue<FrameJob>(4 * BATCH_SIZE));
+        dm.emplace_back(new DeviceMetrics(d.device));
+    }
+    // 推理完的输入缓冲还给读取线程复用
+    std::mutex spare_mutex;
+    std::vector<std::vector<float>> spare;
+
+    auto worker = [&](int k) {
+        DeviceEngine& d = engines[k];
+        cudaSetDevice(d.device);
+        std::vector<FrameJob> jobs;
+        std::vector<Yolo::Letterbox> lbs;
+        std::vector<int> keys;  // jobs中需要推理的下标
+        std::vector<std::vector<int>> groups;
+        std::vector<Yolo::Detection> res;
+        std::vector<Yolo::TrackedDetection> tracks;
+        while (queues[k]->pop_batch(jobs, BATCH_SIZE)) {
+            auto start = std::chrono::steady_clock::now();
+            lbs.clear();
+            keys.clear();
+            for (int j = 0; j < (int)jobs.size(); j++) {
+                if (!jobs[j].infer) continue;
+                lbs.push_back(jobs[j].lb);
+                keys.push_back(j);
+            }
+            group_by_canvas(lbs, groups);
+            for (auto& group : groups) {
+                for (int& g : group) g = keys[g];
+                const int canvas_w = lbs[group[0]].canvas_w;
+                const int canvas_h = lbs[group[0]].canvas_h;
+                const size_t input_size = (size_t)3 * canvas_w * canvas_h;
+                d.data.resize(group.size() * input_size);
+                for (size_t i = 0; i < group.size(); i++) memcpy(&d.data[i * input_size], jobs[group[i]].input.data(), input_size * sizeof(float));
+                doInference(*d.context, d.stream, d.buffers, d.data.data(), d.prob.data(), (int)group.size(), canvas_h, canvas_w);
+                for (size_t i = 0; i < group.size(); i++) {
+                    const FrameJob& job = jobs[group[i]];
+                    SourceSlot& slot = *slots[job.source];
+                    res.clear();
+                    roi_detections(res, &d.prob[i * OUTPUT_SIZE], slot.roi, slot.crop, job.lb);
+                    std::lock_guard<std::mutex> lock(slot.mutex);
+                    // 迁移后原GPU上较晚完成的旧帧不再更新跟踪器
+                    if (job.frame <= slot.last_frame) {
+                        sm[job.source]->dropped.inc();
+                        continue;
+                    }
+                    slot.last_frame = job.frame;
+                    slot.tracker.update(res, tracks);
+                    slot.scheduler.onInference(dispatcher.load(k).ms_per_image);
+                    sm[job.source]->interval.set(slot.scheduler.metrics().interval);
+                    sm[job.source]->inferred.inc();
+                    sm[job.source]->on_tracked(tracks.size(), job.read_at);
+                    std::ostringstream line;
+                    line << "source " << job.source << " frame " << job.frame << " (GPU " << d.device << "): " << res.size() << " objects, " << tracks.size() << " tracks\n";
+                    std::cout << line.str();
+                }
+            }
+            // 非关键帧: 该路较新的帧已经更新过跟踪器时跳过
+            for (const FrameJob& job : jobs) {
+                if (job.infer) continue;
+                SourceSlot& slot = *slots[job.source];
+                std::lock_guard<std::mutex> lock(slot.mutex);
+                if (job.frame <= slot.last_frame) continue;
+                slot.last_frame = job.frame;
+                slot.tracker.predict(tracks);
+                sm[job.source]->on_tracked(tracks.size(), job.read_at);
+            }
+            if (!keys.empty()) {
+                float batch_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+                dispatcher.done(k, (int)keys.size(), batch_ms);
+            }
+            dm[k]->update(dispatcher.load(k));
+            std::lock_guard<std::mutex> lock(spare_mutex);
+            for (FrameJob& job : jobs) {
+                if (job.input.capacity()) spare.push_back(std::move(job.input));
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t k = 0; k < engines.size(); k++) threads.emplace_back(worker, (int)k);
+
+    std::vector<int> last_device(sm.size(), -1);
+    FrameJob job;
+    while (1) {
+        if (job.input.capacity() == 0) {
+            std::lock_guard<std::mutex> lock(spare_mutex);
+            if (!spare.empty()) {
+                job.input = std::move(spare.back());
+                spare.pop_back();
+            }
+        }
+        if (!read(job)) break;
+        const int b = job.source;
+        if (!job.infer) {
+            // 第一帧总是关键帧, 这里该路已经有设备
+            int k = dispatcher.device_of(b);
+            if (k < 0 || !queues[k]->try_push(job)) sm[b]->dropped.inc();
+            continue;
+        }
+        int k = dispatcher.route(b);
+        if (last_device[b] >= 0 && last_device[b] != k) {
+            std::cout << "source " << b << " moved from GPU " << engines[last_device[b]].device << " to GPU " << engines[k].device << std::endl;
+        }
+        last_device[b] = k;
+        bool queued = live ? queues[k]->try_push(job) : queues[k]->push(std::move(job));
+        if (!queued) {
+            dispatcher.cancel(k);
+            sm[b]->dropped.inc();
+        }
+    }
+    for (auto& q : queues) q->close();
+    for (auto& t : threads) t.join();
+    return 0;
+}
+
+// 共享内存输入的多GPU版本: 路数不受BATCH_SIZE限制, 轮流检查各ring, 有新帧就读出最新的一帧
+static int run_shm_sources_multi(std::vector<DeviceEngine>& engines, const std::string& spec) {
+    std::vector<shm_ring_t*> rings;
+    if (!open_shm_rings(spec, rings) || rings.empty()) return -1;
+    std::vector<uint64_t> last_seq(rings.size(), 0);
+    std::vector<std::unique_ptr<SourceMetrics>> sm;
+    std::vector<std::unique_ptr<SourceSlot>> slots;
+    std::vector<Yolo::SourceRoi> rois = load_rois(rings.size());
+    for (size_t b = 0; b < rings.size(); b++) {
+        sm.emplace_back(new SourceMetrics(b));
+        slots.emplace_back(new SourceSlot);
+        slots[b]->roi = rois[b];
+        slots[b]->crop = roi_crop(rois[b], shm_ring_width(rings[b]), shm_ring_height(rings[b]));
+    }
+    size_t next = 0;
+    size_t idle = 0; // 连续没有新帧的ring数, 转完一圈都没有时才等待
+    auto read = [&](FrameJob& job) {
+        while (1) {
+            size_t b = next;
+            next = (next + 1) % rings.size();
+            uint64_t seq = shm_ring_wait(rings[b], last_seq[b], idle >= rings.size() ? 1 : 0);
+            if (seq == 0) {
+                idle++;
+                continue;
+            }
+            idle = 0;
+            if (last_seq[b] > 0 && seq > last_seq[b] + 1) sm[b]->dropped.inc(seq - last_seq[b] - 1);
+            last_seq[b] = seq;
+            job.read_at = std::chrono::steady_clock::now();
+            const uint8_t* pixels = shm_ring_read_begin(rings[b], seq, nullptr);
+            if (!pixels) {
+                sm[b]->dropped.inc();
+                continue;
+            }
+            cv::Mat img(shm_ring_height(rings[b]), shm_ring_width(rings[b]), CV_8UC3, const_cast<uint8_t*>(pixels), shm_ring_stride(rings[b]));
+            {
+                std::lock_guard<std::mutex> lock(slots[b]->mutex);
+                job.infer = slots[b]->scheduler.decide(img);
+            }
+            cv::Mat pr_img;
+            if (job.infer) {
+                const Yolo::RoiCrop& crop = slots[b]->crop;
+                job.lb = make_letterbox(crop.w, crop.h);
+                pr_img = letterbox_img(img(cv::Rect(crop.x, crop.y, crop.w, crop.h)), job.lb);
+            }
+            if (!shm_ring_read_end(rings[b], seq)) {
+                sm[b]->dropped.inc();
+                continue;
+            }
+            sm[b]->on_frame();
+            job.source = (int)b;
+            job.frame = seq;
+            if (job.infer) {
+                job.input.resize((size_t)3 * job.lb.canvas_w * job.lb.canvas_h);
+                blob_from_img(pr_img, job.input.data(), job.lb.canvas_w, job.lb.canvas_h);
+            }
+            return true;
+        }
+    };
+    int ret = run_multi_device(engines, sm, slots, true, read);
+    for (auto ring : rings) shm_ring_close(ring);
+    return ret;
+}
+
+#ifdef USE_FFMPEG
+// FFmpeg输入的多GPU版本: 轮流从各路解码一帧, swscale直接写入该帧的输入缓冲; 目标GPU队列满时等待, 不丢帧
+static int run_ffmpeg_sources_multi(std::vector<DeviceEngine>& engines, const std::string& spec) {
+    std::vector<std::unique_ptr<FfmpegSource>> sources;
+    if (!open_ffmpeg_sources(spec, sources) || sources.empty()) return -1;
+    std::vector<Yolo::Letterbox> lbs;
+    for (const auto& source : sources) lbs.push_back(make_letterbox(source->width(), source->height()));
+    std::vector<std::unique_ptr<SourceMetrics>> sm;
+    std::vector<std::unique_ptr<SourceSlot>> slots;
+    // 与单GPU版本相同, 不裁剪, 只在nms前按ROI过滤
+    std::vector<Yolo::SourceRoi> rois = load_rois(sources.size());
+    for (size_t b = 0; b < sources.size(); b++) {
+        sm.emplace_back(new SourceMetrics(b));
+        slots.emplace_back(new SourceSlot);
+        slots[b]->roi = rois[b];
+        slots[b]->crop = Yolo::RoiCrop{ 0, 0, sources[b]->width(), sources[b]->height() };
+    }
+    std::vector<bool> running(sources.size(), true);
+    size_t remaining = sources.size();
+    size_t next = 0;
+    auto read = [&](FrameJob& job) {
+        while (remaining > 0) {
+            size_t b = next;
+            next = (next + 1) % sources.size();
+            if (!running[b]) continue;
+            job.read_at = std::chrono::steady_clock::now();
+            job.input.resize((size_t)3 * lbs[b].canvas_w * lbs[b].canvas_h);
+            if (!sources[b]->read(lbs[b], job.input.data())) {
+                std::cout << "source " << b << " ended after " << sources[b]->frames() << " frames" << std::endl;
+                running[b] = false;
+                remaining--;
+                continue;
+            }
+            sm[b]->on_frame();
+            job.source = (int)b;
+            job.frame = sources[b]->frames();
+            job.lb = lbs[b];
+            return true;
+        }
+        return false;
+    };
+    return run_multi_device(engines, sm, slots, false, read);
+}
+#endif
+
+// "0,1,2,3" -> {0, 1, 2, 3}
+static std::vector<int> parse_device_list(const std::string& list) {
+    std::vector<int> devices;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) devices.push_back(atoi(item.c_str()));
+    }
+    return devices;
+}
+
+// DEVICES中的每个GPU各反序列化一份engine后运行shm:/ffmpeg:输入
+static int run_devices(const std::vector<int>& devices, const char* plan, size_t size, const std::string& spec) {
+    std::vector<DeviceEngine> engines(devices.size());
+    bool ok = true;
+    for (size_t k = 0; k < devices.size() && ok; k++) ok = open_device_engine(devices[k], plan, size, engines[k]);
+    int ret = -1;
+    if (ok) {
+        std::cout << "Running on " << devices.size() << " GPUs" << std::endl;
+#ifdef USE_FFMPEG
+        if (spec.compare(0, 7, "ffmpeg:") == 0) ret = run_ffmpeg_sources_multi(engines, spec);
+        else
+#endif
+        ret = run_shm_sources_multi(engines, spec);
+    }
+    for (DeviceEngine& d : engines) close_device_engine(d);
+    return ret;
+}
+
+// 精度评估用的记录: 目录中的图片按线上相同的letterbox分批推理, 每张图的原始输出(NMS之前)和平均到每张图的推理耗时写入out_path
+// 格式见detection_file.h, 由./coco_eval离线按不同阈值做NMS并计算mAP
+int run_record_detections(IExecutionContext& context, cudaStream_t& stream, void** buffers, float* data, float* prob,
+                          const std::string& engine_name, const std::string& img_dir, const std::vector<std::string>& file_names, const std::string& out_path) {
+    std::ofstream out(out_path);
+    if (!out) {
+        std::cerr << "could not open " << out_path << std::endl;
+        return -1;
+    }
+#ifdef USE_GPU_NMS
+    write_detection_header(out, true, engine_name);
+    const int max_rows = NMS_TOP_N;
+#else
+    write_detection_header(out, false, engine_name);
+    const int max_rows = Yolo::MAX_OUTPUT_BBOX_COUNT;
+#endif
+    int recorded = 0;
+    double total_ms = 0;
+    for (size_t f = 0; f < file_names.size(); f += BATCH_SIZE) {
+        std::vector<cv::Mat> canvases;
+        std::vector<Yolo::Letterbox> lbs;
+        std::vector<cv::Size> sizes;
+        std::vector<std::string> names;
+        for (size_t i = f; i < std::min(file_names.size(), f + BATCH_SIZE); i++) {
+            cv::Mat img = cv::imread(img_dir + "/" + file_names[i]);
+            if (img.empty()) continue;
+            lbs.push_back(make_letterbox(img.cols, img.rows));
+            canvases.push_back(letterbox_img(img, lbs.back()));
+            sizes.push_back(img.size());
+            names.push_back(file_names[i]);
+        }
+        if (names.empty()) continue;
+        auto start = std::chrono::high_resolution_clock::now();
+        infer_canvases(context, stream, buffers, data, prob, canvases, lbs);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / names.size();
+        for (size_t i = 0; i < names.size(); i++) {
+            write_detection_record(out, names[i], sizes[i].width, sizes[i].height, lbs[i], ms, &prob[i * OUTPUT_SIZE], max_rows);
+        }
+        recorded += (int)names.size();
+        total_ms += ms * names.size();
+    }
+    if (!out.good()) {
+        std::cerr << "write " << out_path << " failed" << std::endl;
+        return -1;
+    }
+    std::cout << "Recorded " << recorded << " images to " << out_path << ", " << (recorded ? total_ms / recorded : 0.0) << " ms/image" << std::endl;
+    return 0;
 }
 
-bool parse_args(int argc, char** argv, std::string& wts, std::string& engine, float& gd, float& gw, std::string& img_dir) {
+// 逐层性能分析: IProfiler只在同步执行(executeV2)时回调, 所以这里不走doInference
+class LayerProfiler : public IProfiler {
+public:
+    explicit LayerProfiler(LayerProfile& profile) : profile_(profile) {}
+    void reportLayerTime(const char* layerName, float ms) override { profile_.add(layerName, ms); }
+
+private:
+    LayerProfile& profile_;
+};
+
+// 以BATCH_SIZE x 3 x INPUT_H x INPUT_W的灰图输入预热后运行iterations次, 打印按model.N聚合的表并写出JSON
+int run_layer_profile(IExecutionContext& context, void** buffers, float* data, int iterations, const std::string& json_path) {
+    const int warmup = 10;
+    std::fill(data, data + BATCH_SIZE * 3 * INPUT_H * INPUT_W, 0.5f);
+    std::vector<void*> bindings = bind_buffers(context, INPUT_BLOB_NAME, OUTPUT_BLOB_NAME, buffers, BATCH_SIZE, INPUT_H, INPUT_W);
+    CUDA_CHECK(cudaMemcpy(buffers[0], data, BATCH_SIZE * 3 * INPUT_H * INPUT_W * sizeof(float), cudaMemcpyHostToDevice));
+    for (int i = 0; i < warmup; i++) context.executeV2(bindings.data());
+
+    LayerProfile stats;
+    LayerProfiler profiler(stats);
+    context.setProfiler(&profiler);
+    for (int i = 0; i < iterations; i++) {
+        context.executeV2(bindings.data());
+        stats.end_iteration();
+    }
+    context.setProfiler(nullptr);
+
+    stats.print_table(std::cout);
+    std::ofstream json(json_path);
+    if (!json) {
+        std::cerr << "could not open " << json_path << std::endl;
+        return -1;
+    }
+    stats.write_json(json);
+    std::cout << "Layer profile written to " << json_path << std::endl;
+    return 0;
+}
+
+// 一致性校验: 同一张图(letterbox到INPUT_W x INPUT_H)分别由engine和CPU参考实现(graph_cpu.h)推理, NMS后逐框比较
+// CPU端由.wts重新生成与构建engine时相同的网络图; 两边框数相同且每个框都能在另一边找到同类别、IoU>0.9的框时通过
+int run_parity_check(IExecutionContext& context, cudaStream_t& stream, void** buffers, float* data, float* prob,
+                     const std::string& wts_name, const ModelConfig& model, const std::string& img_path) {
+    if (model.nc != engine_nc) {
+        std::cerr << "engine has " << engine_nc << " classes but the model has nc " << model.nc << ", rebuild the engine or pass the model it was built from" << std::endl;
+        return -1;
+    }
+    cv::Mat img = cv::imread(img_path);
+    if (img.empty()) {
+        std::cerr << "read " << img_path << " error!" << std::endl;
+        return -1;
+    }
+    Yolo::Letterbox lb = fixed_letterbox(img.cols, img.rows, INPUT_W, INPUT_H);
+    blob_from_img(letterbox_img(img, lb), data, INPUT_W, INPUT_H);
+
+    doInference(context, stream, buffers, data, prob, 1, INPUT_H, INPUT_W);
+    std::vector<Yolo::Detection> trt_res;
+    run_nms(trt_res, prob);
+
+    WeightArena arena;
+    ArenaScope arena_scope(arena);
+    ThreadPool pool;
+    std::map<std::string, Weights> weightMap = loadWeights(wts_name, &pool);
+    fuseConvBatchNorm(weightMap, pool, 1e-3);
+    ir::Graph graph;
+    build_yolov5(graph, weight_table(weightMap), model, INPUT_W, INPUT_H, Yolo::MAX_OUTPUT_BBOX_COUNT);
+    CpuExecutor executor(graph, pool);
+    auto start = std::chrono::system_clock::now();
+    executor.run(data, 1, INPUT_H, INPUT_W);
+    auto end = std::chrono::system_clock::now();
+    std::vector<float> cpu_out = executor.output(0).data;
+    std::vector<Yolo::Detection> cpu_res;
+    nms(cpu_res, cpu_out.data(), CONF_THRESH, NMS_THRESH, engine_nc);
+    std::cout << "CPU reference: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms on " << pool.size() << " threads" << std::endl;
+
+    int matched = 0;
+    float max_conf_diff = 0.f;
+    for (auto& a : cpu_res) {
+        for (auto& b : trt_res) {
+            if (a.class_id == b.class_id && iou(a.bbox, b.bbox) > 0.9f) {
+                matched++;
+                max_conf_diff = std::max(max_conf_diff, fabsf(a.conf - b.conf));
+                break;
+            }
+        }
+    }
+    bool ok = cpu_res.size() == trt_res.size() && matched == (int)cpu_res.size();
+    std::cout << "engine: " << trt_res.size() << " boxes, CPU: " << cpu_res.size() << " boxes, matched " << matched
+              << ", max conf diff " << max_conf_diff << " -> " << (ok ? "parity OK" : "MISMATCH") << std::endl;
+    return ok ? 0 : 1;
+}
+
+bool parse_args(int argc, char** argv, std::string& wts, std::string& engine, ModelConfig& model, std::string& img_dir, int& profile_iters, std::string& check_wts, std::vector<std::string>& merge_caches, std::string& record_path) {
     if (argc < 4) return false;
     if (std::string(argv[1]) == "-s" && (argc == 5 || argc == 7)) {
         wts = std::string(argv[2]);
         engine = std::string(argv[3]);
         auto net = std::string(argv[4]);
-        if (net == "s") {
-            gd = 0.33;
-            gw = 0.50;
-        } else if (net == "m") {
-            gd = 0.67;
-            gw = 0.75;
-        } else if (net == "l") {
-            gd = 1.0;
-            gw = 1.0;
-        } else if (net == "x") {
-            gd = 1.33;
-            gw = 1.25;
-        } else if (net == "c" && argc == 7) {
-            gd = atof(argv[5]);
-            gw = atof(argv[6]);
-        } else {
+        if (net == "c" && argc == 7) {
+            model = yolov5_p6_config(atof(argv[5]), atof(argv[6]));
+        } else if (argc != 5 || !model_from_arg(net, model)) {
             return false;
         }
     } else if (std::string(argv[1]) == "-d" && argc == 4) {
         engine = std::string(argv[2]);
         img_dir = std::string(argv[3]);
+    } else if (std::string(argv[1]) == "-e" && argc == 5) {
+        engine = std::string(argv[2]);
+        img_dir = std::string(argv[3]);
+        record_path = std::string(argv[4]);
+    } else if (std::string(argv[1]) == "-p" && argc == 4) {
+        engine = std::string(argv[2]);
+        profile_iters = atoi(argv[3]);
+        if (profile_iters <= 0) return false;
+    } else if (std::string(argv[1]) == "-v" && (argc == 6 || argc == 8)) {
+        engine = std::string(argv[2]);
+        check_wts = std::string(argv[3]);
+        auto net = std::string(argv[4]);
+        if (net == "c" && argc == 8) {
+            model = yolov5_p6_config(atof(argv[5]), atof(argv[6]));
+        } else if (argc != 6 || !model_from_arg(net, model)) {
+            return false;
+        }
+        img_dir = std::string(argv[argc - 1]);
+    } else if (std::string(argv[1]) == "-m") {
+        engine = std::string(argv[2]); // 合并后的缓存文件
+        merge_caches.assign(argv + 3, argv + argc);
     } else {
         return false;
     }
@@ -219,9 +1185,9 @@ bool parse_args(int argc, char** argv, std::string& wts, std::string& engine, fl
 }
 
 int main(int argc, char** argv) {
-    // check input size
-    if (INPUT_H % 32 != 0 || INPUT_W % 32 != 0){
-        std::cerr << "INPUT_H("<< INPUT_H << ")" << " and INPUT_W(" << INPUT_W << ")" <<" must be divisible by 32."<< std::endl;
+    // check input size, P6模型最大下采样64倍, 动态尺寸下每一级的上采样都需要整除
+    if (INPUT_H % 64 != 0 || INPUT_W % 64 != 0){
+        std::cerr << "INPUT_H("<< INPUT_H << ")" << " and INPUT_W(" << INPUT_W << ")" <<" must be divisible by 64."<< std::endl;
         return -1;
     }
 
@@ -229,19 +1195,35 @@ int main(int argc, char** argv) {
 
     std::string wts_name = "";
     std::string engine_name = "";
-    float gd = 0.0f, gw = 0.0f;
+    ModelConfig model;
     std::string img_dir;
-    if (!parse_args(argc, argv, wts_name, engine_name, gd, gw, img_dir)) {
+    int profile_iters = 0;
+    std::string check_wts;
+    std::vector<std::string> merge_caches;
+    std::string record_path;
+    if (!parse_args(argc, argv, wts_name, engine_name, model, img_dir, profile_iters, check_wts, merge_caches, record_path)) {
         std::cerr << "arguments not right!" << std::endl;
-        std::cerr << "./yolov5 -s [.wts] [.engine] [s/m/l/x or c gd gw]  // serialize model to plan file" << std::endl;
+        std::cerr << "./yolov5 -s [.wts] [.engine] [s/m/l/x, c gd gw or model.yaml]  // serialize model to plan file" << std::endl;
         std::cerr << "./yolov5 -d [.engine] ../samples  // deserialize plan file and run inference" << std::endl;
+        std::cerr << "./yolov5 -d [.engine] shm:/ring0,/ring1  // run inference on shared-memory frame rings" << std::endl;
+        std::cerr << "./yolov5 -e [.engine] [image folder] [out.dets]  // record raw detections and latency for ./coco_eval" << std::endl;
+        std::cerr << "./yolov5 -p [.engine] [iterations]  // per-layer profile, writes layer_profile.json" << std::endl;
+        std::cerr << "./yolov5 -v [.engine] [.wts] [s/m/l/x, c gd gw or model.yaml] [image]  // compare the engine with the CPU reference" << std::endl;
+        std::cerr << "./yolov5 -m [out.cache] [in.cache ...]  // merge timing caches from builds on the same GPU model" << std::endl;
         return -1;
     }
 
+    if (!merge_caches.empty()) {
+        IBuilder* builder = createInferBuilder(gLogger);
+        bool ok = merge_timing_cache_files(builder, engine_name, merge_caches);
+        builder->destroy();
+        return ok ? 0 : -1;
+    }
+
     // create a model using the API directly and serialize it to a stream
     if (!wts_name.empty()) {
         IHostMemory* modelStream{ nullptr };
-        APIToModel(BATCH_SIZE, &modelStream, gd, gw, wts_name);
+        APIToModel(BATCH_SIZE, &modelStream, model, wts_name);
         assert(modelStream != nullptr);
         std::ofstream p(engine_name, std::ios::binary);
         if (!p) {
@@ -269,14 +1251,30 @@ int main(int argc, char** argv) {
     file.read(trtModelStream, size);
     file.close();
 
+    bool shm_input = img_dir.compare(0, 4, "shm:") == 0;
+    bool ffmpeg_input = img_dir.compare(0, 7, "ffmpeg:") == 0;
+#ifndef USE_FFMPEG
+    if (ffmpeg_input) {
+        std::cerr << "ffmpeg: sources need cmake -DWITH_FFMPEG=ON" << std::endl;
+        return -1;
+    }
+#endif
+    // 多GPU只用于shm:/ffmpeg:多路输入, 其余模式仍在DEVICE上运行
+    std::vector<int> devices = parse_device_list(DEVICES);
+    if (!devices.empty() && (shm_input || ffmpeg_input)) {
+        MetricsExporter exporter(metrics(), METRICS_PORT, METRICS_FILE, METRICS_DUMP_SEC);
+        int ret = run_devices(devices, trtModelStream, size, img_dir);
+        delete[] trtModelStream;
+        return ret;
+    }
     std::vector<std::string> file_names;
-    if (read_files_in_dir(img_dir.c_str(), file_names) < 0) {
+    if (!shm_input && !ffmpeg_input && profile_iters == 0 && check_wts.empty() && read_files_in_dir(img_dir.c_str(), file_names) < 0) {
         std::cerr << "read_files_in_dir failed." << std::endl;
         return -1;
     }
 
     // prepare input data ---------------------------
-    static float data[BATCH_SIZE * 3 * INPUT_H * INPUT_W];
+    static float data[BATCH_SIZE * 3 * MAX_INPUT_SIZE * MAX_INPUT_SIZE]; // rect推理时canvas最大为MAX_INPUT_SIZE x MAX_INPUT_SIZE
     //for (int i = 0; i < 3 * INPUT_H * INPUT_W; i++)
     //    data[i] = 1.0;
     static float prob[BATCH_SIZE * OUTPUT_SIZE];
@@ -286,10 +1284,12 @@ int main(int argc, char** argv) {
     // IRuntime::deserializeCudaEngine(存放序列化engine的内存，内存大小)
     ICudaEngine* engine = runtime->deserializeCudaEngine(trtModelStream, size);
     assert(engine != nullptr);
+    engine_nc = engine_class_count(*engine, CLASS_NUM);
     IExecutionContext* context = engine->createExecutionContext();
     assert(context != nullptr);
     delete[] trtModelStream;
-    assert(engine->getNbBindings() == 2);
+    // 每个优化profile各有一组binding, doInference按本次输入的尺寸选择profile并绑定buffers
+    assert(engine->getNbBindings() == 2 * engine->getNbOptimizationProfiles());
     void* buffers[2];
     // In order to bind the buffers, we need to know the names of the input and output tensors.
     // Note that indices are guaranteed to be less than IEngine::getNbBindings()
@@ -297,14 +1297,35 @@ int main(int argc, char** argv) {
     const int outputIndex = engine->getBindingIndex(OUTPUT_BLOB_NAME);
     assert(inputIndex == 0);
     assert(outputIndex == 1);
-    // Create GPU buffers on device
-    CUDA_CHECK(cudaMalloc(&buffers[inputIndex], BATCH_SIZE * 3 * INPUT_H * INPUT_W * sizeof(float)));
+    // Create GPU buffers on device, 输入按最大的profile尺寸分配
+    CUDA_CHECK(cudaMalloc(&buffers[inputIndex], BATCH_SIZE * 3 * MAX_INPUT_SIZE * MAX_INPUT_SIZE * sizeof(float)));
     CUDA_CHECK(cudaMalloc(&buffers[outputIndex], BATCH_SIZE * OUTPUT_SIZE * sizeof(float)));
     // Create stream
     cudaStream_t stream;
     CUDA_CHECK(cudaStreamCreate(&stream));
 
 
+    // 性能分析/一致性校验/评估记录以外的模式导出运行指标
+    std::unique_ptr<MetricsExporter> exporter;
+    if (profile_iters == 0 && check_wts.empty() && record_path.empty()) exporter.reset(new MetricsExporter(metrics(), METRICS_PORT, METRICS_FILE, METRICS_DUMP_SEC));
+
+    if (shm_input || ffmpeg_input || profile_iters > 0 || !check_wts.empty() || !record_path.empty()) {
+        int ret = shm_input ? run_shm_sources(*context, stream, buffers, data, prob, img_dir)
+                : !record_path.empty() ? run_record_detections(*context, stream, buffers, data, prob, engine_name, img_dir, file_names, record_path)
+#ifdef USE_FFMPEG
+                : ffmpeg_input ? run_ffmpeg_sources(*context, stream, buffers, data, prob, img_dir)
+#endif
+                : profile_iters > 0 ? run_layer_profile(*context, buffers, data, profile_iters, "layer_profile.json")
+                : run_parity_check(*context, stream, buffers, data, prob, check_wts, model, img_dir);
+        cudaStreamDestroy(stream);
+        CUDA_CHECK(cudaFree(buffers[inputIndex]));
+        CUDA_CHECK(cudaFree(buffers[outputIndex]));
+        context->destroy();
+        engine->destroy();
+        runtime->destroy();
+        return ret;
+    }
+
     // 图像检测
 //    auto t_start = std::chrono::high_resolution_clock::now();
 //    int fcount = 0;
@@ -456,68 +1477,103 @@ int main(int argc, char** argv) {
      img_h.push_back(img0_h);
      img_h.push_back(img1_h);
     
+     // 每路摄像头一个跟踪器和一个关键帧调度器
+     std::vector<Tracker> trackers(img_w.size());
+     std::vector<KeyframeScheduler> schedulers(img_w.size(), KeyframeScheduler(scheduler_config()));
+     std::vector<Yolo::TrackedDetection> tracks;
+     long long frame_idx = 0;
+     size_t readback_bytes = 0;
+     long long readback_images = 0;
+
+     // 推理前裁剪到ROI的外接矩形, nms前丢掉中心不在ROI内的候选框
+     std::vector<Yolo::SourceRoi> rois = load_rois(img_w.size());
+     std::vector<Yolo::RoiCrop> crops(img_w.size());
+     for (size_t b = 0; b < img_w.size(); b++) crops[b] = roi_crop(rois[b], img_w[b], img_h[b]);
+
+     std::vector<std::unique_ptr<SourceMetrics>> sm;
+     for (size_t b = 0; b < img_w.size(); b++) sm.emplace_back(new SourceMetrics(b));
+
      cv::Mat img0;
      cv::Mat img1;
      while (1){
          cap0 >> img0;
          cap1 >> img1;
          if (img0.empty() || img1.empty()) continue;
+         auto t_read = std::chrono::steady_clock::now();
 
          std::vector<cv::Mat> img;
          img.push_back(img0);
          img.push_back(img1);
+         int num_src = img.size();
+         for (int b = 0; b < num_src; b++) sm[b]->on_frame();
 
-         cv::Mat pr_img0 = preprocess_img(img0, INPUT_W, INPUT_H); // letterbox
-         cv::Mat pr_img1 = preprocess_img(img1, INPUT_W, INPUT_H); // letterbox
-         std::vector<cv::Mat> pr_img;
-         pr_img.push_back(pr_img0);
-         pr_img.push_back(pr_img1);
-
-         // for (int b = 0; b < BATCH_SIZE; b++) {
-         //     cv::imshow(std::to_string(b), pr_img[b]);
-         //     cv::waitKey(1);
-         // }
-
-         for (int b = 0; b < BATCH_SIZE; b++) {
-             int i = 0;
-             for (int row = 0; row < INPUT_H; ++row) {
-                 uchar* uc_pixel = pr_img[b].data + row * pr_img[b].step;
-                 for (int col = 0; col < INPUT_W; ++col) {
-                     data[i + b * 3 * INPUT_H * INPUT_W] = (float)uc_pixel[2] / 255.0;
-                     data[i + INPUT_H * INPUT_W + b * 3 * INPUT_H * INPUT_W] = (float)uc_pixel[1] / 255.0;
-                     data[i + 2 * INPUT_H * INPUT_W + b * 3 * INPUT_H * INPUT_W] = (float)uc_pixel[0] / 255.0;
-                     uc_pixel += 3;
-                     ++i;
-                 }
-             }
+         std::vector<std::vector<Yolo::Detection>> batch_res(num_src);
+         std::vector<char> inferred(num_src, 0);
+
+         // 只把需要推理的源放进batch, batch_src[i]为batch中第i张图对应的源, lbs[i]为它的letterbox参数
+         std::vector<int> batch_src;
+         std::vector<cv::Mat> canvases;
+         std::vector<Yolo::Letterbox> lbs;
+         for (int b = 0; b < num_src; b++) {
+             if (!schedulers[b].decide(img[b])) continue;
+#if TILE_MODE
+             auto t_tile = std::chrono::high_resolution_clock::now();
+             infer_tiled(*context, stream, buffers, data, prob, img[b], batch_res[b]);
+             inferred[b] = 1;
+             schedulers[b].onInference(std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - t_tile).count());
+             continue;
+#endif
+             cv::Mat roi_img = img[b](cv::Rect(crops[b].x, crops[b].y, crops[b].w, crops[b].h));
+             lbs.push_back(make_letterbox(roi_img.cols, roi_img.rows));
+             canvases.push_back(letterbox_img(roi_img, lbs.back()));
+             batch_src.push_back(b);
          }
-         // Run inference
-         doInference(*context, stream, buffers, data, prob, BATCH_SIZE);
- 
-         std::vector<std::vector<Yolo::Detection>> batch_res(BATCH_SIZE);
-
-         for (int b = 0; b < BATCH_SIZE; b++) {
-             auto& res = batch_res[b];
-             nms(res, &prob[b * OUTPUT_SIZE], CONF_THRESH, NMS_THRESH);
-             std::cout << "res1:" << res.size() << std::endl;
-             xywh2xyxy(res);
-             std::cout << "img_w:" << img_w[b] << std::endl;
-             std::cout << "img_h:" << img_h[b] << std::endl;
-             scale_coords(res, img_w[b], img_h[b]);
-             std::cout << "res2:" << res.size() << std::endl;
+
+         if (!batch_src.empty()) {
+             // Run inference
+             pipeline_metrics().queue_depth.set(batch_src.size());
+             auto t_start = std::chrono::high_resolution_clock::now();
+             readback_bytes += infer_canvases(*context, stream, buffers, data, prob, canvases, lbs);
+             readback_images += batch_src.size();
+             auto t_end = std::chrono::high_resolution_clock::now();
+             float infer_ms = std::chrono::duration<float, std::milli>(t_end - t_start).count();
+
+             for (size_t i = 0; i < batch_src.size(); i++) {
+                 int b = batch_src[i];
+                 auto& res = batch_res[b];
+                 roi_detections(res, &prob[i * OUTPUT_SIZE], rois[b], crops[b], lbs[i]);
+                 inferred[b] = 1;
+                 schedulers[b].onInference(infer_ms / batch_src.size());
+             }
          }
         
-         for (int b = 0; b < BATCH_SIZE; b++){
-             auto& res = batch_res[b];
-             for (size_t j = 0; j < res.size(); j++) {
-                 // cv::Rect r = get_rect(img, batch_res[j].bbox);
-                 cv::Rect r = cv::Rect(res[j].bbox[0], res[j].bbox[1], res[j].bbox[2] - res[j].bbox[0], res[j].bbox[3] - res[j].bbox[1]);
+         for (int b = 0; b < num_src; b++){
+             // 非关键帧: 用卡尔曼预测传播上一帧的框
+             if (inferred[b]) trackers[b].update(batch_res[b], tracks);
+             else trackers[b].predict(tracks);
+             if (inferred[b]) sm[b]->inferred.inc();
+             sm[b]->on_tracked(tracks.size(), t_read);
+             for (size_t j = 0; j < tracks.size(); j++) {
+                 const float* bbox = tracks[j].det.bbox;
+                 cv::Rect r = cv::Rect(bbox[0], bbox[1], bbox[2] - bbox[0], bbox[3] - bbox[1]);
                  cv::rectangle(img[b], r, cv::Scalar(0x27, 0xC1, 0x36), 2);
-                 cv::putText(img[b], std::to_string((int)res[j].class_id), cv::Point(r.x, r.y - 1), cv::FONT_HERSHEY_PLAIN, 1.2, cv::Scalar(0xFF, 0xFF, 0xFF), 2);
+                 cv::putText(img[b], std::to_string((int)tracks[j].det.class_id) + ":" + std::to_string(tracks[j].track_id), cv::Point(r.x, r.y - 1), cv::FONT_HERSHEY_PLAIN, 1.2, cv::Scalar(0xFF, 0xFF, 0xFF), 2);
              }
              cv::imshow(std::to_string(b), img[b]);
              cv::waitKey(1);
          }
+
+         if (++frame_idx % 100 == 0) {
+             if (readback_images > 0) {
+                 std::cout << "D2H " << readback_bytes / readback_images << " bytes/image (full copy " << OUTPUT_SIZE * sizeof(float) << ")" << std::endl;
+             }
+             for (int b = 0; b < num_src; b++) {
+                 const SchedulerMetrics& m = schedulers[b].metrics();
+                 sm[b]->interval.set(m.interval);
+                 std::cout << "source " << b << ": interval " << m.interval << ", inference rate " << m.inference_rate
+                           << "/s, skip ratio " << m.skipRatio() << std::endl;
+             }
+         }
      }
 
 
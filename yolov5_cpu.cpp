@@ -0,0 +1,213 @@
+// 不依赖GPU的推理: 与build_engine生成同一张网络图(yolov5_graph.h), 由graph_cpu.h的CpuExecutor在CPU上执行
+// 前后处理(letterbox、分组成batch、NMS)使用detector.h中的Detector, 与pyyolov5相同
+// 用法: ./yolov5_cpu [.wts] [s/m/l/x, c gd gw or model.yaml] ../samples
+// -q: 在校准集上做INT8混合精度搜索(precision_search.h), 输出build_engine使用的精度配置
+// -b: 图片解码速度测试, 比较各JPEG DCT缩放倍数(image_decode.h)
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include "common.hpp"
+#include "yolov5_graph.h"
+#include "graph_cpu.h"
+#include "detector.h"
+#include "precision_search.h"
+#include "image_decode.h"
+
+#define NMS_THRESH 0.5
+#define CONF_THRESH 0.45
+#define BATCH_SIZE 4
+#define SEARCH_IMAGES 16  // 混合精度搜索使用的校准图片数, 每个模块都要在这些图片上推理一遍
+#define PRECISION_PROFILE "precision_profile.txt"
+
+class CpuBackend : public InferBackend {
+public:
+    CpuBackend(const std::string& wts, const ModelConfig& model, int max_batch, int max_input) : max_batch_(max_batch), max_input_(max_input) {
+        // 权重和BN折叠结果都在arena_中, 与图的生命周期相同
+        ArenaScope arena_scope(arena_);
+        std::map<std::string, Weights> weightMap = loadWeights(wts, &pool_);
+        fuseConvBatchNorm(weightMap, pool_, 1e-3);
+        build_yolov5(graph_, weight_table(weightMap), model, Yolo::INPUT_W, Yolo::INPUT_H, Yolo::MAX_OUTPUT_BBOX_COUNT);
+        executor_.reset(new CpuExecutor(graph_, pool_));
+    }
+
+    int maxBatch() const override { return max_batch_; }
+    int maxInput() const override { return max_input_; }
+    int outputSize() const override { return graph_.channels(graph_.outputs()[0]); }
+    bool nmsInEngine() const override { return false; }
+
+    void infer(const float* input, int batch, int input_h, int input_w, float* output) override {
+        executor_->run(input, batch, input_h, input_w);
+        const CpuTensor& out = executor_->output(0);
+        memcpy(output, out.data.data(), out.data.size() * sizeof(float));
+    }
+
+    int threads() const { return pool_.size(); }
+
+private:
+    WeightArena arena_;
+    ThreadPool pool_;
+    ir::Graph graph_;
+    std::unique_ptr<CpuExecutor> executor_;
+    int max_batch_;
+    int max_input_;
+};
+
+// 校准集与Int8EntropyCalibrator2相同: letterbox到INPUT_W x INPUT_H, 取前SEARCH_IMAGES张
+int run_precision_search(const std::string& wts, const ModelConfig& model, const std::string& calib_dir, float budget) {
+    std::vector<std::string> file_names;
+    if (read_files_in_dir(calib_dir.c_str(), file_names) < 0) {
+        std::cerr << "read_files_in_dir failed." << std::endl;
+        return -1;
+    }
+    const size_t image_size = 3 * Yolo::INPUT_H * Yolo::INPUT_W;
+    std::vector<float> images;
+    int count = 0;
+    for (size_t i = 0; i < file_names.size() && count < SEARCH_IMAGES; i++) {
+        cv::Mat img = imread_for_input(calib_dir + "/" + file_names[i], Yolo::INPUT_W, Yolo::INPUT_H);
+        if (img.empty()) continue;
+        images.resize((count + 1) * image_size);
+        Yolo::Letterbox lb = fixed_letterbox(img.cols, img.rows, Yolo::INPUT_W, Yolo::INPUT_H);
+        blob_from_img(letterbox_img(img, lb), &images[count * image_size], Yolo::INPUT_W, Yolo::INPUT_H);
+        count++;
+    }
+    if (count == 0) {
+        std::cerr << "no calibration images in " << calib_dir << std::endl;
+        return -1;
+    }
+
+    WeightArena arena;
+    ArenaScope arena_scope(arena);
+    ThreadPool pool;
+    std::map<std::string, Weights> weightMap = loadWeights(wts, &pool);
+    fuseConvBatchNorm(weightMap, pool, 1e-3);
+    ir::Graph graph;
+    build_yolov5(graph, weight_table(weightMap), model, Yolo::INPUT_W, Yolo::INPUT_H, Yolo::MAX_OUTPUT_BBOX_COUNT);
+
+    PrecisionSearchConfig config;
+    config.budget = budget;
+    config.conf_thresh = CONF_THRESH;
+    config.nms_thresh = NMS_THRESH;
+    std::cout << "Mixed precision search on " << count << " images, F1 budget " << budget << std::endl;
+    PrecisionSearch search(graph, pool, images, count, Yolo::INPUT_H, Yolo::INPUT_W, config);
+    PrecisionPlan plan = search.run();
+    std::cout << plan.pinned.size() << "/" << plan.ranking.size() << " modules kept FP16, INT8 convs " << plan.int8_convs << "/" << plan.total_convs
+              << ", F1 vs FP32: all INT8 " << plan.int8_f1 << ", mixed " << plan.final_f1 << std::endl;
+    if (!write_precision_profile(PRECISION_PROFILE, plan, config)) {
+        std::cerr << "could not write " << PRECISION_PROFILE << std::endl;
+        return -1;
+    }
+    std::cout << "Wrote " << PRECISION_PROFILE << ", copy it next to ./yolov5 and build with USE_INT8" << std::endl;
+    return 0;
+}
+
+// 解码速度: 每张图按完整解码和1/2, 1/4, 1/8 DCT缩放各解码若干次, 按原图尺寸分组输出每张耗时和吞吐(原图百万像素/秒)
+// auto为imread_for_input对网络输入(rect模式, 长边max(INPUT_W, INPUT_H))选择的缩放
+int run_decode_benchmark(const std::string& img_dir) {
+    std::vector<std::string> file_names;
+    if (read_files_in_dir(img_dir.c_str(), file_names) < 0) {
+        std::cerr << "read_files_in_dir failed." << std::endl;
+        return -1;
+    }
+    const int scales[] = { 1, 2, 4, 8 };
+    const int long_side = std::max(Yolo::INPUT_W, Yolo::INPUT_H);
+    struct SizeStats {
+        int images = 0;
+        int auto_scale = 1;
+        double ms[4] = { 0, 0, 0, 0 };
+    };
+    std::map<std::pair<int, int>, SizeStats> stats;
+    for (const auto& name : file_names) {
+        std::vector<uchar> buf;
+        int w = 0, h = 0;
+        if (!read_file_bytes(img_dir + "/" + name, buf)) continue;
+        if (!jpeg_size(buf, w, h)) {
+            std::cout << name << ": not a JPEG, always fully decoded" << std::endl;
+            continue;
+        }
+        SizeStats& s = stats[std::make_pair(w, h)];
+        s.images++;
+        s.auto_scale = jpeg_scale_for(w, h, long_side, long_side);
+        for (int k = 0; k < 4; k++) {
+            const int repeats = 5;
+            auto start = std::chrono::high_resolution_clock::now();
+            for (int r = 0; r < repeats; r++) cv::imdecode(buf, reduced_flag(scales[k]));
+            s.ms[k] += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / repeats;
+        }
+    }
+    for (const auto& it : stats) {
+        const SizeStats& s = it.second;
+        const double mp = it.first.first * (double)it.first.second / 1e6;
+        std::cout << it.first.first << "x" << it.first.second << " (" << s.images << " images):";
+        for (int k = 0; k < 4; k++) {
+            double ms = s.ms[k] / s.images;
+            std::cout << (k ? ", 1/" + std::to_string(scales[k]) : std::string(" full")) << " " << ms << " ms (" << mp * 1000.0 / ms << " MP/s)";
+        }
+        std::cout << "; auto for " << long_side << ": " << (s.auto_scale > 1 ? "1/" + std::to_string(s.auto_scale) : std::string("full")) << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::string(argv[1]) == "-b") return run_decode_benchmark(argv[2]);
+    // 普通模式: [.wts] [模型] [图片目录]; -q: -q [.wts] [模型] [校准图片目录] [budget]
+    const bool search = argc > 1 && std::string(argv[1]) == "-q";
+    const int first = search ? 2 : 1;
+    const int trailing = search ? 2 : 1;
+    ModelConfig model;
+    bool ok = argc == first + 2 + trailing || argc == first + 4 + trailing;
+    if (ok) {
+        std::string net = argv[first + 1];
+        if (net == "c" && argc == first + 4 + trailing) {
+            model = yolov5_p6_config(atof(argv[first + 2]), atof(argv[first + 3]));
+        } else {
+            ok = argc == first + 2 + trailing && model_from_arg(net, model);
+        }
+    }
+    if (!ok) {
+        std::cerr << "arguments not right!" << std::endl;
+        std::cerr << "./yolov5_cpu [.wts] [s/m/l/x, c gd gw or model.yaml] ../samples  // run inference on CPU" << std::endl;
+        std::cerr << "./yolov5_cpu -b ../samples  // JPEG decode throughput per DCT scale" << std::endl;
+        std::cerr << "./yolov5_cpu -q [.wts] [s/m/l/x, c gd gw or model.yaml] ./coco_calib 0.02  // INT8 mixed precision search, writes " << PRECISION_PROFILE << std::endl;
+        return -1;
+    }
+    if (search) return run_precision_search(argv[first], model, argv[argc - 2], (float)atof(argv[argc - 1]));
+    std::string img_dir = argv[argc - 1];
+    std::vector<std::string> file_names;
+    if (read_files_in_dir(img_dir.c_str(), file_names) < 0) {
+        std::cerr << "read_files_in_dir failed." << std::endl;
+        return -1;
+    }
+
+    auto backend = std::make_shared<CpuBackend>(argv[1], model, BATCH_SIZE, std::max(Yolo::INPUT_W, Yolo::INPUT_H));
+    std::cout << "CPU executor on " << backend->threads() << " threads" << std::endl;
+    DetectorConfig config;
+    config.conf_thresh = CONF_THRESH;
+    config.nms_thresh = NMS_THRESH;
+    Detector detector(backend, config);
+
+    for (size_t f = 0; f < file_names.size(); f += BATCH_SIZE) {
+        std::vector<cv::Mat> frames;
+        std::vector<std::string> names;
+        for (size_t i = f; i < std::min(file_names.size(), f + BATCH_SIZE); i++) {
+            // 大JPEG按DCT缩放解码, 结果图与解码后的尺寸相同
+            cv::Mat img = imread_for_input(img_dir + "/" + file_names[i], backend->maxInput(), backend->maxInput());
+            if (img.empty()) continue;
+            frames.push_back(img);
+            names.push_back(file_names[i]);
+        }
+        auto start = std::chrono::system_clock::now();
+        auto results = detector.detect(frames);
+        auto end = std::chrono::system_clock::now();
+        std::cout << frames.size() << " images in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms" << std::endl;
+        for (size_t b = 0; b < frames.size(); b++) {
+            for (const auto& det : results[b]) {
+                cv::Rect r = cv::Rect(det.bbox[0], det.bbox[1], det.bbox[2] - det.bbox[0], det.bbox[3] - det.bbox[1]);
+                cv::rectangle(frames[b], r, cv::Scalar(0x27, 0xC1, 0x36), 2);
+                cv::putText(frames[b], std::to_string((int)det.class_id), cv::Point(r.x, r.y - 1), cv::FONT_HERSHEY_PLAIN, 1.2, cv::Scalar(0xFF, 0xFF, 0xFF), 2);
+            }
+            cv::imwrite("_" + names[b], frames[b]);
+        }
+    }
+    return 0;
+}
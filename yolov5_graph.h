@@ -0,0 +1,334 @@
+#ifndef TRTX_YOLOV5_YOLOV5_GRAPH_H_
+#define TRTX_YOLOV5_YOLOV5_GRAPH_H_
+
+// yolov5网络的定义, 只生成graph_ir.h中的节点, 由graph_trt.h降到TensorRT或由graph_cpu.h在CPU上执行
+// 结构由模型配置(model_config.h, 与PyTorch的模型yaml相同的层表)决定, 内置P6结构, 也可以读入P5或裁剪过的yaml, head数量任意
+// 模块与PyTorch模型的model.N一一对应, 每个模块建完后tag, 层名/分析表据此对应回model.N
+// Detect的1x1卷积归入其model.N(P6为"model.33"), YoloDecode归入"model.N.yolo"
+// BN已经由fuseConvBatchNorm折叠时卷积直接带bias, 否则卷积后接scale节点(scale/shift分配在当前WeightArena中)
+
+#include <math.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "graph_ir.h"
+#include "model_config.h"
+#include "weight_arena.h"
+#include "yolo_types.h"
+
+static int get_width(int x, float gw, int divisor = 8) {
+    //return math.ceil(x / divisor) * divisor
+    if (int(x * gw) % divisor == 0) {
+        return int(x * gw);
+    }
+    return (int(x * gw / divisor) + 1) * divisor;
+}
+
+static int get_depth(int x, float gd) {
+    if (x == 1) {
+        return 1;
+    } else {
+        return round(x * gd) > 1 ? round(x * gd) : 1;
+    }
+}
+
+// s/m/l/x -> (depth_multiple, width_multiple), 其他名称返回false
+static inline bool model_multiples(const std::string& net, float& gd, float& gw) {
+    if (net == "s") {
+        gd = 0.33;
+        gw = 0.50;
+    } else if (net == "m") {
+        gd = 0.67;
+        gw = 0.75;
+    } else if (net == "l") {
+        gd = 1.0;
+        gw = 1.0;
+    } else if (net == "x") {
+        gd = 1.33;
+        gw = 1.25;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static inline ir::Blob weight_blob(const ir::WeightTable& weights, const std::string& name) {
+    auto it = weights.find(name);
+    assert(it != weights.end() && "missing weight blob, does the .wts match the model?");
+    return it->second;
+}
+
+int batchNorm2d(ir::Graph& g, const ir::WeightTable& weights, int input, const std::string& lname, float eps) {
+    const float *gamma = weight_blob(weights, lname + ".weight").data;
+    const float *beta = weight_blob(weights, lname + ".bias").data;
+    const float *mean = weight_blob(weights, lname + ".running_mean").data;
+    ir::Blob var = weight_blob(weights, lname + ".running_var");
+    int len = (int)var.count;
+
+    float *scval = builder_arena().allocate_array<float>(len);
+    float *shval = builder_arena().allocate_array<float>(len);
+    for (int i = 0; i < len; i++) {
+        scval[i] = gamma[i] / sqrt(var.data[i] + eps);
+        shval[i] = beta[i] - mean[i] * gamma[i] / sqrt(var.data[i] + eps);
+    }
+    return g.scale(input, ir::Blob{ scval, len }, ir::Blob{ shval, len });
+}
+
+// conv -> (bn) -> silu, silu = x * sigmoid(x)
+int convBlock(ir::Graph& g, const ir::WeightTable& weights, int input, int outch, int ksize, int s, int groups, const std::string& lname) {
+    auto fused = weights.find(lname + ".conv.fused_weight");
+    int y;
+    if (fused != weights.end()) {
+        y = g.conv(input, outch, ksize, s, groups, fused->second, weight_blob(weights, lname + ".conv.fused_bias"));
+    } else {
+        y = g.conv(input, outch, ksize, s, groups, weight_blob(weights, lname + ".conv.weight"), ir::Blob{ nullptr, 0 });
+        y = batchNorm2d(g, weights, y, lname + ".bn", 1e-3);
+    }
+    return g.mul(y, g.sigmoid(y));
+}
+
+// [N, C, H, W] -> 隔行隔列取4份再按通道拼接 -> [N, 4C, H/2, W/2] -> convBlock
+int focus(ir::Graph& g, const ir::WeightTable& weights, int input, int outch, int ksize, const std::string& lname) {
+    int s1 = g.slice2x(input, 0, 0);
+    int s2 = g.slice2x(input, 1, 0);
+    int s3 = g.slice2x(input, 0, 1);
+    int s4 = g.slice2x(input, 1, 1);
+    int cat = g.concat({ s1, s2, s3, s4 });
+    return convBlock(g, weights, cat, outch, ksize, 1, 1, lname + ".conv");
+}
+
+int bottleneck(ir::Graph& g, const ir::WeightTable& weights, int input, int c1, int c2, bool shortcut, int groups, float e, const std::string& lname) {
+    int cv1 = convBlock(g, weights, input, (int)((float)c2 * e), 1, 1, 1, lname + ".cv1");
+    int cv2 = convBlock(g, weights, cv1, c2, 3, 1, groups, lname + ".cv2");
+    if (shortcut && c1 == c2) return g.add(input, cv2);
+    return cv2;
+}
+
+int bottleneckCSP(ir::Graph& g, const ir::WeightTable& weights, int input, int c1, int c2, int n, bool shortcut, int groups, float e, const std::string& lname) {
+    int c_ = (int)((float)c2 * e);
+    int cv1 = convBlock(g, weights, input, c_, 1, 1, 1, lname + ".cv1");
+    int cv2 = g.conv(input, c_, 1, 1, 1, weight_blob(weights, lname + ".cv2.weight"), ir::Blob{ nullptr, 0 });
+    int y1 = cv1;
+    for (int i = 0; i < n; i++) {
+        y1 = bottleneck(g, weights, y1, c_, c_, shortcut, groups, 1.0, lname + ".m." + std::to_string(i));
+    }
+    int cv3 = g.conv(y1, c_, 1, 1, 1, weight_blob(weights, lname + ".cv3.weight"), ir::Blob{ nullptr, 0 });
+    int cat = g.concat({ cv3, cv2 });
+    int bn = batchNorm2d(g, weights, cat, lname + ".bn", 1e-4);
+    int lr = g.leaky_relu(bn, 0.1);
+    return convBlock(g, weights, lr, c2, 1, 1, 1, lname + ".cv4");
+}
+
+int C3(ir::Graph& g, const ir::WeightTable& weights, int input, int c1, int c2, int n, bool shortcut, int groups, float e, const std::string& lname) {
+    int c_ = (int)((float)c2 * e);
+    int cv1 = convBlock(g, weights, input, c_, 1, 1, 1, lname + ".cv1");
+    int cv2 = convBlock(g, weights, input, c_, 1, 1, 1, lname + ".cv2");
+    int y1 = cv1;
+    for (int i = 0; i < n; i++) {
+        y1 = bottleneck(g, weights, y1, c_, c_, shortcut, groups, 1.0, lname + ".m." + std::to_string(i));
+    }
+    int cat = g.concat({ y1, cv2 });
+    return convBlock(g, weights, cat, c2, 1, 1, 1, lname + ".cv3");
+}
+
+int SPP(ir::Graph& g, const ir::WeightTable& weights, int input, int c1, int c2, const std::vector<int>& ks, const std::string& lname) {
+    int c_ = c1 / 2;
+    int cv1 = convBlock(g, weights, input, c_, 1, 1, 1, lname + ".cv1");
+    std::vector<int> cat_inputs{ cv1 };
+    for (int k : ks) cat_inputs.push_back(g.max_pool(cv1, k));
+    int cat = g.concat(cat_inputs);
+    return convBlock(g, weights, cat, c2, 1, 1, 1, lname + ".cv2");
+}
+
+// Detect: 每个head一个1x1卷积(带bias), 之后由YoloDecode解码
+// heads/strides按stride从小到大(P3, P4, ...)给出, 对应<lname>.m.0, m.1, ...; YoloDecode的输入顺序相反(stride最大的在前), 与YoloLayer插件一致
+// anchor优先取权重中的<lname>.anchor_grid(训练时可能被autoanchor修改过), 没有时用配置中的anchors; 取整, 与YoloLayer插件的参数(int)一致
+int detect(ir::Graph& g, const ir::WeightTable& weights, const std::vector<int>& heads, const std::vector<int>& strides,
+           const std::vector<std::vector<float>>& anchors, int classes, int net_w, int net_h, int max_out, const std::string& lname) {
+    const int na = Yolo::CHECK_COUNT;
+    auto grid = weights.find(lname + ".anchor_grid");
+    bool from_weights = grid != weights.end();
+    assert(from_weights ? grid->second.count == (int64_t)heads.size() * na * 2 : anchors.size() == heads.size());
+    ir::YoloParams params;
+    params.classes = classes;
+    params.max_out = max_out;
+    params.net_width = net_w;
+    params.net_height = net_h;
+    std::vector<int> dets;
+    for (int k = (int)heads.size() - 1; k >= 0; k--) {
+        std::string m = lname + ".m." + std::to_string(k);
+        dets.push_back(g.conv(heads[k], na * (classes + 5), 1, 1, 1, weight_blob(weights, m + ".weight"), weight_blob(weights, m + ".bias")));
+        ir::YoloHead head;
+        head.stride = strides[k];
+        for (int i = 0; i < na * 2; i++) {
+            float a = from_weights ? grid->second.data[k * na * 2 + i] : anchors[k][i];
+            head.anchors.push_back((float)(int)a);
+        }
+        params.heads.push_back(head);
+    }
+    g.tag(lname, "Detect");
+    int yolo = g.yolo_decode(dets, params);
+    g.tag(lname + ".yolo", "YoloLayer");
+    return yolo;
+}
+
+// 按配置的层表生成网络, 第i层的权重前缀为"model.i", 输出为YoloDecode节点
+// 每层的输出通道和stride在生成时推算: 通道数按width_multiple取整到8的倍数, 重复次数按depth_multiple缩放(与yolov5的parse_model相同)
+int build_yolov5(ir::Graph& g, const ir::WeightTable& weights, const ModelConfig& cfg, int net_w, int net_h, int max_out) {
+    const float gd = cfg.depth_multiple, gw = cfg.width_multiple;
+    int data = g.input(3);
+    std::vector<int> outs, chs, strides;
+    int yolo = -1;
+    for (int i = 0; i < (int)cfg.layers.size(); i++) {
+        const LayerSpec& layer = cfg.layers[i];
+        const std::vector<CfgValue>& args = layer.args.items;
+        std::string lname = "model." + std::to_string(i);
+        std::string module = layer.module.compare(0, 3, "nn.") == 0 ? layer.module.substr(3) : layer.module;
+        std::vector<int> from;
+        for (int f : layer.from) {
+            int idx = f < 0 ? i + f : f;
+            assert(idx < i && "layer inputs must come before the layer");
+            from.push_back(idx);
+        }
+        int x = from[0] < 0 ? data : outs[from[0]];
+        int c1 = from[0] < 0 ? 3 : chs[from[0]];
+        int stride = from[0] < 0 ? 1 : strides[from[0]];
+        int n = get_depth(layer.number, gd);
+        int y, c2;
+        if (module == "Focus") {
+            c2 = get_width(args[0].as_int(), gw);
+            y = focus(g, weights, x, c2, args.size() > 1 ? args[1].as_int() : 1, lname);
+            stride *= 2;
+        } else if (module == "Conv") {
+            c2 = get_width(args[0].as_int(), gw);
+            int s = args.size() > 2 ? args[2].as_int() : 1;
+            y = convBlock(g, weights, x, c2, args.size() > 1 ? args[1].as_int() : 1, s, 1, lname);
+            stride *= s;
+        } else if (module == "C3" || module == "BottleneckCSP") {
+            c2 = get_width(args[0].as_int(), gw);
+            bool shortcut = args.size() < 2 || args[1].text != "False";
+            y = module == "C3" ? C3(g, weights, x, c1, c2, n, shortcut, 1, 0.5, lname)
+                               : bottleneckCSP(g, weights, x, c1, c2, n, shortcut, 1, 0.5, lname);
+        } else if (module == "SPP") {
+            c2 = get_width(args[0].as_int(), gw);
+            std::vector<int> ks{ 5, 9, 13 };
+            if (args.size() > 1) {
+                ks.clear();
+                for (const auto& k : args[1].items) ks.push_back(k.as_int());
+            }
+            y = SPP(g, weights, x, c1, c2, ks, lname);
+        } else if (module == "Upsample") {
+            int scale = args.size() > 1 ? args[1].as_int() : 2;
+            c2 = c1;
+            y = g.resize(x, scale); // 输入宽高为最大stride的倍数时与另一支路的尺寸一致
+            stride /= scale;
+        } else if (module == "Concat") {
+            std::vector<int> xs;
+            c2 = 0;
+            for (int f : from) {
+                xs.push_back(outs[f]);
+                c2 += chs[f];
+            }
+            y = g.concat(xs);
+        } else if (module == "Detect") {
+            std::vector<int> heads, head_strides;
+            for (int f : from) {
+                heads.push_back(outs[f]);
+                head_strides.push_back(strides[f]);
+            }
+            y = yolo = detect(g, weights, heads, head_strides, cfg.anchors, cfg.nc, net_w, net_h, max_out, lname);
+            c2 = 0;
+        } else {
+            std::cerr << lname << ": unsupported module " << layer.module << std::endl;
+            assert(false && "unsupported module in model config");
+            return -1;
+        }
+        if (module != "Detect") g.tag(lname, module);
+        outs.push_back(y);
+        chs.push_back(c2);
+        strides.push_back(stride);
+    }
+    assert(yolo >= 0 && "model config has no Detect layer");
+    g.mark_output(yolo);
+    return yolo;
+}
+
+// 内置的P6结构(yolov5s6/m6/l6/x6, 本项目v4.0 P6的层表), s/m/l/x和c gd gw使用
+static const char* kYoloV5P6Yaml = R"(
+anchors:
+  - [19,27, 44,40, 38,94]  # P3/8
+  - [96,68, 86,152, 180,137]  # P4/16
+  - [140,301, 303,264, 238,542]  # P5/32
+  - [436,615, 739,380, 925,792]  # P6/64
+
+backbone:
+  # [from, number, module, args]
+  [[-1, 1, Focus, [64, 3]],  # 0-P1/2
+   [-1, 1, Conv, [128, 3, 2]],  # 1-P2/4
+   [-1, 3, C3, [128]],
+   [-1, 1, Conv, [256, 3, 2]],  # 3-P3/8
+   [-1, 9, C3, [256]],
+   [-1, 1, Conv, [512, 3, 2]],  # 5-P4/16
+   [-1, 9, C3, [512]],
+   [-1, 1, Conv, [768, 3, 2]],  # 7-P5/32
+   [-1, 3, C3, [768]],
+   [-1, 1, Conv, [1024, 3, 2]],  # 9-P6/64
+   [-1, 1, SPP, [1024, [3, 5, 7]]],
+   [-1, 3, C3, [1024, False]],  # 11
+  ]
+
+head:
+  [[-1, 1, Conv, [768, 1, 1]],
+   [-1, 1, nn.Upsample, [None, 2, 'nearest']],
+   [[-1, 8], 1, Concat, [1]],  # cat backbone P5
+   [-1, 3, C3, [768, False]],  # 15
+   [-1, 1, Conv, [512, 1, 1]],
+   [-1, 1, nn.Upsample, [None, 2, 'nearest']],
+   [[-1, 6], 1, Concat, [1]],  # cat backbone P4
+   [-1, 3, C3, [512, False]],  # 19
+   [-1, 1, Conv, [256, 1, 1]],
+   [-1, 1, nn.Upsample, [None, 2, 'nearest']],
+   [[-1, 4], 1, Concat, [1]],  # cat backbone P3
+   [-1, 3, C3, [256, False]],  # 23 (P3/8-small)
+   [-1, 1, Conv, [256, 3, 2]],
+   [[-1, 20], 1, Concat, [1]],  # cat head P4
+   [-1, 3, C3, [512, False]],  # 26 (P4/16-medium)
+   [-1, 1, Conv, [512, 3, 2]],
+   [[-1, 16], 1, Concat, [1]],  # cat head P5
+   [-1, 3, C3, [768, False]],  # 29 (P5/32-large)
+   [-1, 1, Conv, [768, 3, 2]],
+   [[-1, 12], 1, Concat, [1]],  # cat head P6
+   [-1, 3, C3, [1024, False]],  # 32 (P6/64-xlarge)
+   [[23, 26, 29, 32], 1, Detect, [nc, anchors]],  # Detect(P3, P4, P5, P6)
+  ]
+)";
+
+static inline ModelConfig yolov5_p6_config(float gd, float gw) {
+    ModelConfig cfg;
+    std::string err;
+    bool ok = parse_model_config(std::string("nc: ") + std::to_string(Yolo::CLASS_NUM) + "\n" + kYoloV5P6Yaml, cfg, err);
+    assert(ok && "built-in P6 config");
+    (void)ok;
+    cfg.depth_multiple = gd;
+    cfg.width_multiple = gw;
+    return cfg;
+}
+
+// 命令行中的模型: s/m/l/x为内置P6结构的4种大小; 以.yaml结尾时读取模型yaml(nc、depth/width_multiple都来自文件)
+// c gd gw(自定义系数的P6)由调用方用yolov5_p6_config处理
+static inline bool model_from_arg(const std::string& net, ModelConfig& cfg) {
+    float gd, gw;
+    if (net.size() > 5 && net.compare(net.size() - 5, 5, ".yaml") == 0) {
+        std::string err;
+        if (!load_model_config(net, cfg, err)) {
+            std::cerr << err << std::endl;
+            return false;
+        }
+        return true;
+    }
+    if (!model_multiples(net, gd, gw)) return false;
+    cfg = yolov5_p6_config(gd, gw);
+    return true;
+}
+
+#endif  // TRTX_YOLOV5_YOLOV5_GRAPH_H_
@@ -0,0 +1,45 @@
+"""
+The same example as yolov5_trt.py on top of the pyyolov5 extension (pyyolov5.cpp).
+Letterbox, batched inference and NMS run in C++ with the GIL released, no pycuda/torch needed.
+Build with `cmake -DBUILD_PYTHON=ON ..` and put build/ on PYTHONPATH.
+"""
+import ctypes
+import os
+import sys
+
+import cv2
+
+import pyyolov5
+
+CONF_THRESH = 0.5
+IOU_THRESHOLD = 0.4
+
+
+if __name__ == "__main__":
+    # load custom plugins
+    PLUGIN_LIBRARY = "./build/libmyplugins.so"
+    ctypes.CDLL(PLUGIN_LIBRARY)
+    engine_file_path = "./build/yolov5s6.engine"
+
+    categories = ['car', 'bus', 'person', 'bike', 'truck', 'motor', 'rider']
+
+    detector = pyyolov5.Detector.tensorrt(
+        engine_file_path, conf_thresh=CONF_THRESH, nms_thresh=IOU_THRESHOLD
+    )
+
+    input_image_paths = sys.argv[1:] or ["0.jpg"]
+    images = [cv2.imread(path) for path in input_image_paths]
+
+    # one call for all images, sources with the same canvas are batched together
+    results = detector.detect(images)
+    print("batches (n, h, w):", detector.last_batches)
+
+    for path, image_raw, dets in zip(input_image_paths, images, results):
+        for det in dets:
+            c1 = (int(det["x1"]), int(det["y1"]))
+            c2 = (int(det["x2"]), int(det["y2"]))
+            cv2.rectangle(image_raw, c1, c2, (0, 255, 0), 2, cv2.LINE_AA)
+            label = "{}:{:.2f}".format(categories[det["class_id"]], det["conf"])
+            cv2.putText(image_raw, label, (c1[0], c1[1] - 2), 0, 0.6, (225, 255, 255), 1, cv2.LINE_AA)
+        parent, filename = os.path.split(path)
+        cv2.imwrite(os.path.join(parent, "output_" + filename), image_raw)
@@ -84,8 +84,16 @@ class YoLov5TRT(object):
         cuda_outputs = []
         bindings = []
 
+        # Explicit batch engine with dynamic shapes: use profile 0 and a fixed 1x3xINPUT_HxINPUT_W input
+        context.active_optimization_profile = 0
+        context.set_binding_shape(0, (1, 3, INPUT_H, INPUT_W))
+
         for binding in engine:
-            size = trt.volume(engine.get_binding_shape(binding)) * engine.max_batch_size
+            index = engine.get_binding_index(binding)
+            # The other profiles have their own bindings, they are not used here
+            if index >= 2:
+                break
+            size = trt.volume(context.get_binding_shape(index))
             dtype = trt.nptype(engine.get_binding_dtype(binding))
             # Allocate host and device buffers
             host_mem = cuda.pagelocked_empty(size, dtype)
@@ -132,7 +140,7 @@ class YoLov5TRT(object):
         # Transfer input data  to the GPU.
         cuda.memcpy_htod_async(cuda_inputs[0], host_inputs[0], stream)
         # Run inference.
-        context.execute_async(bindings=bindings, stream_handle=stream.handle)
+        context.execute_async_v2(bindings=bindings, stream_handle=stream.handle)
         # Transfer predictions back from the GPU.
         cuda.memcpy_dtoh_async(host_outputs[0], cuda_outputs[0], stream)
         # Synchronize the stream